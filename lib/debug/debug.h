@@ -1,7 +1,11 @@
+#pragma once
+
+// Lines are sent as log frames once the log process exists, see src/diagnostics/log.h
+void log_printf(const char* format, ...);
 
 #define DEBUG 1
 #if DEBUG
-#define debug(x,t) printf(x,t)
+#define debug(x,t) log_printf(x,t)
 #else
 #define debug(x,t)
-#endif
\ No newline at end of file
+#endif
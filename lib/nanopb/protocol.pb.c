@@ -21,10 +21,34 @@ PB_BIND(protocol_Settings, protocol_Settings, AUTO)
 PB_BIND(protocol_BroadcastSequence, protocol_BroadcastSequence, AUTO)
 
 
-PB_BIND(protocol_State, protocol_State, AUTO)
+PB_BIND(protocol_SubsystemAllocations, protocol_SubsystemAllocations, AUTO)
+
+
+PB_BIND(protocol_TaskStack, protocol_TaskStack, AUTO)
+
+
+PB_BIND(protocol_LinkCounters, protocol_LinkCounters, AUTO)
+
+
+PB_BIND(protocol_LinkStats, protocol_LinkStats, AUTO)
+
+
+PB_BIND(protocol_Diagnostics, protocol_Diagnostics, 2)
+
+
+PB_BIND(protocol_State, protocol_State, 2)
+
+
+PB_BIND(protocol_Patch, protocol_Patch, AUTO)
+
+
+PB_BIND(protocol_Message, protocol_Message, 2)
+
+
+
+
 
 
-PB_BIND(protocol_Message, protocol_Message, AUTO)
 
 
 
@@ -27,14 +27,42 @@ typedef enum _protocol_LayerType {
     protocol_LayerType_SectionsWaveMask = 55, /* Required: sections, duration */
     protocol_LayerType_SectionsMask = 56, /* Required: sections, duration */
     protocol_LayerType_StarsMask = 57, /* Required: frequency, speed, length */
-    protocol_LayerType_WaveMask = 58 /* Required: length, gap, duration */
+    protocol_LayerType_WaveMask = 58, /* Required: length, gap, duration */
+    protocol_LayerType_SectionsRandomMask = 59 /* Required: sections, duration */
 } protocol_LayerType;
 
+/* Patchable layer parameters. Values match the field numbers of Layer. */
+typedef enum _protocol_LayerField {
+    protocol_LayerField_NoField = 0,
+    protocol_LayerField_DurationField = 2,
+    protocol_LayerField_LengthField = 3,
+    protocol_LayerField_ColorField = 4,
+    protocol_LayerField_GapField = 5,
+    protocol_LayerField_FrequencyField = 6,
+    protocol_LayerField_SpeedField = 7,
+    protocol_LayerField_ColorsField = 8, /* Element `index` of colors. index == length appends a color. */
+    protocol_LayerField_SectionsField = 9 /* Element `index` of sections. index == length appends a section. */
+} protocol_LayerField;
+
 typedef enum _protocol_Direction {
     protocol_Direction_FORWARD = 0,
     protocol_Direction_BACKWARD = 1
 } protocol_Direction;
 
+typedef enum _protocol_Subsystem {
+    protocol_Subsystem_Decoder = 0,
+    protocol_Subsystem_Scheduler = 1,
+    protocol_Subsystem_Layers = 2,
+    protocol_Subsystem_Radio = 3
+} protocol_Subsystem;
+
+typedef enum _protocol_Link {
+    protocol_Link_RadioLink = 0, /* nRF24L01 */
+    protocol_Link_ESPNowLink = 1,
+    protocol_Link_BluetoothLink = 2,
+    protocol_Link_SerialLink = 3
+} protocol_Link;
+
 /* Struct definitions */
 /* The request message containing the desired effect and brightness. */
 typedef struct _protocol_Layer {
@@ -47,6 +75,7 @@ typedef struct _protocol_Layer {
     uint32_t speed; /* Speed parameter for StarsMask */
     pb_callback_t colors; /* Multiple colors for Fade, SectionsWave, Sections, Switch */
     pb_callback_t sections; /* Section data for Blink, SectionsWave, Sections masks */
+    pb_callback_t color_indexes; /* Colors as indexes into the palette of the sequence, appended after colors */
 } protocol_Layer;
 
 /* The request message containing an array of effects. */
@@ -59,6 +88,7 @@ typedef struct _protocol_Animation {
 } protocol_Animation;
 
 typedef struct _protocol_Sequence {
+    pb_callback_t palette; /* Colors shared by the layers (0xRRGGBB). Must precede the animations. */
     pb_callback_t animations;
 } protocol_Sequence;
 
@@ -73,13 +103,71 @@ typedef struct _protocol_BroadcastSequence {
     pb_callback_t target_groups; /* Groups to execute this sequence on */
 } protocol_BroadcastSequence;
 
+typedef struct _protocol_SubsystemAllocations {
+    protocol_Subsystem subsystem;
+    uint32_t allocations; /* Number of allocations made since boot */
+    uint32_t frees; /* Number of allocations released since boot */
+    uint32_t live_bytes; /* Bytes currently held by the subsystem */
+    uint32_t peak_bytes; /* Highest number of bytes held at once */
+} protocol_SubsystemAllocations;
+
+typedef struct _protocol_TaskStack {
+    char name[16];
+    uint32_t free; /* Stack high-water mark: least free stack seen, in bytes */
+} protocol_TaskStack;
+
+typedef struct _protocol_LinkCounters {
+    uint32_t sent;
+    uint32_t received;
+    uint32_t retransmits; /* Auto-ack retries of the radio (ARC_CNT), and retries after failed sends or NACKs */
+    uint32_t lost; /* Packets never acknowledged (PLOS_CNT), or received but dropped before they were read */
+    uint32_t reassembly_timeouts; /* Messages dropped as fragments were missing */
+    uint32_t crc_errors; /* Packets or frames dropped as corrupt */
+    uint32_t decode_errors; /* Received messages that could not be decoded */
+} protocol_LinkCounters;
+
+typedef struct _protocol_LinkStats {
+    protocol_Link link;
+    bool has_total;
+    protocol_LinkCounters total; /* Since boot */
+    bool has_per_minute;
+    protocol_LinkCounters per_minute; /* Moving averages of the counters per minute */
+} protocol_LinkStats;
+
+typedef struct _protocol_Diagnostics {
+    uint32_t uptime; /* Milliseconds since boot */
+    uint32_t free_heap; /* Currently free heap in bytes */
+    uint32_t largest_free_block; /* Largest allocatable block in bytes */
+    uint32_t min_free_heap; /* Lowest free heap seen since boot in bytes */
+    pb_size_t stacks_count;
+    protocol_TaskStack stacks[4];
+    pb_size_t allocations_count;
+    protocol_SubsystemAllocations allocations[4];
+    uint32_t dedupe_hits; /* Received sequences skipped as they were already playing */
+    uint32_t dedupe_misses; /* Received sequences that were decoded */
+    pb_size_t links_count;
+    protocol_LinkStats links[4]; /* Packet counters of the transports in use */
+} protocol_Diagnostics;
+
 typedef struct _protocol_State {
     bool has_sequence;
     protocol_Sequence sequence; /* The current sequence set on the device */
     bool has_settings;
     protocol_Settings settings; /* The current settings of the device */
+    bool has_diagnostics;
+    protocol_Diagnostics diagnostics; /* Heap and stack telemetry, only set in responses */
 } protocol_State;
 
+/* Change a single parameter of a layer in the running sequence, without
+ restarting the animation. */
+typedef struct _protocol_Patch {
+    uint32_t animation; /* Index of the animation in the sequence */
+    uint32_t layer; /* Index of the layer in the animation */
+    protocol_LayerField field;
+    uint32_t value; /* New value of the field */
+    uint32_t index; /* Element index, only used for colors and sections */
+} protocol_Patch;
+
 typedef struct _protocol_Message {
     pb_callback_t cb_payload;
     pb_size_t which_payload;
@@ -89,6 +177,7 @@ typedef struct _protocol_Message {
         protocol_State save_state;
         bool request_state; /* Request the current sequence and settings from the device */
         protocol_State response_state; /* Response with the current sequence and settings from the device */
+        protocol_Patch patch; /* Change a parameter of the running sequence */
     } payload;
 } protocol_Message;
 
@@ -99,13 +188,25 @@ extern "C" {
 
 /* Helper constants for enums */
 #define _protocol_LayerType_MIN protocol_LayerType_SingleColor
-#define _protocol_LayerType_MAX protocol_LayerType_WaveMask
-#define _protocol_LayerType_ARRAYSIZE ((protocol_LayerType)(protocol_LayerType_WaveMask+1))
+#define _protocol_LayerType_MAX protocol_LayerType_SectionsRandomMask
+#define _protocol_LayerType_ARRAYSIZE ((protocol_LayerType)(protocol_LayerType_SectionsRandomMask+1))
+
+#define _protocol_LayerField_MIN protocol_LayerField_NoField
+#define _protocol_LayerField_MAX protocol_LayerField_SectionsField
+#define _protocol_LayerField_ARRAYSIZE ((protocol_LayerField)(protocol_LayerField_SectionsField+1))
 
 #define _protocol_Direction_MIN protocol_Direction_FORWARD
 #define _protocol_Direction_MAX protocol_Direction_BACKWARD
 #define _protocol_Direction_ARRAYSIZE ((protocol_Direction)(protocol_Direction_BACKWARD+1))
 
+#define _protocol_Subsystem_MIN protocol_Subsystem_Decoder
+#define _protocol_Subsystem_MAX protocol_Subsystem_Radio
+#define _protocol_Subsystem_ARRAYSIZE ((protocol_Subsystem)(protocol_Subsystem_Radio+1))
+
+#define _protocol_Link_MIN protocol_Link_RadioLink
+#define _protocol_Link_MAX protocol_Link_SerialLink
+#define _protocol_Link_ARRAYSIZE ((protocol_Link)(protocol_Link_SerialLink+1))
+
 #define protocol_Layer_type_ENUMTYPE protocol_LayerType
 
 #define protocol_Animation_direction_ENUMTYPE protocol_Direction
@@ -113,23 +214,44 @@ extern "C" {
 
 
 
+#define protocol_SubsystemAllocations_subsystem_ENUMTYPE protocol_Subsystem
+
+
+
+#define protocol_LinkStats_link_ENUMTYPE protocol_Link
+
+
+
+#define protocol_Patch_field_ENUMTYPE protocol_LayerField
 
 
 
 /* Initializer values for message structs */
-#define protocol_Layer_init_default              {_protocol_LayerType_MIN, 0, 0, 0, 0, 0, 0, {{NULL}, NULL}, {{NULL}, NULL}}
+#define protocol_Layer_init_default              {_protocol_LayerType_MIN, 0, 0, 0, 0, 0, 0, {{NULL}, NULL}, {{NULL}, NULL}, {{NULL}, NULL}}
 #define protocol_Animation_init_default          {_protocol_Direction_MIN, 0, 0, 0, {{NULL}, NULL}}
-#define protocol_Sequence_init_default           {{{NULL}, NULL}}
+#define protocol_Sequence_init_default           {{{NULL}, NULL}, {{NULL}, NULL}}
 #define protocol_Settings_init_default           {0, 0}
 #define protocol_BroadcastSequence_init_default  {false, protocol_Sequence_init_default, {{NULL}, NULL}}
-#define protocol_State_init_default              {false, protocol_Sequence_init_default, false, protocol_Settings_init_default}
+#define protocol_SubsystemAllocations_init_default {_protocol_Subsystem_MIN, 0, 0, 0, 0}
+#define protocol_TaskStack_init_default          {"", 0}
+#define protocol_LinkCounters_init_default       {0, 0, 0, 0, 0, 0, 0}
+#define protocol_LinkStats_init_default          {_protocol_Link_MIN, false, protocol_LinkCounters_init_default, false, protocol_LinkCounters_init_default}
+#define protocol_Diagnostics_init_default        {0, 0, 0, 0, 0, {protocol_TaskStack_init_default, protocol_TaskStack_init_default, protocol_TaskStack_init_default, protocol_TaskStack_init_default}, 0, {protocol_SubsystemAllocations_init_default, protocol_SubsystemAllocations_init_default, protocol_SubsystemAllocations_init_default, protocol_SubsystemAllocations_init_default}, 0, 0, 0, {protocol_LinkStats_init_default, protocol_LinkStats_init_default, protocol_LinkStats_init_default, protocol_LinkStats_init_default}}
+#define protocol_State_init_default              {false, protocol_Sequence_init_default, false, protocol_Settings_init_default, false, protocol_Diagnostics_init_default}
+#define protocol_Patch_init_default              {0, 0, _protocol_LayerField_MIN, 0, 0}
 #define protocol_Message_init_default            {{{NULL}, NULL}, 0, {protocol_Sequence_init_default}}
-#define protocol_Layer_init_zero                 {_protocol_LayerType_MIN, 0, 0, 0, 0, 0, 0, {{NULL}, NULL}, {{NULL}, NULL}}
+#define protocol_Layer_init_zero                 {_protocol_LayerType_MIN, 0, 0, 0, 0, 0, 0, {{NULL}, NULL}, {{NULL}, NULL}, {{NULL}, NULL}}
 #define protocol_Animation_init_zero             {_protocol_Direction_MIN, 0, 0, 0, {{NULL}, NULL}}
-#define protocol_Sequence_init_zero              {{{NULL}, NULL}}
+#define protocol_Sequence_init_zero              {{{NULL}, NULL}, {{NULL}, NULL}}
 #define protocol_Settings_init_zero              {0, 0}
 #define protocol_BroadcastSequence_init_zero     {false, protocol_Sequence_init_zero, {{NULL}, NULL}}
-#define protocol_State_init_zero                 {false, protocol_Sequence_init_zero, false, protocol_Settings_init_zero}
+#define protocol_SubsystemAllocations_init_zero  {_protocol_Subsystem_MIN, 0, 0, 0, 0}
+#define protocol_TaskStack_init_zero             {"", 0}
+#define protocol_LinkCounters_init_zero          {0, 0, 0, 0, 0, 0, 0}
+#define protocol_LinkStats_init_zero             {_protocol_Link_MIN, false, protocol_LinkCounters_init_zero, false, protocol_LinkCounters_init_zero}
+#define protocol_Diagnostics_init_zero           {0, 0, 0, 0, 0, {protocol_TaskStack_init_zero, protocol_TaskStack_init_zero, protocol_TaskStack_init_zero, protocol_TaskStack_init_zero}, 0, {protocol_SubsystemAllocations_init_zero, protocol_SubsystemAllocations_init_zero, protocol_SubsystemAllocations_init_zero, protocol_SubsystemAllocations_init_zero}, 0, 0, 0, {protocol_LinkStats_init_zero, protocol_LinkStats_init_zero, protocol_LinkStats_init_zero, protocol_LinkStats_init_zero}}
+#define protocol_State_init_zero                 {false, protocol_Sequence_init_zero, false, protocol_Settings_init_zero, false, protocol_Diagnostics_init_zero}
+#define protocol_Patch_init_zero                 {0, 0, _protocol_LayerField_MIN, 0, 0}
 #define protocol_Message_init_zero               {{{NULL}, NULL}, 0, {protocol_Sequence_init_zero}}
 
 /* Field tags (for use in manual encoding/decoding) */
@@ -142,23 +264,58 @@ extern "C" {
 #define protocol_Layer_speed_tag                 7
 #define protocol_Layer_colors_tag                8
 #define protocol_Layer_sections_tag              9
+#define protocol_Layer_color_indexes_tag         10
 #define protocol_Animation_direction_tag         1
 #define protocol_Animation_duration_tag          2
 #define protocol_Animation_first_tick_tag        3
 #define protocol_Animation_brightness_tag        4
 #define protocol_Animation_layers_tag            5
+#define protocol_Sequence_palette_tag            1
 #define protocol_Sequence_animations_tag         2
 #define protocol_Settings_group_id_tag           1
 #define protocol_Settings_virtual_offset_tag     2
 #define protocol_BroadcastSequence_sequence_tag  1
 #define protocol_BroadcastSequence_target_groups_tag 2
+#define protocol_SubsystemAllocations_subsystem_tag 1
+#define protocol_SubsystemAllocations_allocations_tag 2
+#define protocol_SubsystemAllocations_frees_tag  3
+#define protocol_SubsystemAllocations_live_bytes_tag 4
+#define protocol_SubsystemAllocations_peak_bytes_tag 5
+#define protocol_TaskStack_name_tag              1
+#define protocol_TaskStack_free_tag              2
+#define protocol_LinkCounters_sent_tag           1
+#define protocol_LinkCounters_received_tag       2
+#define protocol_LinkCounters_retransmits_tag    3
+#define protocol_LinkCounters_lost_tag           4
+#define protocol_LinkCounters_reassembly_timeouts_tag 5
+#define protocol_LinkCounters_crc_errors_tag     6
+#define protocol_LinkCounters_decode_errors_tag  7
+#define protocol_LinkStats_link_tag              1
+#define protocol_LinkStats_total_tag             2
+#define protocol_LinkStats_per_minute_tag        3
+#define protocol_Diagnostics_uptime_tag          1
+#define protocol_Diagnostics_free_heap_tag       2
+#define protocol_Diagnostics_largest_free_block_tag 3
+#define protocol_Diagnostics_min_free_heap_tag   4
+#define protocol_Diagnostics_stacks_tag          5
+#define protocol_Diagnostics_allocations_tag     6
+#define protocol_Diagnostics_dedupe_hits_tag     7
+#define protocol_Diagnostics_dedupe_misses_tag   8
+#define protocol_Diagnostics_links_tag           9
 #define protocol_State_sequence_tag              1
 #define protocol_State_settings_tag              2
+#define protocol_State_diagnostics_tag           3
+#define protocol_Patch_animation_tag             1
+#define protocol_Patch_layer_tag                 2
+#define protocol_Patch_field_tag                 3
+#define protocol_Patch_value_tag                 4
+#define protocol_Patch_index_tag                 5
 #define protocol_Message_sequence_tag            1
 #define protocol_Message_broadcast_sequence_tag  2
 #define protocol_Message_save_state_tag          3
 #define protocol_Message_request_state_tag       4
 #define protocol_Message_response_state_tag      5
+#define protocol_Message_patch_tag               6
 
 /* Struct field encoding specification for nanopb */
 #define protocol_Layer_FIELDLIST(X, a) \
@@ -170,7 +327,8 @@ X(a, STATIC,   SINGULAR, UINT32,   gap,               5) \
 X(a, STATIC,   SINGULAR, UINT32,   frequency,         6) \
 X(a, STATIC,   SINGULAR, UINT32,   speed,             7) \
 X(a, CALLBACK, REPEATED, UINT32,   colors,            8) \
-X(a, CALLBACK, SINGULAR, BYTES,    sections,          9)
+X(a, CALLBACK, SINGULAR, BYTES,    sections,          9) \
+X(a, CALLBACK, SINGULAR, BYTES,    color_indexes,    10)
 #define protocol_Layer_CALLBACK pb_default_field_callback
 #define protocol_Layer_DEFAULT NULL
 
@@ -185,6 +343,7 @@ X(a, CALLBACK, REPEATED, MESSAGE,  layers,            5)
 #define protocol_Animation_layers_MSGTYPE protocol_Layer
 
 #define protocol_Sequence_FIELDLIST(X, a) \
+X(a, CALLBACK, REPEATED, UINT32,   palette,           1) \
 X(a, CALLBACK, REPEATED, MESSAGE,  animations,        2)
 #define protocol_Sequence_CALLBACK pb_default_field_callback
 #define protocol_Sequence_DEFAULT NULL
@@ -203,33 +362,103 @@ X(a, CALLBACK, REPEATED, UINT32,   target_groups,     2)
 #define protocol_BroadcastSequence_DEFAULT NULL
 #define protocol_BroadcastSequence_sequence_MSGTYPE protocol_Sequence
 
+#define protocol_SubsystemAllocations_FIELDLIST(X, a) \
+X(a, STATIC,   SINGULAR, UENUM,    subsystem,         1) \
+X(a, STATIC,   SINGULAR, UINT32,   allocations,       2) \
+X(a, STATIC,   SINGULAR, UINT32,   frees,             3) \
+X(a, STATIC,   SINGULAR, UINT32,   live_bytes,        4) \
+X(a, STATIC,   SINGULAR, UINT32,   peak_bytes,        5)
+#define protocol_SubsystemAllocations_CALLBACK NULL
+#define protocol_SubsystemAllocations_DEFAULT NULL
+
+#define protocol_TaskStack_FIELDLIST(X, a) \
+X(a, STATIC,   SINGULAR, STRING,   name,              1) \
+X(a, STATIC,   SINGULAR, UINT32,   free,              2)
+#define protocol_TaskStack_CALLBACK NULL
+#define protocol_TaskStack_DEFAULT NULL
+
+#define protocol_LinkCounters_FIELDLIST(X, a) \
+X(a, STATIC,   SINGULAR, UINT32,   sent,              1) \
+X(a, STATIC,   SINGULAR, UINT32,   received,          2) \
+X(a, STATIC,   SINGULAR, UINT32,   retransmits,       3) \
+X(a, STATIC,   SINGULAR, UINT32,   lost,              4) \
+X(a, STATIC,   SINGULAR, UINT32,   reassembly_timeouts,   5) \
+X(a, STATIC,   SINGULAR, UINT32,   crc_errors,        6) \
+X(a, STATIC,   SINGULAR, UINT32,   decode_errors,     7)
+#define protocol_LinkCounters_CALLBACK NULL
+#define protocol_LinkCounters_DEFAULT NULL
+
+#define protocol_LinkStats_FIELDLIST(X, a) \
+X(a, STATIC,   SINGULAR, UENUM,    link,              1) \
+X(a, STATIC,   OPTIONAL, MESSAGE,  total,             2) \
+X(a, STATIC,   OPTIONAL, MESSAGE,  per_minute,        3)
+#define protocol_LinkStats_CALLBACK NULL
+#define protocol_LinkStats_DEFAULT NULL
+#define protocol_LinkStats_total_MSGTYPE protocol_LinkCounters
+#define protocol_LinkStats_per_minute_MSGTYPE protocol_LinkCounters
+
+#define protocol_Diagnostics_FIELDLIST(X, a) \
+X(a, STATIC,   SINGULAR, UINT32,   uptime,            1) \
+X(a, STATIC,   SINGULAR, UINT32,   free_heap,         2) \
+X(a, STATIC,   SINGULAR, UINT32,   largest_free_block,   3) \
+X(a, STATIC,   SINGULAR, UINT32,   min_free_heap,     4) \
+X(a, STATIC,   REPEATED, MESSAGE,  stacks,            5) \
+X(a, STATIC,   REPEATED, MESSAGE,  allocations,       6) \
+X(a, STATIC,   SINGULAR, UINT32,   dedupe_hits,       7) \
+X(a, STATIC,   SINGULAR, UINT32,   dedupe_misses,     8) \
+X(a, STATIC,   REPEATED, MESSAGE,  links,             9)
+#define protocol_Diagnostics_CALLBACK NULL
+#define protocol_Diagnostics_DEFAULT NULL
+#define protocol_Diagnostics_stacks_MSGTYPE protocol_TaskStack
+#define protocol_Diagnostics_allocations_MSGTYPE protocol_SubsystemAllocations
+#define protocol_Diagnostics_links_MSGTYPE protocol_LinkStats
+
 #define protocol_State_FIELDLIST(X, a) \
 X(a, STATIC,   OPTIONAL, MESSAGE,  sequence,          1) \
-X(a, STATIC,   OPTIONAL, MESSAGE,  settings,          2)
+X(a, STATIC,   OPTIONAL, MESSAGE,  settings,          2) \
+X(a, STATIC,   OPTIONAL, MESSAGE,  diagnostics,       3)
 #define protocol_State_CALLBACK NULL
 #define protocol_State_DEFAULT NULL
 #define protocol_State_sequence_MSGTYPE protocol_Sequence
 #define protocol_State_settings_MSGTYPE protocol_Settings
+#define protocol_State_diagnostics_MSGTYPE protocol_Diagnostics
+
+#define protocol_Patch_FIELDLIST(X, a) \
+X(a, STATIC,   SINGULAR, UINT32,   animation,         1) \
+X(a, STATIC,   SINGULAR, UINT32,   layer,             2) \
+X(a, STATIC,   SINGULAR, UENUM,    field,             3) \
+X(a, STATIC,   SINGULAR, UINT32,   value,             4) \
+X(a, STATIC,   SINGULAR, UINT32,   index,             5)
+#define protocol_Patch_CALLBACK NULL
+#define protocol_Patch_DEFAULT NULL
 
 #define protocol_Message_FIELDLIST(X, a) \
 X(a, STATIC,   ONEOF,    MSG_W_CB, (payload,sequence,payload.sequence),   1) \
 X(a, STATIC,   ONEOF,    MSG_W_CB, (payload,broadcast_sequence,payload.broadcast_sequence),   2) \
 X(a, STATIC,   ONEOF,    MSG_W_CB, (payload,save_state,payload.save_state),   3) \
 X(a, STATIC,   ONEOF,    BOOL,     (payload,request_state,payload.request_state),   4) \
-X(a, STATIC,   ONEOF,    MSG_W_CB, (payload,response_state,payload.response_state),   5)
+X(a, STATIC,   ONEOF,    MSG_W_CB, (payload,response_state,payload.response_state),   5) \
+X(a, STATIC,   ONEOF,    MSG_W_CB, (payload,patch,payload.patch),   6)
 #define protocol_Message_CALLBACK NULL
 #define protocol_Message_DEFAULT NULL
 #define protocol_Message_payload_sequence_MSGTYPE protocol_Sequence
 #define protocol_Message_payload_broadcast_sequence_MSGTYPE protocol_BroadcastSequence
 #define protocol_Message_payload_save_state_MSGTYPE protocol_State
 #define protocol_Message_payload_response_state_MSGTYPE protocol_State
+#define protocol_Message_payload_patch_MSGTYPE protocol_Patch
 
 extern const pb_msgdesc_t protocol_Layer_msg;
 extern const pb_msgdesc_t protocol_Animation_msg;
 extern const pb_msgdesc_t protocol_Sequence_msg;
 extern const pb_msgdesc_t protocol_Settings_msg;
 extern const pb_msgdesc_t protocol_BroadcastSequence_msg;
+extern const pb_msgdesc_t protocol_SubsystemAllocations_msg;
+extern const pb_msgdesc_t protocol_TaskStack_msg;
+extern const pb_msgdesc_t protocol_LinkCounters_msg;
+extern const pb_msgdesc_t protocol_LinkStats_msg;
+extern const pb_msgdesc_t protocol_Diagnostics_msg;
 extern const pb_msgdesc_t protocol_State_msg;
+extern const pb_msgdesc_t protocol_Patch_msg;
 extern const pb_msgdesc_t protocol_Message_msg;
 
 /* Defines for backwards compatibility with code written before nanopb-0.4.0 */
@@ -238,7 +467,13 @@ extern const pb_msgdesc_t protocol_Message_msg;
 #define protocol_Sequence_fields &protocol_Sequence_msg
 #define protocol_Settings_fields &protocol_Settings_msg
 #define protocol_BroadcastSequence_fields &protocol_BroadcastSequence_msg
+#define protocol_SubsystemAllocations_fields &protocol_SubsystemAllocations_msg
+#define protocol_TaskStack_fields &protocol_TaskStack_msg
+#define protocol_LinkCounters_fields &protocol_LinkCounters_msg
+#define protocol_LinkStats_fields &protocol_LinkStats_msg
+#define protocol_Diagnostics_fields &protocol_Diagnostics_msg
 #define protocol_State_fields &protocol_State_msg
+#define protocol_Patch_fields &protocol_Patch_msg
 #define protocol_Message_fields &protocol_Message_msg
 
 /* Maximum encoded size of messages (where known) */
@@ -248,8 +483,14 @@ extern const pb_msgdesc_t protocol_Message_msg;
 /* protocol_BroadcastSequence_size depends on runtime parameters */
 /* protocol_State_size depends on runtime parameters */
 /* protocol_Message_size depends on runtime parameters */
-#define PROTOCOL_PROTOCOL_PB_H_MAX_SIZE          protocol_Settings_size
+#define PROTOCOL_PROTOCOL_PB_H_MAX_SIZE          protocol_Diagnostics_size
+#define protocol_Diagnostics_size                616
+#define protocol_LinkCounters_size               42
+#define protocol_LinkStats_size                  90
+#define protocol_Patch_size                      26
 #define protocol_Settings_size                   12
+#define protocol_SubsystemAllocations_size       26
+#define protocol_TaskStack_size                  23
 
 #ifdef __cplusplus
 } /* extern "C" */
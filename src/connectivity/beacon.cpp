@@ -0,0 +1,196 @@
+#include "beacon.h"
+
+static inline u16_t read_u16(const u8_t* data) {
+  return data[0] | data[1] << 8;
+}
+
+static inline u32_t read_u32(const u8_t* data) {
+  return data[0] | data[1] << 8 | data[2] << 16 | (u32_t)data[3] << 24;
+}
+
+static inline void write_u16(u8_t* data, u16_t value) {
+  data[0] = value & 0xFF;
+  data[1] = value >> 8;
+}
+
+static inline void write_u32(u8_t* data, u32_t value) {
+  data[0] = value & 0xFF;
+  data[1] = (value >> 8) & 0xFF;
+  data[2] = (value >> 16) & 0xFF;
+  data[3] = value >> 24;
+}
+
+/**
+ * @brief Construct a new Sequence Beacon object
+ *
+ * @param scheduler The scheduler whose position is sent, or followed
+ * @param role Whether this controller sends the beacons, or follows them
+ * @param send Sends a frame on the transport, e.g. ESP-NOW or a relay
+ */
+SequenceBeacon::SequenceBeacon(SequenceScheduler* scheduler, BeaconRole role, BeaconSend send) {
+  this->scheduler = scheduler;
+  this->role = role;
+  this->send = send;
+}
+
+String SequenceBeacon::getName() {
+  return "Sequence Beacon";
+}
+
+bool SequenceBeacon::isBeaconFrame(const u8_t* data, size_t length) {
+  return 0 < length && data[0] == BEACON_FRAME_MAGIC;
+}
+
+/**
+ * @brief Set the callback of the gateway that sends the whole sequence, once it was requested
+ *
+ * @param callback Sends the encoded sequence kept with keep, e.g. wrapped in a sequence message
+ */
+void SequenceBeacon::setOnSequenceRequested(OnSequenceRequested callback) {
+  onSequenceRequested = callback;
+}
+
+/**
+ * @brief Keep the encoded sequence the gateway received, to resend it when it is requested. Only
+ * the gateway keeps it.
+ *
+ * @param sequence The encoded sequence, see MessageDecoder::getSequenceData
+ * @param length Length of the encoded sequence
+ * @param hash The hash of the encoded sequence, as passed to SequenceScheduler::set
+ */
+void SequenceBeacon::keep(const u8_t* sequence, size_t length, u32_t hash) {
+  if (role != BeaconRole::GATEWAY) return;
+
+  this->sequence.assign(sequence, sequence + length);
+  sequenceHash = hash;
+}
+
+BeaconStats SequenceBeacon::getStats() {
+  return stats;
+}
+
+bool SequenceBeacon::sendFrame(BeaconFrameType type, u32_t hash, u16_t animation, u16_t tick) {
+  u8_t frame[BEACON_FRAME_SIZE];
+  frame[0] = BEACON_FRAME_MAGIC;
+  frame[1] = type;
+  write_u32(frame + 2, hash);
+  write_u16(frame + 6, animation);
+  write_u16(frame + 8, tick);
+  return send(frame, BEACON_FRAME_SIZE);
+}
+
+/**
+ * @brief Handle a received beacon frame
+ *
+ * @param frame The received frame
+ * @param length Length of the frame
+ * @return false if the frame is malformed
+ */
+bool SequenceBeacon::receive(const u8_t* frame, size_t length) {
+  if (length != BEACON_FRAME_SIZE || !isBeaconFrame(frame, length)) {
+    stats.invalid++;
+    return false;
+  }
+
+  u32_t hash = read_u32(frame + 2);
+  switch (frame[1]) {
+    case BEACON_POSITION:
+      receivePosition(hash, read_u16(frame + 6), read_u16(frame + 8));
+      return true;
+    case BEACON_REQUEST:
+      receiveRequest(hash);
+      return true;
+  }
+
+  stats.invalid++;
+  return false;
+}
+
+/**
+ * @brief Follow the position of the gateway if the sequence matches, and otherwise schedule a
+ * request for it after a random backoff
+ */
+void SequenceBeacon::receivePosition(u32_t hash, u16_t animation, u16_t tick) {
+  if (role != BeaconRole::RECEIVER || hash == 0) return;
+
+  stats.received++;
+  if (scheduler->isPaused()) return; // Another source controls the animator
+
+  if (hash == scheduler->getHash()) {
+    requestedHash = 0;
+
+    s32_t difference = (s32_t)tick - scheduler->getTick();
+    if (animation == scheduler->getAnimationIndex() && -BEACON_TICK_TOLERANCE <= difference && difference <= BEACON_TICK_TOLERANCE) return;
+
+    if (!scheduler->seek(animation, tick)) {
+      stats.invalid++;
+      return;
+    }
+    stats.synced++;
+    return;
+  }
+
+  stats.mismatches++;
+  if (requestedHash == hash) return; // Already pending
+  if (requested && millis() - lastRequestAt < BEACON_REQUEST_INTERVAL) return;
+
+  requestedHash = hash;
+  dueAt = millis() + random(BEACON_REQUEST_JITTER + 1);
+}
+
+/**
+ * @brief The gateway collects requests for its sequence into a single resend. A receiver that hears
+ * another receiver request the sequence it wants drops its own request.
+ */
+void SequenceBeacon::receiveRequest(u32_t hash) {
+  if (role == BeaconRole::RECEIVER) {
+    if (requestedHash == 0 || requestedHash != hash) return;
+
+    stats.suppressed++;
+    requestedHash = 0;
+    requested = true;
+    lastRequestAt = millis();
+    return;
+  }
+
+  if (hash == 0 || hash != scheduler->getHash() || requestedHash != 0) return;
+  if (requested && millis() - lastRequestAt < BEACON_RESEND_INTERVAL) return;
+
+  requestedHash = hash;
+  dueAt = millis() + BEACON_RESEND_WINDOW;
+}
+
+/**
+ * @brief Send the beacon when it is due, and the pending request or resend
+ */
+void SequenceBeacon::update() {
+  u32_t now = millis();
+
+  if (requestedHash != 0 && (s32_t)(now - dueAt) >= 0) {
+    // The sequence may have changed, or arrived, while the request was pending. Only the bytes
+    // the hash was taken over are resent.
+    if (role == BeaconRole::GATEWAY && requestedHash == scheduler->getHash() && requestedHash == sequenceHash && onSequenceRequested != nullptr) {
+      onSequenceRequested(sequence.data(), sequence.size());
+      stats.resends++;
+      lastBeaconAt = now - BEACON_INTERVAL; // Follows the sequence, such that the receivers start at the position
+    }
+    else if (role == BeaconRole::RECEIVER && requestedHash != scheduler->getHash() && sendFrame(BEACON_REQUEST, requestedHash, 0, 0)) {
+      stats.requests++;
+    }
+
+    requestedHash = 0;
+    requested = true;
+    lastRequestAt = now;
+  }
+
+  if (role != BeaconRole::GATEWAY || now - lastBeaconAt < BEACON_INTERVAL) return;
+
+  // The position does not move while another source controls the animator
+  u32_t hash = scheduler->getHash();
+  if (hash == 0 || scheduler->isPaused()) return;
+
+  lastBeaconAt = now;
+  if (sendFrame(BEACON_POSITION, hash, scheduler->getAnimationIndex(), scheduler->getTick())) {
+    stats.sent++;
+  }
+}
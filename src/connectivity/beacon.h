@@ -0,0 +1,96 @@
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+#include "../leds/sequence_scheduler.h"
+#include "../scheduler/scheduler.h"
+
+#define BEACON_FRAME_MAGIC 0xF6   // Wire type 6, like RELAY_FRAME_MAGIC, so it is never a Message
+#define BEACON_FRAME_SIZE 10
+#define BEACON_INTERVAL 1000      // ms between beacons of the gateway
+#define BEACON_TICK_TOLERANCE 2   // Ticks a receiver may be off before it jumps to the position of the gateway
+#define BEACON_REQUEST_JITTER 50  // ms. Receivers wait a random time up to this before requesting the sequence, such that one request answers all.
+#define BEACON_REQUEST_INTERVAL 3000 // ms between two requests of a receiver, while the sequence is on its way
+#define BEACON_RESEND_WINDOW 100  // ms the gateway collects requests, before it sends the sequence once
+#define BEACON_RESEND_INTERVAL 2000 // ms between two resends of the gateway
+
+enum class BeaconRole {
+  GATEWAY,  // Sends beacons of its sequence, and resends the sequence when it is requested
+  RECEIVER, // Follows the beacons, and requests the sequence if it has another one
+};
+
+enum BeaconFrameType : u8_t {
+  BEACON_POSITION = 0, // The sequence hash, animation and tick of the gateway
+  BEACON_REQUEST = 1,  // A receiver asks for the sequence with the hash
+};
+
+typedef bool (*BeaconSend)(const u8_t* frame, size_t length);
+typedef void (*OnSequenceRequested)(const u8_t* sequence, size_t length);
+
+/**
+ * @brief Counters of a sequence beacon.
+ */
+struct BeaconStats {
+  u32_t sent;       // Beacons sent by the gateway
+  u32_t received;   // Beacons received
+  u32_t synced;     // Times the receiver jumped to the position of the gateway
+  u32_t mismatches; // Beacons of a sequence the receiver does not have
+  u32_t requests;   // Requests sent by the receiver
+  u32_t suppressed; // Requests not sent, as another receiver requested the same sequence
+  u32_t resends;    // Times the gateway resent its sequence
+  u32_t invalid;    // Frames that were malformed, or pointed outside the sequence
+};
+
+/**
+ * @brief Keeps the controllers of a show on the same sequence without resending it periodically.
+ *
+ * The gateway sends a beacon of BEACON_FRAME_SIZE bytes every BEACON_INTERVAL, rather than the
+ * whole sequence:
+ *
+ * Byte 0: BEACON_FRAME_MAGIC
+ * Byte 1: BeaconFrameType
+ * Byte 2-5: Hash of the encoded sequence, see MessageDecoder::getSequenceHash, little-endian
+ * Byte 6-7: Index of the current animation, little-endian
+ * Byte 8-9: Tick of the current animation, little-endian
+ *
+ * A receiver with the same hash jumps to the position if it is off by more than
+ * BEACON_TICK_TOLERANCE. A receiver with another sequence, e.g. after a reboot, requests the sequence
+ * after a random backoff, unless another receiver requests it first. The gateway collects requests
+ * for BEACON_RESEND_WINDOW, then resends the sequence once, and sends a beacon right after it, such
+ * that the receivers start at the position of the gateway. No beacons are sent while the sequence of
+ * the gateway has no hash, e.g. after a patch.
+ *
+ * The gateway resends the encoded sequence exactly as it received it, see keep. Encoding the
+ * decoded sequence again need not give the same bytes, e.g. with another palette or field order,
+ * and receivers would then never match the hash of the beacons.
+ */
+class SequenceBeacon : public Process {
+  SequenceScheduler* scheduler;
+  BeaconRole role;
+  BeaconSend send;
+  OnSequenceRequested onSequenceRequested = nullptr;
+  std::vector<u8_t> sequence; // The encoded sequence of the gateway, as it was received
+  u32_t sequenceHash = 0;     // Hash of sequence, or 0 if none is kept
+  u32_t lastBeaconAt = 0;
+  u32_t requestedHash = 0; // Hash of the sequence a request or resend is pending for, or 0
+  u32_t dueAt = 0;         // When the pending request or resend is sent
+  u32_t lastRequestAt = 0;
+  bool requested = false;  // Whether a request or resend was made before, such that lastRequestAt is valid
+  BeaconStats stats = {};
+
+  bool sendFrame(BeaconFrameType type, u32_t hash, u16_t animation, u16_t tick);
+  void receivePosition(u32_t hash, u16_t animation, u16_t tick);
+  void receiveRequest(u32_t hash);
+
+  public:
+  SequenceBeacon(SequenceScheduler* scheduler, BeaconRole role, BeaconSend send);
+
+  static bool isBeaconFrame(const u8_t* data, size_t length);
+  bool receive(const u8_t* frame, size_t length);
+  void keep(const u8_t* sequence, size_t length, u32_t hash);
+  void setOnSequenceRequested(OnSequenceRequested callback);
+  BeaconStats getStats();
+
+  String getName() override;
+  void update() override;
+};
@@ -1,5 +1,6 @@
 #include "bluetooth.h"
 #include "debug.h"
+#include "packet_ring.h"
 
 // UUIDs for service and characteristics
 #define SERVICE_UUID        "b2085082-e29b-4d4e-b868-f782458dec9a"
@@ -17,6 +18,9 @@ enum BluetoothState {
 };
 
 BluetoothState bluetoothServiceState = BluetoothState::UNINITIALIZED;
+// Written by the BLE task, read by the main loop
+PacketRing<BLE_RX_SLOTS, BLE_CHUNK_SIZE> bluetoothReceived;
+BluetoothStats bluetoothStats = {};
 
 class MyServerCallbacks: public BLEServerCallbacks {
     void onConnect(BLEServer* pServer) {
@@ -31,14 +35,36 @@ class MyServerCallbacks: public BLEServerCallbacks {
 };
 
 class MyCallbacks: public BLECharacteristicCallbacks {
+    /**
+     * @brief Queue the written bytes for the main loop. Runs in the BLE task, so nothing is decoded here.
+     */
     void onWrite(BLECharacteristic *pCharacteristic) {
-      std::string rxValue = pCharacteristic->getValue();
-      printf("%s\n",rxValue.c_str());
-      printf("%i\n",rxValue.length());
+      const uint8_t* data = pCharacteristic->getData();
+      size_t length = pCharacteristic->getLength();
+      bluetoothStats.writes++;
+      bluetoothStats.bytes += length;
+
+      // Writes up to the MTU span several slots. A write is queued whole or dropped whole.
+      size_t slots = (length + BLE_CHUNK_SIZE - 1) / BLE_CHUNK_SIZE;
+      if (BLE_RX_SLOTS - bluetoothReceived.size() < slots) {
+        bluetoothReceived.drop();
+        return;
+      }
+
+      for (size_t offset = 0; offset < length; offset += BLE_CHUNK_SIZE) {
+        size_t size = length - offset < BLE_CHUNK_SIZE ? length - offset : BLE_CHUNK_SIZE;
+        memcpy(bluetoothReceived.claim(), data + offset, size);
+        bluetoothReceived.commit(size);
+      }
     }
 };
 
-BluetoothService::BluetoothService() {
+/**
+ * @brief Construct a new Bluetooth Service object, and start advertising
+ *
+ * @param maxPacketSize The largest packet that can be received
+ */
+BluetoothService::BluetoothService(size_t maxPacketSize) : decoder(maxPacketSize) {
   // Create the BLE Device
   BLEDevice::init("ESP32-C3-BLE");
 
@@ -58,7 +84,7 @@ BluetoothService::BluetoothService() {
 
   pRxCharacteristic = pService->createCharacteristic(
                     CHARACTERISTIC_UUID_RX,
-                    BLECharacteristic::PROPERTY_WRITE
+                    BLECharacteristic::PROPERTY_WRITE | BLECharacteristic::PROPERTY_WRITE_NR
                   );
 
   pRxCharacteristic->setCallbacks(new MyCallbacks());
@@ -77,28 +103,38 @@ BluetoothService::BluetoothService() {
   pAdvertising->setMinPreferred(0x0);
   
   BLEDevice::startAdvertising();
-  printf("Waiting for a client connection to notify...\n");
+  log_printf("Waiting for a client connection to notify...\n");
 };
 
+/**
+ * @brief Reassemble and deliver the frames written since the last update, and advertise again after
+ * a disconnect
+ */
 void BluetoothService::update() {
+  u8_t length;
+  const u8_t* chunk;
+  while ((chunk = bluetoothReceived.peek(&length)) != nullptr) {
+    decoder.push(chunk, length);
+    bluetoothReceived.pop();
+  }
+
   // Handle disconnection
   if (bluetoothServiceState == BluetoothState::DISCONNECTED) {
+    // Drop a frame that was cut off, rather than joining it with the first frame of the next client
+    uint8_t delimiter = FRAME_DELIMITER;
+    decoder.push(&delimiter, 1);
+
     pServer->startAdvertising(); // Restart advertising
-    bluetoothServiceState == BluetoothState::ADVERTISING;
-    printf("Start advertising\n");
+    bluetoothServiceState = BluetoothState::ADVERTISING;
+    log_printf("Start advertising\n");
   }
 }
 
 void BluetoothService::send(uint8_t* data, size_t length) {
-  printf("Sending data: ");
-  for (size_t i = 0; i < length; i++) {
-    printf("%02x ", data[i]);
-  }
-  printf("\n");
-  printf("state: %d\n", bluetoothServiceState);
     if (bluetoothServiceState == BluetoothState::CONNECTED) {
         pTxCharacteristic->setValue(data, length);
         pTxCharacteristic->notify();
+        bluetoothStats.notifications++;
     }
 }
 
@@ -106,6 +142,85 @@ void BluetoothService::setOnReceive(BLECharacteristicCallbacks* callbacks) {
   pRxCharacteristic->setCallbacks(callbacks);
 }
 
+/**
+ * @brief Set the callback receiving complete packets. It is called from update(), in the main loop.
+ * The data is only valid during the callback.
+ *
+ * @param callback The function to call with each complete packet
+ */
+void BluetoothService::onData(OnFrame callback) {
+  decoder.onFrame(callback);
+}
+
+BluetoothStats BluetoothService::getStats() {
+  BluetoothStats stats = bluetoothStats;
+  stats.dropped = bluetoothReceived.getDrops();
+  return stats;
+}
+
+/**
+ * @brief Get the frame counters, including CRC and framing errors
+ *
+ * @return FrameStats
+ */
+FrameStats BluetoothService::getFrameStats() {
+  return decoder.getStats();
+}
+
+/**
+ * @brief Get the counters of BLE as a link. Packets are counted as frames, as a frame may span any
+ * number of writes.
+ */
+LinkCounters BluetoothService::getLinkCounters() {
+  FrameStats frames = decoder.getStats();
+
+  LinkCounters link = {};
+  link.sent = bluetoothStats.notifications;
+  link.received = frames.frames;
+  link.lost = bluetoothReceived.getDrops() + frames.overflows;
+  link.crcErrors = frames.crcErrors + frames.framingErrors;
+  return link;
+}
+
 String BluetoothService::getName() {
   return "Bluetooth Service";
 }
+
+
+/**
+ * @brief Construct a new Bluetooth Stream object
+ *
+ * @param service The service to send notifications with
+ */
+BluetoothStream::BluetoothStream(BluetoothService* service) : service(service) {}
+
+/**
+ * @brief Payload size of a notification: the negotiated MTU minus the 3 byte ATT header
+ */
+size_t BluetoothStream::chunkSize() {
+  if (bluetoothServiceState != BluetoothState::CONNECTED) return BLE_CHUNK_SIZE;
+
+  size_t mtu = pServer->getPeerMTU(pServer->getConnId());
+  if (mtu < 23) return 20; // Default MTU before negotiation
+  if (BLE_CHUNK_SIZE < mtu - 3) return BLE_CHUNK_SIZE;
+  return mtu - 3;
+}
+
+size_t BluetoothStream::write(uint8_t byte) {
+  return write(&byte, 1);
+}
+
+size_t BluetoothStream::write(const uint8_t* data, size_t size) {
+  size_t limit = chunkSize();
+  for (size_t i = 0; i < size; i++) {
+    chunk[length++] = data[i];
+    if (limit <= length) flush();
+  }
+  return size;
+}
+
+void BluetoothStream::flush() {
+  if (length == 0) return;
+  service->send(chunk, length);
+  length = 0;
+}
\ No newline at end of file
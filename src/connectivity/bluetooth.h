@@ -5,13 +5,63 @@
 #include <BLEUtils.h>
 #include <BLE2902.h>
 #include "../scheduler/scheduler.h"
+#include "framing.h"
+#include "../diagnostics/link_monitor.h"
+
+// Largest notification payload. Notifications are also limited by the negotiated MTU.
+#define BLE_CHUNK_SIZE 244
+// Written chunks queued for the main loop, i.e. about 4 KB, or a few frames of the largest packet
+#define BLE_RX_SLOTS 16
+
+/**
+ * @brief Counters of the BLE receive path.
+ */
+struct BluetoothStats {
+    u32_t writes;        // Writes to the RX characteristic
+    u32_t bytes;         // Bytes written
+    u32_t dropped;       // Writes dropped as the queue was full. The frame they were part of fails its CRC.
+    u32_t notifications; // Notifications sent
+};
+
+/**
+ * @brief Receives packets written to the RX characteristic, and sends responses as notifications.
+ *
+ * Packets are framed like on serial, see Framing, and may be split over any number of writes, with
+ * or without response. The BLE task only copies each write into a queue. The main loop drains the
+ * queue in update(), reassembles the frames and hands complete packets to the data callback, such
+ * that packets are decoded outside the BLE stack.
+ */
+class BluetoothService : public Process, public LinkSource {
+    FrameDecoder decoder;
 
-class BluetoothService : public Process {
 public:
-    BluetoothService();
+    BluetoothService(size_t maxPacketSize = 1024);
     void send(uint8_t* data, size_t length);
     void setOnReceive(BLECharacteristicCallbacks* callbacks);
+    void onData(OnFrame callback);
+    BluetoothStats getStats();
+    FrameStats getFrameStats();
+    LinkCounters getLinkCounters() override;
 
     String getName() override;
     void update() override;
 };
+
+/**
+ * @brief Sends everything written to it as notifications of at most one MTU. Only a single chunk
+ * is buffered, so large responses can be streamed. Call flush() to send the last chunk.
+ */
+class BluetoothStream : public Print {
+    BluetoothService* service;
+    uint8_t chunk[BLE_CHUNK_SIZE];
+    size_t length = 0;
+
+    size_t chunkSize();
+
+public:
+    BluetoothStream(BluetoothService* service);
+
+    size_t write(uint8_t byte) override;
+    size_t write(const uint8_t* data, size_t size) override;
+    void flush() override;
+};
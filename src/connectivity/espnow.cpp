@@ -1,21 +1,27 @@
 #include "espnow.h"
+#include "../diagnostics/telemetry.h"
 
 // Address for broadcasting
 uint8_t global_mac[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
 
+ESPNetwork* ESPNetwork::instance = nullptr;
+
 /**
  * @brief Construct a new ESPNow object
- * 
- * @param address Must be of length 5
- * @param payload Allows for a custom payload to be set. This is useful for setting the data array to a custom size.
+ *
+ * @param mode Whether the device receives or sends messages
+ * @param maxMessageSize Largest message that can be sent and received
  */
-ESPNetwork::ESPNetwork(ConnectivityMode mode) {
+ESPNetwork::ESPNetwork(ConnectivityMode mode, size_t maxMessageSize)
+    : sender(ESPNOW_MTU, maxMessageSize), reassembler(ESPNOW_MTU, maxMessageSize, false) {
     this->mode = mode;
     this->mac = global_mac;
+    instance = this;
+
     WiFi.mode(WIFI_STA);
     WiFi.disconnect();
     while (ESPNow.init() != ESP_OK) {
-        printf("ESPNow init failed\n");
+        log_printf("ESPNow init failed\n");
         delay(200);
     }
     if (mode == ConnectivityMode::READER) {
@@ -23,12 +29,216 @@ ESPNetwork::ESPNetwork(ConnectivityMode mode) {
     } else {
         ESPNow.add_peer(mac);
     }
+
+    ESPNow.reg_recv_cb(ESPNetwork::onReceive);
+    ESPNow.reg_send_cb(ESPNetwork::onSent);
 }
 
+ESPNetwork::~ESPNetwork() {
+    if (instance == this) instance = nullptr;
+
+    for (; queueCount != 0; queueCount--) {
+        QueuedMessage& message = queue[queueStart];
+        delete[] message.data;
+        Telemetry::released(Subsystem::RADIO, message.length);
+        queueStart = (queueStart + 1) % ESPNOW_SEND_QUEUE;
+    }
+}
+
+/**
+ * @brief Queue a message. The message is copied, so it may be released after the call.
+ *
+ * @return false if the message is too large, or ESPNOW_SEND_QUEUE messages are already waiting
+ */
 bool ESPNetwork::write(Payload payload) {
-    return ESPNow.send_message(mac, payload.data, payload.length);
+    if (payload.length == 0 || sender.maxMessageSize() < payload.length) {
+        log_printf("ESPNow message of %d bytes is too large\n", payload.length);
+        return false;
+    }
+
+    if (queueCount == ESPNOW_SEND_QUEUE) {
+        stats.queueFull++;
+        return false;
+    }
+
+    QueuedMessage& message = queue[(queueStart + queueCount) % ESPNOW_SEND_QUEUE];
+    message.data = new u8_t[payload.length];
+    message.length = payload.length;
+    memcpy(message.data, payload.data, payload.length);
+    Telemetry::allocated(Subsystem::RADIO, message.length);
+    queueCount++;
+
+    sendPending(); // Start right away if nothing is in flight
+    return true;
+}
+
+/**
+ * @brief Send the packet in the outgoing buffer. The send callback of this attempt clears inFlight
+ * when it is done.
+ */
+void ESPNetwork::transmit() {
+    attempts++;
+    sentAt = millis();
+    failed.store(false, std::memory_order_relaxed);
+    // Before sending, as the callback may run first
+    pendingSend.store(sends + 1, std::memory_order_relaxed);
+    inFlight.store(true, std::memory_order_release);
+
+    if (ESPNow.send_message(mac, outgoing, outgoingLength) != ESP_OK) {
+        // E.g. the queue of the Wi-Fi driver is full. No callback follows, so the number is reused.
+        // Try again in the next update.
+        inFlight.store(false, std::memory_order_relaxed);
+        failed.store(true, std::memory_order_relaxed);
+        return;
+    }
+    sends++;
+}
+
+/**
+ * @brief Get the next fragment into the outgoing buffer, starting the next queued message if the
+ * current one is sent.
+ *
+ * @return false if there is nothing left to send
+ */
+bool ESPNetwork::nextPacket() {
+    outgoingLength = sender.next(outgoing);
+    while (outgoingLength == 0 && queueCount != 0) {
+        QueuedMessage& message = queue[queueStart];
+        sender.begin(message.data, message.length); // The size was checked by write()
+        delete[] message.data;
+        Telemetry::released(Subsystem::RADIO, message.length);
+        queueStart = (queueStart + 1) % ESPNOW_SEND_QUEUE;
+        queueCount--;
+
+        outgoingLength = sender.next(outgoing);
+    }
+
+    return outgoingLength != 0;
+}
+
+/**
+ * @brief Move the send queue forward. Waits for the packet in flight, sends it again if it failed,
+ * and otherwise sends the next packet.
+ */
+void ESPNetwork::sendPending() {
+    if (outgoingLength != 0) {
+        if (inFlight.load(std::memory_order_acquire)) {
+            if (millis() - sentAt < ESPNOW_SEND_TIMEOUT) return;
+
+            inFlight.store(false, std::memory_order_relaxed);
+            failed.store(true, std::memory_order_relaxed);
+            stats.timeouts++;
+        }
+
+        if (failed.load(std::memory_order_relaxed)) {
+            if (attempts <= ESPNOW_SEND_RETRIES) {
+                stats.retries++;
+                transmit();
+                return;
+            }
+            stats.sendFailures++;
+        }
+        else {
+            stats.packetsSent++;
+        }
+
+        outgoingLength = 0;
+    }
+
+    if (!nextPacket()) return;
+
+    attempts = 0;
+    transmit();
+}
+
+/**
+ * @brief Runs in the Wi-Fi task. Only copies the packet, as the callback must return quickly.
+ */
+void ESPNetwork::onReceive(const uint8_t* mac, const uint8_t* data, int length) {
+    if (instance == nullptr || length <= 0 || ESPNOW_MTU < length) return;
+
+    u8_t* slot = instance->ring.claim();
+    if (slot == nullptr) {
+        instance->ring.drop();
+        return;
+    }
+
+    memcpy(slot, data, length);
+    instance->ring.commit(length);
+}
+
+/**
+ * @brief Runs in the Wi-Fi task when a packet is sent, or failed to be sent. Callbacks of attempts
+ * that timed out and were sent again are ignored.
+ */
+void ESPNetwork::onSent(const uint8_t* mac, esp_now_send_status_t status) {
+    if (instance == nullptr) return;
+
+    u32_t number = ++instance->callbacks;
+    if (number != instance->pendingSend.load(std::memory_order_acquire)) return;
+
+    instance->failed.store(status != ESP_NOW_SEND_SUCCESS, std::memory_order_relaxed);
+    instance->inFlight.store(false, std::memory_order_release);
+}
+
+void ESPNetwork::onData(OnFrame callback) {
+    dataCallback = callback;
+}
+
+ESPNowStats ESPNetwork::getStats() {
+    ESPNowStats current = stats;
+    current.ringDrops = ring.getDrops();
+    return current;
 }
 
-void ESPNetwork::setOnReceive(esp_now_recv_cb_t callback) {
-    ESPNow.reg_recv_cb(callback);
-}
\ No newline at end of file
+FragmentSenderStats ESPNetwork::getSenderStats() {
+    return sender.getStats();
+}
+
+ReassemblyStats ESPNetwork::getReassemblyStats() {
+    return reassembler.getStats();
+}
+
+/**
+ * @brief Get the counters of ESP-NOW as a link. Corrupt packets are dropped by the Wi-Fi hardware,
+ * so only packets with an invalid fragment header count as CRC errors.
+ */
+LinkCounters ESPNetwork::getLinkCounters() {
+    ReassemblyStats received = reassembler.getStats();
+
+    LinkCounters link = {};
+    link.sent = stats.packetsSent;
+    link.received = stats.packetsReceived;
+    link.retransmits = stats.retries + sender.getStats().retransmits;
+    link.lost = stats.sendFailures + ring.getDrops();
+    link.reassemblyTimeouts = received.timeouts + received.evictions;
+    link.crcErrors = received.invalid;
+    return link;
+}
+
+String ESPNetwork::getName() {
+    return "ESPNow";
+}
+
+/**
+ * @brief Send the next packet, and pass every complete message in the ring buffer to the data callback
+ */
+void ESPNetwork::update() {
+    sendPending();
+    reassembler.expire();
+
+    u8_t length;
+    const u8_t* packet;
+    while ((packet = ring.peek(&length)) != nullptr) {
+        stats.packetsReceived++;
+
+        const u8_t* message;
+        size_t messageLength;
+        if (reassembler.push(packet, length, &message, &messageLength) && dataCallback != nullptr) {
+            dataCallback(message, messageLength);
+        }
+
+        // Single fragments are delivered from the slot itself, so it is released after the callback
+        ring.pop();
+    }
+}
@@ -3,7 +3,20 @@
 #include <optional.h>
 #include <Arduino.h>
 #include <WiFi.h>
+#include <atomic>
 #include "ESPNowW.h"
+#include "fragmentation.h"
+#include "framing.h"
+#include "packet_ring.h"
+#include "../diagnostics/link_monitor.h"
+#include "../scheduler/scheduler.h"
+
+#define ESPNOW_MTU ESP_NOW_MAX_DATA_LEN // Largest payload of an ESP-NOW packet
+#define ESPNOW_MAX_MESSAGE_SIZE 2048
+#define ESPNOW_RING_SLOTS 16  // Packets buffered between the Wi-Fi task and the main loop
+#define ESPNOW_SEND_QUEUE 4   // Messages waiting for the current message to be sent
+#define ESPNOW_SEND_TIMEOUT 50 // ms to wait for the send callback, before the packet counts as failed
+#define ESPNOW_SEND_RETRIES 2 // Attempts per packet after the first
 
 struct Payload {
     u8_t* data;
@@ -16,14 +29,79 @@ enum class ConnectivityMode {
     WRITER,
 };
 
-class ESPNetwork {
+/**
+ * @brief Counters of the ESP-NOW transport.
+ */
+struct ESPNowStats {
+    u32_t packetsSent;    // Packets confirmed by the send callback
+    u32_t sendFailures;   // Packets given up on after ESPNOW_SEND_RETRIES
+    u32_t retries;        // Packets sent again after a failure
+    u32_t timeouts;       // Packets without a send callback within ESPNOW_SEND_TIMEOUT
+    u32_t queueFull;      // Messages rejected as ESPNOW_SEND_QUEUE messages were waiting
+    u32_t packetsReceived;
+    u32_t ringDrops;      // Packets dropped as the main loop did not drain the ring in time
+};
+
+struct QueuedMessage {
+    u8_t* data;
+    size_t length;
+};
+
+/**
+ * @brief Sends and receives messages of up to ESPNOW_MAX_MESSAGE_SIZE bytes over ESP-NOW, by
+ * splitting them into 250-byte fragments. See FragmentHeader for the packet format.
+ *
+ * Only one packet is in flight at a time. The send callback of ESP-NOW marks it done, and update()
+ * then sends the next fragment, or the next queued message. Failed packets are sent again.
+ *
+ * A packet whose callback times out is sent again while ESP-NOW may still hold the earlier
+ * attempt. The callbacks carry no reference to their packet, but ESP-NOW sends in order, so they
+ * are numbered as they arrive, and only the callback of the latest attempt counts.
+ *
+ * The receive callback runs in the Wi-Fi task, so it only copies packets to a ring buffer.
+ * update() reassembles them in the main loop and passes complete messages to the onData callback.
+ * Messages are broadcast to many receivers, so lost fragments are not requested with NACKs.
+ */
+class ESPNetwork : public Process, public LinkSource {
+    static ESPNetwork* instance; // ESP-NOW callbacks do not take an argument
+
     uint8_t* mac;
     ConnectivityMode mode = ConnectivityMode::NOT_INITIALIZED;
-    
-    void (*onReceiveCallback)(Payload*) = nullptr;
+    FragmentSender sender;
+    FragmentReassembler reassembler;
+    PacketRing<ESPNOW_RING_SLOTS, ESPNOW_MTU> ring;
+    QueuedMessage queue[ESPNOW_SEND_QUEUE];
+    u8_t queueStart = 0;
+    u8_t queueCount = 0;
+    u8_t outgoing[ESPNOW_MTU];
+    size_t outgoingLength = 0; // Length of the packet in flight, or 0 if the next one can be sent
+    u8_t attempts = 0;
+    u32_t sentAt = 0;
+    u32_t sends = 0;                     // Packets accepted by ESP-NOW, which numbers the attempts
+    std::atomic<u32_t> pendingSend{ 0 }; // Number of the attempt in flight, whose callback counts
+    u32_t callbacks = 0;                 // Send callbacks so far, counted in the Wi-Fi task
+    std::atomic<bool> inFlight{ false };
+    std::atomic<bool> failed{ false };
+    ESPNowStats stats = {};
+    OnFrame dataCallback = nullptr;
+
+    void transmit();
+    bool nextPacket();
+    void sendPending();
+
+    static void onReceive(const uint8_t* mac, const uint8_t* data, int length);
+    static void onSent(const uint8_t* mac, esp_now_send_status_t status);
 
     public:
-    ESPNetwork(ConnectivityMode mode);
+    ESPNetwork(ConnectivityMode mode, size_t maxMessageSize = ESPNOW_MAX_MESSAGE_SIZE);
+    ~ESPNetwork();
     bool write(Payload payload);
-    void setOnReceive(esp_now_recv_cb_t callback);
-};
\ No newline at end of file
+    void onData(OnFrame callback);
+    ESPNowStats getStats();
+    FragmentSenderStats getSenderStats();
+    ReassemblyStats getReassemblyStats();
+    LinkCounters getLinkCounters() override;
+
+    String getName() override;
+    void update() override;
+};
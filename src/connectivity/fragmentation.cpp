@@ -0,0 +1,346 @@
+#include "fragmentation.h"
+#include "../diagnostics/telemetry.h"
+
+static inline bool bit_get(const u8_t* bitmap, u8_t index) {
+  return bitmap[index / 8] & (1 << (index % 8));
+}
+
+static inline void bit_set(u8_t* bitmap, u8_t index) {
+  bitmap[index / 8] |= 1 << (index % 8);
+}
+
+static inline void bit_clear(u8_t* bitmap, u8_t index) {
+  bitmap[index / 8] &= ~(1 << (index % 8));
+}
+
+/**
+ * @brief Most fragments of a message, such that a NACK bitmap of all of them fits in a packet.
+ */
+static size_t max_fragments(size_t fragmentSize) {
+  size_t count = fragmentSize * 8;
+  return count < FRAGMENT_MAX_COUNT ? count : FRAGMENT_MAX_COUNT;
+}
+
+/**
+ * @brief Parse the header of a packet
+ *
+ * @param packet The received packet
+ * @param length Length of the packet
+ * @param header Set to the header
+ * @return false if the packet is not a valid fragment or NACK
+ */
+bool FragmentHeader::read(const u8_t* packet, size_t length, FragmentHeader* header) {
+  if (length < FRAGMENT_HEADER_SIZE) return false;
+  if (packet[0] != FRAGMENT_DATA && packet[0] != FRAGMENT_NACK) return false;
+
+  header->type = (FragmentType)packet[0];
+  header->messageId = packet[1] | packet[2] << 8;
+  header->index = packet[3];
+  header->count = packet[4];
+
+  return header->count != 0 && header->index < header->count;
+}
+
+void FragmentHeader::write(u8_t* packet) const {
+  packet[0] = type;
+  packet[1] = messageId & 0xFF;
+  packet[2] = messageId >> 8;
+  packet[3] = index;
+  packet[4] = count;
+}
+
+/**
+ * @brief Construct a new Fragment Sender object
+ *
+ * @param mtu Largest packet of the transport, e.g. 32 for RF24
+ * @param maxMessageSize Largest message that can be sent
+ */
+FragmentSender::FragmentSender(size_t mtu, size_t maxMessageSize) {
+  fragmentSize = mtu - FRAGMENT_HEADER_SIZE;
+  capacity = maxMessageSize;
+  buffer = new u8_t[capacity];
+  Telemetry::allocated(Subsystem::RADIO, capacity);
+
+  // Start at a random id, such that a rebooted sender is not mistaken for a retransmit
+  messageId = random(0x10000);
+}
+
+FragmentSender::~FragmentSender() {
+  delete[] buffer;
+  Telemetry::released(Subsystem::RADIO, capacity);
+}
+
+/**
+ * @brief Start sending a message. The message is copied, so it may be released after the call.
+ *
+ * @param data The message
+ * @param length Length of the message
+ * @return false if the message is empty or too large
+ */
+bool FragmentSender::begin(const u8_t* data, size_t length) {
+  size_t fragments = (length + fragmentSize - 1) / fragmentSize;
+  if (length == 0 || capacity < length || max_fragments(fragmentSize) < fragments) return false;
+
+  memcpy(buffer, data, length);
+  this->length = length;
+  count = fragments;
+  messageId++;
+  retransmitting = false;
+
+  memset(pending, 0, sizeof(pending));
+  for (u8_t i = 0; i < count; i++) {
+    bit_set(pending, i);
+  }
+
+  stats.messages++;
+  return true;
+}
+
+/**
+ * @brief Write the next fragment to send
+ *
+ * @param packet Where the fragment is written. Must hold mtu bytes.
+ * @return size_t Length of the packet, or 0 if there is nothing left to send
+ */
+size_t FragmentSender::next(u8_t* packet) {
+  for (u8_t i = 0; i < count; i++) {
+    if (!bit_get(pending, i)) continue;
+
+    bit_clear(pending, i);
+    FragmentHeader header = { FRAGMENT_DATA, messageId, i, count };
+    header.write(packet);
+
+    size_t offset = i * fragmentSize;
+    size_t size = length - offset < fragmentSize ? length - offset : fragmentSize;
+    memcpy(packet + FRAGMENT_HEADER_SIZE, buffer + offset, size);
+
+    stats.fragments++;
+    if (retransmitting) stats.retransmits++;
+    return FRAGMENT_HEADER_SIZE + size;
+  }
+
+  retransmitting = false;
+  return 0;
+}
+
+/**
+ * @brief Queue the fragments that a receiver reports missing. NACKs for older messages are ignored.
+ *
+ * @param packet The received NACK
+ * @param length Length of the packet
+ * @return true if fragments were queued, such that next() must be called again
+ */
+bool FragmentSender::onNack(const u8_t* packet, size_t length) {
+  FragmentHeader header;
+  if (!FragmentHeader::read(packet, length, &header) || header.type != FRAGMENT_NACK) return false;
+  if (header.messageId != messageId || header.count != count) return false;
+  if (length - FRAGMENT_HEADER_SIZE < (size_t)(count + 7) / 8) return false;
+
+  stats.nacksReceived++;
+  const u8_t* missing = packet + FRAGMENT_HEADER_SIZE;
+  bool queued = false;
+  for (u8_t i = 0; i < count; i++) {
+    if (bit_get(missing, i)) {
+      bit_set(pending, i);
+      queued = true;
+    }
+  }
+
+  retransmitting = queued;
+  return queued;
+}
+
+size_t FragmentSender::maxMessageSize() {
+  size_t fragmented = max_fragments(fragmentSize) * fragmentSize;
+  return capacity < fragmented ? capacity : fragmented;
+}
+
+FragmentSenderStats FragmentSender::getStats() {
+  return stats;
+}
+
+/**
+ * @brief Construct a new Fragment Reassembler object
+ *
+ * @param mtu Largest packet of the transport. Must match the sender.
+ * @param maxMessageSize Largest message that can be received. Larger messages are dropped.
+ * @param nack Whether to request missing fragments with nextNack()
+ */
+FragmentReassembler::FragmentReassembler(size_t mtu, size_t maxMessageSize, bool nack) {
+  fragmentSize = mtu - FRAGMENT_HEADER_SIZE;
+  capacity = maxMessageSize;
+  this->nack = nack;
+
+  for (ReassemblySlot& slot : slots) {
+    slot = {};
+    slot.data = new u8_t[capacity];
+  }
+  Telemetry::allocated(Subsystem::RADIO, capacity * REASSEMBLY_SLOTS);
+}
+
+FragmentReassembler::~FragmentReassembler() {
+  for (ReassemblySlot& slot : slots) {
+    delete[] slot.data;
+  }
+  Telemetry::released(Subsystem::RADIO, capacity * REASSEMBLY_SLOTS);
+}
+
+bool FragmentReassembler::isRecent(u16_t messageId) {
+  for (u8_t i = 0; i < recentCount; i++) {
+    if (recent[i] == messageId) return true;
+  }
+  return false;
+}
+
+void FragmentReassembler::remember(u16_t messageId) {
+  recent[recentNext] = messageId;
+  recentNext = (recentNext + 1) % REASSEMBLY_RECENT;
+  if (recentCount < REASSEMBLY_RECENT) recentCount++;
+}
+
+/**
+ * @brief Find the slot of the message, or claim one. The least recently updated message is
+ * evicted if all slots are in use.
+ */
+ReassemblySlot* FragmentReassembler::slotFor(const FragmentHeader& header) {
+  ReassemblySlot* free = nullptr;
+  ReassemblySlot* oldest = &slots[0];
+
+  for (ReassemblySlot& slot : slots) {
+    if (slot.count != 0 && slot.messageId == header.messageId) {
+      return slot.count == header.count ? &slot : nullptr;
+    }
+    if (slot.count == 0 && free == nullptr) free = &slot;
+    if (oldest->updatedAt > slot.updatedAt) oldest = &slot;
+  }
+
+  if (free == nullptr) {
+    free = oldest;
+    stats.evictions++;
+  }
+
+  u8_t* data = free->data;
+  *free = {};
+  free->data = data;
+  free->messageId = header.messageId;
+  free->count = header.count;
+  return free;
+}
+
+/**
+ * @brief Add a received packet. NACKs and invalid packets are ignored.
+ *
+ * @param packet The received packet
+ * @param length Length of the packet
+ * @param message Set to the complete message, if this packet completed one. It is valid until the next push.
+ * @param messageLength Set to the length of the message
+ * @return true if a message is complete
+ */
+bool FragmentReassembler::push(const u8_t* packet, size_t length, const u8_t** message, size_t* messageLength) {
+  FragmentHeader header;
+  if (!FragmentHeader::read(packet, length, &header)) {
+    stats.invalid++;
+    return false;
+  }
+  if (header.type != FRAGMENT_DATA) return false;
+
+  // All but the last fragment are full, and the message must fit
+  size_t size = length - FRAGMENT_HEADER_SIZE;
+  bool last = header.index == header.count - 1;
+  if (size > fragmentSize || (!last && size != fragmentSize) || capacity < header.index * fragmentSize + size) {
+    stats.invalid++;
+    return false;
+  }
+
+  stats.fragments++;
+  if (isRecent(header.messageId)) {
+    stats.duplicates++;
+    return false;
+  }
+
+  // Single fragments are delivered from the packet itself
+  if (header.count == 1) {
+    remember(header.messageId);
+    stats.messages++;
+    *message = packet + FRAGMENT_HEADER_SIZE;
+    *messageLength = size;
+    return true;
+  }
+
+  ReassemblySlot* slot = slotFor(header);
+  if (slot == nullptr) {
+    stats.invalid++;
+    return false;
+  }
+
+  if (bit_get(slot->received, header.index)) {
+    stats.duplicates++;
+    return false;
+  }
+
+  memcpy(slot->data + header.index * fragmentSize, packet + FRAGMENT_HEADER_SIZE, size);
+  bit_set(slot->received, header.index);
+  slot->receivedCount++;
+  slot->updatedAt = millis();
+  if (last) slot->length = header.index * fragmentSize + size;
+
+  if (slot->receivedCount < slot->count) return false;
+
+  // Complete. The data stays in the slot until it is claimed again.
+  slot->count = 0;
+  remember(header.messageId);
+  stats.messages++;
+  *message = slot->data;
+  *messageLength = slot->length;
+  return true;
+}
+
+/**
+ * @brief Drop incomplete messages that have not received a fragment for REASSEMBLY_TIMEOUT
+ */
+void FragmentReassembler::expire() {
+  u32_t now = millis();
+  for (ReassemblySlot& slot : slots) {
+    if (slot.count != 0 && now - slot.updatedAt >= REASSEMBLY_TIMEOUT) {
+      slot.count = 0;
+      stats.timeouts++;
+    }
+  }
+}
+
+/**
+ * @brief Write a request for the missing fragments of a stalled message. Call it until it returns 0.
+ *
+ * @param packet Where the NACK is written. Must hold mtu bytes.
+ * @return size_t Length of the NACK, or 0 if no message is waiting for fragments
+ */
+size_t FragmentReassembler::nextNack(u8_t* packet) {
+  if (!nack) return 0;
+
+  u32_t now = millis();
+  for (ReassemblySlot& slot : slots) {
+    if (slot.count == 0 || slot.nacks >= NACK_MAX || now - slot.updatedAt < NACK_DELAY) continue;
+
+    FragmentHeader header = { FRAGMENT_NACK, slot.messageId, 0, slot.count };
+    header.write(packet);
+
+    u8_t* missing = packet + FRAGMENT_HEADER_SIZE;
+    size_t bitmapSize = (slot.count + 7) / 8;
+    memset(missing, 0, bitmapSize);
+    for (u8_t i = 0; i < slot.count; i++) {
+      if (!bit_get(slot.received, i)) bit_set(missing, i);
+    }
+
+    // Wait for the retransmits before asking again
+    slot.updatedAt = now;
+    slot.nacks++;
+    stats.nacksSent++;
+    return FRAGMENT_HEADER_SIZE + bitmapSize;
+  }
+
+  return 0;
+}
+
+ReassemblyStats FragmentReassembler::getStats() {
+  return stats;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define FRAGMENT_HEADER_SIZE 5
+#define FRAGMENT_MAX_COUNT 255
+
+// Reassembly of incomplete messages
+#define REASSEMBLY_SLOTS 4        // Messages reassembled at once. The oldest is evicted when a new one starts.
+#define REASSEMBLY_TIMEOUT 1000   // ms without new fragments after which an incomplete message is dropped
+#define REASSEMBLY_RECENT 8       // Completed message ids remembered, such that late retransmits are not delivered twice
+#define NACK_DELAY 30             // ms without new fragments before missing fragments are requested
+#define NACK_MAX 3                // Requests per message, before waiting for the timeout
+
+enum FragmentType : u8_t {
+  FRAGMENT_DATA = 0xD5, // Header, then a part of the message
+  FRAGMENT_NACK = 0xAC, // Header, then a bitmap of the fragments that are missing. The index is unused.
+};
+
+/**
+ * @brief Header of every packet. Multi-byte values are little-endian.
+ *
+ * Packet on the wire: type (1) | message id (2) | fragment index (1) | fragment count (1) | data
+ *
+ * All fragments but the last carry exactly `mtu - FRAGMENT_HEADER_SIZE` bytes, such that the
+ * receiver can place any fragment in the message without having seen the others.
+ */
+struct FragmentHeader {
+  FragmentType type;
+  u16_t messageId;
+  u8_t index;
+  u8_t count;
+
+  static bool read(const u8_t* packet, size_t length, FragmentHeader* header);
+  void write(u8_t* packet) const;
+};
+
+/**
+ * @brief Counters of a fragment sender.
+ */
+struct FragmentSenderStats {
+  u32_t messages;      // Messages sent
+  u32_t fragments;     // Fragments sent, including retransmits
+  u32_t retransmits;   // Fragments sent again after a NACK
+  u32_t nacksReceived; // NACKs for the current message
+};
+
+/**
+ * @brief Splits messages into packets of at most `mtu` bytes.
+ *
+ * The last message is kept, such that fragments that a receiver reports missing can be sent again.
+ * Fragments are pulled one at a time with next(), so the transport decides when to send them.
+ */
+class FragmentSender {
+  u8_t* buffer;
+  size_t capacity;
+  size_t fragmentSize;
+  size_t length = 0;
+  u16_t messageId;
+  u8_t count = 0;
+  u8_t pending[FRAGMENT_MAX_COUNT / 8 + 1] = {}; // Bitmap of the fragments left to send
+  bool retransmitting = false;
+  FragmentSenderStats stats = {};
+
+  public:
+  FragmentSender(size_t mtu, size_t maxMessageSize);
+  ~FragmentSender();
+
+  bool begin(const u8_t* data, size_t length);
+  size_t next(u8_t* packet);
+  bool onNack(const u8_t* packet, size_t length);
+  size_t maxMessageSize();
+  FragmentSenderStats getStats();
+};
+
+/**
+ * @brief Counters of a fragment reassembler.
+ */
+struct ReassemblyStats {
+  u32_t messages;   // Messages delivered
+  u32_t fragments;  // Fragments received
+  u32_t duplicates; // Fragments dropped as they were already received
+  u32_t invalid;    // Packets dropped as the header or size was invalid
+  u32_t timeouts;   // Incomplete messages dropped after REASSEMBLY_TIMEOUT
+  u32_t evictions;  // Incomplete messages dropped to make room for a new one
+  u32_t nacksSent;  // Requests for missing fragments
+};
+
+struct ReassemblySlot {
+  u8_t* data;
+  u8_t received[FRAGMENT_MAX_COUNT / 8 + 1]; // Bitmap of the received fragments
+  u16_t messageId;
+  u8_t count; // 0 if the slot is free
+  u8_t receivedCount;
+  u16_t length; // Known once the last fragment is received
+  u32_t updatedAt;
+  u8_t nacks;
+};
+
+/**
+ * @brief Reassembles messages from fragments that may arrive in any order, duplicated or not at all.
+ *
+ * Memory is bounded: REASSEMBLY_SLOTS buffers of the maximum message size are allocated up front.
+ * Incomplete messages are dropped after REASSEMBLY_TIMEOUT, or when a newer message needs the slot.
+ * With NACKs enabled, nextNack() produces requests for the fragments of stalled messages.
+ */
+class FragmentReassembler {
+  ReassemblySlot slots[REASSEMBLY_SLOTS];
+  u16_t recent[REASSEMBLY_RECENT] = {};
+  u8_t recentCount = 0;
+  u8_t recentNext = 0;
+  size_t capacity;
+  size_t fragmentSize;
+  bool nack;
+  ReassemblyStats stats = {};
+
+  bool isRecent(u16_t messageId);
+  void remember(u16_t messageId);
+  ReassemblySlot* slotFor(const FragmentHeader& header);
+
+  public:
+  FragmentReassembler(size_t mtu, size_t maxMessageSize, bool nack = true);
+  ~FragmentReassembler();
+
+  bool push(const u8_t* packet, size_t length, const u8_t** message, size_t* messageLength);
+  void expire();
+  size_t nextNack(u8_t* packet);
+  ReassemblyStats getStats();
+};
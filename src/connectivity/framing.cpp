@@ -0,0 +1,220 @@
+#include "framing.h"
+
+// CRC-32 (IEEE 802.3) lookup table for one nibble at a time. Small enough to keep in flash,
+// and fast enough for 2 Mbaud.
+static const uint32_t crc32_nibble_table[16] = {
+  0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+  0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+/**
+ * @brief Calculate the CRC-32 (IEEE 802.3, as used by zlib) of the data.
+ *
+ * @param data The data to checksum
+ * @param length Length of the data
+ * @param crc CRC of the preceding data, when checksumming in chunks
+ * @return uint32_t
+ */
+uint32_t Framing::crc32(const uint8_t* data, size_t length, uint32_t crc) {
+  crc = ~crc;
+  for (size_t i = 0; i < length; i++) {
+    crc = crc32_nibble_table[(crc ^ data[i]) & 0x0F] ^ (crc >> 4);
+    crc = crc32_nibble_table[(crc ^ (data[i] >> 4)) & 0x0F] ^ (crc >> 4);
+  }
+  return ~crc;
+}
+
+/**
+ * @brief COBS decode the data in place. The data must not contain the frame delimiter.
+ *
+ * @param data The encoded data, which is overwritten by the decoded data
+ * @param length Length of the encoded data
+ * @return size_t Length of the decoded data, or 0 if the data is not valid COBS
+ */
+size_t Framing::cobsDecode(uint8_t* data, size_t length) {
+  size_t readIndex = 0;
+  size_t writeIndex = 0;
+
+  while (readIndex < length) {
+    uint8_t code = data[readIndex++];
+    if (code == 0 || readIndex + code - 1 > length) return 0;
+
+    for (uint8_t i = 1; i < code; i++) {
+      data[writeIndex++] = data[readIndex++];
+    }
+
+    // A zero is implied after every block, except after full blocks and the last block
+    if (code != 0xFF && readIndex < length) {
+      data[writeIndex++] = 0;
+    }
+  }
+
+  return writeIndex;
+}
+
+/**
+ * @brief Construct a new Frame Encoder object, and start the frame with a delimiter
+ *
+ * @param output Where the encoded frame is written, e.g. Serial
+ */
+FrameEncoder::FrameEncoder(Print* output) : output(output) {
+  uint8_t delimiter = FRAME_DELIMITER;
+  output->write(&delimiter, 1);
+}
+
+/**
+ * @brief Write a complete frame in one go
+ *
+ * @param output Where the encoded frame is written
+ * @param payload The payload to frame
+ * @param length Length of the payload
+ */
+void FrameEncoder::send(Print* output, const uint8_t* payload, size_t length) {
+  FrameEncoder encoder(output);
+  encoder.write(payload, length);
+  encoder.finish();
+}
+
+/**
+ * @brief Append payload bytes to the frame
+ *
+ * @param data The payload bytes
+ * @param length Number of bytes
+ */
+void FrameEncoder::write(const uint8_t* data, size_t length) {
+  crc = Framing::crc32(data, length, crc);
+  for (size_t i = 0; i < length; i++) {
+    encodeByte(data[i]);
+  }
+}
+
+/**
+ * @brief Append the CRC trailer and the delimiter. The encoder must not be used afterwards.
+ */
+void FrameEncoder::finish() {
+  encodeByte(crc);
+  encodeByte(crc >> 8);
+  encodeByte(crc >> 16);
+  encodeByte(crc >> 24);
+  flushBlock();
+
+  uint8_t delimiter = FRAME_DELIMITER;
+  output->write(&delimiter, 1);
+}
+
+/**
+ * @brief End a frame that could not be completed. The CRC trailer is left out,
+ * so the receiver drops the frame. The encoder must not be used afterwards.
+ */
+void FrameEncoder::abort() {
+  flushBlock();
+
+  uint8_t delimiter = FRAME_DELIMITER;
+  output->write(&delimiter, 1);
+}
+
+void FrameEncoder::encodeByte(uint8_t byte) {
+  if (byte == 0) {
+    flushBlock();
+    return;
+  }
+
+  block[blockLength++] = byte;
+  if (blockLength == 0xFF) flushBlock();
+}
+
+/**
+ * @brief Write the current block, prefixed by its COBS code: the distance to the next zero
+ */
+void FrameEncoder::flushBlock() {
+  block[0] = blockLength;
+  output->write(block, blockLength);
+  blockLength = 1;
+}
+
+/**
+ * @brief Construct a new Frame Decoder object
+ *
+ * @param maxPayloadSize The largest payload that can be received, excluding the CRC
+ */
+FrameDecoder::FrameDecoder(size_t maxPayloadSize) {
+  capacity = COBS_ENCODED_SIZE(maxPayloadSize + FRAME_CRC_SIZE);
+  buffer = (uint8_t*)malloc(capacity);
+}
+
+FrameDecoder::~FrameDecoder() {
+  free(buffer);
+}
+
+/**
+ * @brief Set the callback receiving valid payloads. The data is only valid during the callback.
+ *
+ * @param callback The function to call with each payload
+ */
+void FrameDecoder::onFrame(OnFrame callback) {
+  frameCallback = callback;
+}
+
+FrameStats FrameDecoder::getStats() {
+  return stats;
+}
+
+/**
+ * @brief Feed received bytes. Complete frames are delivered as soon as their delimiter is seen.
+ *
+ * @param data The received bytes
+ * @param size Number of received bytes
+ */
+void FrameDecoder::push(const uint8_t* data, size_t size) {
+  if (!buffer) return;
+
+  for (size_t i = 0; i < size; i++) {
+    if (data[i] == FRAME_DELIMITER) {
+      completeFrame();
+      continue;
+    }
+
+    if (discarding) continue;
+
+    if (length == capacity) {
+      stats.overflows++;
+      discarding = true; // Resynchronise on the next delimiter
+      continue;
+    }
+
+    buffer[length++] = data[i];
+  }
+}
+
+/**
+ * @brief Decode the buffered frame in place, verify its CRC and deliver the payload
+ */
+void FrameDecoder::completeFrame() {
+  size_t frameLength = length;
+  bool discarded = discarding;
+  length = 0;
+  discarding = false;
+
+  // Consecutive delimiters and the tail of an overflowed frame are skipped silently
+  if (discarded || frameLength == 0) return;
+
+  size_t decoded = Framing::cobsDecode(buffer, frameLength);
+  if (decoded <= FRAME_CRC_SIZE) {
+    stats.framingErrors++;
+    return;
+  }
+
+  size_t payloadLength = decoded - FRAME_CRC_SIZE;
+  uint8_t* trailer = buffer + payloadLength;
+  uint32_t expected = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | ((uint32_t)trailer[3] << 24);
+
+  if (Framing::crc32(buffer, payloadLength) != expected) {
+    stats.crcErrors++;
+    return;
+  }
+
+  stats.frames++;
+  if (frameCallback) {
+    frameCallback(buffer, payloadLength);
+  }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define FRAME_DELIMITER 0x00
+#define FRAME_CRC_SIZE 4
+
+/**
+ * @brief Size of a COBS encoded block of `length` bytes, excluding the frame delimiter.
+ */
+#define COBS_ENCODED_SIZE(length) ((length) + (length) / 254 + 1)
+
+/**
+ * @brief Frames are COBS encoded (Consistent Overhead Byte Stuffing), such that the payload never
+ * contains a zero byte, and a zero byte marks the start and end of every frame. A receiver that loses a
+ * byte resynchronises on the next delimiter. Each frame carries a CRC-32 trailer of the payload.
+ * Bytes that are not framed, e.g. boot messages on the same port, end at the leading delimiter of
+ * the next frame, and are dropped as a bad frame without affecting it.
+ *
+ * Frame on the wire: 0x00 + COBS(payload + CRC-32 little-endian) + 0x00
+ */
+class Framing {
+  public:
+  static uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc = 0);
+  static size_t cobsDecode(uint8_t* data, size_t length);
+};
+
+/**
+ * @brief Writes a frame to an output while the payload is produced, without buffering the payload.
+ * Only a single COBS block of up to 255 bytes is held at a time.
+ */
+class FrameEncoder {
+  Print* output;
+  uint8_t block[255];
+  uint8_t blockLength = 1; // block[0] is reserved for the COBS code
+  uint32_t crc = 0;
+
+  void encodeByte(uint8_t byte);
+  void flushBlock();
+
+  public:
+  FrameEncoder(Print* output);
+
+  void write(const uint8_t* data, size_t length);
+  void finish();
+  void abort();
+
+  static void send(Print* output, const uint8_t* payload, size_t length);
+};
+
+typedef void (*OnFrame)(const uint8_t* data, size_t length);
+
+/**
+ * @brief Error counters of a frame decoder.
+ */
+struct FrameStats {
+  u32_t frames;        // Valid frames delivered
+  u32_t crcErrors;     // Frames dropped as the CRC did not match
+  u32_t framingErrors; // Frames dropped as they were not valid COBS or too short
+  u32_t overflows;     // Frames dropped as they exceeded the buffer
+};
+
+/**
+ * @brief Reassembles frames from a byte stream that may arrive in arbitrary fragments.
+ * Valid frames are handed to the callback, and any error drops bytes up to the next delimiter only.
+ */
+class FrameDecoder {
+  uint8_t* buffer;
+  size_t capacity;
+  size_t length = 0;
+  bool discarding = false;
+  FrameStats stats = {};
+  OnFrame frameCallback = nullptr;
+
+  void completeFrame();
+
+  public:
+  FrameDecoder(size_t maxPayloadSize);
+  ~FrameDecoder();
+
+  void push(const uint8_t* data, size_t size);
+  void onFrame(OnFrame callback);
+  FrameStats getStats();
+};
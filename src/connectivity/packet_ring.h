@@ -0,0 +1,92 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+/**
+ * @brief Lock-free ring of fixed-size packets, for a single producer and a single consumer, e.g. a
+ * receive task and the main loop. The producer claims a slot, fills it and commits it. The consumer
+ * peeks at the oldest packet and pops it when it is done with the data.
+ *
+ * When the ring is full, the producer drops the packet rather than overwriting packets the
+ * consumer has not read, and counts it with drop().
+ *
+ * @tparam SLOTS Number of packets. Must be a power of two.
+ * @tparam SIZE Largest packet
+ */
+template <size_t SLOTS, size_t SIZE>
+class PacketRing {
+  static_assert(SLOTS != 0 && (SLOTS & (SLOTS - 1)) == 0, "SLOTS must be a power of two");
+  static_assert(SIZE <= 255, "Packet lengths are stored in a byte");
+
+  struct Slot {
+    u8_t length;
+    u8_t data[SIZE];
+  };
+
+  Slot slots[SLOTS];
+  std::atomic<u32_t> head{ 0 }; // Next slot to write. Only changed by the producer.
+  std::atomic<u32_t> tail{ 0 }; // Next slot to read. Only changed by the consumer.
+  std::atomic<u32_t> drops{ 0 };
+
+  public:
+  /**
+   * @brief Get the slot to write the next packet to
+   *
+   * @return u8_t* The data of the slot, or nullptr if the ring is full
+   */
+  u8_t* claim() {
+    u32_t current = head.load(std::memory_order_relaxed);
+    if (current - tail.load(std::memory_order_acquire) == SLOTS) return nullptr;
+
+    return slots[current & (SLOTS - 1)].data;
+  }
+
+  /**
+   * @brief Publish the claimed slot to the consumer
+   *
+   * @param length Length of the packet written to the slot
+   */
+  void commit(u8_t length) {
+    u32_t current = head.load(std::memory_order_relaxed);
+    slots[current & (SLOTS - 1)].length = length;
+    head.store(current + 1, std::memory_order_release);
+  }
+
+  /**
+   * @brief Get the oldest packet, without removing it
+   *
+   * @param length Set to the length of the packet
+   * @return const u8_t* The packet, or nullptr if the ring is empty
+   */
+  const u8_t* peek(u8_t* length) {
+    u32_t current = tail.load(std::memory_order_relaxed);
+    if (current == head.load(std::memory_order_acquire)) return nullptr;
+
+    const Slot& slot = slots[current & (SLOTS - 1)];
+    *length = slot.length;
+    return slot.data;
+  }
+
+  /**
+   * @brief Remove the oldest packet, such that the producer can reuse its slot
+   */
+  void pop() {
+    tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  /**
+   * @brief Count a packet that the producer dropped, as the ring was full
+   */
+  void drop() {
+    drops.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  size_t size() {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+
+  u32_t getDrops() {
+    return drops.load(std::memory_order_relaxed);
+  }
+};
@@ -1,22 +1,16 @@
 #include "radio.h"
 
-// TODO: WORK IN PROGRESS
-// This is a work in progress. The current implementation is not working as expected.
-// Only sends 32 bytes of data at a time. This is not sufficient for the protocol
-// The implementation should support larger messages and handle the splitting of the message into smaller parts.
-// Implement a protocol for sending these larger messages.
-
 /**
  * @brief Construct a new Radio object
  * 
  * @param address Must be of length 5
- * @param payload Allows for a custom payload to be set. This is useful for setting the data array to a custom size.
+ * @param maxMessageSize Largest message that can be sent and received
+ * @param nack Whether to request lost fragments from the sender
  */
-Radio::Radio(const char* writer, const char* reader, RadioPayload payload) {
-    this->payload = payload;
-
+Radio::Radio(const char* writer, const char* reader, size_t maxMessageSize, bool nack)
+    : sender(RADIO_MTU, maxMessageSize), reassembler(RADIO_MTU, maxMessageSize, nack) {
     if (strlen(writer) != 5 || strlen(reader) != 5) {
-        printf("Address must be of length 5\n");
+        log_printf("Address must be of length 5\n");
         return;
     }
 
@@ -27,22 +21,28 @@ Radio::Radio(const char* writer, const char* reader, RadioPayload payload) {
     this->readerAddress[5] = '\0';
 }
 
-bool Radio::setup(u8_t CE_PIN, u8_t CSN_PIN) {
+/**
+ * @brief Start the radio
+ *
+ * @param IRQ_PIN Pin connected to the IRQ of the radio, or -1 to poll the radio in read()
+ * @return false if the radio did not respond, e.g. as none is fitted
+ */
+bool Radio::setup(u8_t CE_PIN, u8_t CSN_PIN, int8_t IRQ_PIN) {
     radio = RF24(CE_PIN, CSN_PIN);
     uint16_t counter = 0;
 
     while (!radio.begin())
     {
-        printf("radio hardware is not responding - %d\n", counter);
+        log_printf("radio hardware is not responding - %d\n", counter);
+        if (RADIO_SETUP_ATTEMPTS <= ++counter) return false;
         delay(200);
-        counter++;
     }
 
     // Set the PA Level low to try preventing power supply related problems
     // because these examples are likely run with nodes in close proximity to each other.
     // radio.setPALevel(RF24_PA_LOW);  // RF24_PA_MAX is default.
 
-    radio.setPayloadSize(32); // Here we are setting the size of data to be received as the size of data array.
+    radio.enableDynamicPayloads(); // Fragments are up to 32 bytes, and the last one is usually shorter
     
     // set the TX address of the RX node into the TX pipe
     radio.openWritingPipe(writerAddress);  // always uses pipe 0
@@ -54,10 +54,77 @@ bool Radio::setup(u8_t CE_PIN, u8_t CSN_PIN) {
     // radio.setDataRate(RF24_250KBPS); //estimated max is only 64kbps
     /* radio.startListening();
     mode = RadioMode::READER; */
+
+    if (0 <= IRQ_PIN) {
+        // Only interrupt on received packets. The receive task keeps the radio listening.
+        radio.maskIRQ(true, true, false);
+        sync = xSemaphoreCreateMutex();
+        listen();
+
+        xTaskCreate(Radio::receiveTask, "radio", 3072, this, configMAX_PRIORITIES - 1, &receiver);
+        pinMode(IRQ_PIN, INPUT);
+        attachInterruptArg(digitalPinToInterrupt(IRQ_PIN), Radio::onInterrupt, this, FALLING);
+    }
     
     return true;
 }
 
+/**
+ * @brief Wake the receive task. Reading the radio needs SPI, which is not done in an interrupt.
+ */
+void IRAM_ATTR Radio::onInterrupt(void* arg) {
+    Radio* radio = static_cast<Radio*>(arg);
+    radio->stats.interrupts.fetch_add(1, std::memory_order_relaxed);
+
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(radio->receiver, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+void Radio::receiveTask(void* arg) {
+    Radio* radio = static_cast<Radio*>(arg);
+    for (;;) {
+        // Also read the radio now and then, in case an interrupt was missed
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(RADIO_POLL_INTERVAL));
+        radio->drain();
+    }
+}
+
+/**
+ * @brief Move all packets in the FIFO of the radio to the ring buffer. Runs in the receive task.
+ */
+void Radio::drain() {
+    lock();
+
+    bool txOk, txFail, rxReady;
+    radio.whatHappened(txOk, txFail, rxReady); // Clear the flags, such that the IRQ pin is released
+    if (radio.rxFifoFull()) stats.fifoFull.fetch_add(1, std::memory_order_relaxed);
+
+    u8_t discard[RADIO_MTU];
+    u8_t length;
+    for (;;) {
+        u8_t* slot = ring.claim();
+        if (!readPacket(slot != nullptr ? slot : discard, &length)) break;
+
+        if (slot != nullptr) {
+            ring.commit(length);
+        }
+        else {
+            ring.drop();
+        }
+    }
+
+    unlock();
+}
+
+void Radio::lock() {
+    if (sync != nullptr) xSemaphoreTake(sync, portMAX_DELAY);
+}
+
+void Radio::unlock() {
+    if (sync != nullptr) xSemaphoreGive(sync);
+}
+
 String Radio::toString() {
         String result = "Radio Status:\n";
         result += "Millis since last receive: " + String(payload.receivedAt) + "\n";
@@ -70,45 +137,228 @@ String Radio::toString() {
         return result;
 }
 
-bool Radio::write(RadioPayload payload) {
+void Radio::listen() {
+    if (mode != RadioMode::READER) {
+        radio.startListening();
+        mode = RadioMode::READER;
+    }
+}
+
+void Radio::transmit() {
     if (mode != RadioMode::WRITER) {
         radio.stopListening();
         mode = RadioMode::WRITER;
     }
-    // copy the data into the local payload
-/*     size_t block_index = 0;
-    while(block_index < payload.length) {
-        u8_t end_of_block_index = block_index + 31;
-        u8_t end_of_block = payload.data[end_of_block_index];
+}
 
-        payload.data[end_of_block_index] = payload.length - block_index;
-        radio.write(payload.data + block_index, 32);
-        
-        payload.data[end_of_block_index] = end_of_block;
-        block_index += 31;
-    } */
+/**
+ * @brief Write a packet from the outgoing buffer, and count its retries. PLOS_CNT saturates at 15
+ * and is only reset by changing the channel, so lost packets are counted here instead.
+ *
+ * @return false if the packet was not acknowledged
+ */
+bool Radio::writePacket(u8_t length) {
+    bool success = radio.write(outgoing, length);
+    stats.sent.fetch_add(1, std::memory_order_relaxed);
+    stats.retransmits.fetch_add(radio.getARC(), std::memory_order_relaxed);
+    if (!success) stats.lost.fetch_add(1, std::memory_order_relaxed);
+    return success;
+}
 
-    return radio.write(payload.data, payload.length);
+/**
+ * @brief Send the fragments that are queued in the sender
+ *
+ * @return false if a fragment could not be sent
+ */
+bool Radio::sendPending() {
+    transmit();
+
+    bool success = true;
+    size_t length;
+    while ((length = sender.next(outgoing)) != 0) {
+        success &= writePacket(length);
+    }
+
+    return success;
 }
 
-Option<RadioPayload> Radio::read() {
-    if (mode != RadioMode::READER) {
-        radio.startListening();
-        mode = RadioMode::READER;
+/**
+ * @brief Request the missing fragments of stalled messages
+ */
+void Radio::sendNacks() {
+    size_t length;
+    while ((length = reassembler.nextNack(outgoing)) != 0) {
+        transmit();
+        writePacket(length);
+    }
+}
+
+/**
+ * @brief Send a message, split in fragments
+ *
+ * @param payload The message. It is copied, so it may be released after the call.
+ * @return false if the message is too large, or a fragment could not be sent
+ */
+bool Radio::write(RadioPayload payload) {
+    if (!sender.begin(payload.data, payload.length)) {
+        log_printf("Radio message of %d bytes is too large\n", payload.length);
+        return false;
     }
 
-    payload.length = 0;
+    lock();
+    bool success = sendPending();
+    if (receiver != nullptr) listen(); // The receive task relies on the radio listening
+    unlock();
+
+    return success;
+}
+
+/**
+ * @brief Read a packet from the FIFO of the radio. The bus must be locked.
+ *
+ * @param packet Where the packet is written. Must hold RADIO_MTU bytes.
+ * @param length Set to the length of the packet
+ * @return false if the FIFO is empty
+ */
+bool Radio::readPacket(u8_t* packet, u8_t* length) {
     uint8_t pipe = 0;
     while (radio.available(&pipe))
     {
-        radio.read(payload.data + payload.length, 32);
-        payload.length += 32;
+        *length = radio.getDynamicPayloadSize();
+        if (*length == 0 || RADIO_MTU < *length) {
+            radio.flush_rx(); // The payload is corrupt, as described by the RF24 library
+            stats.corrupt.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        radio.read(packet, *length);
+        stats.packets.fetch_add(1, std::memory_order_relaxed);
+        return true;
     }
-    payload.receivedAt = millis();
 
-    if (payload.length > 0) {
-        return Option<RadioPayload>(payload);
+    return false;
+}
+
+/**
+ * @brief Get the next received packet into the incoming buffer, from the ring buffer if the
+ * receive task runs, and otherwise from the radio.
+ *
+ * @param length Set to the length of the packet
+ * @return false if no packet is waiting
+ */
+bool Radio::nextPacket(u8_t* length) {
+    if (receiver == nullptr) {
+        return readPacket(incoming, length);
     }
-    
+
+    const u8_t* packet = ring.peek(length);
+    if (packet == nullptr) return false;
+
+    memcpy(incoming, packet, *length);
+    ring.pop();
+    return true;
+}
+
+/**
+ * @brief Read the received fragments, until a message is complete. Also answers NACKs for
+ * the last message that was written, and requests lost fragments.
+ *
+ * @return The message, if one was completed. The data is valid until the next read.
+ */
+Option<RadioPayload> Radio::read() {
+    lock();
+    listen();
+    unlock();
+    reassembler.expire();
+
+    u8_t length;
+    while (nextPacket(&length))
+    {
+        if (sender.onNack(incoming, length)) {
+            lock();
+            sendPending();
+            listen();
+            unlock();
+            continue;
+        }
+
+        const u8_t* message;
+        size_t messageLength;
+        if (reassembler.push(incoming, length, &message, &messageLength)) {
+            payload = { message, (u16_t)messageLength, (long)millis() };
+            return Option<RadioPayload>(payload);
+        }
+    }
+
+    lock();
+    sendNacks();
+    listen();
+    unlock();
     return Option<RadioPayload>().empty();
-}
\ No newline at end of file
+}
+
+void Radio::onData(OnFrame callback) {
+    dataCallback = callback;
+}
+
+/**
+ * @brief Read the counters of the radio. The counters are read one by one, so they may be off by
+ * the packets handled meanwhile.
+ */
+RadioStats Radio::getStats() {
+    return RadioStats{
+        stats.sent.load(std::memory_order_relaxed),
+        stats.retransmits.load(std::memory_order_relaxed),
+        stats.lost.load(std::memory_order_relaxed),
+        stats.interrupts.load(std::memory_order_relaxed),
+        stats.packets.load(std::memory_order_relaxed),
+        stats.corrupt.load(std::memory_order_relaxed),
+        stats.fifoFull.load(std::memory_order_relaxed),
+        ring.getDrops(),
+    };
+}
+
+FragmentSenderStats Radio::getSenderStats() {
+    return sender.getStats();
+}
+
+ReassemblyStats Radio::getReassemblyStats() {
+    return reassembler.getStats();
+}
+
+/**
+ * @brief Get the counters of the radio as a link. Packets lost on the way in are those that did
+ * not fit in the ring buffer.
+ */
+LinkCounters Radio::getLinkCounters() {
+    RadioStats counters = getStats();
+    FragmentSenderStats sent = sender.getStats();
+    ReassemblyStats received = reassembler.getStats();
+
+    LinkCounters link = {};
+    link.sent = counters.sent;
+    link.received = counters.packets;
+    link.retransmits = counters.retransmits + sent.retransmits;
+    link.lost = counters.lost + counters.ringDrops;
+    link.reassemblyTimeouts = received.timeouts + received.evictions;
+    link.crcErrors = counters.corrupt + received.invalid;
+    return link;
+}
+
+String Radio::getName() {
+    return "Radio";
+}
+
+/**
+ * @brief Pass every complete message to the data callback
+ */
+void Radio::update() {
+    for (;;) {
+        Option<RadioPayload> received = read();
+        if (received.isEmpty()) return;
+
+        if (dataCallback != nullptr) {
+            dataCallback(received.getValue().data, received.getValue().length);
+        }
+    }
+}
@@ -1,10 +1,25 @@
 #pragma once
 
 #include <RF24.h>
+#include <atomic>
 #include <optional.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "fragmentation.h"
+#include "framing.h"
+#include "packet_ring.h"
+#include "../diagnostics/link_monitor.h"
+#include "../scheduler/scheduler.h"
+
+#define RADIO_MTU 32 // Largest payload of the nRF24L01
+#define RADIO_MAX_MESSAGE_SIZE 1024
+#define RADIO_RING_SLOTS 32 // Packets buffered between the receive task and the main loop
+#define RADIO_POLL_INTERVAL 50 // ms between reads of the radio if no interrupt arrives
+#define RADIO_SETUP_ATTEMPTS 5 // Tries to reach the radio, 200 ms apart, before it is considered absent
 
 struct RadioPayload {
-    u8_t* data;
+    const u8_t* data;
     u16_t length;
     long receivedAt;
 };
@@ -15,17 +30,88 @@ enum class RadioMode {
     WRITER,
 };
 
-class Radio {
+/**
+ * @brief Counters of the radio.
+ */
+struct RadioStats {
+    u32_t sent;        // Packets written, including NACKs
+    u32_t retransmits; // Auto-ack retries of the written packets, from ARC_CNT
+    u32_t lost;        // Written packets that were not acknowledged after all retries, like PLOS_CNT
+    u32_t interrupts;  // IRQ edges from the radio
+    u32_t packets;     // Packets read from the radio
+    u32_t corrupt;    // Packets with an invalid length, which are flushed
+    u32_t fifoFull;   // Reads that found the 3-packet RX FIFO full, such that packets may have been lost
+    u32_t ringDrops;  // Packets dropped as the main loop did not drain the ring in time
+};
+
+/**
+ * @brief The counters of RadioStats, updated from the interrupt, the receive task and the main
+ * loop. Read them as RadioStats with Radio::getStats.
+ */
+struct RadioCounters {
+    std::atomic<u32_t> sent;
+    std::atomic<u32_t> retransmits;
+    std::atomic<u32_t> lost;
+    std::atomic<u32_t> interrupts;
+    std::atomic<u32_t> packets;
+    std::atomic<u32_t> corrupt;
+    std::atomic<u32_t> fifoFull;
+};
+
+/**
+ * @brief Sends and receives messages of up to RADIO_MAX_MESSAGE_SIZE bytes over an nRF24L01, by
+ * splitting them into 32-byte fragments. See FragmentHeader for the packet format.
+ *
+ * Receivers request lost fragments with NACKs. A writer only answers them while it reads, so a
+ * writer that wants retransmits must call read() regularly.
+ *
+ * Without an IRQ pin the radio is polled by read(). With an IRQ pin, a high priority task is woken
+ * by the interrupt and moves packets from the 3-packet FIFO of the radio to a ring buffer, such
+ * that bursts are not lost while the main loop is busy. read() then drains the ring buffer.
+ * Used as a process, complete messages are passed to the onData callback.
+ */
+class Radio : public Process, public LinkSource {
     RF24 radio;
     u8_t writerAddress[6];
     u8_t readerAddress[6];
-    RadioPayload payload;
+    RadioPayload payload = {};
     RadioMode mode = RadioMode::NOT_INITIALIZED;
+    FragmentSender sender;
+    FragmentReassembler reassembler;
+    u8_t incoming[RADIO_MTU];
+    u8_t outgoing[RADIO_MTU];
+    PacketRing<RADIO_RING_SLOTS, RADIO_MTU> ring;
+    RadioCounters stats = {};
+    SemaphoreHandle_t sync = nullptr; // Guards the SPI bus while the receive task runs
+    TaskHandle_t receiver = nullptr;
+    OnFrame dataCallback = nullptr;
+
+    void lock();
+    void unlock();
+    void listen();
+    void transmit();
+    bool writePacket(u8_t length);
+    bool sendPending();
+    void sendNacks();
+    bool readPacket(u8_t* packet, u8_t* length);
+    bool nextPacket(u8_t* length);
+    void drain();
+
+    static void onInterrupt(void* arg);
+    static void receiveTask(void* arg);
 
     public:
-    Radio(const char* writer, const char* reader, RadioPayload payload = {new u8_t[256], 0, 0});
-    bool setup(u8_t CE_PIN, u8_t CSN_PIN);
+    Radio(const char* writer, const char* reader, size_t maxMessageSize = RADIO_MAX_MESSAGE_SIZE, bool nack = true);
+    bool setup(u8_t CE_PIN, u8_t CSN_PIN, int8_t IRQ_PIN = -1);
     String toString();
     bool write(RadioPayload payload);
     Option<RadioPayload> read();
-};
\ No newline at end of file
+    void onData(OnFrame callback);
+    RadioStats getStats();
+    FragmentSenderStats getSenderStats();
+    ReassemblyStats getReassemblyStats();
+    LinkCounters getLinkCounters() override;
+
+    String getName() override;
+    void update() override;
+};
@@ -0,0 +1,203 @@
+#include "relay.h"
+#include "../diagnostics/telemetry.h"
+
+static inline u32_t read_u32(const u8_t* data) {
+  return data[0] | data[1] << 8 | data[2] << 16 | (u32_t)data[3] << 24;
+}
+
+static inline void write_u32(u8_t* data, u32_t value) {
+  data[0] = value & 0xFF;
+  data[1] = (value >> 8) & 0xFF;
+  data[2] = (value >> 16) & 0xFF;
+  data[3] = value >> 24;
+}
+
+/**
+ * @brief Construct a new Relay object
+ *
+ * @param send Sends a frame on the transport. Returns false if the frame could not be sent now,
+ * e.g. as the transport is busy, in which case it is tried again after a new backoff.
+ * @param forward Whether to rebroadcast received messages, or only receive and originate them
+ * @param maxMessageSize Largest message that can be relayed
+ * @param suppressCount Copies heard during the backoff after which a rebroadcast is cancelled
+ */
+Relay::Relay(RelaySend send, bool forward, size_t maxMessageSize, u8_t suppressCount) {
+  this->send = send;
+  this->forward = forward;
+  this->suppressCount = suppressCount;
+  capacity = maxMessageSize + RELAY_HEADER_SIZE;
+  outgoing = new u8_t[capacity];
+  Telemetry::allocated(Subsystem::RADIO, capacity);
+}
+
+Relay::~Relay() {
+  for (PendingRelay& entry : pending) {
+    release(entry);
+  }
+  delete[] outgoing;
+  Telemetry::released(Subsystem::RADIO, capacity);
+}
+
+bool Relay::isRelayFrame(const u8_t* data, size_t length) {
+  return RELAY_HEADER_SIZE <= length && data[0] == RELAY_FRAME_MAGIC;
+}
+
+/**
+ * @brief Whether the message was seen before. A hit refreshes the entry, such that ids of messages
+ * that are still flooding stay in the cache.
+ */
+bool Relay::isSeen(u32_t messageId) {
+  for (u8_t i = 0; i < seenCount; i++) {
+    if (seen[i] == messageId) {
+      seenAt[i] = millis();
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Add a message id to the cache, replacing the least recently seen id if it is full
+ */
+void Relay::remember(u32_t messageId) {
+  u8_t index = seenCount;
+  if (seenCount == RELAY_SEEN_SIZE) {
+    index = 0;
+    for (u8_t i = 1; i < seenCount; i++) {
+      if (seenAt[i] < seenAt[index]) index = i;
+    }
+  }
+  else {
+    seenCount++;
+  }
+
+  seen[index] = messageId;
+  seenAt[index] = millis();
+}
+
+/**
+ * @brief Send a message from this controller to every controller within RELAY_MAX_HOPS
+ *
+ * @param hops Rebroadcasts of the message after this one. 0 only reaches the neighbours.
+ * @return false if the message is too large, or could not be sent
+ */
+bool Relay::originate(const u8_t* message, size_t length, u8_t hops) {
+  if (capacity < length + RELAY_HEADER_SIZE) return false;
+
+  u32_t messageId = (u32_t)random(0x10000) << 16 | (u32_t)random(0x10000);
+  outgoing[0] = RELAY_FRAME_MAGIC;
+  outgoing[1] = hops;
+  write_u32(outgoing + 2, messageId);
+  memcpy(outgoing + RELAY_HEADER_SIZE, message, length);
+
+  // Our own message must not be relayed back to us
+  remember(messageId);
+  stats.originated++;
+  return send(outgoing, length + RELAY_HEADER_SIZE);
+}
+
+/**
+ * @brief Queue a copy of the frame to be rebroadcast after a random backoff, with one hop less
+ */
+void Relay::schedule(const u8_t* frame, size_t length, u32_t messageId) {
+  for (PendingRelay& entry : pending) {
+    if (entry.frame != nullptr) continue;
+
+    entry.frame = new u8_t[length];
+    Telemetry::allocated(Subsystem::RADIO, length);
+    memcpy(entry.frame, frame, length);
+    entry.frame[1]--;
+    entry.length = length;
+    entry.messageId = messageId;
+    entry.dueAt = millis() + random(RELAY_BACKOFF_MIN, RELAY_BACKOFF_MAX + 1);
+    entry.heard = 0;
+    return;
+  }
+
+  stats.queueFull++;
+}
+
+void Relay::release(PendingRelay& entry) {
+  if (entry.frame == nullptr) return;
+
+  delete[] entry.frame;
+  Telemetry::released(Subsystem::RADIO, entry.length);
+  entry.frame = nullptr;
+}
+
+/**
+ * @brief Handle a received relay frame. New messages are passed on to the caller, and queued for a
+ * rebroadcast if hops are left.
+ *
+ * @param frame The received frame
+ * @param length Length of the frame
+ * @param message Set to the message in the frame. Valid as long as the frame is.
+ * @param messageLength Set to the length of the message
+ * @return true if the message is new, and should be handled by this controller
+ */
+bool Relay::receive(const u8_t* frame, size_t length, const u8_t** message, size_t* messageLength) {
+  if (!isRelayFrame(frame, length) || capacity < length) {
+    stats.invalid++;
+    return false;
+  }
+
+  u32_t messageId = read_u32(frame + 2);
+  if (isSeen(messageId)) {
+    stats.duplicates++;
+
+    // A neighbour rebroadcast it, so ours may not be needed
+    for (PendingRelay& entry : pending) {
+      if (entry.frame != nullptr && entry.messageId == messageId) entry.heard++;
+    }
+    return false;
+  }
+
+  remember(messageId);
+  stats.received++;
+  if (forward && 0 < frame[1]) {
+    schedule(frame, length, messageId);
+  }
+
+  *message = frame + RELAY_HEADER_SIZE;
+  *messageLength = length - RELAY_HEADER_SIZE;
+  return true;
+}
+
+RelayStats Relay::getStats() {
+  return stats;
+}
+
+String Relay::getName() {
+  return "Relay";
+}
+
+/**
+ * @brief Send the rebroadcast that is due first, unless the last one was sent less than
+ * RELAY_MIN_INTERVAL ago
+ */
+void Relay::update() {
+  u32_t now = millis();
+  if (now - lastSentAt < RELAY_MIN_INTERVAL) return;
+
+  PendingRelay* next = nullptr;
+  for (PendingRelay& entry : pending) {
+    if (entry.frame == nullptr || (s32_t)(now - entry.dueAt) < 0) continue;
+
+    if (suppressCount <= entry.heard) {
+      stats.suppressed++;
+      release(entry);
+      continue;
+    }
+    if (next == nullptr || (s32_t)(entry.dueAt - next->dueAt) < 0) next = &entry;
+  }
+  if (next == nullptr) return;
+
+  if (!send(next->frame, next->length)) {
+    next->dueAt = now + random(RELAY_BACKOFF_MIN, RELAY_BACKOFF_MAX + 1);
+    return;
+  }
+
+  lastSentAt = now;
+  stats.relayed++;
+  release(*next);
+}
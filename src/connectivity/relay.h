@@ -0,0 +1,80 @@
+#pragma once
+
+#include <Arduino.h>
+#include "../scheduler/scheduler.h"
+
+#define RELAY_FRAME_MAGIC 0xFE  // Not a valid first byte of a protobuf message, like CONTROL_FRAME_MAGIC
+#define RELAY_HEADER_SIZE 6
+#define RELAY_MAX_HOPS 4        // Rebroadcasts of a message after the origin
+#define RELAY_SEEN_SIZE 32      // Message ids remembered, such that floods do not loop
+#define RELAY_QUEUE 4           // Rebroadcasts waiting for their backoff
+#define RELAY_BACKOFF_MIN 2     // ms. Rebroadcasts wait a random time in this range, such that
+#define RELAY_BACKOFF_MAX 30    // neighbours that received the same message do not collide
+#define RELAY_MIN_INTERVAL 5    // ms between two rebroadcasts of this relay
+#define RELAY_SUPPRESS_COUNT 3  // Copies heard during the backoff after which the rebroadcast is cancelled.
+                                // See test/test_relay for the simulation it was chosen with.
+
+typedef bool (*RelaySend)(const u8_t* frame, size_t length);
+
+/**
+ * @brief Counters of a relay.
+ */
+struct RelayStats {
+  u32_t originated; // Messages sent by this controller
+  u32_t received;   // New messages received
+  u32_t duplicates; // Copies of messages that were already received
+  u32_t invalid;    // Frames that were too short or too large
+  u32_t relayed;    // Rebroadcasts sent
+  u32_t suppressed; // Rebroadcasts cancelled, as enough neighbours already rebroadcast the message
+  u32_t queueFull;  // Rebroadcasts dropped, as RELAY_QUEUE rebroadcasts were waiting
+};
+
+struct PendingRelay {
+  u8_t* frame; // nullptr if the entry is free
+  size_t length;
+  u32_t messageId;
+  u32_t dueAt;
+  u8_t heard; // Copies heard from other relays since the message was received
+};
+
+/**
+ * @brief Floods messages across controllers that are out of range of the sender, by rebroadcasting
+ * them. Works on complete messages, so any transport can be used, e.g. ESP-NOW or RF24.
+ *
+ * Frame: RELAY_FRAME_MAGIC (1) | hops left (1) | message id (4, little-endian) | message
+ *
+ * The origin picks a random message id. Every relay remembers the ids it has seen in a small LRU
+ * cache, and only passes on new messages. A rebroadcast waits a random backoff, is rate limited,
+ * and is cancelled if suppressCount neighbours rebroadcast the message first. The hop count
+ * is decremented by every relay, and bounds how far a message travels.
+ */
+class Relay : public Process {
+  RelaySend send;
+  bool forward;
+  u8_t suppressCount;
+  size_t capacity;
+  u8_t* outgoing;
+  u32_t seen[RELAY_SEEN_SIZE] = {};
+  u32_t seenAt[RELAY_SEEN_SIZE] = {}; // When the id was last seen, to evict the least recent
+  u8_t seenCount = 0;
+  PendingRelay pending[RELAY_QUEUE] = {};
+  u32_t lastSentAt = 0;
+  RelayStats stats = {};
+
+  bool isSeen(u32_t messageId);
+  void remember(u32_t messageId);
+  void schedule(const u8_t* frame, size_t length, u32_t messageId);
+  void release(PendingRelay& entry);
+
+  public:
+  Relay(RelaySend send, bool forward = true, size_t maxMessageSize = 1024, u8_t suppressCount = RELAY_SUPPRESS_COUNT);
+  ~Relay();
+
+  static bool isRelayFrame(const u8_t* data, size_t length);
+  bool originate(const u8_t* message, size_t length, u8_t hops = RELAY_MAX_HOPS);
+  bool receive(const u8_t* frame, size_t length, const u8_t** message, size_t* messageLength);
+  RelayStats getStats();
+
+  String getName() override;
+  void update() override;
+};
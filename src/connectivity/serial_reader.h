@@ -0,0 +1,29 @@
+#pragma once
+
+#include <Arduino.h>
+#include "framing.h"
+#include "../diagnostics/link_monitor.h"
+#include "../scheduler/scheduler.h"
+
+/**
+ * @brief Reads COBS framed packets from a serial stream without blocking.
+ *
+ * Every update consumes whatever bytes are available and feeds them to a frame decoder. Valid
+ * packets are handed to the data callback. Corrupt or truncated packets are counted and dropped,
+ * and the stream resynchronises on the next frame delimiter. See Framing for the frame format.
+ */
+class SerialProtocol : public Process, public LinkSource {
+  Stream* serial;
+  FrameDecoder decoder;
+
+  public:
+  SerialProtocol(Stream* serial, size_t maxPacketSize = 1024);
+
+  void sendBytes(const uint8_t* data, size_t length);
+  void onData(OnFrame callback);
+  FrameStats getStats();
+  LinkCounters getLinkCounters() override;
+
+  String getName() override;
+  void update() override;
+};
@@ -0,0 +1,79 @@
+#include "hash.h"
+
+#define XXH_PRIME32_1 0x9E3779B1U
+#define XXH_PRIME32_2 0x85EBCA77U
+#define XXH_PRIME32_3 0xC2B2AE3DU
+#define XXH_PRIME32_4 0x27D4EB2FU
+#define XXH_PRIME32_5 0x165667B1U
+
+static inline uint32_t rotl32(uint32_t value, uint8_t bits) {
+  return (value << bits) | (value >> (32 - bits));
+}
+
+// Unaligned little-endian read, as payloads start at arbitrary offsets
+static inline uint32_t read32(const uint8_t* data) {
+  return (uint32_t)data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+static inline uint32_t round32(uint32_t accumulator, uint32_t input) {
+  accumulator += input * XXH_PRIME32_2;
+  accumulator = rotl32(accumulator, 13);
+  return accumulator * XXH_PRIME32_1;
+}
+
+/**
+ * @brief xxHash32 of a buffer. It processes 16 bytes per round, and is fast enough to hash
+ * every received packet.
+ *
+ * @param data The data to hash
+ * @param length Length of the data
+ * @param seed Seed of the hash
+ * @return uint32_t
+ */
+uint32_t Hash::xxh32(const uint8_t* data, size_t length, uint32_t seed) {
+  const uint8_t* end = data + length;
+  uint32_t hash;
+
+  if (16 <= length) {
+    uint32_t v1 = seed + XXH_PRIME32_1 + XXH_PRIME32_2;
+    uint32_t v2 = seed + XXH_PRIME32_2;
+    uint32_t v3 = seed;
+    uint32_t v4 = seed - XXH_PRIME32_1;
+
+    const uint8_t* limit = end - 16;
+    do {
+      v1 = round32(v1, read32(data));
+      v2 = round32(v2, read32(data + 4));
+      v3 = round32(v3, read32(data + 8));
+      v4 = round32(v4, read32(data + 12));
+      data += 16;
+    } while (data <= limit);
+
+    hash = rotl32(v1, 1) + rotl32(v2, 7) + rotl32(v3, 12) + rotl32(v4, 18);
+  }
+  else {
+    hash = seed + XXH_PRIME32_5;
+  }
+
+  hash += (uint32_t)length;
+
+  while (data + 4 <= end) {
+    hash += read32(data) * XXH_PRIME32_3;
+    hash = rotl32(hash, 17) * XXH_PRIME32_4;
+    data += 4;
+  }
+
+  while (data < end) {
+    hash += (*data) * XXH_PRIME32_5;
+    hash = rotl32(hash, 11) * XXH_PRIME32_1;
+    data++;
+  }
+
+  hash ^= hash >> 15;
+  hash *= XXH_PRIME32_2;
+  hash ^= hash >> 13;
+  hash *= XXH_PRIME32_3;
+  hash ^= hash >> 16;
+
+  return hash;
+}
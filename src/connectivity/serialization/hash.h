@@ -0,0 +1,11 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @brief Non-cryptographic hashing of received payloads.
+ */
+class Hash {
+  public:
+  static uint32_t xxh32(const uint8_t* data, size_t length, uint32_t seed = 0);
+};
@@ -1,9 +1,30 @@
 
 #include "message_decoder.h"
+#include "hash.h"
+#include "../../diagnostics/telemetry.h"
+#include "../../leds/layers/registry.h"
 
+/**
+ * @brief Decode the target groups of a broadcast. They are counted on a copy of the stream first,
+ * such that the vector is allocated once, and attributed to the decoder.
+ */
 bool message_decoder_readTargetGroups(pb_istream_t *stream, const pb_field_iter_t *field, void **arg)
 {
     std::vector<uint32_t>* group_ids = static_cast<std::vector<uint32_t>*>(*arg);
+    pb_istream_t counting = *stream;
+    size_t count = 0;
+    while (counting.bytes_left)
+    {
+        uint32_t value;
+        if (!pb_decode_varint32(&counting, &value))
+            return false;
+        count++;
+    }
+
+    size_t capacity = group_ids->capacity();
+    group_ids->reserve(group_ids->size() + count);
+    Telemetry::reallocated(Subsystem::DECODER, capacity * sizeof(uint32_t), group_ids->capacity() * sizeof(uint32_t));
+
     while (stream->bytes_left)
     {
         uint32_t value;
@@ -14,82 +35,278 @@ bool message_decoder_readTargetGroups(pb_istream_t *stream, const pb_field_iter_
     return true;
 }
 
-bool message_decoder_cb_callback(pb_istream_t *stream, const pb_field_t *field, void **arg) {
+/**
+ * @brief Set up the decoding of the payload, before nanopb decodes it. The sequence is held by the
+ * decoder rather than the message, such that it is released if decoding fails halfway.
+ *
+ * @param arg The MessageDecoder
+ */
+bool MessageDecoder::payload_callback(pb_istream_t *stream, const pb_field_t *field, void **arg) {
+  MessageDecoder* decoder = static_cast<MessageDecoder*>(*arg);
+
+  // A later payload replaces an earlier one, as nanopb clears the union
+  decoder->release();
+
   if(field->tag == protocol_Message_sequence_tag) {
       protocol_Sequence *incoming_sequence = static_cast<protocol_Sequence*>(field->pData);
-      Sequence* sequence = new Sequence();
-      incoming_sequence->animations.funcs.decode = SequenceDecoder::decode_animation;
-      incoming_sequence->animations.arg = sequence;
+      decoder->prepareSequence(incoming_sequence);
 
   } else if(field->tag == protocol_Message_broadcast_sequence_tag) {
       protocol_BroadcastSequence *incoming_broadcast = static_cast<protocol_BroadcastSequence*>(field->pData);
-      Sequence* sequence = new Sequence();
-      incoming_broadcast->sequence.animations.funcs.decode = SequenceDecoder::decode_animation;
-      incoming_broadcast->sequence.animations.arg = sequence;
+      decoder->prepareSequence(&incoming_broadcast->sequence);
 
       incoming_broadcast->target_groups.funcs.decode = message_decoder_readTargetGroups;
-      std::vector<uint32_t>* target_groups = new std::vector<uint32_t>();
-      incoming_broadcast->target_groups.arg = target_groups;
+      incoming_broadcast->target_groups.arg = &decoder->targetGroups;
 
   } else if (field->tag == protocol_Message_save_state_tag) {
       protocol_State *incoming_state = static_cast<protocol_State*>(field->pData);
-      Sequence* sequence = new Sequence();
-      incoming_state->sequence.animations.funcs.decode = SequenceDecoder::decode_animation;
-      incoming_state->sequence.animations.arg = sequence;
+      decoder->prepareSequence(&incoming_state->sequence);
 
   } else if (field->tag == protocol_Message_request_state_tag) {
     // No need for extra decoding, this is just a request
+  } else if (field->tag == protocol_Message_patch_tag) {
+    // Patches have no callbacks, nanopb decodes them directly
   }
   // Do not react on other messages.
 
   return true;
 }
 
-bool MessageDecoder::decode(pb_istream_t* stream) {
+/**
+ * @brief Decode a sequence of the payload into a new decodedSequence
+ *
+ * @param incoming The sequence field of the payload
+ */
+void MessageDecoder::prepareSequence(protocol_Sequence* incoming) {
+  decodedSequence = new Sequence();
+  sequenceDecoding.sequence = decodedSequence;
+  SequenceDecoder::prepare(incoming, &sequenceDecoding);
+}
+
+/**
+ * @brief Delete the sequence that has not been passed to a callback, and release the target groups.
+ */
+void MessageDecoder::release() {
+  SequenceDecoder::finish(&sequenceDecoding);
+  Sequence::destroy(decodedSequence);
+  decodedSequence = nullptr;
+  Telemetry::reallocated(Subsystem::DECODER, targetGroups.capacity() * sizeof(uint32_t), 0);
+  std::vector<uint32_t>().swap(targetGroups);
+}
+
+/**
+ * @brief Read the header of a length-delimited field, and point to its content.
+ *
+ * @param stream A stream created by pb_istream_from_buffer(buffer, size)
+ * @param buffer The buffer of the stream, such that the position is found from bytes_left
+ */
+static bool read_delimited(pb_istream_t* stream, const pb_byte_t* buffer, size_t size, const pb_byte_t** data, size_t* length) {
+  uint32_t delimited;
+  if (!pb_decode_varint32(stream, &delimited) || stream->bytes_left < delimited) return false;
+
+  *data = buffer + (size - stream->bytes_left);
+  *length = delimited;
+  return pb_read(stream, nullptr, delimited);
+}
+
+/**
+ * @brief Find the encoded Sequence in a message without decoding it, by walking the field headers.
+ *
+ * @param buffer The encoded message
+ * @param size Length of the message
+ * @param tag Set to the payload tag of the message
+ * @param data Set to the start of the encoded Sequence in the buffer
+ * @param length Set to the length of the encoded Sequence
+ * @return true if the message carries a sequence
+ */
+bool MessageDecoder::findSequence(const pb_byte_t* buffer, size_t size, uint32_t* tag, const pb_byte_t** data, size_t* length) {
+  pb_istream_t message = pb_istream_from_buffer(buffer, size);
+  pb_wire_type_t wire_type;
+  bool eof;
+  if (!pb_decode_tag(&message, &wire_type, tag, &eof) || wire_type != PB_WT_STRING) return false;
+  if (!read_delimited(&message, buffer, size, data, length)) return false;
+  if (*tag == protocol_Message_sequence_tag) return true;
+
+  // Broadcasts and states wrap the sequence in field 1
+  if (*tag != protocol_Message_broadcast_sequence_tag && *tag != protocol_Message_save_state_tag) return false;
+  static_assert(protocol_BroadcastSequence_sequence_tag == 1 && protocol_State_sequence_tag == 1, "Sequence must be field 1");
+
+  const pb_byte_t* wrapped = *data;
+  size_t wrappedSize = *length;
+  pb_istream_t wrapper = pb_istream_from_buffer(wrapped, wrappedSize);
+  uint32_t field;
+  while (pb_decode_tag(&wrapper, &wire_type, &field, &eof)) {
+    if (field == 1 && wire_type == PB_WT_STRING) return read_delimited(&wrapper, wrapped, wrappedSize, data, length);
+    if (!pb_skip_field(&wrapper, wire_type)) return false;
+  }
+
+  return false;
+}
+
+/**
+ * @brief Whether a target group is the group of this controller. Groups are varints, either packed
+ * or as separate fields.
+ *
+ * @return true if the group is found. Sets found to true if any target group is read.
+ */
+static bool read_group(pb_istream_t* stream, const pb_byte_t* buffer, size_t size, pb_wire_type_t wire_type, u32_t group_id, bool* found) {
+  uint32_t value;
+  if (wire_type == PB_WT_VARINT) {
+    *found = true;
+    return pb_decode_varint32(stream, &value) && value == group_id;
+  }
+
+  const pb_byte_t* data;
+  size_t length;
+  if (wire_type != PB_WT_STRING || !read_delimited(stream, buffer, size, &data, &length)) return false;
+
+  pb_istream_t packed = pb_istream_from_buffer(data, length);
+  while (packed.bytes_left && pb_decode_varint32(&packed, &value)) {
+    *found = true;
+    if (value == group_id) return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Check the target groups of a broadcast by walking the field headers, before anything of
+ * the sequence is decoded or allocated.
+ *
+ * @param buffer The encoded message
+ * @param size Length of the message
+ * @param broadcast Set to true if the message is a broadcast sequence
+ * @return false if the message is a broadcast that only targets other groups. Malformed messages
+ * are let through, such that the full decode reports them.
+ */
+bool MessageDecoder::isTargeted(const pb_byte_t* buffer, size_t size, bool* broadcast) {
+  *broadcast = false;
+
+  pb_istream_t message = pb_istream_from_buffer(buffer, size);
+  pb_wire_type_t wire_type;
+  uint32_t tag;
+  bool eof;
+  const pb_byte_t* data;
+  size_t length;
+  if (!pb_decode_tag(&message, &wire_type, &tag, &eof) || tag != protocol_Message_broadcast_sequence_tag) return true;
+  if (wire_type != PB_WT_STRING || !read_delimited(&message, buffer, size, &data, &length)) return true;
+  *broadcast = true;
+
+  // No target groups means every group. The groups may come before or after the sequence.
+  pb_istream_t wrapper = pb_istream_from_buffer(data, length);
+  bool found = false;
+  uint32_t field;
+  while (pb_decode_tag(&wrapper, &wire_type, &field, &eof)) {
+    if (field != protocol_BroadcastSequence_target_groups_tag) {
+      if (!pb_skip_field(&wrapper, wire_type)) return true;
+      continue;
+    }
+
+    if (read_group(&wrapper, data, length, wire_type, groupId, &found)) return true;
+  }
+
+  return !found;
+}
+
+/**
+ * @brief Construct a new Message Decoder object
+ *
+ * @param scheduler Sequences that are already playing on this scheduler are not decoded again.
+ * Pass nullptr to decode every sequence.
+ */
+MessageDecoder::MessageDecoder(SequenceScheduler* scheduler) : scheduler(scheduler) {}
+
+/**
+ * @brief Decode a message, and pass it to its callback
+ *
+ * @param data The encoded message. Messages are always decoded from memory, such that sequences
+ * can be found and hashed before they are decoded.
+ * @param length Length of the message
+ * @return false if the message could not be decoded, or has no callback
+ */
+bool MessageDecoder::decode(const pb_byte_t* data, size_t length) {
   protocol_Message incomingMessage = protocol_Message_init_zero;
-  std::vector<uint32_t> target_groups;
 
-  incomingMessage.cb_payload.funcs.decode = message_decoder_cb_callback; // Set the callback for decoding the payload
+  // Skip broadcasts for other groups, without decoding the sequence
+  bool broadcast;
+  if (!isTargeted(data, length, &broadcast)) {
+    groupFilterStats.rejected++;
+    return true;
+  }
+  if (broadcast) groupFilterStats.accepted++;
+
+  // Hash the encoded sequence, and skip the message if that sequence is already playing.
+  // Saved states are always decoded, as they also need to be stored.
+  uint32_t tag;
+  sequenceHash = 0;
+  if (findSequence(data, length, &tag, &sequenceData, &sequenceLength)) {
+    sequenceHash = Hash::xxh32(sequenceData, sequenceLength);
+    if (sequenceHash == 0) sequenceHash = 1; // 0 means no hash
+
+    // A paused sequence is not shown, so receiving it again must hand the animator back to it
+    if (scheduler != nullptr && tag != protocol_Message_save_state_tag && !scheduler->isPaused() && sequenceHash == scheduler->getHash()) {
+      dedupeStats.hits++;
+      return true;
+    }
+    dedupeStats.misses++;
+  }
+
+  incomingMessage.cb_payload.funcs.decode = MessageDecoder::payload_callback; // Set the callback for decoding the payload
+  incomingMessage.cb_payload.arg = this;
 
   // Setup callbacks for decoding 
-  if (!pb_decode(stream, protocol_Message_fields, &incomingMessage)) {
+  pb_istream_t stream = pb_istream_from_buffer(data, length);
+  bool success = pb_decode(&stream, protocol_Message_fields, &incomingMessage);
+  SequenceDecoder::finish(&sequenceDecoding); // The palette is not needed once the layers are decoded
+  if (!success) {
     debug("\033[1;31mFailed to decode message\033[0m\n", 0);
-    return false;  // Return empty sequence if decoding fails
+  }
+  else {
+    success = dispatch(&incomingMessage);
   }
 
-  Sequence* sequence;
+  // Release anything decoded that was not passed on, e.g. a partial sequence
+  release();
+  return success;
+}
+
+/**
+ * @brief Pass a decoded message to its callback. Sequences are handed over to the callback.
+ *
+ * @param message The decoded message
+ * @return false if no callback is set for the message
+ */
+bool MessageDecoder::dispatch(protocol_Message* message) {
+  Sequence* sequence = decodedSequence;
 
-  switch (incomingMessage.which_payload) {
+  switch (message->which_payload) {
     case protocol_Message_sequence_tag: {
-      sequence = static_cast<Sequence*>(incomingMessage.payload.sequence.animations.arg);
       if (this->onSequenceReceived == nullptr) {
         debug("\033[1;31mNo callback set for sequence received\033[0m\n", 0);
         return false;
       }
+      decodedSequence = nullptr;
       this->onSequenceReceived(sequence);
       break;
     }
 
     case protocol_Message_broadcast_sequence_tag: {
-      protocol_BroadcastSequence broadcast = incomingMessage.payload.broadcast_sequence;
-      sequence = static_cast<Sequence*>(broadcast.sequence.animations.arg);
-      std::vector<uint32_t>* group_ids = static_cast<std::vector<uint32_t>*>(broadcast.target_groups.arg);
       if (this->onBroadcastSequenceReceived == nullptr) {
         debug("\033[1;31mNo callback set for broadcast sequence received\033[0m\n", 0);
         return false;
       }
-      this->onBroadcastSequenceReceived(sequence, group_ids);
+      decodedSequence = nullptr;
+      this->onBroadcastSequenceReceived(sequence, &targetGroups);
       break;
     }
 
     case protocol_Message_save_state_tag: {
-      protocol_State* state = &incomingMessage.payload.save_state;
-      sequence = static_cast<Sequence*>(state->sequence.animations.arg);
+      protocol_State* state = &message->payload.save_state;
 
       if (this->onSaveStateReceived == nullptr) {
         debug("\033[1;31mNo callback set for save state received\033[0m\n", 0);
         return false;
       }
+      decodedSequence = nullptr;
       this->onSaveStateReceived(sequence, &state->settings);
       break;
     }
@@ -101,11 +318,31 @@ bool MessageDecoder::decode(pb_istream_t* stream) {
       this->onRequestState();
       break;
     }
+    case protocol_Message_patch_tag: {
+      if (this->onPatchReceived == nullptr) {
+        debug("\033[1;31mNo callback set for patch received\033[0m\n", 0);
+        return false;
+      }
+      // Unknown fields are passed on as NoField, which no layer accepts
+      int32_t field = enum_value(message->payload.patch.field);
+      if (field < _protocol_LayerField_MIN || _protocol_LayerField_MAX < field) {
+        message->payload.patch.field = protocol_LayerField_NoField;
+      }
+      this->onPatchReceived(&message->payload.patch);
+      break;
+    }
   }
 
   return true;
 }
 
+/**
+ * @brief Set the group of this controller. Broadcast sequences for other groups are skipped.
+ */
+void MessageDecoder::setGroup(u32_t groupId) {
+  this->groupId = groupId;
+}
+
 void MessageDecoder::setOnSequenceReceived(OnSequenceReceived callback) {
   this->onSequenceReceived = callback;
 }
@@ -120,4 +357,39 @@ void MessageDecoder::setOnSaveStateReceived(OnSaveStateReceived callback) {
 
 void MessageDecoder::setOnRequestState(OnRequestState callback) {
   this->onRequestState = callback;
+}
+
+void MessageDecoder::setOnPatchReceived(OnPatchReceived callback) {
+  this->onPatchReceived = callback;
+}
+
+/**
+ * @brief Get the hash of the encoded sequence in the message being decoded. Pass it to
+ * SequenceScheduler::set, such that copies of the sequence are recognised.
+ *
+ * @return u32_t The hash, or 0 if the message has no sequence. Only valid during the callbacks.
+ */
+u32_t MessageDecoder::getSequenceHash() {
+  return sequenceHash;
+}
+
+/**
+ * @brief Get the encoded sequence in the message being decoded, which the hash was taken over. A
+ * gateway keeps it to resend the sequence, see SequenceBeacon::keep.
+ *
+ * @param length Set to the length of the encoded sequence
+ * @return const pb_byte_t* The encoded sequence, or nullptr if the message has no sequence. Only
+ * valid during the callbacks.
+ */
+const pb_byte_t* MessageDecoder::getSequenceData(size_t* length) {
+  *length = sequenceHash == 0 ? 0 : sequenceLength;
+  return sequenceHash == 0 ? nullptr : sequenceData;
+}
+
+DedupeStats MessageDecoder::getDedupeStats() {
+  return dedupeStats;
+}
+
+GroupFilterStats MessageDecoder::getGroupFilterStats() {
+  return groupFilterStats;
 }
\ No newline at end of file
@@ -2,21 +2,64 @@
 
 #include "common.h"
 
+// The sequence callbacks take ownership of the sequence. The group ids are only valid during the callback.
 typedef void (*OnSequenceReceived)(Sequence* sequence);
 typedef void (*OnBroadcastSequenceReceived)(Sequence* sequence, std::vector<uint32_t>* group_ids);
 typedef void (*OnSaveStateReceived)(Sequence* sequence, protocol_Settings* settings);
 typedef void (*OnRequestState)();
+typedef void (*OnPatchReceived)(protocol_Patch* patch);
+
+/**
+ * @brief Counters of the sequence deduplication.
+ */
+struct DedupeStats {
+  u32_t hits;   // Sequences skipped as they were already playing
+  u32_t misses; // Sequences that were decoded
+};
+
+/**
+ * @brief Counters of the group filter of broadcast sequences.
+ */
+struct GroupFilterStats {
+  u32_t accepted; // Broadcasts that target the group of this controller, or every group
+  u32_t rejected; // Broadcasts skipped before decoding, as they target other groups
+};
 
 class MessageDecoder {
+  SequenceScheduler* scheduler;
+  u32_t groupId = 0;
+  u32_t sequenceHash = 0;
+  const pb_byte_t* sequenceData = nullptr; // The encoded sequence the hash was taken over
+  size_t sequenceLength = 0;
+  Sequence* decodedSequence = nullptr; // Owned by the decoder until it is passed to a callback
+  SequenceDecoding sequenceDecoding = {}; // The palette of decodedSequence, while it is decoded
+  std::vector<uint32_t> targetGroups;
+  DedupeStats dedupeStats = {};
+  GroupFilterStats groupFilterStats = {};
   OnSequenceReceived onSequenceReceived = nullptr;
   OnBroadcastSequenceReceived onBroadcastSequenceReceived = nullptr;
   OnSaveStateReceived onSaveStateReceived = nullptr;
   OnRequestState onRequestState = nullptr;
+  OnPatchReceived onPatchReceived = nullptr;
+
+  bool isTargeted(const pb_byte_t* buffer, size_t size, bool* broadcast);
+  static bool findSequence(const pb_byte_t* buffer, size_t size, uint32_t* tag, const pb_byte_t** data, size_t* length);
+  static bool payload_callback(pb_istream_t* stream, const pb_field_t* field, void** arg);
+  void prepareSequence(protocol_Sequence* incoming);
+  bool dispatch(protocol_Message* message);
+  void release();
 
   public:
-  bool decode(pb_istream_t* stream);
+  MessageDecoder(SequenceScheduler* scheduler = nullptr);
+  bool decode(const pb_byte_t* data, size_t length);
+  void setGroup(u32_t groupId);
+  u32_t getSequenceHash();
+  const pb_byte_t* getSequenceData(size_t* length);
+  DedupeStats getDedupeStats();
+  GroupFilterStats getGroupFilterStats();
   void setOnSequenceReceived(OnSequenceReceived callback);
   void setOnBroadcastSequenceReceived(OnBroadcastSequenceReceived callback);
   void setOnSaveStateReceived(OnSaveStateReceived callback);
   void setOnRequestState(OnRequestState callback);
+  void setOnPatchReceived(OnPatchReceived callback);
 };
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include "message_encoder.h"
+#include "debug.h"
+#include "../../leds/serialization/sequence_encoder.h"
+
+bool MessageEncoder::write_callback(pb_ostream_t* stream, const pb_byte_t* buf, size_t count) {
+  static_cast<FrameEncoder*>(stream->state)->write(buf, count);
+  return true;
+}
+
+/**
+ * @brief Create a protobuf stream that writes into a frame.
+ *
+ * @param frame The frame to write the encoded message to
+ * @return pb_ostream_t
+ */
+pb_ostream_t MessageEncoder::frameStream(FrameEncoder* frame) {
+  pb_ostream_t stream = { &MessageEncoder::write_callback, frame, SIZE_MAX, 0 };
+  return stream;
+}
+
+/**
+ * @brief Encode a message as a single frame on the output, and flush the output.
+ * If encoding fails halfway, the frame is ended without CRC, such that the host drops it.
+ *
+ * @param output Where the frame is written, e.g. Serial or a BluetoothStream
+ * @param message The message to send
+ * @return true if the message was sent
+ */
+bool MessageEncoder::send(Print* output, const protocol_Message* message) {
+  FrameEncoder frame(output);
+  pb_ostream_t stream = frameStream(&frame);
+
+  bool success = pb_encode(&stream, protocol_Message_fields, message);
+  if (success) {
+    frame.finish();
+  }
+  else {
+    debug("\033[1;31mFailed to encode message: %s\033[0m\n", PB_GET_ERROR(&stream));
+    frame.abort();
+  }
+
+  output->flush();
+  return success;
+}
+
+/**
+ * @brief Send the state of the device as a response_state message.
+ *
+ * @param output Where the response is written
+ * @param state The current sequence and settings
+ * @param diagnostics Telemetry to include, or nullptr
+ * @return true if the response was sent
+ */
+bool MessageEncoder::sendState(Print* output, State* state, const protocol_Diagnostics* diagnostics) {
+  protocol_Message message = protocol_Message_init_zero;
+  message.which_payload = protocol_Message_response_state_tag;
+
+  protocol_State* response = &message.payload.response_state;
+  SequenceEncoding encoding;
+  response->has_sequence = true;
+  response->sequence = SequenceEncoder::toEncodable(state->sequence, &encoding);
+
+  response->has_settings = true;
+  response->settings.group_id = state->settings->group_id;
+  response->settings.virtual_offset = state->settings->virtual_offset;
+
+  if (diagnostics != nullptr) {
+    response->has_diagnostics = true;
+    response->diagnostics = *diagnostics;
+  }
+
+  return send(output, &message);
+}
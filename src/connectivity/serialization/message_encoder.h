@@ -0,0 +1,24 @@
+#pragma once
+
+#include <Arduino.h>
+#include <pb_encode.h>
+#include "protocol.pb.h"
+#include "common.h"
+#include "../framing.h"
+
+/**
+ * @brief Encodes messages for the host directly into a framed transport.
+ *
+ * The message is never held in memory as a whole. The protobuf stream feeds a FrameEncoder,
+ * which only holds one COBS block and passes it on to the output: the serial TX buffer, or
+ * a BluetoothStream that sends notifications. The memory needed is therefore independent of
+ * the size of the sequence.
+ */
+class MessageEncoder {
+  static bool write_callback(pb_ostream_t* stream, const pb_byte_t* buf, size_t count);
+
+  public:
+  static pb_ostream_t frameStream(FrameEncoder* frame);
+  static bool send(Print* output, const protocol_Message* message);
+  static bool sendState(Print* output, State* state, const protocol_Diagnostics* diagnostics);
+};
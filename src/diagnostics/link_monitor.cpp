@@ -0,0 +1,138 @@
+#include "link_monitor.h"
+
+static_assert(sizeof(LinkCounters) == LINK_COUNTERS * sizeof(u32_t), "Link counters are averaged as an array");
+
+static const char* linkNames[(size_t)Link::COUNT] = { "rf24", "espnow", "ble", "serial" };
+
+static inline u32_t* counters(LinkCounters* link) {
+  return reinterpret_cast<u32_t*>(link);
+}
+
+/**
+ * @brief Construct a new Link Monitor object
+ *
+ * @param reportEvery Print the links to serial every `reportEvery` samples. 0 disables printing.
+ */
+LinkMonitor::LinkMonitor(u16_t reportEvery) : reportEvery(reportEvery) {
+  sampledAt = millis();
+}
+
+String LinkMonitor::getName() {
+  return "Link Monitor";
+}
+
+/**
+ * @brief Sample the counters of a transport from now on
+ *
+ * @param link The link the transport is reported as
+ * @param source The transport
+ */
+void LinkMonitor::watch(Link link, LinkSource* source) {
+  sources[(size_t)link] = source;
+  last[(size_t)link] = getCounters(link); // Averages start from now, not from boot
+}
+
+/**
+ * @brief Count a message received on a link that could not be decoded
+ */
+void LinkMonitor::countDecodeError(Link link) {
+  decodeErrors[(size_t)link]++;
+}
+
+/**
+ * @brief Get the counters of a link since boot
+ */
+LinkCounters LinkMonitor::getCounters(Link link) {
+  LinkCounters current = {};
+  if (sources[(size_t)link] != nullptr) {
+    current = sources[(size_t)link]->getLinkCounters();
+  }
+  current.decodeErrors = decodeErrors[(size_t)link];
+  return current;
+}
+
+/**
+ * @brief Get the moving averages of the counters of a link, per minute
+ */
+LinkCounters LinkMonitor::getPerMinute(Link link) {
+  LinkCounters rates;
+  for (size_t i = 0; i < LINK_COUNTERS; i++) {
+    counters(&rates)[i] = (u32_t)(averages[(size_t)link][i] + 0.5f);
+  }
+  return rates;
+}
+
+/**
+ * @brief Add the counts since the last sample to the moving averages. The rate is taken over the
+ * actual time since the last sample, such that late updates do not skew the averages.
+ */
+void LinkMonitor::sample() {
+  u32_t now = millis();
+  u32_t elapsed = now - sampledAt;
+  if (elapsed == 0) return;
+  sampledAt = now;
+
+  for (size_t link = 0; link < (size_t)Link::COUNT; link++) {
+    LinkCounters current = getCounters((Link)link);
+    for (size_t i = 0; i < LINK_COUNTERS; i++) {
+      float perMinute = (float)(counters(&current)[i] - counters(&last[link])[i]) * 60000 / elapsed;
+      averages[link][i] += LINK_AVERAGE_WEIGHT * (perMinute - averages[link][i]);
+    }
+    last[link] = current;
+  }
+}
+
+/**
+ * @brief Print a line per watched link to serial, with the counters since boot and their averages
+ * per minute, e.g.
+ * [links] rf24 tx=1200/60 rx=3400/170 retx=35/2 lost=4/0 timeout=1/0 crc=0/0 dec=0/0
+ */
+void LinkMonitor::printStats() {
+  for (size_t link = 0; link < (size_t)Link::COUNT; link++) {
+    if (sources[link] == nullptr) continue;
+
+    LinkCounters total = getCounters((Link)link);
+    LinkCounters rate = getPerMinute((Link)link);
+    log_printf("[links] %s tx=%lu/%lu rx=%lu/%lu retx=%lu/%lu lost=%lu/%lu timeout=%lu/%lu crc=%lu/%lu dec=%lu/%lu\n", linkNames[link],
+      total.sent, rate.sent, total.received, rate.received, total.retransmits, rate.retransmits, total.lost, rate.lost,
+      total.reassemblyTimeouts, rate.reassemblyTimeouts, total.crcErrors, rate.crcErrors, total.decodeErrors, rate.decodeErrors);
+  }
+}
+
+static void toEncodable(const LinkCounters& counters, protocol_LinkCounters* encoded) {
+  encoded->sent = counters.sent;
+  encoded->received = counters.received;
+  encoded->retransmits = counters.retransmits;
+  encoded->lost = counters.lost;
+  encoded->reassembly_timeouts = counters.reassemblyTimeouts;
+  encoded->crc_errors = counters.crcErrors;
+  encoded->decode_errors = counters.decodeErrors;
+}
+
+/**
+ * @brief Add the watched links to the diagnostics
+ */
+void LinkMonitor::toEncodable(protocol_Diagnostics* diagnostics) {
+  for (size_t link = 0; link < (size_t)Link::COUNT; link++) {
+    if (sources[link] == nullptr) continue;
+    if (diagnostics->links_count == sizeof(diagnostics->links) / sizeof(diagnostics->links[0])) break;
+
+    protocol_LinkStats& encoded = diagnostics->links[diagnostics->links_count++];
+    encoded.link = (protocol_Link)link;
+    encoded.has_total = true;
+    ::toEncodable(getCounters((Link)link), &encoded.total);
+    encoded.has_per_minute = true;
+    ::toEncodable(getPerMinute((Link)link), &encoded.per_minute);
+  }
+}
+
+/**
+ * @brief Sample the links, and print them every `reportEvery` samples
+ */
+void LinkMonitor::update() {
+  sample();
+
+  if (reportEvery == 0 || ++samplesSinceReport < reportEvery) return;
+  samplesSinceReport = 0;
+  printStats();
+}
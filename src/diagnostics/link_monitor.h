@@ -0,0 +1,73 @@
+#pragma once
+
+#include <Arduino.h>
+#include "protocol.pb.h"
+#include "../scheduler/scheduler.h"
+
+#define LINK_AVERAGE_WEIGHT 0.1f // Weight of the latest sample in the moving averages, i.e. about the last 10 samples
+
+/**
+ * @brief Transports whose packets are counted. Matches protocol_Link.
+ */
+enum class Link {
+  RADIO,       // nRF24L01
+  ESPNOW,
+  BLUETOOTH,
+  SERIAL_PORT, // Not SERIAL, which Arduino.h defines
+  COUNT,
+};
+
+/**
+ * @brief Packet counters of a link. Counters that do not apply to a link stay 0.
+ */
+struct LinkCounters {
+  u32_t sent;               // Packets sent
+  u32_t received;           // Packets received
+  u32_t retransmits;        // Packets sent again: auto-ack retries of the radio (ARC_CNT), and retries after failed sends or NACKs
+  u32_t lost;               // Packets never acknowledged (PLOS_CNT), or received but dropped before they were read
+  u32_t reassemblyTimeouts; // Messages dropped as fragments were missing
+  u32_t crcErrors;          // Packets or frames dropped as corrupt
+  u32_t decodeErrors;       // Received messages that could not be decoded
+};
+
+#define LINK_COUNTERS (sizeof(LinkCounters) / sizeof(u32_t))
+
+/**
+ * @brief A transport that reports link counters, since boot.
+ */
+class LinkSource {
+  public:
+  virtual LinkCounters getLinkCounters() = 0;
+};
+
+/**
+ * @brief Collects the counters of every link, and keeps moving averages of them per minute, to
+ * compare channels, data rates and placements across a venue.
+ *
+ * The counters are sampled on every update. Decode errors happen after the transport, so they are
+ * counted with countDecodeError().
+ */
+class LinkMonitor : public Process {
+  LinkSource* sources[(size_t)Link::COUNT] = {};
+  u32_t decodeErrors[(size_t)Link::COUNT] = {};
+  LinkCounters last[(size_t)Link::COUNT] = {};
+  float averages[(size_t)Link::COUNT][LINK_COUNTERS] = {};
+  u32_t sampledAt = 0;
+  u16_t samplesSinceReport = 0;
+  u16_t reportEvery;
+
+  public:
+  LinkMonitor(u16_t reportEvery = 60);
+
+  void watch(Link link, LinkSource* source);
+  void countDecodeError(Link link);
+  LinkCounters getCounters(Link link);
+  LinkCounters getPerMinute(Link link);
+
+  void sample();
+  void printStats();
+  void toEncodable(protocol_Diagnostics* diagnostics);
+
+  String getName() override;
+  void update() override;
+};
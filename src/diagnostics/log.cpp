@@ -0,0 +1,73 @@
+#include "log.h"
+#include "../connectivity/framing.h"
+
+QueueHandle_t Log::queue = nullptr;
+std::atomic<u32_t> Log::dropped(0);
+
+/**
+ * @brief Format a line and queue it as a log frame. Safe to call from any task, but not from an ISR.
+ */
+void log_printf(const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  Log::write(format, args);
+  va_end(args);
+}
+
+/**
+ * @brief Construct the log process. Lines are queued from now on.
+ *
+ * @param output Where log frames are written, e.g. Serial
+ */
+Log::Log(Print* output) : output(output) {
+  queue = xQueueCreate(LOG_QUEUE_LENGTH, LOG_LINE_SIZE);
+}
+
+String Log::getName() {
+  return "Log";
+}
+
+/**
+ * @brief Format a line into the queue. The line is dropped if the queue is full, as a task must not
+ * block on logging.
+ *
+ * @param format printf format of the line
+ * @param args Arguments of the format
+ */
+void Log::write(const char* format, va_list args) {
+  if (queue == nullptr) {
+    vprintf(format, args);
+    return;
+  }
+
+  char line[LOG_LINE_SIZE];
+  vsnprintf(line, sizeof(line), format, args);
+  if (xQueueSend(queue, line, 0) != pdTRUE) {
+    dropped++;
+  }
+}
+
+/**
+ * @brief Frame every queued line, and report lines that were dropped since the last update.
+ */
+void Log::update() {
+  char line[LOG_LINE_SIZE];
+  while (xQueueReceive(queue, line, 0) == pdTRUE) {
+    send(line);
+  }
+
+  u32_t total = dropped.load();
+  if (total != reportedDropped) {
+    snprintf(line, sizeof(line), "[log] dropped %lu lines\n", (unsigned long)(total - reportedDropped));
+    send(line);
+    reportedDropped = total;
+  }
+}
+
+void Log::send(const char* line) {
+  const uint8_t magic = LOG_FRAME_MAGIC;
+  FrameEncoder encoder(output);
+  encoder.write(&magic, 1);
+  encoder.write((const uint8_t*)line, strlen(line));
+  encoder.finish();
+}
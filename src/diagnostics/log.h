@@ -0,0 +1,40 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <stdarg.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include "../scheduler/scheduler.h"
+
+#define LOG_FRAME_MAGIC 0xEF // Wire type 7, like CONTROL_FRAME_MAGIC, so it is never a Message
+#define LOG_LINE_SIZE 192    // Longer lines are truncated
+#define LOG_QUEUE_LENGTH 8   // Lines waiting for the main loop. Further lines are dropped.
+
+/**
+ * @brief Sends log lines as frames on the port that responses are framed on, such that text never
+ * ends up inside a response frame. Lines are written with log_printf (or debug) from any task, and
+ * queued until this process frames them on the main loop, which is the only writer of the port.
+ *
+ * Frame payload: LOG_FRAME_MAGIC + text of the line, without a terminating zero.
+ *
+ * Until the process is constructed, e.g. early in setup, lines are printed unframed. The leading
+ * delimiter of the next frame separates them from any later frame.
+ */
+class Log : public Process {
+  static QueueHandle_t queue;
+  static std::atomic<u32_t> dropped;
+
+  Print* output;
+  u32_t reportedDropped = 0;
+
+  void send(const char* line);
+
+  public:
+  Log(Print* output);
+
+  static void write(const char* format, va_list args);
+
+  String getName() override;
+  void update() override;
+};
@@ -0,0 +1,165 @@
+#include "telemetry.h"
+#include "log.h"
+
+AllocationCounters Telemetry::allocationCounters[(size_t)Subsystem::COUNT];
+std::vector<WatchedTask> Telemetry::tasks;
+
+static const char* subsystemNames[(size_t)Subsystem::COUNT] = { "dec", "sch", "lay", "rad" };
+
+/**
+ * @brief Construct a new Telemetry object
+ *
+ * @param reportEvery Print a stats line to serial every `reportEvery` samples. 0 disables printing.
+ */
+Telemetry::Telemetry(u16_t reportEvery) : reportEvery(reportEvery) {
+  sample();
+}
+
+String Telemetry::getName() {
+  return "Telemetry";
+}
+
+/**
+ * @brief Attribute an allocation to a subsystem
+ *
+ * @param subsystem The subsystem owning the allocation
+ * @param bytes Size of the allocation
+ */
+void Telemetry::allocated(Subsystem subsystem, size_t bytes) {
+  AllocationCounters& counters = allocationCounters[(size_t)subsystem];
+  counters.allocations.fetch_add(1, std::memory_order_relaxed);
+  u32_t live = counters.liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+
+  u32_t peak = counters.peakBytes.load(std::memory_order_relaxed);
+  while (peak < live && !counters.peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+}
+
+/**
+ * @brief Attribute a release of memory to a subsystem
+ *
+ * @param subsystem The subsystem that owned the allocation
+ * @param bytes Size of the allocation
+ */
+void Telemetry::released(Subsystem subsystem, size_t bytes) {
+  AllocationCounters& counters = allocationCounters[(size_t)subsystem];
+  counters.frees.fetch_add(1, std::memory_order_relaxed);
+
+  u32_t live = counters.liveBytes.load(std::memory_order_relaxed);
+  while (!counters.liveBytes.compare_exchange_weak(live, bytes < live ? live - bytes : 0, std::memory_order_relaxed)) {}
+}
+
+/**
+ * @brief Attribute the reallocation of a buffer to a subsystem, e.g. a vector that was reserved
+ * or released. Nothing is counted if the size did not change.
+ *
+ * @param subsystem The subsystem owning the buffer
+ * @param previousBytes Size of the buffer before, 0 if there was none
+ * @param bytes Size of the buffer now, 0 if it was released
+ */
+void Telemetry::reallocated(Subsystem subsystem, size_t previousBytes, size_t bytes) {
+  if (previousBytes == bytes) return;
+  if (previousBytes != 0) released(subsystem, previousBytes);
+  if (bytes != 0) allocated(subsystem, bytes);
+}
+
+/**
+ * @brief Read the allocation counters of a subsystem. The counters are read one by one, so they
+ * may be off by the allocations made meanwhile.
+ */
+AllocationStats Telemetry::getAllocationStats(Subsystem subsystem) {
+  AllocationCounters& counters = allocationCounters[(size_t)subsystem];
+  return AllocationStats{
+    counters.allocations.load(std::memory_order_relaxed),
+    counters.frees.load(std::memory_order_relaxed),
+    counters.liveBytes.load(std::memory_order_relaxed),
+    counters.peakBytes.load(std::memory_order_relaxed),
+  };
+}
+
+/**
+ * @brief Sample the stack high-water mark of a task on every update
+ *
+ * @param name Short name of the task, at most 15 characters
+ * @param handle Handle of the task. NULL is not allowed, as it would sample the calling task.
+ */
+void Telemetry::watchTask(const char* name, TaskHandle_t handle) {
+  if (handle == nullptr) return;
+  tasks.push_back({ name, handle, 0 });
+}
+
+/**
+ * @brief Sample the current heap and stack usage
+ */
+void Telemetry::sample() {
+  freeHeap = ESP.getFreeHeap();
+  largestFreeBlock = ESP.getMaxAllocHeap();
+  minFreeHeap = ESP.getMinFreeHeap();
+
+  for (WatchedTask& task : tasks) {
+    task.stackFree = uxTaskGetStackHighWaterMark(task.handle);
+  }
+}
+
+/**
+ * @brief Log a compact, single line stats frame, e.g.
+ * [stats] up=61000 heap=201344/110580/198712 stack=loop:5212 alloc=dec:0/0/0 sch:4/0/96 lay:6/0/312 rad:0/0/0
+ * Heap is free/largest block/minimum ever. Allocations are allocations/frees/live bytes.
+ */
+void Telemetry::printStats() {
+  char line[LOG_LINE_SIZE];
+  size_t length = snprintf(line, sizeof(line), "[stats] up=%lu heap=%lu/%lu/%lu stack=", millis(), freeHeap, largestFreeBlock, minFreeHeap);
+  for (size_t i = 0; i < tasks.size() && length < sizeof(line); i++) {
+    length += snprintf(line + length, sizeof(line) - length, i == 0 ? "%s:%lu" : ",%s:%lu", tasks[i].name, tasks[i].stackFree);
+  }
+  if (length < sizeof(line)) length += snprintf(line + length, sizeof(line) - length, " alloc=");
+  for (size_t i = 0; i < (size_t)Subsystem::COUNT && length < sizeof(line); i++) {
+    AllocationStats stats = getAllocationStats((Subsystem)i);
+    length += snprintf(line + length, sizeof(line) - length, i == 0 ? "%s:%lu/%lu/%lu" : " %s:%lu/%lu/%lu", subsystemNames[i], stats.allocations, stats.frees, stats.liveBytes);
+  }
+  // The line is sent as a single log frame
+  log_printf("%s\n", line);
+}
+
+/**
+ * @brief Encode the latest sample into a protocol buffer.
+ *
+ * @return protocol_Diagnostics
+ */
+protocol_Diagnostics Telemetry::toEncodable() {
+  protocol_Diagnostics diagnostics = protocol_Diagnostics_init_zero;
+  diagnostics.uptime = millis();
+  diagnostics.free_heap = freeHeap;
+  diagnostics.largest_free_block = largestFreeBlock;
+  diagnostics.min_free_heap = minFreeHeap;
+
+  for (const WatchedTask& task : tasks) {
+    if (diagnostics.stacks_count == sizeof(diagnostics.stacks) / sizeof(diagnostics.stacks[0])) break;
+
+    protocol_TaskStack& stack = diagnostics.stacks[diagnostics.stacks_count++];
+    strncpy(stack.name, task.name, sizeof(stack.name) - 1);
+    stack.free = task.stackFree;
+  }
+
+  for (size_t i = 0; i < (size_t)Subsystem::COUNT; i++) {
+    AllocationStats stats = getAllocationStats((Subsystem)i);
+    protocol_SubsystemAllocations& encoded = diagnostics.allocations[diagnostics.allocations_count++];
+    encoded.subsystem = (protocol_Subsystem)i;
+    encoded.allocations = stats.allocations;
+    encoded.frees = stats.frees;
+    encoded.live_bytes = stats.liveBytes;
+    encoded.peak_bytes = stats.peakBytes;
+  }
+
+  return diagnostics;
+}
+
+/**
+ * @brief Sample heap and stacks, and print a stats frame every `reportEvery` samples
+ */
+void Telemetry::update() {
+  sample();
+
+  if (reportEvery == 0 || ++samplesSinceReport < reportEvery) return;
+  samplesSinceReport = 0;
+  printStats();
+}
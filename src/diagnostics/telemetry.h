@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <vector>
+#include "protocol.pb.h"
+#include "../scheduler/scheduler.h"
+
+/**
+ * @brief Subsystems that heap allocations are attributed to.
+ */
+enum class Subsystem {
+  DECODER,   // Scratch data owned by the message decoders
+  SCHEDULER, // Sequences and animations
+  LAYERS,    // Layer objects
+  RADIO,     // Radio buffers
+  COUNT,
+};
+
+/**
+ * @brief Allocation counters of a single subsystem.
+ */
+struct AllocationStats {
+  u32_t allocations; // Number of allocations made since boot
+  u32_t frees;       // Number of allocations released since boot
+  u32_t liveBytes;   // Bytes currently held
+  u32_t peakBytes;   // Highest number of bytes held at once
+};
+
+/**
+ * @brief The allocation counters of a subsystem, updated from any task. Read them as
+ * AllocationStats with Telemetry::getAllocationStats.
+ */
+struct AllocationCounters {
+  std::atomic<u32_t> allocations;
+  std::atomic<u32_t> frees;
+  std::atomic<u32_t> liveBytes;
+  std::atomic<u32_t> peakBytes;
+};
+
+/**
+ * @brief A FreeRTOS task whose stack high-water mark is sampled.
+ */
+struct WatchedTask {
+  const char* name;
+  TaskHandle_t handle;
+  u32_t stackFree; // Least free stack seen, in bytes
+};
+
+/**
+ * @brief Periodically samples heap and stack usage, and keeps per-subsystem allocation counters.
+ * Allocation counters are static, such that any subsystem can report to them without a reference
+ * to the telemetry process. They are atomic, as layers, sequences and radio buffers are allocated
+ * from the main loop as well as the radio, Wi-Fi, BLE and UDP tasks.
+ */
+class Telemetry : public Process {
+  static AllocationCounters allocationCounters[(size_t)Subsystem::COUNT];
+  static std::vector<WatchedTask> tasks;
+
+  u32_t freeHeap = 0;
+  u32_t largestFreeBlock = 0;
+  u32_t minFreeHeap = 0;
+  u16_t samplesSinceReport = 0;
+  u16_t reportEvery;
+
+  public:
+  Telemetry(u16_t reportEvery = 60);
+
+  static void allocated(Subsystem subsystem, size_t bytes);
+  static void released(Subsystem subsystem, size_t bytes);
+  static void reallocated(Subsystem subsystem, size_t previousBytes, size_t bytes);
+  static AllocationStats getAllocationStats(Subsystem subsystem);
+  static void watchTask(const char* name, TaskHandle_t handle);
+
+  void sample();
+  void printStats();
+  protocol_Diagnostics toEncodable();
+
+  String getName() override;
+  void update() override;
+};
@@ -1,14 +1,14 @@
 #include "dmx.h"
+#include "debug.h"
 
 // Global variable definitions
-u16_t DMX_START = 3; // 3, 18
+u16_t DMX_START = 1; // 1, 16
 u8_t channels[16] = {0};
 u8_t prevChannels[16] = {0};
 
-// NOTE: The DMX protocol expects 123, 234 on channels 1 and 2, respectively.
-// This is a hack to ensure that the DMX controller is working correctly.
-// This hack is done as the MAX485 often reads faulty data, and this
-// ensures that we only update the animation if the DMX controller is working correctly.
+// NOTE: The MAX485 often reads faulty data. Rather than reserving channels for
+// magic values, the receive task validates every frame, see dmx_lib.cpp, and
+// only complete frames are read here.
 
 /**
  * DMX PROTOCOL
@@ -34,25 +34,21 @@ u8_t prevChannels[16] = {0};
  * fill it with 255 for the first byte, and 0 for the rest.
  * 
  * @param value 
- * @return std::vector<u8_t>* 
+ * @return std::vector<u8_t> 
  */
-std::vector<u8_t> * to_sections(u8_t value) {
-    std::vector<u8_t> * sections = new std::vector<u8_t>();
-    sections->push_back(255);
-    for (int i = 1; i < value; i++) sections->push_back(0);
+std::vector<u8_t> to_sections(u8_t value) {
+    std::vector<u8_t> sections(value, 0);
+    if (0 < value) sections[0] = 255;
     return sections;
 }
 
 /**
  * @brief Creates a vector of sections, where each section is filled with 255.
  * @param value 
- * @return std::vector<u8_t>* 
+ * @return std::vector<u8_t> 
  */
-std::vector<u8_t> * to_full_sections(u8_t value) {
-    std::vector<u8_t> * sections = new std::vector<u8_t>();
-    
-    for (int i = 0; i < value; i++) sections->push_back(255);
-    return sections;
+std::vector<u8_t> to_full_sections(u8_t value) {
+    return std::vector<u8_t>(value, 255);
 }
 
 /** 
@@ -80,16 +76,16 @@ u16_t valueScaler(u16_t value) {
     }
 }
 
-ILayer * dmx_to_mask(u8_t* channels) {
+ILayer * dmx_to_mask(const u8_t* channels) {
     switch(channels[0]) {
         case 1: // WaveMask
             return new WaveMask(valueScaler(channels[1]), valueScaler(channels[2]), valueScaler(channels[3]));
         case 2: // StarsMask
             return new StarsMask(valueScaler(channels[1]), channels[2], channels[3]);
         case 3: 
-            return new BlinkMask(*to_sections(channels[1]), valueScaler(channels[2]));
+            return new BlinkMask(to_sections(channels[1]), valueScaler(channels[2]));
         case 4: // SectionsMask
-            return new SectionsMask(*to_sections(channels[1]), valueScaler(channels[2]));
+            return new SectionsMask(to_sections(channels[1]), valueScaler(channels[2]));
         case 5: // PulseSawtoothMask
             return new PulseSawtoothMask(valueScaler(channels[1]), valueScaler(channels[2]));
         case 6: // PulseMask
@@ -97,14 +93,44 @@ ILayer * dmx_to_mask(u8_t* channels) {
         case 7: // SawtoothMask
             return new SawtoothMask(valueScaler(channels[1]), valueScaler(channels[2]), valueScaler(channels[3]));
         case 8: // SectionsWaveMask
-            return new SectionsWaveMask(*to_sections(channels[1]), valueScaler(channels[2]));
+            return new SectionsWaveMask(to_sections(channels[1]), valueScaler(channels[2]));
         case 9: // SectionsRandomMask
-            return new SectionsRandomMask(*to_full_sections(channels[1]), valueScaler(channels[2]));
+            return new SectionsRandomMask(to_full_sections(channels[1]), valueScaler(channels[2]));
         default:
             return nullptr; // Unknown layer type
     }
 }
 
+/**
+ * @brief Checks whether a mask block can be rendered. dmx_to_mask accepts any values, but masks
+ * divide by their duration and section count, so zero values would crash the animator.
+ * 
+ * @param channels The four channels of a mask block (type and three parameters)
+ * @return true if the block is empty or describes a mask that is safe to apply
+ */
+bool dmx_mask_valid(const u8_t* channels) {
+    switch(channels[0]) {
+        case 0: // No mask
+        case 2: // StarsMask
+            return true;
+        case 1: // WaveMask
+        case 7: // SawtoothMask
+            return channels[1] != 0 && channels[3] != 0;
+        case 3: // BlinkMask
+        case 8: // SectionsWaveMask
+            return channels[1] != 0 && channels[2] != 0;
+        case 4: // SectionsMask
+        case 9: // SectionsRandomMask
+            // Every section needs at least one tick of the duration
+            return channels[1] != 0 && channels[1] <= valueScaler(channels[2]);
+        case 5: // PulseSawtoothMask
+        case 6: // PulseMask
+            return channels[2] != 0;
+        default:
+            return false; // Unknown layer type
+    }
+}
+
 /**
  * @brief Checks whether the channels from `from` to `to` has changed compared to the previous channels.
  * 
@@ -128,6 +154,10 @@ bool hasChannelsChanged(u8_t* channels, u8_t from, u8_t to) {
 // without resetting the wave animation
 SingleColor* color = new SingleColor(CRGB::Black);
 
+// The masks currently shown. They are owned here, and deleted when replaced.
+ILayer* mask1 = nullptr;
+ILayer* mask2 = nullptr;
+
 /**
  * We check whether the 1-7 has changed and only update color if that is the case
  * We check whether the 8-15 has changed and only update masks if that is the case
@@ -135,13 +165,17 @@ SingleColor* color = new SingleColor(CRGB::Black);
  * If a wave animation is running, and only color updates, it makes sense to keep the current position
  * of the wave, so we do not update the masks, as it would reset tick and reset the wave animation.
  * This allows us to smoothly change color without resetting the wave animation.
+ *
+ * Masks that fail dmx_mask_valid, e.g. sections without a section, are not applied, and the current
+ * masks are kept. The frames of the DMX input are only checked for transmission errors.
  * 
  * @param animator The animator object that renders the animation onto the LED-strip
  * @param channels DMX channels to interpret. Assumes channels 1-7 are for color, and channels 8-15 are for masks.
+ * @param force Apply all channels, even if they are unchanged. Used when taking over the animator from another source.
  */
-void dmx_to_animation(Animator* animator, u8_t* channels) {
+void dmx_to_animation(Animator* animator, u8_t* channels, bool force) {
     // If the first 7 channels has changed, update the animator settings.
-    if(hasChannelsChanged(channels, 0, 7)) {
+    if(force || hasChannelsChanged(channels, 0, 7)) {
         // Set dimmer
         animator->setBrightness(channels[1]);
 
@@ -152,9 +186,15 @@ void dmx_to_animation(Animator* animator, u8_t* channels) {
         animator->setDirection(channels[5] < 128 ? Direction::FORWARD : Direction::BACKWARD);
     }
 
-    if(hasChannelsChanged(channels, 8, 15)) {
-        ILayer* mask1 = dmx_to_mask(channels + 8); // Use channels 8-11 to decode effect
-        ILayer* mask2 = dmx_to_mask(channels + 12); // Use channels 12-15 to decode effect
+    // Masks that cannot be rendered are not applied, and the current masks are kept
+    bool masksValid = dmx_mask_valid(channels + 8) && dmx_mask_valid(channels + 12);
+    if(force || (masksValid && hasChannelsChanged(channels, 8, 15))) {
+        ILayer* previousMask1 = mask1;
+        ILayer* previousMask2 = mask2;
+        if (masksValid) {
+            mask1 = dmx_to_mask(channels + 8); // Use channels 8-11 to decode effect
+            mask2 = dmx_to_mask(channels + 12); // Use channels 12-15 to decode effect
+        }
 
         if (mask1 != nullptr && mask2 != nullptr) {
             // if wwo masks, combine them
@@ -172,12 +212,30 @@ void dmx_to_animation(Animator* animator, u8_t* channels) {
         // Start at higher tick if DMX channel 6 is set
         // This is used to offset the animation
         animator->setTick(channels[5] % 128);
+
+        // The animator no longer references the previous masks
+        if (previousMask1 != mask1) delete previousMask1;
+        if (previousMask2 != mask2) delete previousMask2;
     }
     memcpy(prevChannels, channels, sizeof(prevChannels));
 }
 
-ReadDMXProcess::ReadDMXProcess(Animator* animator) : Process() {
+/**
+ * @brief Construct a new DMX reader
+ *
+ * @param animator The animator to control
+ * @param sequenceScheduler The scheduler to pause while the DMX input controls the animator
+ * @param zones Number of zones. 1 uses the protocol above, more split the strip into zones of
+ * DMX_ZONE_CHANNELS channels each, see DMXZones. Limited by the channels after DMX_START.
+ */
+ReadDMXProcess::ReadDMXProcess(Animator* animator, SequenceScheduler* sequenceScheduler, u8_t zones) : Process() {
     this->animator = animator;
+    this->sequenceScheduler = sequenceScheduler;
+    u16_t available = (513 - DMX_START) / DMX_ZONE_CHANNELS;
+    if (available < zones) zones = available;
+    if (1 < zones) {
+        this->zones = new DMXZones(zones);
+    }
     DMX::Initialize(input);
 }
 
@@ -185,26 +243,66 @@ String ReadDMXProcess::getName() {
     return "DMX Reader";
 }
 
+/**
+ * @brief Take the animator over from the sequence, on a new frame
+ *
+ * @param tookOver Set to true if the animator was taken over just now, such that every channel is applied
+ * @return true if the DMX input controls the animator
+ */
+bool ReadDMXProcess::takeOver(bool* tookOver) {
+    lastFrameAt = millis();
+    *tookOver = sequenceScheduler->getOwner() == AnimatorOwner::SEQUENCE;
+    if (*tookOver) {
+        sequenceScheduler->pause(AnimatorOwner::DMX_INPUT);
+        debug("DMX input took over the animator\n", 0);
+    }
+    return sequenceScheduler->getOwner() == AnimatorOwner::DMX_INPUT;
+}
+
+/**
+ * @brief Hand the animator back to the sequence, once no frame has arrived for DMX_INPUT_TIMEOUT
+ */
+void ReadDMXProcess::release() {
+    if (sequenceScheduler->getOwner() == AnimatorOwner::DMX_INPUT && millis() - lastFrameAt >= DMX_INPUT_TIMEOUT) {
+        sequenceScheduler->resume(AnimatorOwner::DMX_INPUT);
+        debug("DMX input timed out\n", 0);
+    }
+}
+
 void ReadDMXProcess::update() {
-    // Given the MAX485 often reads faulty data, I've temporarily added a hack, where
-    // the DMX controller outputs 123 and 234 on channels 1 and 2, respectively.
-    // If these values are not present, we assume the DMX data is invalid,
-    // and we do not update the animation.
-    if (DMX::Read(1) != 123 || DMX::Read(2) != 234) {
+    if (zones != nullptr) {
+        updateZones();
         return;
     }
 
-    // Depending on addresses, we read the DMX data.
-    // TODO: Change to DMX::ReadAll(uint8_t * data, uint16_t start, size_t size).
-    // Do not that this will copy to the same indexes, so the channels array have to
-    // be larger. Otherwise, we can also use DMX_IGNORE_THREADSAFETY = 1, which makes
-    // Read quicker, as no semaphore is used.
-    for (int i = 0; i < 15; ++i) {
-        channels[i+1] = DMX::Read(i + DMX_START);
+    // A consistent snapshot of our channels from the last valid frame, taken without locking.
+    uint32_t frameNumber = DMX::ReadAll(channels + 1, DMX_START, 15);
+    if (frameNumber == lastFrame) {
+        release(); // No new frame since the last update
+        return;
     }
+    lastFrame = frameNumber;
 
     // Map the DMX channels to the animation.
-    if (animator != nullptr) {
-        dmx_to_animation(animator, channels);
+    bool tookOver;
+    if (takeOver(&tookOver) && animator != nullptr) {
+        dmx_to_animation(animator, channels, tookOver);
+    }
+}
+
+void ReadDMXProcess::updateZones() {
+    u8_t zoneChannels[DMX_ZONES_MAX * DMX_ZONE_CHANNELS];
+    uint32_t frameNumber = DMX::ReadAll(zoneChannels, DMX_START, zones->getCount() * DMX_ZONE_CHANNELS);
+    if (frameNumber == lastFrame) {
+        release(); // No new frame since the last update
+        return;
+    }
+    lastFrame = frameNumber;
+
+    zones->setChannels(zoneChannels);
+    bool tookOver;
+    if (takeOver(&tookOver) && tookOver && animator != nullptr) {
+        // The zones render the whole strip, as the only layer, until the sequence resumes
+        animator->setLayers({zones});
     }
 }
@@ -5,10 +5,14 @@
 #include <Arduino.h>
 #include "../scheduler/scheduler.h"
 #include "../leds/animator.h"
+#include "../leds/sequence_scheduler.h"
 #include "../leds/layers/layer.h"
 #include "../leds/layers/colors/colors.h"
 #include "../leds/layers/masks/masks.h"
 #include "dmx_lib.h"
+#include "dmx_zones.h"
+
+#define DMX_INPUT_TIMEOUT 2000 // ms without frames, after which the sequence is shown again
 
 // Type definitions
 typedef uint8_t u8_t;
@@ -20,22 +24,34 @@ extern u8_t channels[16];
 extern u8_t prevChannels[16];
 
 // Function declarations
-std::vector<u8_t>* to_sections(u8_t value);
-std::vector<u8_t>* to_full_sections(u8_t value);
+std::vector<u8_t> to_sections(u8_t value);
+std::vector<u8_t> to_full_sections(u8_t value);
 u16_t valueScaler(u16_t value);
-ILayer* dmx_to_mask(u8_t* channels);
+ILayer* dmx_to_mask(const u8_t* channels);
+bool dmx_mask_valid(const u8_t* channels);
 bool hasChannelsChanged(u8_t* channels, u8_t from, u8_t to);
-void dmx_to_animation(Animator* animator, u8_t* channels);
+void dmx_to_animation(Animator* animator, u8_t* channels, bool force = false);
 
-// Process class for reading DMX data
+// Process class for reading DMX data. A new frame takes the animator over from the sequence, and
+// the sequence resumes after DMX_INPUT_TIMEOUT without frames. Live control and pixel streams keep
+// the animator until they hand it back to the sequence, and the next frame takes it over again.
 class ReadDMXProcess : public Process {
 private:
     Animator* animator;
+    SequenceScheduler* sequenceScheduler;
+    DMXZones* zones = nullptr; // Set when the strip is split into zones
+    uint32_t lastFrame = 0; // Number of the last frame that was applied
+    uint32_t lastFrameAt = 0;
 
 public:
-    ReadDMXProcess(Animator* animator); // Parameterized constructor
+    ReadDMXProcess(Animator* animator, SequenceScheduler* sequenceScheduler, u8_t zones = 1); // Parameterized constructor
     String getName() override;
     void update() override;
+
+private:
+    bool takeOver(bool* tookOver);
+    void release();
+    void updateZones();
 };
 
 #endif // DMX_H
\ No newline at end of file
@@ -17,6 +17,7 @@
 
 #include "dmx_lib.h"
 #include <Arduino.h>
+#include "../diagnostics/telemetry.h"
 
 #define DMX_SERIAL_INPUT_PIN    GPIO_NUM_4 // pin for dmx rx
 #define DMX_SERIAL_OUTPUT_PIN   GPIO_NUM_2 // pin for dmx tx
@@ -32,6 +33,8 @@
 
 #define DMX_IGNORE_THREADSAFETY 0           // set to 1 to disable all threadsafe mechanisms
 
+#define DMX_LENGTH_FRAMES       2           // frames in a row a new frame length has to be received, before it is accepted
+
 QueueHandle_t DMX::dmx_rx_queue;
 
 SemaphoreHandle_t DMX::sync_dmx;
@@ -44,6 +47,24 @@ long DMX::last_dmx_packet = 0;
 
 uint8_t DMX::dmx_data[513];
 
+uint8_t DMX::dmx_frames[2][513];
+
+std::atomic<uint32_t> DMX::dmx_frame_count{ 0 };
+
+uint16_t DMX::dmx_frame_length = 0;
+
+uint16_t DMX::dmx_pending_length = 0;
+
+uint8_t DMX::dmx_pending_frames = 0;
+
+uint8_t DMX::dmx_agreement = 1;
+
+uint8_t DMX::dmx_candidate[513];
+
+uint8_t DMX::dmx_candidate_frames[513];
+
+DMXStats DMX::dmx_stats = {};
+
 DMX::DMX()
 {
 
@@ -83,7 +104,9 @@ void DMX::Initialize(DMXDirection direction)
         dmx_state = DMX_OUTPUT;
         
         // create send task
-        xTaskCreatePinnedToCore(DMX::uart_send_task, "uart_send_task", 1024, NULL, 1, NULL, DMX_CORE);
+        TaskHandle_t task;
+        xTaskCreatePinnedToCore(DMX::uart_send_task, "uart_send_task", 1024, NULL, 1, &task, DMX_CORE);
+        Telemetry::watchTask("dmx_tx", task);
     }
     else
     {    
@@ -91,10 +114,18 @@ void DMX::Initialize(DMXDirection direction)
         dmx_state = DMX_IDLE;
 
         // create receive task
-        xTaskCreatePinnedToCore(DMX::uart_event_task, "uart_event_task", 2048, NULL, 1, NULL, DMX_CORE);
+        TaskHandle_t task;
+        xTaskCreatePinnedToCore(DMX::uart_event_task, "uart_event_task", 2048, NULL, 1, &task, DMX_CORE);
+        Telemetry::watchTask("dmx_rx", task);
     }
 }
 
+// Received frames are double buffered. The event task fills the back buffer, and publishes it by
+// incrementing dmx_frame_count once the frame is complete, which swaps the buffers. Readers copy
+// from the front buffer without a lock, and copy again if a frame was published meanwhile, as the
+// event task then writes the next frame into the buffer they copied from. Every copy therefore
+// holds the channels of a single frame.
+
 uint8_t DMX::Read(uint16_t channel)
 {
     // restrict acces to dmx array to valid values
@@ -103,31 +134,32 @@ uint8_t DMX::Read(uint16_t channel)
         return 0;
     }
 
-    // take data threadsafe from array and return
-#ifndef DMX_IGNORE_THREADSAFETY
-    xSemaphoreTake(sync_dmx, portMAX_DELAY);
-#endif
-    uint8_t tmp_dmx = dmx_data[channel];
-#ifndef DMX_IGNORE_THREADSAFETY
-    xSemaphoreGive(sync_dmx);
-#endif
-    return tmp_dmx;
+    // a single channel is never torn
+    return dmx_frames[dmx_frame_count.load(std::memory_order_acquire) & 1][channel];
 }
 
-void DMX::ReadAll(uint8_t * data, uint16_t start, size_t size)
+uint32_t DMX::ReadAll(uint8_t * data, uint16_t start, size_t size)
 {
     // restrict acces to dmx array to valid values
     if(start < 1 || start > 512 || start + size > 513)
     {
-        return;
+        return 0;
     }
-#ifndef DMX_IGNORE_THREADSAFETY
-    xSemaphoreTake(sync_dmx, portMAX_DELAY);
-#endif
-    memcpy(data, (uint8_t *)dmx_data + start, size);
-#ifndef DMX_IGNORE_THREADSAFETY
-    xSemaphoreGive(sync_dmx);
-#endif
+
+    uint32_t count;
+    do
+    {
+        count = dmx_frame_count.load(std::memory_order_acquire);
+        memcpy(data, dmx_frames[count & 1] + start, size);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while(count != dmx_frame_count.load(std::memory_order_relaxed));
+
+    return count;
+}
+
+uint32_t DMX::FrameCount()
+{
+    return dmx_frame_count.load(std::memory_order_acquire);
 }
 
 void DMX::Write(uint16_t channel, uint8_t value)
@@ -165,14 +197,9 @@ void DMX::WriteAll(uint8_t * data, uint16_t start, size_t size)
 
 uint8_t DMX::IsHealthy()
 {
-    // get timestamp of last received packet
-#ifndef DMX_IGNORE_THREADSAFETY
-    xSemaphoreTake(sync_dmx, portMAX_DELAY);
-#endif
+    // get timestamp of last received packet, which is written in a single store
     long dmx_timeout = last_dmx_packet;
-#ifndef DMX_IGNORE_THREADSAFETY
-    xSemaphoreGive(sync_dmx);
-#endif
+
     // check if elapsed time < defined timeout
     if(xTaskGetTickCount() - dmx_timeout < HEALTHY_TIME)
     {
@@ -181,6 +208,17 @@ uint8_t DMX::IsHealthy()
     return 0;
 }
 
+void DMX::SetAgreement(uint8_t frames)
+{
+    // 0 would never apply a change
+    dmx_agreement = frames < 1 ? 1 : frames;
+}
+
+DMXStats DMX::GetStats()
+{
+    return dmx_stats;
+}
+
 void DMX::uart_send_task(void*pvParameters)
 {
     uint8_t start_code = 0x00;
@@ -209,6 +247,193 @@ void DMX::uart_send_task(void*pvParameters)
     }
 }
 
+void DMX::store_bytes(const uint8_t* data, int size)
+{
+    // only the event task publishes frames, so the count is stable here
+    uint8_t* frame = dmx_frames[(dmx_frame_count.load(std::memory_order_relaxed) + 1) & 1];
+    for(int i = 0; i < size; i++)
+    {
+        if(current_rx_addr < 513)
+        {
+            frame[current_rx_addr++] = data[i];
+        }
+    }
+}
+
+// Received frames are validated before they are published:
+// - a frame starts at a break, followed by the start code 0. Other start codes are RDM or other
+//   protocols, and the packet is ignored.
+// - a framing, parity or overflow error drops the frame being received.
+// - a frame ends at the next break, or after 512 channels. A sender keeps the number of channels,
+//   so a frame of another length was likely cut short by noise. It is dropped, unless the new length
+//   is received DMX_LENGTH_FRAMES times in a row.
+// - with an agreement of more than 1 frame, a changed channel keeps its previous value until the
+//   same value was received on that many frames in a row.
+
+void DMX::receive_event(uart_event_type_t type, const uint8_t* data, size_t size)
+{
+    switch(type)
+    {
+        case UART_DATA:
+            receive_data(data, size);
+            break;
+        case UART_BREAK:
+            dmx_stats.breaks++;
+            // break detected, which ends a frame of less than 512 channels
+            if(dmx_state == DMX_DATA)
+            {
+                end_frame();
+            }
+            dmx_state = DMX_BREAK;
+            break;
+        case UART_FRAME_ERR:
+            // the break itself is a byte without stop bit, which may be reported right after it
+            if(dmx_state == DMX_BREAK)
+            {
+                break;
+            }
+            dmx_stats.framingErrors++;
+            drop_frame();
+            break;
+        case UART_PARITY_ERR:
+            dmx_stats.parityErrors++;
+            drop_frame();
+            break;
+        case UART_BUFFER_FULL:
+        case UART_FIFO_OVF:
+            dmx_stats.overflows++;
+            drop_frame();
+            break;
+        default:
+            drop_frame();
+            break;
+    }
+}
+
+void DMX::receive_data(const uint8_t* data, size_t size)
+{
+    if(size == 0)
+    {
+        return;
+    }
+
+    // check if break detected
+    if(dmx_state == DMX_BREAK)
+    {
+        // if not 0, then RDM or custom protocol, which is ignored up to the next break
+        if(data[0] != 0)
+        {
+            dmx_stats.alternateStartCodes++;
+            dmx_state = DMX_IDLE;
+            return;
+        }
+        dmx_state = DMX_DATA;
+        // reset dmx adress to 0
+        current_rx_addr = 0;
+        // store received timestamp
+        last_dmx_packet = xTaskGetTickCount();
+    }
+    // check if in data receive mode
+    if(dmx_state == DMX_DATA)
+    {
+        // copy received bytes to the frame being received
+        store_bytes(data, size);
+        // end a full frame right away, rather than at the next break
+        if(current_rx_addr == 513)
+        {
+            end_frame();
+            dmx_state = DMX_IDLE;
+        }
+    }
+}
+
+void DMX::drop_frame()
+{
+    // error recevied, going to idle mode. The frame being received is dropped.
+    if(dmx_state == DMX_DATA)
+    {
+        dmx_stats.dropped++;
+    }
+    dmx_state = DMX_IDLE;
+}
+
+void DMX::end_frame()
+{
+    uint16_t length = current_rx_addr;
+    // a frame without channels is not published
+    if(length < 2)
+    {
+        dmx_stats.shortFrames++;
+        return;
+    }
+
+    if(length != dmx_frame_length)
+    {
+        if(length != dmx_pending_length)
+        {
+            dmx_pending_length = length;
+            dmx_pending_frames = 0;
+        }
+        if(++dmx_pending_frames < DMX_LENGTH_FRAMES)
+        {
+            dmx_stats.lengthMismatches++;
+            return;
+        }
+        dmx_frame_length = length;
+    }
+    dmx_pending_length = 0;
+    dmx_pending_frames = 0;
+
+    if(dmx_agreement > 1)
+    {
+        uint32_t count = dmx_frame_count.load(std::memory_order_relaxed);
+        if(confirm_changes(dmx_frames[(count + 1) & 1], dmx_frames[count & 1]))
+        {
+            dmx_stats.unconfirmed++;
+        }
+    }
+
+    publish_frame();
+}
+
+bool DMX::confirm_changes(uint8_t* frame, const uint8_t* last)
+{
+    bool held = false;
+    for(uint16_t i = 1; i < current_rx_addr; i++)
+    {
+        if(frame[i] == last[i])
+        {
+            dmx_candidate_frames[i] = 0;
+            continue;
+        }
+        // a new value restarts the agreement
+        if(dmx_candidate_frames[i] == 0 || frame[i] != dmx_candidate[i])
+        {
+            dmx_candidate[i] = frame[i];
+            dmx_candidate_frames[i] = 0;
+        }
+        if(++dmx_candidate_frames[i] < dmx_agreement)
+        {
+            frame[i] = last[i];
+            held = true;
+        }
+        else
+        {
+            dmx_candidate_frames[i] = 0;
+        }
+    }
+    return held;
+}
+
+void DMX::publish_frame()
+{
+    uint32_t count = dmx_frame_count.load(std::memory_order_relaxed);
+    uint8_t* frame = dmx_frames[(count + 1) & 1];
+    // channels after the end of a short frame keep their previous values
+    memcpy(frame + current_rx_addr, dmx_frames[count & 1] + current_rx_addr, 513 - current_rx_addr);
+    dmx_frame_count.store(count + 1, std::memory_order_release);
+}
+
 void DMX::uart_event_task(void *pvParameters)
 {
     uart_event_t event;
@@ -218,68 +443,18 @@ void DMX::uart_event_task(void *pvParameters)
         // wait for data in the dmx_queue
         if(xQueueReceive(dmx_rx_queue, (void * )&event, (portTickType)portMAX_DELAY))
         {
-            bzero(dtmp, BUF_SIZE);
-            switch(event.type)
+            if(event.type == UART_DATA)
             {
-                case UART_DATA:
-                    // read the received data
-                    uart_read_bytes(DMX_UART_NUM, dtmp, event.size, portMAX_DELAY);
-                    // check if break detected
-                    if(dmx_state == DMX_BREAK)
-                    {
-                        // if not 0, then RDM or custom protocol
-                        if(dtmp[0] == 0)
-                        {
-                        dmx_state = DMX_DATA;
-                        // reset dmx adress to 0
-                        current_rx_addr = 0;
-#ifndef DMX_IGNORE_THREADSAFETY
-                        xSemaphoreTake(sync_dmx, portMAX_DELAY);
-#endif
-                        // store received timestamp
-                        last_dmx_packet = xTaskGetTickCount();
-#ifndef DMX_IGNORE_THREADSAFETY
-                        xSemaphoreGive(sync_dmx);
-#endif
-                        }
-                    }
-                    // check if in data receive mode
-                    if(dmx_state == DMX_DATA)
-                    {
-#ifndef DMX_IGNORE_THREADSAFETY
-                        xSemaphoreTake(sync_dmx, portMAX_DELAY);
-#endif
-                        // copy received bytes to dmx data array
-                        for(int i = 0; i < event.size; i++)
-                        {
-                            if(current_rx_addr < 513)
-                            {
-                                dmx_data[current_rx_addr++] = dtmp[i];
-                            }
-                        }
-#ifndef DMX_IGNORE_THREADSAFETY
-                        xSemaphoreGive(sync_dmx);
-#endif
-                    }
-                    break;
-                case UART_BREAK:
-                    // break detected
-                    // clear queue und flush received bytes                    
-                    uart_flush_input(DMX_UART_NUM);
-                    xQueueReset(dmx_rx_queue);
-                    dmx_state = DMX_BREAK;
-                    break;
-                case UART_FRAME_ERR:
-                case UART_PARITY_ERR:
-                case UART_BUFFER_FULL:
-                case UART_FIFO_OVF:
-                default:
-                    // error recevied, going to idle mode
-                    uart_flush_input(DMX_UART_NUM);
-                    xQueueReset(dmx_rx_queue);
-                    dmx_state = DMX_IDLE;
-                    break;
+                // read the received data
+                uart_read_bytes(DMX_UART_NUM, dtmp, event.size, portMAX_DELAY);
+            }
+            else
+            {
+                // clear queue und flush received bytes, which belong to the frame that ended or broke
+                uart_flush_input(DMX_UART_NUM);
+                xQueueReset(dmx_rx_queue);
             }
+            receive_event(event.type, dtmp, event.type == UART_DATA ? event.size : 0);
         }
     }
 }
@@ -17,6 +17,7 @@
 
 #include <stdint.h>
 #include <string.h>
+#include <atomic>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -29,6 +30,19 @@
 enum DMXDirection { input, output };
 enum DMXState { DMX_IDLE, DMX_BREAK, DMX_DATA, DMX_OUTPUT };
 
+struct DMXStats
+{
+    uint32_t breaks;                // breaks detected
+    uint32_t alternateStartCodes;   // packets with a start code other than 0, e.g. RDM, which are ignored
+    uint32_t framingErrors;         // bytes without a valid stop bit, the frame is dropped
+    uint32_t parityErrors;          // bytes with a parity error, the frame is dropped
+    uint32_t overflows;             // uart buffer or fifo overflows, the frame is dropped
+    uint32_t dropped;               // frames dropped after one of the errors above
+    uint32_t shortFrames;           // frames without channels
+    uint32_t lengthMismatches;      // frames dropped as they were not as long as the frames before
+    uint32_t unconfirmed;           // frames with changed channels that were held back until the next frames agreed
+};
+
 class DMX
 {
     public:
@@ -36,15 +50,23 @@ class DMX
 
         static uint8_t Read(uint16_t channel);              // returns the dmx value for the givven address (values from 1 to 512)
 
-        static void ReadAll(uint8_t * data, uint16_t start, size_t size);   // copies the defined channels from the read buffer
+        static uint32_t ReadAll(uint8_t * data, uint16_t start, size_t size);   // copies the defined channels of the last complete frame, returns its frame number
+
+        static uint32_t FrameCount();                       // number of complete frames received, 0 until the first frame
 
         static void Write(uint16_t channel, uint8_t value); // writes the dmx value to the buffer
         
         static void WriteAll(uint8_t * data, uint16_t start, size_t size);  // copies the defined channels into the write buffer
 
         static uint8_t IsHealthy();                            // returns true, when a valid DMX signal was received within the last 500ms
+
+        static void SetAgreement(uint8_t frames);           // changed channels are applied once they agree on this many frames, 1 applies them right away
+
+        static DMXStats GetStats();                         // returns the receive error counters
         
     private:
+        friend struct DMXTest;                              // feeds uart events to the receive state machine in the host tests
+
         DMX();                                              // hide constructor
 
         static QueueHandle_t dmx_rx_queue;                  // queue for uart rx events
@@ -57,7 +79,39 @@ class DMX
 
         static long last_dmx_packet;                        // timestamp for the last received packet
 
-        static uint8_t dmx_data[513];                       // stores the received dmx data
+        static uint8_t dmx_data[513];                       // stores the dmx data to send
+
+        static uint8_t dmx_frames[2][513];                  // received frames: the last complete frame, and the frame being received
+
+        static std::atomic<uint32_t> dmx_frame_count;       // complete frames, the last one is in dmx_frames[dmx_frame_count & 1]
+
+        static uint16_t dmx_frame_length;                   // length of the accepted frames, including the start code
+
+        static uint16_t dmx_pending_length;                 // another length that was received, which is accepted once it repeats
+
+        static uint8_t dmx_pending_frames;                  // frames received in a row with the pending length
+
+        static uint8_t dmx_agreement;                       // frames a changed channel has to agree on
+
+        static uint8_t dmx_candidate[513];                  // changed values waiting for agreement
+
+        static uint8_t dmx_candidate_frames[513];           // frames in a row the changed values were received
+
+        static DMXStats dmx_stats;                          // receive error counters
+
+        static void receive_event(uart_event_type_t type, const uint8_t* data, size_t size); // runs the receive state machine for a uart event
+
+        static void receive_data(const uint8_t* data, size_t size); // handles received bytes
+
+        static void drop_frame();                           // drops the frame being received after an error
+
+        static void end_frame();                            // validates the frame being received, and publishes it
+
+        static bool confirm_changes(uint8_t* frame, const uint8_t* last); // holds back changed channels that have not agreed yet
+
+        static void store_bytes(const uint8_t* data, int size); // copies received channels into the frame being received
+
+        static void publish_frame();                        // makes the frame being received the last complete frame
 
         static void uart_event_task(void *pvParameters);    // event task
 
@@ -0,0 +1,276 @@
+#include "dmx_network.h"
+#include "dmx.h"
+#include "../diagnostics/telemetry.h"
+
+static const u8_t ARTNET_ID[8] = { 'A', 'r', 't', '-', 'N', 'e', 't', 0 };
+static const u8_t E131_ID[12] = { 'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0 };
+
+#define ARTNET_OP_DMX 0x5000
+#define ARTNET_HEADER_SIZE 18
+#define E131_HEADER_SIZE 126 // Up to and including the start code
+#define E131_OPTION_PREVIEW 0x80
+#define E131_OPTION_TERMINATED 0x40
+
+static inline u16_t read_u16_be(const u8_t* data) {
+  return data[0] << 8 | data[1];
+}
+
+static inline u32_t read_u32_be(const u8_t* data) {
+  return (u32_t)data[0] << 24 | data[1] << 16 | data[2] << 8 | data[3];
+}
+
+/**
+ * @brief Construct a DMX network input in control mode
+ *
+ * @param liveControl Applies the channels to the animator
+ * @param universe The universe to read. The channels from DMX_START are used.
+ */
+DMXNetwork::DMXNetwork(LiveControl* liveControl, u16_t universe) {
+  this->mode = DMXNetworkMode::CONTROL;
+  this->liveControl = liveControl;
+  this->universe = universe;
+}
+
+/**
+ * @brief Construct a DMX network input in pixel mode. Universe `firstUniverse + n` holds pixels
+ * from `n * DMX_UNIVERSE_PIXELS`, as RGB from channel 1.
+ *
+ * @param pixelStream Takes over the animator while pixels arrive
+ * @param animator The animator whose LED buffer is written
+ * @param firstUniverse The universe of the first pixel
+ * @param universeCount Universes to read, at most DMX_NETWORK_MAX_UNIVERSES
+ */
+DMXNetwork::DMXNetwork(PixelStream* pixelStream, Animator* animator, u16_t firstUniverse, u8_t universeCount) {
+  this->mode = DMXNetworkMode::PIXELS;
+  this->pixelStream = pixelStream;
+  this->animator = animator;
+  this->universe = firstUniverse;
+  this->universeCount = universeCount < DMX_NETWORK_MAX_UNIVERSES ? universeCount : DMX_NETWORK_MAX_UNIVERSES;
+  this->sync = xSemaphoreCreateMutex();
+
+  for (CRGB*& buffer : pixels) {
+    buffer = new CRGB[this->universeCount * DMX_UNIVERSE_PIXELS];
+    Telemetry::allocated(Subsystem::RADIO, this->universeCount * DMX_UNIVERSE_PIXELS * sizeof(CRGB));
+  }
+}
+
+DMXNetwork::~DMXNetwork() {
+  for (CRGB* buffer : pixels) {
+    if (buffer == nullptr) continue;
+    delete[] buffer;
+    Telemetry::released(Subsystem::RADIO, universeCount * DMX_UNIVERSE_PIXELS * sizeof(CRGB));
+  }
+  if (sync != nullptr) vSemaphoreDelete(sync);
+}
+
+String DMXNetwork::getName() {
+  return "DMX Network";
+}
+
+/**
+ * @brief Parse an ArtDmx packet in place
+ *
+ * @return false if the packet is not an ArtDmx packet, or is shorter than its header says
+ */
+bool DMXNetwork::parseArtNet(const u8_t* data, size_t length, DMXPacket* packet) {
+  if (length < ARTNET_HEADER_SIZE || memcmp(data, ARTNET_ID, sizeof(ARTNET_ID)) != 0) return false;
+  if ((data[8] | data[9] << 8) != ARTNET_OP_DMX || read_u16_be(data + 10) < 14) return false;
+
+  packet->sequence = data[12];
+  packet->universe = (data[15] & 0x7F) << 8 | data[14]; // Net, then Sub-Net and Universe
+  packet->count = read_u16_be(data + 16);
+  packet->channels = data + ARTNET_HEADER_SIZE;
+
+  return 2 <= packet->count && packet->count <= 512 && packet->count <= length - ARTNET_HEADER_SIZE;
+}
+
+/**
+ * @brief Parse an E1.31 data packet in place. Preview data, stream termination and alternate start
+ * codes are not DMX levels, and are rejected.
+ *
+ * @return false if the packet is not an E1.31 data packet, or is shorter than its header says
+ */
+bool DMXNetwork::parseE131(const u8_t* data, size_t length, DMXPacket* packet) {
+  if (length < E131_HEADER_SIZE || read_u16_be(data) != 0x0010) return false;
+  if (memcmp(data + 4, E131_ID, sizeof(E131_ID)) != 0) return false;
+
+  // Root, framing and DMP layer vectors
+  if (read_u32_be(data + 18) != 0x00000004 || read_u32_be(data + 40) != 0x00000002) return false;
+  if (data[117] != 0x02 || data[118] != 0xA1) return false;
+  if (data[112] & (E131_OPTION_PREVIEW | E131_OPTION_TERMINATED)) return false;
+
+  // The property values start with the start code, which is 0 for DMX levels
+  u16_t values = read_u16_be(data + 123);
+  if (values < 2 || 513 < values || length < (size_t)E131_HEADER_SIZE - 1 + values || data[125] != 0) return false;
+
+  packet->sequence = data[111];
+  packet->universe = read_u16_be(data + 113);
+  packet->count = values - 1;
+  packet->channels = data + E131_HEADER_SIZE;
+  return true;
+}
+
+/**
+ * @brief Start listening. Wi-Fi must be connected.
+ *
+ * @return false if a socket could not be opened
+ */
+bool DMXNetwork::begin() {
+  if (!artnet.listen(ARTNET_PORT)) return false;
+  artnet.onPacket([this](AsyncUDPPacket& packet) {
+    receive(packet.data(), packet.length(), false);
+  });
+
+  for (u8_t i = 0; i < universeCount; i++) {
+    // sACN is multicast to 239.255.<universe high byte>.<universe low byte>
+    u16_t number = universe + i;
+    if (!e131[i].listenMulticast(IPAddress(239, 255, number >> 8, number & 0xFF), E131_PORT)) return false;
+    e131[i].onPacket([this](AsyncUDPPacket& packet) {
+      receive(packet.data(), packet.length(), true);
+    });
+  }
+
+  return true;
+}
+
+/**
+ * @brief Drop packets that arrive after a newer packet of the universe, as described by E1.31.
+ * Senders that do not number their packets send 0.
+ */
+bool DMXNetwork::isInOrder(u8_t index, u8_t sequence) {
+  s8_t difference = (s8_t)(sequence - lastSequence[index]);
+  if (sequence != 0 && lastSequence[index] != 0 && -20 < difference && difference <= 0) return false;
+
+  lastSequence[index] = sequence;
+  return true;
+}
+
+/**
+ * @brief Handle a received packet. Runs in the UDP task, with the data still in the network buffer.
+ *
+ * @param data The UDP payload
+ * @param length Length of the payload
+ * @param sacn Whether the packet arrived on the sACN port, rather than the Art-Net port
+ */
+void DMXNetwork::receive(const u8_t* data, size_t length, bool sacn) {
+  DMXPacket packet;
+  if (!(sacn ? parseE131(data, length, &packet) : parseArtNet(data, length, &packet))) {
+    stats.invalid.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  if (packet.universe < universe || universeCount <= packet.universe - universe) {
+    stats.filtered.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  u8_t index = packet.universe - universe;
+  if (!isInOrder(index, packet.sequence)) {
+    stats.outOfOrder.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  stats.packets.fetch_add(1, std::memory_order_relaxed);
+  if (mode == DMXNetworkMode::CONTROL) {
+    applyControl(packet);
+  }
+  else {
+    applyPixels(index, packet);
+  }
+}
+
+/**
+ * @brief Post the channels from DMX_START as a control frame, such that they are applied like the
+ * physical DMX input
+ */
+void DMXNetwork::applyControl(const DMXPacket& packet) {
+  if (packet.count < DMX_START - 1 + CONTROL_FRAME_SIZE - 1) {
+    stats.invalid.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  u8_t frame[CONTROL_FRAME_SIZE];
+  frame[0] = CONTROL_FRAME_MAGIC;
+  memcpy(frame + 1, packet.channels + DMX_START - 1, CONTROL_FRAME_SIZE - 1);
+  if (!liveControl->post(frame, CONTROL_FRAME_SIZE)) {
+    stats.invalid.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+/**
+ * @brief Copy the pixels of a universe into the frame being received. A universe that is already
+ * in the frame starts the next frame, so the frame is complete as far as it arrived.
+ */
+void DMXNetwork::applyPixels(u8_t index, const DMXPacket& packet) {
+  size_t count = packet.count / 3;
+  if (DMX_UNIVERSE_PIXELS < count) count = DMX_UNIVERSE_PIXELS;
+
+  xSemaphoreTake(sync, portMAX_DELAY);
+  if (received & (1 << index)) completeFrame();
+
+  memcpy(pixels[filling] + index * DMX_UNIVERSE_PIXELS, packet.channels, count * 3);
+  if (received == 0) frameStartedAt = millis();
+  received |= 1 << index;
+
+  if (received == (1u << universeCount) - 1) completeFrame();
+  xSemaphoreGive(sync);
+}
+
+/**
+ * @brief Hand the frame being received to the main loop, and receive the next frame into the other
+ * buffer. A complete frame the main loop has not shown yet is replaced. Call with sync taken.
+ */
+void DMXNetwork::completeFrame() {
+  if (ready != 0) stats.skipped.fetch_add(1, std::memory_order_relaxed);
+
+  ready = received;
+  received = 0;
+  filling ^= 1;
+}
+
+DMXNetworkStats DMXNetwork::getStats() {
+  return DMXNetworkStats{
+    stats.packets.load(std::memory_order_relaxed),
+    stats.filtered.load(std::memory_order_relaxed),
+    stats.invalid.load(std::memory_order_relaxed),
+    stats.outOfOrder.load(std::memory_order_relaxed),
+    stats.frames.load(std::memory_order_relaxed),
+    stats.skipped.load(std::memory_order_relaxed),
+  };
+}
+
+/**
+ * @brief Copy the last complete pixel frame into the LED buffer and show it. A frame whose
+ * remaining universes were lost is shown DMX_PIXEL_FRAME_WAIT after its first universe arrived.
+ */
+void DMXNetwork::update() {
+  if (mode != DMXNetworkMode::PIXELS) return;
+
+  xSemaphoreTake(sync, portMAX_DELAY);
+  if (ready == 0 && received != 0 && millis() - frameStartedAt >= DMX_PIXEL_FRAME_WAIT) {
+    completeFrame();
+  }
+
+  u32_t universes = ready;
+  if (universes != 0) {
+    // Takes the animator over from the sequence, such that the layers are not rendered over the frame
+    pixelStream->start();
+
+    const CRGB* frame = pixels[filling ^ 1];
+    size_t length = animator->getLength();
+    for (u8_t i = 0; i < universeCount; i++) {
+      size_t first = i * DMX_UNIVERSE_PIXELS;
+      if (!(universes & (1 << i)) || length <= first) continue;
+
+      size_t count = length - first < DMX_UNIVERSE_PIXELS ? length - first : DMX_UNIVERSE_PIXELS;
+      memcpy(animator->getLeds() + first, frame + first, count * 3);
+    }
+    ready = 0;
+  }
+  xSemaphoreGive(sync);
+
+  if (universes == 0) return;
+
+  pixelStream->show();
+  stats.frames.fetch_add(1, std::memory_order_relaxed);
+}
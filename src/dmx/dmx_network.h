@@ -0,0 +1,111 @@
+#pragma once
+
+#include <Arduino.h>
+#include <AsyncUDP.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "live_control.h"
+#include "../leds/animator.h"
+#include "../leds/pixel_stream.h"
+#include "../scheduler/scheduler.h"
+
+#define ARTNET_PORT 6454
+#define E131_PORT 5568
+#define DMX_NETWORK_MAX_UNIVERSES 4 // Universes of a pixel mapping, i.e. 680 pixels
+#define DMX_UNIVERSE_PIXELS 170     // RGB pixels in the 512 channels of a universe
+#define DMX_PIXEL_FRAME_WAIT 25     // ms to wait for the remaining universes of a frame, before it is shown anyway
+
+enum class DMXNetworkMode {
+  CONTROL, // A single universe, mapped like the physical DMX input, see dmx.cpp
+  PIXELS,  // Consecutive universes of RGB pixels
+};
+
+/**
+ * @brief The DMX data of an Art-Net or sACN packet. The channels point into the received packet.
+ */
+struct DMXPacket {
+  u16_t universe;
+  u8_t sequence; // 0 if the sender does not number its packets
+  const u8_t* channels;
+  u16_t count;
+};
+
+/**
+ * @brief Counters of the DMX network input.
+ */
+struct DMXNetworkStats {
+  u32_t packets;    // Packets with DMX data for a universe of this controller
+  u32_t filtered;   // Packets for other universes
+  u32_t invalid;    // Packets that are not Art-Net or sACN DMX data, or too short
+  u32_t outOfOrder; // Packets dropped as a newer packet of the universe was already received
+  u32_t frames;     // Pixel frames shown
+  u32_t skipped;    // Complete pixel frames replaced by the next one before the main loop showed them
+};
+
+/**
+ * @brief The counters of DMXNetworkStats, updated from the UDP task and the main loop. Read them
+ * as DMXNetworkStats with DMXNetwork::getStats.
+ */
+struct DMXNetworkCounters {
+  std::atomic<u32_t> packets;
+  std::atomic<u32_t> filtered;
+  std::atomic<u32_t> invalid;
+  std::atomic<u32_t> outOfOrder;
+  std::atomic<u32_t> frames;
+  std::atomic<u32_t> skipped;
+};
+
+/**
+ * @brief Receives DMX over Wi-Fi, as Art-Net on port 6454 and sACN (E1.31) on port 5568, from
+ * lighting desks and media servers. Wi-Fi must be connected before begin() is called.
+ *
+ * Packets are parsed in place in the UDP task, and packets for other universes are dropped after
+ * reading the universe, before anything is copied. In control mode, the channels of the universe
+ * from DMX_START are posted to LiveControl, which applies them with the same mapping as the
+ * physical DMX input.
+ *
+ * In pixel mode, each universe is copied from the packet into a back buffer. Once all universes of
+ * a frame have arrived, the buffer is handed to the main loop, and the next frame is received into
+ * the other buffer. The main loop copies the frame into the LED buffer and shows it, such that the
+ * LEDs are never written while they are rendered or shown, and a frame is never mixed with the
+ * next one.
+ */
+class DMXNetwork : public Process {
+  DMXNetworkMode mode;
+  u16_t universe; // The control universe, or the first pixel universe
+  u8_t universeCount = 1;
+  LiveControl* liveControl = nullptr;
+  PixelStream* pixelStream = nullptr;
+  Animator* animator = nullptr;
+  AsyncUDP artnet;
+  AsyncUDP e131[DMX_NETWORK_MAX_UNIVERSES];
+  u8_t lastSequence[DMX_NETWORK_MAX_UNIVERSES] = {};
+  SemaphoreHandle_t sync = nullptr; // Guards the pixel buffers between the UDP task and the main loop
+  CRGB* pixels[2] = {};  // The frame being received, and the last complete frame
+  u8_t filling = 0;      // Index of the buffer of the frame being received
+  u32_t received = 0;    // Bitmap of the universes received for the frame being received
+  u32_t ready = 0;       // Bitmap of the universes of the complete frame, 0 once it is shown
+  u32_t frameStartedAt = 0;
+  DMXNetworkCounters stats = {};
+
+  bool isInOrder(u8_t index, u8_t sequence);
+  void applyControl(const DMXPacket& packet);
+  void applyPixels(u8_t index, const DMXPacket& packet);
+  void completeFrame();
+
+  public:
+  DMXNetwork(LiveControl* liveControl, u16_t universe);
+  DMXNetwork(PixelStream* pixelStream, Animator* animator, u16_t firstUniverse, u8_t universeCount);
+  ~DMXNetwork();
+
+  static bool parseArtNet(const u8_t* data, size_t length, DMXPacket* packet);
+  static bool parseE131(const u8_t* data, size_t length, DMXPacket* packet);
+
+  bool begin();
+  void receive(const u8_t* data, size_t length, bool sacn);
+  DMXNetworkStats getStats();
+
+  String getName() override;
+  void update() override;
+};
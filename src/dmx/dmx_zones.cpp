@@ -0,0 +1,117 @@
+#include "dmx_zones.h"
+#include "dmx.h"
+
+/**
+ * @brief Construct the zones of a strip. The zones are black until the first channels are set.
+ *
+ * @param count Number of zones, at most DMX_ZONES_MAX
+ */
+DMXZones::DMXZones(u8_t count) {
+  this->count = count < 1 ? 1 : count < DMX_ZONES_MAX ? count : DMX_ZONES_MAX;
+  for (u8_t i = 0; i < this->count; i++) {
+    zones[i] = DMXZone{ 0, 0, 0, CRGB::Black, { nullptr, nullptr } };
+  }
+}
+
+DMXZones::~DMXZones() {
+  for (u8_t i = 0; i < count; i++) {
+    delete zones[i].masks[0];
+    delete zones[i].masks[1];
+  }
+}
+
+String DMXZones::getName() {
+  return "DMX Zones";
+}
+
+/**
+ * @brief The zones have no protocol type, as they are never encoded. They are reported as the
+ * colours they start from.
+ */
+protocol_LayerType DMXZones::getType() {
+  return protocol_LayerType_SingleColor;
+}
+
+String DMXZones::toString() {
+  return "DMXZones: n: " + String(count);
+}
+
+protocol_Layer DMXZones::toEncodable() {
+  return protocol_Layer{};
+}
+
+u8_t DMXZones::getCount() {
+  return count;
+}
+
+/**
+ * @brief Apply the channels of every zone. Masks are only rebuilt when their channels change, such
+ * that they keep their state, and are kept while their channels are invalid.
+ *
+ * @param channels DMX_ZONE_CHANNELS channels for each zone, from the first zone
+ */
+void DMXZones::setChannels(const u8_t* channels) {
+  for (u8_t i = 0; i < count; i++) {
+    applyZone(zones[i], channels + i * DMX_ZONE_CHANNELS, previous + i * DMX_ZONE_CHANNELS);
+  }
+  memcpy(previous, channels, count * DMX_ZONE_CHANNELS);
+  applied = true;
+}
+
+void DMXZones::applyZone(DMXZone& zone, const u8_t* channels, const u8_t* previous) {
+  zone.dimmer = channels[0];
+  zone.color = CRGB(channels[1], channels[2], channels[3]);
+
+  for (u8_t i = 0; i < 2; i++) {
+    const u8_t* mask = channels + 4 + i * 4;
+    if (applied && memcmp(mask, previous + 4 + i * 4, 4) == 0) continue;
+    if (!dmx_mask_valid(mask)) continue;
+
+    delete zone.masks[i];
+    zone.masks[i] = dmx_to_mask(mask);
+  }
+}
+
+/**
+ * @brief Split the strip into zones of equal length. Zones are empty if the strip has fewer LEDs
+ * than zones.
+ */
+void DMXZones::setBounds(size_t length) {
+  for (u8_t i = 0; i < count; i++) {
+    zones[i].first = length * i / count;
+    zones[i].length = length * (i + 1) / count - zones[i].first;
+  }
+  boundsLength = length;
+  current = 0;
+}
+
+/**
+ * @brief Apply the colour and masks of the zone of the LED. The masks get the state of the LED
+ * within its zone.
+ *
+ * @param color Unused, the zone sets the colour
+ * @param state The current state of the LED, including the tick count
+ * @return The colour of the zone, masked and dimmed
+ */
+CRGB DMXZones::apply(CRGB color, LEDState* state) {
+  if (boundsLength != state->length) setBounds(state->length);
+
+  // The animator goes through the LEDs in order, so the zone rarely changes
+  u16_t index = state->index;
+  if (index < zones[current].first) current = 0;
+  while (current + 1 < count && zones[current].first + zones[current].length <= index) current++;
+
+  DMXZone& zone = zones[current];
+  CRGB result = zone.color;
+  if (zone.masks[0] == nullptr && zone.masks[1] == nullptr) return result.scale8(zone.dimmer);
+
+  LEDState local = *state;
+  local.index = index - zone.first;
+  local.virtual_index = local.index;
+  local.length = zone.length;
+
+  for (ILayer* mask : zone.masks) {
+    if (mask != nullptr) result = mask->apply(result, &local);
+  }
+  return result.scale8(zone.dimmer);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include "../leds/layers/layer.h"
+
+#define DMX_ZONE_CHANNELS 12 // Channels of a zone, see DMXZones
+#define DMX_ZONES_MAX 40     // Zones of a strip, i.e. 480 channels
+
+/**
+ * @brief A part of the strip with its own colour and masks.
+ */
+struct DMXZone {
+  u16_t first;     // First LED of the zone
+  u16_t length;    // LEDs in the zone
+  u8_t dimmer;
+  CRGB color;
+  ILayer* masks[2]; // Applied after the colour, or nullptr
+};
+
+/**
+ * @brief Splits the strip into zones of equal length, which are controlled by consecutive blocks of
+ * DMX channels. Each zone reads DMX_ZONE_CHANNELS channels:
+ *
+ * 1: Dimmer
+ * 2: Red
+ * 3: Green
+ * 4: Blue
+ * 5: Mask 1 type (1-9)
+ * 6-8: Mask 1 parameters
+ * 9: Mask 2 type (1-9)
+ * 10-12: Mask 2 parameters
+ *
+ * The masks decode like channels 8-15 of the single zone protocol, see dmx.cpp. Masks see the zone
+ * as their strip, such that e.g. a wave runs through every zone on its own. Every zone is rendered
+ * in the single pass of the animator over the strip, as the only layer.
+ *
+ * The zones only exist on the animator, and are never part of a sequence, so they are not encoded.
+ */
+class DMXZones : public ILayer {
+  DMXZone zones[DMX_ZONES_MAX];
+  u8_t previous[DMX_ZONES_MAX * DMX_ZONE_CHANNELS];
+  u8_t count;
+  size_t boundsLength = 0; // Strip length the zone bounds were computed for
+  u8_t current = 0;        // Zone of the last LED, as the animator goes through the LEDs in order
+  bool applied = false;
+
+  void setBounds(size_t length);
+  void applyZone(DMXZone& zone, const u8_t* channels, const u8_t* previous);
+
+  public:
+  DMXZones(u8_t count);
+  ~DMXZones();
+
+  u8_t getCount();
+  void setChannels(const u8_t* channels);
+
+  String getName() override;
+  protocol_LayerType getType() override;
+  String toString() override;
+  protocol_Layer toEncodable() override;
+  CRGB apply(CRGB color, LEDState* state) override;
+};
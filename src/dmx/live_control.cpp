@@ -0,0 +1,78 @@
+#include "live_control.h"
+#include "dmx.h"
+#include "debug.h"
+
+/**
+ * @brief Construct a new Live Control object
+ *
+ * @param animator The animator to control
+ * @param sequenceScheduler The scheduler to pause while the animator is under live control
+ */
+LiveControl::LiveControl(Animator* animator, SequenceScheduler* sequenceScheduler) {
+  this->animator = animator;
+  this->sequenceScheduler = sequenceScheduler;
+  this->sync = xSemaphoreCreateMutex();
+}
+
+String LiveControl::getName() {
+  return "Live Control";
+}
+
+/**
+ * @brief Check whether a packet is a control frame rather than a protobuf message.
+ *
+ * @param data The packet
+ * @param length Length of the packet
+ */
+bool LiveControl::isControlFrame(const u8_t* data, size_t length) {
+  return 0 < length && data[0] == CONTROL_FRAME_MAGIC;
+}
+
+/**
+ * @brief Validate a control frame and queue it for the next update. A frame that has not been
+ * applied yet is replaced, as only the latest fader positions matter.
+ *
+ * @param data The control frame
+ * @param length Length of the control frame
+ * @return true if the frame was valid
+ */
+bool LiveControl::post(const u8_t* data, size_t length) {
+  if (length != CONTROL_FRAME_SIZE || !isControlFrame(data, length)) return false;
+  if (!dmx_mask_valid(data + 8) || !dmx_mask_valid(data + 12)) return false;
+
+  xSemaphoreTake(sync, portMAX_DELAY);
+  memcpy(pending, data, CONTROL_FRAME_SIZE);
+  hasPending = true;
+  xSemaphoreGive(sync);
+  return true;
+}
+
+/**
+ * @brief Apply the latest control frame, if a new one has arrived. Hands the animator back to the
+ * sequence when no frame has arrived for LIVE_CONTROL_TIMEOUT.
+ */
+void LiveControl::update() {
+  if (!hasPending) {
+    if (sequenceScheduler->getOwner() == AnimatorOwner::LIVE_CONTROL && millis() - lastFrameAt >= LIVE_CONTROL_TIMEOUT) {
+      sequenceScheduler->resume(AnimatorOwner::LIVE_CONTROL);
+      debug("Live control timed out\n", 0);
+    }
+    return;
+  }
+
+  xSemaphoreTake(sync, portMAX_DELAY);
+  memcpy(frame, pending, CONTROL_FRAME_SIZE);
+  hasPending = false;
+  xSemaphoreGive(sync);
+
+  // Take over the animator from the sequence or another source, and apply every channel once
+  bool takeOver = sequenceScheduler->getOwner() != AnimatorOwner::LIVE_CONTROL;
+  if (takeOver) {
+    sequenceScheduler->pause(AnimatorOwner::LIVE_CONTROL);
+    animator->setStreaming(false); // Ends a pixel stream, which then leaves the scheduler paused
+    debug("Live control took over the animator\n", 0);
+  }
+  lastFrameAt = millis();
+
+  dmx_to_animation(animator, frame, takeOver);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "../scheduler/scheduler.h"
+#include "../leds/animator.h"
+#include "../leds/sequence_scheduler.h"
+
+#define CONTROL_FRAME_MAGIC 0xFF
+#define CONTROL_FRAME_SIZE 16
+#define LIVE_CONTROL_TIMEOUT 10000 // ms without frames, after which the sequence is shown again
+
+/**
+ * @brief Applies fixed-size control frames to the animator, for fader-style control at high rates.
+ *
+ * A control frame is a DMX channel block sent over serial or BLE, and is applied without
+ * protobuf decoding or rebuilding a sequence:
+ *
+ * Byte 0: CONTROL_FRAME_MAGIC
+ * Byte 1-15: DMX channels 1-15, see the DMX protocol in dmx.cpp
+ *
+ * The magic has wire type 7, which is invalid in protobuf, so a control frame is never mistaken
+ * for a Message. Frames can be posted from any task. Only the latest frame is kept, and it is
+ * applied on the next update. The first frame takes the animator over from the sequence, or from a
+ * pixel stream, and applies every channel. The sequence resumes after LIVE_CONTROL_TIMEOUT without
+ * frames, so a client that only sends on change must repeat its latest frame, or when a new
+ * sequence is set.
+ */
+class LiveControl : public Process {
+  Animator* animator;
+  SequenceScheduler* sequenceScheduler;
+  SemaphoreHandle_t sync;
+  u8_t pending[CONTROL_FRAME_SIZE];
+  u8_t frame[CONTROL_FRAME_SIZE];
+  volatile bool hasPending = false;
+  u32_t lastFrameAt = 0;
+
+  public:
+  LiveControl(Animator* animator, SequenceScheduler* sequenceScheduler);
+
+  static bool isControlFrame(const u8_t* data, size_t length);
+  bool post(const u8_t* data, size_t length);
+
+  String getName() override;
+  void update() override;
+};
@@ -31,6 +31,11 @@ Animator::Animator(CRGB* leds, size_t size) {
   clear();
 }
 
+// The layers are owned by the sequence they belong to
+Animator::~Animator() {
+  delete state;
+}
+
 String Animator::getName() {
   return "Animator";
 }
@@ -93,11 +98,46 @@ u8_t Animator::getBrightness() {
   return brightness;
 }
 
+/**
+ * @brief Hand the LED buffer to a stream of raw pixels. While streaming, update() leaves the
+ * pixels alone, and the stream shows them.
+ *
+ * @param streaming Whether pixels are streamed
+ */
+void Animator::setStreaming(bool streaming) {
+  this->streaming = streaming;
+}
+
+bool Animator::isStreaming() {
+  return streaming;
+}
+
+/**
+ * @brief Get the LED buffer, for writing pixels directly while streaming
+ *
+ * @return CRGB* The buffer of getLength() pixels
+ */
+CRGB* Animator::getLeds() {
+  return leds;
+}
+
+size_t Animator::getLength() {
+  return state->length;
+}
+
+/**
+ * @brief Show the LED buffer at the master brightness
+ */
+void Animator::show() {
+  FastLED.show(brightness);
+}
+
 /**
  * @brief A method to update the LED strip with the current layers
  * It should be called every 20ms
  */
 void Animator::update() {
+  if (streaming) return;
 
   if (layers.size() == 0) {
     for (u16_t i = 0; i < state->length; i++) {
@@ -118,5 +158,5 @@ void Animator::update() {
 
   // Tick should not exceed max
   state->tick = (state->tick + state->direction) % ANIMATION_DURATION_MAX;
-  FastLED.show(brightness);
+  show();
 }
\ No newline at end of file
@@ -15,11 +15,13 @@ class Animator : public Process {
   LEDState* state;
   u8_t brightness = 255;
   u16_t virtual_offset = 0;
+  bool streaming = false; // The pixels are written by a PixelStream, so the layers are not applied
 
   void resetTick();
 
   public:
   Animator(CRGB* leds, size_t size);
+  ~Animator();
   void setVirtualOffset(u16_t virtual_offset);
   void clear();
   void setBrightness(u8_t brightness);
@@ -27,6 +29,11 @@ class Animator : public Process {
   u8_t getBrightness();
   void setDirection(Direction direction);
   void setLayers(std::vector<ILayer*> layers);
+  void setStreaming(bool streaming);
+  bool isStreaming();
+  CRGB* getLeds();
+  size_t getLength();
+  void show();
 
   String getName();
   void update();
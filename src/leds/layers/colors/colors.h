@@ -13,8 +13,10 @@ class FadeColor : public ILayer {
   public:
   FadeColor(std::vector<CRGB> colors, u16_t duration);
   String getName() override;
+  protocol_LayerType getType() override;
   String toString() override;
   protocol_Layer toEncodable() override;
+  bool patch(protocol_LayerField field, u32_t index, u32_t value) override;
   CRGB apply(CRGB color, LEDState* state) override;
 };
 
@@ -25,8 +27,10 @@ class RainbowColor : public ILayer {
 
   public:
   String getName() override;
+  protocol_LayerType getType() override;
   String toString() override;
   protocol_Layer toEncodable() override;
+  bool patch(protocol_LayerField field, u32_t index, u32_t value) override;
   RainbowColor(u16_t duration, u16_t length);
   CRGB apply(CRGB color, LEDState* state) override;
 };
@@ -38,8 +42,10 @@ class SectionsWaveColor : public ILayer {
 
   public:
   String getName() override;
+  protocol_LayerType getType() override;
   String toString() override;
   protocol_Layer toEncodable() override;
+  bool patch(protocol_LayerField field, u32_t index, u32_t value) override;
   SectionsWaveColor(std::vector<CRGB> colors, u16_t duration);
   CRGB apply(CRGB color, LEDState* state) override;
 };
@@ -51,8 +57,10 @@ class SectionsColor : public ILayer {
   public:
   std::vector<CRGB> colors;
   String getName() override;
+  protocol_LayerType getType() override;
   String toString() override;
   protocol_Layer toEncodable() override;
+  bool patch(protocol_LayerField field, u32_t index, u32_t value) override;
   SectionsColor(std::vector<CRGB> colors, u16_t duration);
   CRGB apply(CRGB color, LEDState* state) override;
 };
@@ -63,10 +71,12 @@ class SingleColor : public ILayer {
 
   public:
   String getName();
+  protocol_LayerType getType() override;
   SingleColor(CRGB color);
   void setColor(CRGB color);
   String toString() override;
   protocol_Layer toEncodable() override;
+  bool patch(protocol_LayerField field, u32_t index, u32_t value) override;
   CRGB apply(CRGB color, LEDState* state);
 };
 
@@ -77,8 +87,10 @@ class SwitchColor : public ILayer {
 
   public:
   String getName() override;
+  protocol_LayerType getType() override;
   String toString() override;
   protocol_Layer toEncodable() override;
+  bool patch(protocol_LayerField field, u32_t index, u32_t value) override;
   SwitchColor(std::vector<CRGB> colors, u16_t duration);
   CRGB apply(CRGB color, LEDState* state) override;
 };
\ No newline at end of file
@@ -9,6 +9,10 @@ String FadeColor::getName() {
   return "Fade Color";
 }
 
+protocol_LayerType FadeColor::getType() {
+  return protocol_LayerType_FadeColor;
+}
+
 /**
  * @brief Construct a new Fade Color object
  *
@@ -18,7 +22,7 @@ String FadeColor::getName() {
  * @example FadeColor({CRGB::Red, CRGB::Green, CRGB::Blue}, 20)
  */
 FadeColor::FadeColor(std::vector<CRGB> colors, u16_t duration) {
-  this->colors = colors;
+  this->colors = std::move(colors);
   this->duration = duration;
 }
 
@@ -69,10 +73,28 @@ CRGB FadeColor::apply(CRGB color, LEDState* state) {
 
 protocol_Layer FadeColor::toEncodable() {
   return protocol_Layer {
-    .type = protocol_LayerType_FadeColor,
     .duration = this->duration,
     .colors = {
       .arg = &this->colors
     }
   };
+}
+
+/**
+ * @brief Change a parameter of the layer in place.
+ * @param field The field to change
+ * @param index Element index, only used for colors
+ * @param value The new value of the field
+ * @return true if the layer has the field
+ */
+bool FadeColor::patch(protocol_LayerField field, u32_t index, u32_t value) {
+  switch (field) {
+    case protocol_LayerField_DurationField:
+      this->duration = value;
+      return true;
+    case protocol_LayerField_ColorsField:
+      return LayerUtils::patch_colors(this->colors, index, value);
+    default:
+      return false;
+  }
 }
\ No newline at end of file
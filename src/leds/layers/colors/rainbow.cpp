@@ -7,6 +7,10 @@ String RainbowColor::getName() {
   return "Rainbow Color";
 }
 
+protocol_LayerType RainbowColor::getType() {
+  return protocol_LayerType_RainbowColor;
+}
+
 /**
  * @brief Construct a new Rainbow Color object
  *
@@ -40,8 +44,27 @@ CRGB RainbowColor::apply(CRGB color, LEDState* state) {
 
 protocol_Layer RainbowColor::toEncodable() {
   return protocol_Layer {
-    .type = protocol_LayerType_RainbowColor,
     .duration = static_cast<uint32_t>(this->duration),
     .length = static_cast<uint32_t>(this->length)
   };
 }
+
+/**
+ * @brief Change a parameter of the layer in place.
+ * @param field The field to change
+ * @param index Unused, the layer has no lists
+ * @param value The new value of the field
+ * @return true if the layer has the field
+ */
+bool RainbowColor::patch(protocol_LayerField field, u32_t index, u32_t value) {
+  switch (field) {
+    case protocol_LayerField_DurationField:
+      this->duration = value;
+      return true;
+    case protocol_LayerField_LengthField:
+      this->length = value;
+      return true;
+    default:
+      return false;
+  }
+}
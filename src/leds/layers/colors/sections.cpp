@@ -8,6 +8,10 @@ String SectionsColor::getName() {
   return "Sections Color";
 }
 
+protocol_LayerType SectionsColor::getType() {
+  return protocol_LayerType_SectionsColor;
+}
+
 /**
  * @brief Construct a new Sections Mask object
  *
@@ -18,7 +22,7 @@ String SectionsColor::getName() {
  */
 SectionsColor::SectionsColor(std::vector<CRGB> colors, u16_t duration) {
   this->duration = duration;
-  this->colors = colors;
+  this->colors = std::move(colors);
 }
 
 String SectionsColor::toString() {
@@ -43,10 +47,28 @@ CRGB SectionsColor::apply(CRGB color, LEDState* state) {
 
 protocol_Layer SectionsColor::toEncodable() {
   return protocol_Layer {
-    .type = protocol_LayerType_SectionsColor,
     .duration = this->duration,
     .colors = {
       .arg = &this->colors
     }
   };
+}
+
+/**
+ * @brief Change a parameter of the layer in place.
+ * @param field The field to change
+ * @param index Element index, only used for colors
+ * @param value The new value of the field
+ * @return true if the layer has the field
+ */
+bool SectionsColor::patch(protocol_LayerField field, u32_t index, u32_t value) {
+  switch (field) {
+    case protocol_LayerField_DurationField:
+      this->duration = value;
+      return true;
+    case protocol_LayerField_ColorsField:
+      return LayerUtils::patch_colors(this->colors, index, value);
+    default:
+      return false;
+  }
 }
\ No newline at end of file
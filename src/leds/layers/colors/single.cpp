@@ -7,6 +7,10 @@ String SingleColor::getName() {
   return "Single Color";
 }
 
+protocol_LayerType SingleColor::getType() {
+  return protocol_LayerType_SingleColor;
+}
+
 /**
  * @brief Construct a new Single Color object
  *
@@ -40,7 +44,19 @@ void SingleColor::setColor(CRGB color) {
 
 protocol_Layer SingleColor::toEncodable() {
   return protocol_Layer {
-    .type = protocol_LayerType_SingleColor,
     .color = (uint32_t)0 | this->localColor.r << 16 | this->localColor.g << 8 | this->localColor.b
   };
+}
+
+/**
+ * @brief Change a parameter of the layer in place.
+ * @param field The field to change
+ * @param index Unused, the layer has no lists
+ * @param value The new value of the field
+ * @return true if the layer has the field
+ */
+bool SingleColor::patch(protocol_LayerField field, u32_t index, u32_t value) {
+  if (field != protocol_LayerField_ColorField) return false;
+  this->localColor = CRGB(value);
+  return true;
 }
\ No newline at end of file
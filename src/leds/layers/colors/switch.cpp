@@ -7,6 +7,10 @@ String SwitchColor::getName() {
   return "Switch Color";
 }
 
+protocol_LayerType SwitchColor::getType() {
+  return protocol_LayerType_SwitchColor;
+}
+
 /**
  * @brief Construct a new Switch Color object
  *
@@ -16,7 +20,7 @@ String SwitchColor::getName() {
  * @example SwitchColor({CRGB::Red, CRGB::Green, CRGB::Blue}, 20)
  */
 SwitchColor::SwitchColor(std::vector<CRGB> colors, u16_t duration) {
-  this->colors = colors;
+  this->colors = std::move(colors);
   this->duration = duration;
 }
 
@@ -41,10 +45,28 @@ CRGB SwitchColor::apply(CRGB color, LEDState* state) {
 
 protocol_Layer SwitchColor::toEncodable() {
   return protocol_Layer {
-    .type = protocol_LayerType_SwitchColor,
     .duration = duration,
     .colors = {
       .arg = &this->colors
     }
   };
+}
+
+/**
+ * @brief Change a parameter of the layer in place.
+ * @param field The field to change
+ * @param index Element index, only used for colors
+ * @param value The new value of the field
+ * @return true if the layer has the field
+ */
+bool SwitchColor::patch(protocol_LayerField field, u32_t index, u32_t value) {
+  switch (field) {
+    case protocol_LayerField_DurationField:
+      this->duration = value;
+      return true;
+    case protocol_LayerField_ColorsField:
+      return LayerUtils::patch_colors(this->colors, index, value);
+    default:
+      return false;
+  }
 }
\ No newline at end of file
@@ -1,5 +1,16 @@
 #include "layer.h"
 #include <FastLED.h>
+#include "../../diagnostics/telemetry.h"
+
+void* ILayer::operator new(size_t size) {
+  Telemetry::allocated(Subsystem::LAYERS, size);
+  return ::operator new(size);
+}
+
+void ILayer::operator delete(void* ptr, size_t size) {
+  Telemetry::released(Subsystem::LAYERS, size);
+  ::operator delete(ptr);
+}
 
 /**
  * @brief A dynamic layer that can be changed at runtime.
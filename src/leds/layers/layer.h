@@ -5,10 +5,18 @@
 #include "protocol.pb.h"
 #include "../state.h"
 
+#define LAYER_COLORS_MAX 255 // Colors of a layer. Colors are indexed with a byte, e.g. by FadeColor.
+
 class ILayer {
   public:
   virtual ~ILayer() {}
 
+  /**
+   * @brief Allocate a layer. Layers are attributed to the layers subsystem in the telemetry.
+   */
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr, size_t size);
+
   /**
    * @brief Get the Name object
    *
@@ -16,6 +24,13 @@ class ILayer {
    */
   virtual String getName() = 0;
 
+  /**
+   * @brief Get the protocol type of the layer. It is the key of the layer in the LayerRegistry.
+   *
+   * @return protocol_LayerType
+   */
+  virtual protocol_LayerType getType() = 0;
+
   /**
    * @brief To String
    * 
@@ -24,12 +39,25 @@ class ILayer {
   virtual String toString() = 0;
 
   /**
-   * @brief Encode the layer into a protocol buffer.
+   * @brief Encode the parameters of the layer into a protocol buffer.
+   * Use LayerRegistry::encode, which also sets the type.
    *
    * @return protocol_Layer
    */
   virtual protocol_Layer toEncodable() = 0;
 
+  /**
+   * @brief Change a single parameter of the layer in place. The layer keeps its phase,
+   * as the tick is owned by the animator. Use LayerRegistry::patch, which first checks the value
+   * against the schema of the layer type, such that values that would break apply() never get here.
+   *
+   * @param field The field to change
+   * @param index Element index, only used for colors and sections. At most the number of elements.
+   * @param value The new value of the field
+   * @return true if the layer has the field
+   */
+  virtual bool patch(protocol_LayerField field, u32_t index, u32_t value) { return false; }
+
   /**
    * @brief Apply the layer to the given color.
    *
@@ -13,12 +13,16 @@
  * @example BlinkMask({255, 0, 0, 0}, 20)
  */
 BlinkMask::BlinkMask(std::vector<u8_t> pattern, u16_t duration)
-  : duration(duration), pattern(pattern) {}
+  : duration(duration), pattern(std::move(pattern)) {}
 
 String BlinkMask::getName() {
   return "Blink Mask";
 }
 
+protocol_LayerType BlinkMask::getType() {
+  return protocol_LayerType_BlinkMask;
+}
+
 String BlinkMask::toString() {
   String str = "BlinkMask: d: " + String(this->duration) + ", c: ";
   str += LayerUtils::bytes_to_string(this->pattern);
@@ -39,10 +43,28 @@ CRGB BlinkMask::apply(CRGB color, LEDState* state) {
 
 protocol_Layer BlinkMask::toEncodable() {
   return protocol_Layer {
-    .type = protocol_LayerType_BlinkMask,
     .duration = this->duration,
     .sections = {
       .arg = &this->pattern
     }
   };
+}
+
+/**
+ * @brief Change a parameter of the layer in place.
+ * @param field The field to change
+ * @param index Element index, only used for the pattern
+ * @param value The new value of the field
+ * @return true if the layer has the field
+ */
+bool BlinkMask::patch(protocol_LayerField field, u32_t index, u32_t value) {
+  switch (field) {
+    case protocol_LayerField_DurationField:
+      this->duration = value;
+      return true;
+    case protocol_LayerField_SectionsField:
+      return LayerUtils::patch_bytes(this->pattern, index, value);
+    default:
+      return false;
+  }
 }
\ No newline at end of file
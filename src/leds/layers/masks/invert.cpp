@@ -6,6 +6,10 @@ String InvertMask::getName() {
   return "Invert Mask";
 }
 
+protocol_LayerType InvertMask::getType() {
+  return protocol_LayerType_InvertMask;
+}
+
 /**
  * @brief Inverts the given color based on the current state.
  * @param color The original color of the LED.
@@ -21,7 +25,5 @@ String InvertMask::toString() {
 }
 
 protocol_Layer InvertMask::toEncodable() {
-  return protocol_Layer {
-    .type = protocol_LayerType_InvertMask
-  };
+  return protocol_Layer {};
 }
\ No newline at end of file
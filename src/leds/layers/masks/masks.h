@@ -11,14 +11,17 @@ class BlinkMask : public ILayer {
   public:
   BlinkMask(std::vector<u8_t> pattern, u16_t duration);
   String getName() override;
+  protocol_LayerType getType() override;
   String toString() override;
   protocol_Layer toEncodable() override;
+  bool patch(protocol_LayerField field, u32_t index, u32_t value) override;
   CRGB apply(CRGB color, LEDState* state) override;
 };
 
 class InvertMask : public ILayer {
   public:
   String getName() override;
+  protocol_LayerType getType() override;
   String toString() override;
   protocol_Layer toEncodable() override;
   CRGB apply(CRGB color, LEDState* state) override;
@@ -31,8 +34,10 @@ class PulseSawtoothMask : public ILayer {
   public:
   PulseSawtoothMask(u16_t pulse_gap, u16_t duration);
   String getName() override;
+  protocol_LayerType getType() override;
   String toString() override;
   protocol_Layer toEncodable() override;
+  bool patch(protocol_LayerField field, u32_t index, u32_t value) override;
   CRGB apply(CRGB color, LEDState* state) override;
 };
 
@@ -44,8 +49,10 @@ class SectionsRandomMask : public ILayer {
 
   public:
   String getName() override;
+  protocol_LayerType getType() override;
   String toString() override;
   protocol_Layer toEncodable() override;
+  bool patch(protocol_LayerField field, u32_t index, u32_t value) override;
   SectionsRandomMask(std::vector<u8_t> sections, u16_t duration);
   CRGB apply(CRGB color, LEDState* state) override;
 };
@@ -56,8 +63,10 @@ class PulseMask : public ILayer {
 
   public:
   String getName() override;
+  protocol_LayerType getType() override;
   String toString() override;
   protocol_Layer toEncodable() override;
+  bool patch(protocol_LayerField field, u32_t index, u32_t value) override;
   PulseMask(u16_t pulse_gap, u16_t duration);
   CRGB apply(CRGB color, LEDState* state) override;
 };
@@ -70,8 +79,10 @@ class SawtoothMask : public ILayer {
   public:
   SawtoothMask(u16_t wavelength, u16_t wavegap, u16_t duration);
   String getName() override;
+  protocol_LayerType getType() override;
   String toString() override;
   protocol_Layer toEncodable() override;
+  bool patch(protocol_LayerField field, u32_t index, u32_t value) override;
   CRGB apply(CRGB color, LEDState* state) override;
 };
 
@@ -81,8 +92,10 @@ class SectionsWaveMask : public ILayer {
 
   public:
   String getName() override;
+  protocol_LayerType getType() override;
   String toString() override;
   protocol_Layer toEncodable() override;
+  bool patch(protocol_LayerField field, u32_t index, u32_t value) override;
   SectionsWaveMask(std::vector<u8_t> sections, u16_t duration);
   CRGB apply(CRGB color, LEDState* state) override;
 };
@@ -93,8 +106,10 @@ class SectionsMask : public ILayer {
   public:
   std::vector<u8_t> sections;
   String getName() override;
+  protocol_LayerType getType() override;
   String toString() override;
   protocol_Layer toEncodable() override;
+  bool patch(protocol_LayerField field, u32_t index, u32_t value) override;
   SectionsMask(std::vector<u8_t> sections, u16_t duration);
   CRGB apply(CRGB color, LEDState* state) override;
 };
@@ -111,8 +126,10 @@ class StarsMask : public ILayer {
 
   public:
   String getName() override;
+  protocol_LayerType getType() override;
   String toString() override;
   protocol_Layer toEncodable() override;
+  bool patch(protocol_LayerField field, u32_t index, u32_t value) override;
   StarsMask(u16_t frequency, u8_t decaySpeed, u8_t starLength);
   CRGB apply(CRGB color, LEDState* state) override;
 };
@@ -124,8 +141,10 @@ class WaveMask : public ILayer {
 
   public:
   String getName() override;
+  protocol_LayerType getType() override;
   String toString() override;
   protocol_Layer toEncodable() override;
+  bool patch(protocol_LayerField field, u32_t index, u32_t value) override;
   WaveMask(u16_t wavelength, u16_t wavegap, u16_t duration);
   CRGB apply(CRGB color, LEDState* state) override;
 };
\ No newline at end of file
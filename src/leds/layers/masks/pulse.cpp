@@ -7,6 +7,10 @@ String PulseMask::getName() {
   return "Pulse Mask";
 }
 
+protocol_LayerType PulseMask::getType() {
+  return protocol_LayerType_PulseMask;
+}
+
 /**
  * @brief Construct a new Pulse Mask object
  *
@@ -47,8 +51,27 @@ CRGB PulseMask::apply(CRGB color, LEDState* state) {
 
 protocol_Layer PulseMask::toEncodable() {
   return protocol_Layer {
-    .type = protocol_LayerType_PulseMask,
     .duration = this->duration,
     .gap = this->pulse_gap
   };
+}
+
+/**
+ * @brief Change a parameter of the layer in place.
+ * @param field The field to change
+ * @param index Unused, the layer has no lists
+ * @param value The new value of the field
+ * @return true if the layer has the field
+ */
+bool PulseMask::patch(protocol_LayerField field, u32_t index, u32_t value) {
+  switch (field) {
+    case protocol_LayerField_DurationField:
+      this->duration = value;
+      return true;
+    case protocol_LayerField_GapField:
+      this->pulse_gap = value;
+      return true;
+    default:
+      return false;
+  }
 }
\ No newline at end of file
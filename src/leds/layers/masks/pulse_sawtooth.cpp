@@ -18,6 +18,10 @@ String PulseSawtoothMask::getName() {
   return "Pulse Sawtooth Mask";
 }
 
+protocol_LayerType PulseSawtoothMask::getType() {
+  return protocol_LayerType_PulseSawtoothMask;
+}
+
 /**
  * @brief Construct a new Pulse Sawtooth Mask object
  *
@@ -52,8 +56,27 @@ String PulseSawtoothMask::toString() {
 
 protocol_Layer PulseSawtoothMask::toEncodable() {
   return protocol_Layer {
-    .type = protocol_LayerType_PulseSawtoothMask,
     .duration = this->duration,
     .gap = this->pulse_gap
   };
+}
+
+/**
+ * @brief Change a parameter of the layer in place.
+ * @param field The field to change
+ * @param index Unused, the layer has no lists
+ * @param value The new value of the field
+ * @return true if the layer has the field
+ */
+bool PulseSawtoothMask::patch(protocol_LayerField field, u32_t index, u32_t value) {
+  switch (field) {
+    case protocol_LayerField_DurationField:
+      this->duration = value;
+      return true;
+    case protocol_LayerField_GapField:
+      this->pulse_gap = value;
+      return true;
+    default:
+      return false;
+  }
 }
\ No newline at end of file
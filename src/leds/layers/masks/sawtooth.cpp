@@ -8,6 +8,10 @@ String SawtoothMask::getName() {
   return "Sawtooth Mask";
 }
 
+protocol_LayerType SawtoothMask::getType() {
+  return protocol_LayerType_SawtoothMask;
+}
+
 /**
  * @brief Construct a new Sawtooth Mask object
  *
@@ -54,9 +58,31 @@ CRGB SawtoothMask::apply(CRGB color, LEDState* state) {
 
 protocol_Layer SawtoothMask::toEncodable() {
   return protocol_Layer {
-    .type = protocol_LayerType_SawtoothMask,
     .duration = this->duration,
     .length = this->wavelength,
     .gap = this->wavegap
   };
+}
+
+/**
+ * @brief Change a parameter of the layer in place.
+ * @param field The field to change
+ * @param index Unused, the layer has no lists
+ * @param value The new value of the field
+ * @return true if the layer has the field
+ */
+bool SawtoothMask::patch(protocol_LayerField field, u32_t index, u32_t value) {
+  switch (field) {
+    case protocol_LayerField_DurationField:
+      this->duration = value;
+      return true;
+    case protocol_LayerField_LengthField:
+      this->wavelength = value;
+      return true;
+    case protocol_LayerField_GapField:
+      this->wavegap = value;
+      return true;
+    default:
+      return false;
+  }
 }
\ No newline at end of file
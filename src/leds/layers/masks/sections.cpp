@@ -8,6 +8,10 @@ String SectionsMask::getName() {
   return "Sections Mask";
 }
 
+protocol_LayerType SectionsMask::getType() {
+  return protocol_LayerType_SectionsMask;
+}
+
 /**
  * @brief Construct a new Sections Mask object
  *
@@ -18,7 +22,7 @@ String SectionsMask::getName() {
  */
 SectionsMask::SectionsMask(std::vector<u8_t> sections, u16_t duration) {
   this->duration = duration;
-  this->sections = sections;
+  this->sections = std::move(sections);
 }
 
 String SectionsMask::toString() {
@@ -44,10 +48,28 @@ CRGB SectionsMask::apply(CRGB color, LEDState* state) {
 
 protocol_Layer SectionsMask::toEncodable() {
   return protocol_Layer {
-    .type = protocol_LayerType_SectionsMask,
     .duration = this->duration,
     .sections = {
       .arg = &this->sections
     }
   };
+}
+
+/**
+ * @brief Change a parameter of the layer in place.
+ * @param field The field to change
+ * @param index Element index, only used for sections
+ * @param value The new value of the field
+ * @return true if the layer has the field
+ */
+bool SectionsMask::patch(protocol_LayerField field, u32_t index, u32_t value) {
+  switch (field) {
+    case protocol_LayerField_DurationField:
+      this->duration = value;
+      return true;
+    case protocol_LayerField_SectionsField:
+      return LayerUtils::patch_bytes(this->sections, index, value);
+    default:
+      return false;
+  }
 }
\ No newline at end of file
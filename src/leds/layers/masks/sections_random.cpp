@@ -8,7 +8,7 @@
 SectionsRandomMask::SectionsRandomMask(std::vector<u8_t> sections, u16_t duration)
     : duration(duration), sections(std::move(sections)) {
         this->tick_of_next_update = duration;
-        this->current_section = random(0, sections.size());
+        this->current_section = random(0, this->sections.size());
     }
 
 // Returns the name of the layer
@@ -16,6 +16,11 @@ String SectionsRandomMask::getName() {
     return "SectionsRandomMask";
 }
 
+// Returns the protocol type of the layer
+protocol_LayerType SectionsRandomMask::getType() {
+    return protocol_LayerType_SectionsRandomMask;
+}
+
 // Returns a string representation of the layer
 String SectionsRandomMask::toString() {
   String str = "SectionsRandomMask: d: " + String(this->duration) + ", c: ";
@@ -27,7 +32,6 @@ String SectionsRandomMask::toString() {
 // Encodes the layer into a protocol_Layer object
 protocol_Layer SectionsRandomMask::toEncodable() {
   return protocol_Layer {
-    .type = protocol_LayerType_SectionsWaveMask,
     .duration = this->duration,
     .sections = {
       .arg = &this->sections
@@ -52,4 +56,23 @@ CRGB SectionsRandomMask::apply(CRGB color, LEDState* state) {
     }
 
     return color.scale8(this->sections[this->current_section]);
+}
+
+/**
+ * @brief Change a parameter of the layer in place.
+ * @param field The field to change
+ * @param index Element index, only used for sections
+ * @param value The new value of the field
+ * @return true if the layer has the field
+ */
+bool SectionsRandomMask::patch(protocol_LayerField field, u32_t index, u32_t value) {
+  switch (field) {
+    case protocol_LayerField_DurationField:
+      this->duration = value;
+      return true;
+    case protocol_LayerField_SectionsField:
+      return LayerUtils::patch_bytes(this->sections, index, value);
+    default:
+      return false;
+  }
 }
\ No newline at end of file
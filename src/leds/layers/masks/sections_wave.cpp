@@ -8,6 +8,10 @@ String SectionsWaveMask::getName() {
   return "Sections Wave Mask";
 }
 
+protocol_LayerType SectionsWaveMask::getType() {
+  return protocol_LayerType_SectionsWaveMask;
+}
+
 /**
  * @brief Construct a new Sections Mask object
  *
@@ -18,7 +22,7 @@ String SectionsWaveMask::getName() {
  */
 SectionsWaveMask::SectionsWaveMask(std::vector<u8_t> sections, u16_t duration) {
   this->duration = duration;
-  this->sections = sections;
+  this->sections = std::move(sections);
 }
 
 String SectionsWaveMask::toString() {
@@ -45,10 +49,28 @@ CRGB SectionsWaveMask::apply(CRGB color, LEDState* state) {
 
 protocol_Layer SectionsWaveMask::toEncodable() {
   return protocol_Layer {
-    .type = protocol_LayerType_SectionsWaveMask,
     .duration = this->duration,
     .sections = {
       .arg = &this->sections
     }
   };
+}
+
+/**
+ * @brief Change a parameter of the layer in place.
+ * @param field The field to change
+ * @param index Element index, only used for sections
+ * @param value The new value of the field
+ * @return true if the layer has the field
+ */
+bool SectionsWaveMask::patch(protocol_LayerField field, u32_t index, u32_t value) {
+  switch (field) {
+    case protocol_LayerField_DurationField:
+      this->duration = value;
+      return true;
+    case protocol_LayerField_SectionsField:
+      return LayerUtils::patch_bytes(this->sections, index, value);
+    default:
+      return false;
+  }
 }
\ No newline at end of file
@@ -16,16 +16,7 @@
  */
 void StarsMask::adjustVector(size_t length) {
   if (this->multipliers.size() != length) {
-    if (this->multipliers.size() < length) {
-      for (u16_t i = 0; i < length - this->multipliers.size(); i++) {
-        this->multipliers.push_back(0);
-      }
-    }
-    else {
-      for (u16_t i = 0; i < this->multipliers.size() - length; i++) {
-        this->multipliers.pop_back();
-      }
-    }
+    this->multipliers.resize(length, 0);
   }
 }
 
@@ -40,7 +31,7 @@ void StarsMask::adjustVector(size_t length) {
  */
 void StarsMask::brightenNeighbourLEDs(LEDState* state) {
   for (u8_t i = 1; i <= this->starLength / 2; i++) {
-    u16_t left = (state->index - i) % state->length;
+    u16_t left = (state->index + state->length - i % state->length) % state->length;
     u16_t right = (state->index + i) % state->length;
     u8_t scale = 255 / ((float)i + .5f);
     this->multipliers[left] = max(scale, this->multipliers[left]);
@@ -66,6 +57,10 @@ String StarsMask::getName() {
   return "Stars Mask";
 }
 
+protocol_LayerType StarsMask::getType() {
+  return protocol_LayerType_StarsMask;
+}
+
 /**
  * @brief Construct a new Stars Mask object
  * @param frequency amount of stars spawning every second
@@ -106,9 +101,31 @@ CRGB StarsMask::apply(CRGB color, LEDState* state) {
 
 protocol_Layer StarsMask::toEncodable() {
   return protocol_Layer {
-    .type = protocol_LayerType_StarsMask,
     .length = this->starLength,
     .frequency = this->frequency,
     .speed = this->decaySpeed,
   };
 }
+
+/**
+ * @brief Change a parameter of the layer in place.
+ * @param field The field to change
+ * @param index Unused, the layer has no lists
+ * @param value The new value of the field
+ * @return true if the layer has the field
+ */
+bool StarsMask::patch(protocol_LayerField field, u32_t index, u32_t value) {
+  switch (field) {
+    case protocol_LayerField_FrequencyField:
+      this->frequency = value;
+      return true;
+    case protocol_LayerField_SpeedField:
+      this->decaySpeed = value;
+      return true;
+    case protocol_LayerField_LengthField:
+      this->starLength = value;
+      return true;
+    default:
+      return false;
+  }
+}
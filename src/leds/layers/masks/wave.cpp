@@ -9,6 +9,10 @@ String WaveMask::getName() {
   return "Wave Mask";
 }
 
+protocol_LayerType WaveMask::getType() {
+  return protocol_LayerType_WaveMask;
+}
+
 /**
  * @brief Construct a new Wave Mask object
  *
@@ -56,9 +60,31 @@ CRGB WaveMask::apply(CRGB color, LEDState* state) {
 
 protocol_Layer WaveMask::toEncodable() {
   return protocol_Layer {
-    .type = protocol_LayerType_WaveMask,
     .duration = this->duration,
     .length = this->wavelength,
     .gap = this->wavegap,
   };
+}
+
+/**
+ * @brief Change a parameter of the layer in place.
+ * @param field The field to change
+ * @param index Unused, the layer has no lists
+ * @param value The new value of the field
+ * @return true if the layer has the field
+ */
+bool WaveMask::patch(protocol_LayerField field, u32_t index, u32_t value) {
+  switch (field) {
+    case protocol_LayerField_DurationField:
+      this->duration = value;
+      return true;
+    case protocol_LayerField_LengthField:
+      this->wavelength = value;
+      return true;
+    case protocol_LayerField_GapField:
+      this->wavegap = value;
+      return true;
+    default:
+      return false;
+  }
 }
\ No newline at end of file
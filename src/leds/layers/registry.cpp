@@ -0,0 +1,294 @@
+#include "registry.h"
+#include "debug.h"
+#include "colors/colors.h"
+#include "masks/masks.h"
+
+static ILayer* create_single_color(LayerParameters& p) {
+  return new SingleColor(CRGB(p.layer.color));
+}
+
+static ILayer* create_rainbow_color(LayerParameters& p) {
+  return new RainbowColor(p.layer.duration, p.layer.length);
+}
+
+static ILayer* create_sections_wave_color(LayerParameters& p) {
+  return new SectionsWaveColor(std::move(p.colors), p.layer.duration);
+}
+
+static ILayer* create_sections_color(LayerParameters& p) {
+  return new SectionsColor(std::move(p.colors), p.layer.duration);
+}
+
+static ILayer* create_fade_color(LayerParameters& p) {
+  return new FadeColor(std::move(p.colors), p.layer.duration);
+}
+
+static ILayer* create_switch_color(LayerParameters& p) {
+  return new SwitchColor(std::move(p.colors), p.layer.duration);
+}
+
+static ILayer* create_blink_mask(LayerParameters& p) {
+  return new BlinkMask(std::move(p.sections), p.layer.duration);
+}
+
+static ILayer* create_invert_mask(LayerParameters& p) {
+  return new InvertMask();
+}
+
+static ILayer* create_pulse_sawtooth_mask(LayerParameters& p) {
+  return new PulseSawtoothMask(p.layer.gap, p.layer.duration);
+}
+
+static ILayer* create_pulse_mask(LayerParameters& p) {
+  return new PulseMask(p.layer.gap, p.layer.duration);
+}
+
+static ILayer* create_sawtooth_mask(LayerParameters& p) {
+  return new SawtoothMask(p.layer.length, p.layer.gap, p.layer.duration);
+}
+
+static ILayer* create_sections_wave_mask(LayerParameters& p) {
+  return new SectionsWaveMask(std::move(p.sections), p.layer.duration);
+}
+
+static ILayer* create_sections_mask(LayerParameters& p) {
+  return new SectionsMask(std::move(p.sections), p.layer.duration);
+}
+
+static ILayer* create_stars_mask(LayerParameters& p) {
+  return new StarsMask(p.layer.frequency, p.layer.speed, p.layer.length);
+}
+
+static ILayer* create_wave_mask(LayerParameters& p) {
+  return new WaveMask(p.layer.length, p.layer.gap, p.layer.duration);
+}
+
+static ILayer* create_sections_random_mask(LayerParameters& p) {
+  return new SectionsRandomMask(std::move(p.sections), p.layer.duration);
+}
+
+// Frequently used schemas
+static constexpr LayerSchema COLORS_SCHEMA = {
+  LAYER_FIELD(Colors) | LAYER_FIELD(Duration), LAYER_FIELD(Colors) | LAYER_FIELD(Duration), 0, false
+};
+static constexpr LayerSchema COLOR_SEGMENTS_SCHEMA = {
+  LAYER_FIELD(Colors) | LAYER_FIELD(Duration), LAYER_FIELD(Colors) | LAYER_FIELD(Duration), 0, true
+};
+static constexpr LayerSchema SECTIONS_SCHEMA = {
+  LAYER_FIELD(Sections) | LAYER_FIELD(Duration), LAYER_FIELD(Sections) | LAYER_FIELD(Duration), 0, false
+};
+static constexpr LayerSchema SECTION_SEGMENTS_SCHEMA = {
+  LAYER_FIELD(Sections) | LAYER_FIELD(Duration), LAYER_FIELD(Sections) | LAYER_FIELD(Duration), 0, true
+};
+static constexpr LayerSchema PULSE_SCHEMA = {
+  LAYER_FIELD(Gap) | LAYER_FIELD(Duration), LAYER_FIELD(Duration), 0, false
+};
+static constexpr LayerSchema WAVE_SCHEMA = {
+  LAYER_FIELD(Length) | LAYER_FIELD(Gap) | LAYER_FIELD(Duration), LAYER_FIELD(Length) | LAYER_FIELD(Duration), 0, false
+};
+
+/**
+ * The table is indexed by slot(type). Colors take the first slots, followed by the masks.
+ */
+static constexpr LayerDefinition LAYERS[] = {
+  // Colors
+  { protocol_LayerType_SingleColor, "Single Color", create_single_color, { LAYER_FIELD(Color), 0, 0, false }, 1 },
+  { protocol_LayerType_RainbowColor, "Rainbow Color", create_rainbow_color,
+    { LAYER_FIELD(Duration) | LAYER_FIELD(Length), LAYER_FIELD(Duration) | LAYER_FIELD(Length), 0, false }, 4 },
+  { protocol_LayerType_SectionsWaveColor, "Sections Wave Color", create_sections_wave_color, COLORS_SCHEMA, 3 },
+  { protocol_LayerType_SectionsColor, "Sections Color", create_sections_color, COLOR_SEGMENTS_SCHEMA, 3 },
+  { protocol_LayerType_FadeColor, "Fade Color", create_fade_color, COLOR_SEGMENTS_SCHEMA, 4 },
+  { protocol_LayerType_SwitchColor, "Switch Color", create_switch_color, COLOR_SEGMENTS_SCHEMA, 2 },
+
+  // Masks
+  { protocol_LayerType_BlinkMask, "Blink Mask", create_blink_mask, SECTIONS_SCHEMA, 2 },
+  { protocol_LayerType_InvertMask, "Invert Mask", create_invert_mask, { 0, 0, 0, false }, 1 },
+  { protocol_LayerType_PulseSawtoothMask, "Pulse Sawtooth Mask", create_pulse_sawtooth_mask, PULSE_SCHEMA, 2 },
+  { protocol_LayerType_PulseMask, "Pulse Mask", create_pulse_mask, PULSE_SCHEMA, 3 },
+  { protocol_LayerType_SawtoothMask, "Sawtooth Mask", create_sawtooth_mask, WAVE_SCHEMA, 4 },
+  { protocol_LayerType_SectionsWaveMask, "Sections Wave Mask", create_sections_wave_mask, SECTIONS_SCHEMA, 3 },
+  { protocol_LayerType_SectionsMask, "Sections Mask", create_sections_mask, SECTION_SEGMENTS_SCHEMA, 3 },
+  { protocol_LayerType_StarsMask, "Stars Mask", create_stars_mask,
+    { LAYER_FIELD(Frequency) | LAYER_FIELD(Speed) | LAYER_FIELD(Length), 0, LAYER_FIELD(Speed) | LAYER_FIELD(Length), false }, 3 },
+  { protocol_LayerType_WaveMask, "Wave Mask", create_wave_mask, WAVE_SCHEMA, 4 },
+  { protocol_LayerType_SectionsRandomMask, "Sections Random Mask", create_sections_random_mask, SECTION_SEGMENTS_SCHEMA, 3 },
+};
+
+static constexpr size_t slot(protocol_LayerType type) {
+  return type < LAYER_MASK_OFFSET ? type : LAYER_COLOR_COUNT + type - LAYER_MASK_OFFSET;
+}
+
+static constexpr bool is_indexed_by_type(size_t index) {
+  return LAYER_TYPE_COUNT <= index || (slot(LAYERS[index].type) == index && is_indexed_by_type(index + 1));
+}
+
+static_assert(sizeof(LAYERS) / sizeof(LAYERS[0]) == LAYER_TYPE_COUNT, "Every layer type must have a definition");
+static_assert(is_indexed_by_type(0), "Layer definitions must be ordered by type");
+
+/**
+ * @brief Look up the definition of a layer type.
+ *
+ * @param type The protocol type of the layer
+ * @return The definition, or nullptr if the type is unknown
+ */
+const LayerDefinition* LayerRegistry::find(protocol_LayerType type) {
+  if (type < 0 || _protocol_LayerType_MAX < type) return nullptr;
+  if (LAYER_COLOR_COUNT <= type && type < LAYER_MASK_OFFSET) return nullptr;
+  return &LAYERS[slot(type)];
+}
+
+/**
+ * @brief Point to a number of a layer by its field.
+ *
+ * @return The number, or nullptr for colors, sections and unknown fields
+ */
+static uint32_t* field_value(protocol_Layer& layer, u8_t field) {
+  switch (field) {
+    case protocol_LayerField_DurationField: return &layer.duration;
+    case protocol_LayerField_LengthField: return &layer.length;
+    case protocol_LayerField_ColorField: return &layer.color;
+    case protocol_LayerField_GapField: return &layer.gap;
+    case protocol_LayerField_FrequencyField: return &layer.frequency;
+    case protocol_LayerField_SpeedField: return &layer.speed;
+    default: return nullptr;
+  }
+}
+
+/**
+ * @brief Check the decoded parameters against the schema of the layer type, such that a layer
+ * can not be created with values that would crash or overflow it.
+ *
+ * @param definition The definition of the layer type
+ * @param layer The decoded layer
+ * @param colors Number of decoded colors
+ * @param sections Number of decoded sections
+ * @return true if the layer can be created
+ */
+bool LayerRegistry::validate(const LayerDefinition* definition, const protocol_Layer& layer, size_t colors, size_t sections) {
+  const LayerSchema& schema = definition->schema;
+  protocol_Layer values = layer;
+
+  // Fields that do not belong to the layer type are ignored
+  for (u8_t field = protocol_LayerField_DurationField; field <= protocol_LayerField_SpeedField; field++) {
+    u16_t bit = 1 << field;
+    u32_t max = UINT16_MAX;
+    if (schema.narrow & bit) max = UINT8_MAX;
+    if (field == protocol_LayerField_ColorField) max = 0xFFFFFF;
+
+    u32_t value = *field_value(values, field);
+    if (!(schema.fields & bit)) continue;
+    if ((schema.required & bit) && value == 0) return false;
+    if (max < value) return false;
+  }
+
+  size_t elements = 0;
+  if (schema.fields & LAYER_FIELD(Colors)) elements += colors;
+  if (schema.fields & LAYER_FIELD(Sections)) elements += sections;
+  if ((schema.required & (LAYER_FIELD(Colors) | LAYER_FIELD(Sections))) && elements == 0) return false;
+
+  // Every color or section needs at least one tick of the duration
+  if (schema.tickPerElement && layer.duration < elements) return false;
+
+  return true;
+}
+
+/**
+ * @brief Create a layer from its decoded parameters.
+ *
+ * @param layer The decoded layer
+ * @param colors The decoded colors. They are moved into the layer.
+ * @param sections The decoded sections. They are moved into the layer.
+ * @return The new layer, or nullptr if the type is unknown or the parameters are invalid
+ */
+ILayer* LayerRegistry::create(const protocol_Layer& layer, std::vector<CRGB>& colors, std::vector<u8_t>& sections) {
+  int32_t type = enum_value(layer.type);
+  const LayerDefinition* definition = type < _protocol_LayerType_MIN || _protocol_LayerType_MAX < type ? nullptr : find(layer.type);
+  if (definition == nullptr) {
+    debug("Missing layer type %d\n", type);
+    return nullptr;
+  }
+
+  if (!validate(definition, layer, colors.size(), sections.size())) {
+    debug("\033[1;31mInvalid parameters for %s\033[0m\n", definition->name);
+    return nullptr;
+  }
+
+  LayerParameters parameters = { layer, colors, sections };
+  return definition->create(parameters);
+}
+
+/**
+ * @brief Change a parameter of a layer in place, if the layer with the new value still passes the
+ * schema of its type. The same rules apply as when the layer is decoded, see validate.
+ *
+ * @param layer The layer to change
+ * @param field The field to change. It must be one of the fields of the layer type.
+ * @param index Element index, only used for colors and sections. The length appends an element.
+ * @param value The new value of the field
+ * @return true if the layer was patched
+ */
+bool LayerRegistry::patch(ILayer* layer, protocol_LayerField field, u32_t index, u32_t value) {
+  const LayerDefinition* definition = find(layer->getType());
+  if (definition == nullptr || field <= protocol_LayerField_NoField || _protocol_LayerField_MAX < field) return false;
+  if (!(definition->schema.fields & (1 << field))) return false;
+
+  // The layer as it would be encoded after the patch
+  protocol_Layer patched = encode(layer);
+  const std::vector<CRGB>* colors = static_cast<const std::vector<CRGB>*>(patched.colors.arg);
+  const std::vector<u8_t>* sections = static_cast<const std::vector<u8_t>*>(patched.sections.arg);
+  size_t colorCount = colors != nullptr ? colors->size() : 0;
+  size_t sectionCount = sections != nullptr ? sections->size() : 0;
+
+  if (field == protocol_LayerField_ColorsField) {
+    if (colorCount < index || 0xFFFFFF < value) return false;
+    if (index == colorCount && ++colorCount > LAYER_COLORS_MAX) return false;
+  }
+  else if (field == protocol_LayerField_SectionsField) {
+    if (sectionCount < index || UINT8_MAX < value) return false;
+    if (index == sectionCount) sectionCount++;
+  }
+  else {
+    *field_value(patched, field) = value;
+  }
+
+  if (!validate(definition, patched, colorCount, sectionCount)) {
+    debug("\033[1;31mInvalid patch of %s\033[0m\n", definition->name);
+    return false;
+  }
+
+  return layer->patch(field, index, value);
+}
+
+/**
+ * @brief Encode a layer, including its type.
+ * Callbacks are cleared for colors and sections if they are not part of the layer type.
+ *
+ * @param layer The layer to encode
+ * @return protocol_Layer
+ */
+protocol_Layer LayerRegistry::encode(ILayer* layer) {
+  protocol_Layer encoded = layer->toEncodable();
+  encoded.type = layer->getType();
+
+  const LayerDefinition* definition = find(encoded.type);
+  u16_t fields = definition != nullptr ? definition->schema.fields : 0;
+  if (!(fields & LAYER_FIELD(Colors))) encoded.colors.arg = nullptr;
+  if (!(fields & LAYER_FIELD(Sections))) encoded.sections.arg = nullptr;
+
+  return encoded;
+}
+
+/**
+ * @brief Estimate the cost of applying layers to one LED, relative to a SingleColor.
+ *
+ * @param layers The layers of an animation
+ * @return u32_t
+ */
+u32_t LayerRegistry::cost(const std::vector<ILayer*>& layers) {
+  u32_t total = 0;
+  for (ILayer* layer : layers) {
+    const LayerDefinition* definition = find(layer->getType());
+    total += definition != nullptr ? definition->cost : 1;
+  }
+  return total;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include <string.h>
+#include <vector>
+#include "protocol.pb.h"
+#include "layer.h"
+
+// Masks are numbered from 50 in protocol_LayerType, colors from 0
+#define LAYER_MASK_OFFSET 50
+#define LAYER_COLOR_COUNT (protocol_LayerType_SwitchColor + 1)
+#define LAYER_TYPE_COUNT (LAYER_COLOR_COUNT + _protocol_LayerType_MAX - LAYER_MASK_OFFSET + 1)
+
+// Cost of the layers of an animation, see LayerRegistry::cost, that can be rendered within a
+// frame. Heavier animations are rejected by the decoder, as they would stall the main loop.
+#define ANIMATION_COST_MAX 32
+
+// Bit of a protocol_Layer field in a schema. Fields are numbered as in protocol_LayerField.
+#define LAYER_FIELD(field) (1 << protocol_LayerField_##field##Field)
+
+/**
+ * @brief Read a decoded enum field as its number. nanopb stores any decoded varint in an enum field,
+ * and a number outside of the enum must not be read as the enum type.
+ */
+template <typename T>
+inline int32_t enum_value(const T& field) {
+  static_assert(sizeof(T) == sizeof(int32_t), "Enums are stored as int");
+  int32_t value;
+  memcpy(&value, &field, sizeof(value));
+  return value;
+}
+
+/**
+ * @brief The decoded content of a protocol_Layer. Factories may move the colors and sections.
+ */
+struct LayerParameters {
+  const protocol_Layer& layer;
+  std::vector<CRGB>& colors;
+  std::vector<u8_t>& sections;
+};
+
+typedef ILayer* (*LayerFactory)(LayerParameters& parameters);
+
+/**
+ * @brief Describes the parameters of a layer type.
+ *
+ * fields: The fields the layer uses. Only these are encoded and accepted.
+ * required: The fields that must be non-zero, or non-empty for colors and sections.
+ * narrow: The fields stored in a byte. Other numbers are stored in 16 bits, and colors in 24.
+ * tickPerElement: The duration must be at least the number of colors or sections.
+ */
+struct LayerSchema {
+  u16_t fields;
+  u16_t required;
+  u16_t narrow;
+  bool tickPerElement;
+};
+
+/**
+ * @brief Everything needed to decode, validate and encode a layer type.
+ *
+ * cost: Estimated cost of applying the layer to one LED, relative to SingleColor. The layers of an
+ * animation may cost at most ANIMATION_COST_MAX.
+ */
+struct LayerDefinition {
+  protocol_LayerType type;
+  const char* name;
+  LayerFactory create;
+  LayerSchema schema;
+  u8_t cost;
+};
+
+/**
+ * @brief Compile-time table of every layer type, indexed by protocol_LayerType. Adding a layer
+ * means adding its protocol type, its class and a row in the table.
+ */
+class LayerRegistry {
+  public:
+  static const LayerDefinition* find(protocol_LayerType type);
+  static bool validate(const LayerDefinition* definition, const protocol_Layer& layer, size_t colors, size_t sections);
+  static ILayer* create(const protocol_Layer& layer, std::vector<CRGB>& colors, std::vector<u8_t>& sections);
+  static bool patch(ILayer* layer, protocol_LayerField field, u32_t index, u32_t value);
+  static protocol_Layer encode(ILayer* layer);
+  static u32_t cost(const std::vector<ILayer*>& layers);
+};
@@ -1,4 +1,5 @@
 #include "utils.h"
+#include "layer.h"
 #include "math.h"
 #include <sstream>
 #include <iomanip>
@@ -35,4 +36,44 @@ String LayerUtils::bytes_to_string(std::vector<u8_t> bytes) {
   }
   result << "]";
   return String(result.str().c_str());
+}
+
+/**
+ * @brief Replace a color in a list of colors, or append it if index is the length of the list.
+ * The value and the length of the list are checked by LayerRegistry::patch.
+ *
+ * @param colors The colors to patch
+ * @param index Index of the color to replace
+ * @param value The new color as 0xRRGGBB
+ * @return true if the colors were patched
+ */
+bool LayerUtils::patch_colors(std::vector<CRGB>& colors, u32_t index, u32_t value) {
+  if (colors.size() < index) return false;
+  if (index == colors.size()) {
+    colors.push_back(CRGB(value));
+  }
+  else {
+    colors[index] = CRGB(value);
+  }
+  return true;
+}
+
+/**
+ * @brief Replace a byte in a list of bytes, or append it if index is the length of the list.
+ * The value is checked by LayerRegistry::patch.
+ *
+ * @param bytes The bytes to patch
+ * @param index Index of the byte to replace
+ * @param value The new byte
+ * @return true if the bytes were patched
+ */
+bool LayerUtils::patch_bytes(std::vector<u8_t>& bytes, u32_t index, u32_t value) {
+  if (bytes.size() < index) return false;
+  if (index == bytes.size()) {
+    bytes.push_back(value);
+  }
+  else {
+    bytes[index] = value;
+  }
+  return true;
 }
\ No newline at end of file
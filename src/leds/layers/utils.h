@@ -10,4 +10,6 @@ class LayerUtils {
   static String color_to_string(CRGB color);
   static String colors_to_string(std::vector<CRGB> colors);
   static String bytes_to_string(std::vector<u8_t> bytes);
+  static bool patch_colors(std::vector<CRGB>& colors, u32_t index, u32_t value);
+  static bool patch_bytes(std::vector<u8_t>& bytes, u32_t index, u32_t value);
 };
\ No newline at end of file
@@ -0,0 +1,183 @@
+#include "pixel_stream.h"
+#include "debug.h"
+
+static_assert(sizeof(CRGB) == 3, "Raw pixels are copied straight into the LED buffer");
+
+/**
+ * @brief Construct a new Pixel Stream object
+ *
+ * @param animator The animator whose LED buffer is written
+ * @param sequenceScheduler Paused while pixels are streamed
+ */
+PixelStream::PixelStream(Animator* animator, SequenceScheduler* sequenceScheduler) {
+  this->animator = animator;
+  this->sequenceScheduler = sequenceScheduler;
+}
+
+String PixelStream::getName() {
+  return "Pixel Stream";
+}
+
+bool PixelStream::isPixelFrame(const u8_t* data, size_t length) {
+  return 0 < length && data[0] == PIXEL_FRAME_MAGIC;
+}
+
+bool PixelStream::decodeRaw(const u8_t* data, size_t length, CRGB* pixels, size_t count) {
+  if (length % 3 != 0 || count < length / 3) return false;
+
+  memcpy(pixels, data, length);
+  return true;
+}
+
+bool PixelStream::decodeRle(const u8_t* data, size_t length, CRGB* pixels, size_t count) {
+  if (length % 4 != 0) return false;
+
+  // Check the whole frame first, such that a malformed frame leaves the pixels as they are
+  size_t total = 0;
+  for (size_t i = 0; i < length; i += 4) {
+    if (data[i] == 0) return false;
+    total += data[i];
+  }
+  if (count < total) return false;
+
+  size_t position = 0;
+  for (size_t i = 0; i < length; i += 4) {
+    CRGB color(data[i + 1], data[i + 2], data[i + 3]);
+    for (u8_t j = 0; j < data[i]; j++) {
+      pixels[position++] = color;
+    }
+  }
+
+  return true;
+}
+
+bool PixelStream::decodeDelta(const u8_t* data, size_t length, CRGB* pixels, size_t count) {
+  // Check the whole frame first, such that a malformed frame leaves the pixels as they are
+  size_t position = 0;
+  size_t i = 0;
+  while (i < length) {
+    if (length - i < 2) return false;
+
+    size_t skip = data[i];
+    size_t changed = data[i + 1];
+    i += 2;
+    if (count - position < skip + changed || length - i < changed * 3) return false;
+
+    position += skip + changed;
+    i += changed * 3;
+  }
+
+  position = 0;
+  for (i = 0; i < length; ) {
+    size_t changed = data[i + 1];
+    position += data[i];
+    memcpy(pixels + position, data + i + 2, changed * 3);
+    position += changed;
+    i += 2 + changed * 3;
+  }
+
+  return true;
+}
+
+/**
+ * @brief Decode a pixel frame into the LED buffer, and show it if it is flagged to be shown.
+ * Takes over the animator from the sequence on the first frame.
+ *
+ * @param data The pixel frame
+ * @param length Length of the frame
+ * @return false if the frame is malformed, or exceeds the strip
+ */
+bool PixelStream::apply(const u8_t* data, size_t length) {
+  if (length < PIXEL_FRAME_HEADER_SIZE || !isPixelFrame(data, length)) {
+    stats.invalid++;
+    return false;
+  }
+
+  u16_t offset = data[2] | data[3] << 8;
+  u8_t flags = data[4];
+  size_t count = animator->getLength();
+  if (count < offset) {
+    stats.invalid++;
+    return false;
+  }
+
+  const u8_t* pixels = data + PIXEL_FRAME_HEADER_SIZE;
+  size_t size = length - PIXEL_FRAME_HEADER_SIZE;
+  CRGB* leds = animator->getLeds() + offset;
+  bool valid = false;
+  switch (data[1]) {
+    case PIXEL_RAW:
+      valid = decodeRaw(pixels, size, leds, count - offset);
+      break;
+    case PIXEL_RLE:
+      valid = decodeRle(pixels, size, leds, count - offset);
+      break;
+    case PIXEL_DELTA:
+      valid = decodeDelta(pixels, size, leds, count - offset);
+      break;
+  }
+
+  if (!valid) {
+    stats.invalid++;
+    return false;
+  }
+
+  start();
+  if (flags & PIXEL_FRAME_SHOW) show();
+
+  return true;
+}
+
+/**
+ * @brief Count a frame that was written to the LED buffer, and take over the animator from the
+ * sequence if it is the first. Pixels may also be written by other sources, e.g. DMX over UDP.
+ */
+void PixelStream::start() {
+  if (sequenceScheduler->getOwner() != AnimatorOwner::PIXEL_STREAM || !animator->isStreaming()) {
+    sequenceScheduler->pause(AnimatorOwner::PIXEL_STREAM);
+    animator->setStreaming(true);
+    debug("Pixel stream took over the animator\n", 0);
+  }
+
+  stats.frames++;
+  lastFrameAt = millis();
+}
+
+void PixelStream::show() {
+  animator->show();
+  stats.shown++;
+}
+
+/**
+ * @brief Hand the animator back to the sequence, from its first animation, unless another source
+ * has taken it over meanwhile
+ */
+void PixelStream::stop() {
+  if (!animator->isStreaming()) return;
+
+  animator->setStreaming(false);
+  sequenceScheduler->resume(AnimatorOwner::PIXEL_STREAM);
+  debug("Pixel stream stopped\n", 0);
+}
+
+PixelStreamStats PixelStream::getStats() {
+  return stats;
+}
+
+/**
+ * @brief Stop streaming when no frame has arrived for PIXEL_STREAM_TIMEOUT
+ */
+void PixelStream::update() {
+  if (!animator->isStreaming()) return;
+
+  // A new sequence or another source, e.g. live control, has taken the animator
+  if (sequenceScheduler->getOwner() != AnimatorOwner::PIXEL_STREAM) {
+    animator->setStreaming(false);
+    return;
+  }
+
+  if (millis() - lastFrameAt >= PIXEL_STREAM_TIMEOUT) {
+    stats.timeouts++;
+    stop();
+  }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include "animator.h"
+#include "sequence_scheduler.h"
+#include "../scheduler/scheduler.h"
+
+#define PIXEL_FRAME_MAGIC 0xF7 // Wire type 7, like CONTROL_FRAME_MAGIC, so it is never a Message
+#define PIXEL_FRAME_HEADER_SIZE 5
+#define PIXEL_FRAME_SHOW 0x01  // Flag: show the pixels after this frame. Unset for all but the last part of a split frame.
+#define PIXEL_STREAM_TIMEOUT 2000 // ms without frames, after which the sequence is shown again
+
+enum PixelEncoding : u8_t {
+  PIXEL_RAW = 0,   // RGB for every pixel from the offset
+  PIXEL_RLE = 1,   // Runs of count (1) | RGB, with count 1-255
+  PIXEL_DELTA = 2, // Chunks of skip (1) | count (1) | count * RGB. Skipped pixels keep the previous frame.
+};
+
+/**
+ * @brief Counters of a pixel stream.
+ */
+struct PixelStreamStats {
+  u32_t frames;   // Valid frames written to the LEDs
+  u32_t shown;    // Frames shown
+  u32_t invalid;  // Frames dropped as they were malformed or exceeded the strip
+  u32_t timeouts; // Times the stream stopped and the sequence was shown again
+};
+
+/**
+ * @brief Shows raw pixels from a media server instead of the layers of the sequence.
+ *
+ * A pixel frame is sent like any other packet, e.g. over the framed serial protocol, and is
+ * decoded straight from the received packet into the LED buffer of the animator:
+ *
+ * Byte 0: PIXEL_FRAME_MAGIC
+ * Byte 1: PixelEncoding
+ * Byte 2-3: Index of the first pixel, little-endian
+ * Byte 4: Flags, see PIXEL_FRAME_SHOW
+ * Byte 5-: Pixels in the encoding
+ *
+ * Malformed frames, and frames that exceed the strip, are dropped without touching the LEDs.
+ *
+ * The first frame pauses the sequence scheduler, and stops the animator from applying its layers.
+ * The sequence resumes after PIXEL_STREAM_TIMEOUT without frames, or when a new sequence is set.
+ * Another source taking over the animator, e.g. live control, ends the stream without resuming.
+ */
+class PixelStream : public Process {
+  Animator* animator;
+  SequenceScheduler* sequenceScheduler;
+  u32_t lastFrameAt = 0;
+  PixelStreamStats stats = {};
+
+  static bool decodeRaw(const u8_t* data, size_t length, CRGB* pixels, size_t count);
+  static bool decodeRle(const u8_t* data, size_t length, CRGB* pixels, size_t count);
+  static bool decodeDelta(const u8_t* data, size_t length, CRGB* pixels, size_t count);
+
+  public:
+  PixelStream(Animator* animator, SequenceScheduler* sequenceScheduler);
+
+  static bool isPixelFrame(const u8_t* data, size_t length);
+  bool apply(const u8_t* data, size_t length);
+  void start();
+  void show();
+  void stop();
+  PixelStreamStats getStats();
+
+  String getName() override;
+  void update() override;
+};
@@ -1,6 +1,53 @@
 #include <Arduino.h>
 #include <vector>
 #include "sequence_scheduler.h"
+#include "layers/registry.h"
+#include "../diagnostics/telemetry.h"
+
+// Animations and sequences are attributed to the scheduler subsystem in the telemetry
+void* Animation::operator new(size_t size) {
+  Telemetry::allocated(Subsystem::SCHEDULER, size);
+  return ::operator new(size);
+}
+
+void Animation::operator delete(void* ptr, size_t size) {
+  Telemetry::released(Subsystem::SCHEDULER, size);
+  ::operator delete(ptr);
+}
+
+/**
+ * @brief Delete the layers of the animation, which it owns
+ */
+Animation::~Animation() {
+  for (ILayer* layer : layers) {
+    delete layer;
+  }
+}
+
+/**
+ * @brief Delete a sequence together with its animations and their layers.
+ * Use delete for sequences that share their animations, e.g. from SequenceScheduler::getSequence.
+ *
+ * @param sequence The sequence to delete, or nullptr
+ */
+void Sequence::destroy(Sequence* sequence) {
+  if (sequence == nullptr) return;
+
+  for (Animation* animation : sequence->animations) {
+    delete animation;
+  }
+  delete sequence;
+}
+
+void* Sequence::operator new(size_t size) {
+  Telemetry::allocated(Subsystem::SCHEDULER, size);
+  return ::operator new(size);
+}
+
+void Sequence::operator delete(void* ptr, size_t size) {
+  Telemetry::released(Subsystem::SCHEDULER, size);
+  ::operator delete(ptr);
+}
 
 /**
  * @brief Reset the scheduler to the initial state
@@ -55,13 +102,18 @@ void SequenceScheduler::set(std::vector<Animation*> animations) {
 }
 
 /**
- * @brief Set sequence of animations in the scheduler
+ * @brief Set sequence of animations in the scheduler. The scheduler takes ownership of the
+ * sequence, and deletes the previous animations.
  *
  * @param sequence The new sequence of animations
+ * @param hash Hash of the encoded sequence, used to recognise it when it is received again
  */
-void SequenceScheduler::set(Sequence* sequence) {
+void SequenceScheduler::set(Sequence* sequence, u32_t hash) {
   clear();
+  owner = AnimatorOwner::SEQUENCE;
+  this->hash = hash;
   animations = sequence->animations;
+  delete sequence;
   for (Animation* animation : animations) {
     animation->tickDuration = animation->tickDuration == 0 ? ANIMATION_DURATION_MAX : animation->tickDuration; // Set duration to max if not set
   }
@@ -73,9 +125,90 @@ void SequenceScheduler::set(Sequence* sequence) {
  *
  */
 void SequenceScheduler::clear() {
+  animator->clear(); // The animator must not hold on to the layers that are deleted below
+  for (Animation* animation : animations) {
+    delete animation;
+  }
   animations = {};
-  animator->clear();
+  hash = 0;
+  reset();
+}
+
+/**
+ * @brief Stop applying the sequence, so another source can control the animator. The source owns
+ * the animator until it resumes the scheduler, another source takes over, or a new sequence is set.
+ * The sequence keeps its hash, such that the gateway announces it again once it is resumed.
+ *
+ * @param owner The source taking over the animator
+ */
+void SequenceScheduler::pause(AnimatorOwner owner) {
+  this->owner = owner;
+}
+
+/**
+ * @brief Resume the sequence from its first animation, if the source still owns the animator
+ *
+ * @param owner The source handing the animator back
+ * @return true if the sequence was resumed
+ */
+bool SequenceScheduler::resume(AnimatorOwner owner) {
+  if (this->owner != owner) return false;
+
+  this->owner = AnimatorOwner::SEQUENCE;
   reset();
+  return true;
+}
+
+bool SequenceScheduler::isPaused() {
+  return owner != AnimatorOwner::SEQUENCE;
+}
+
+AnimatorOwner SequenceScheduler::getOwner() {
+  return owner;
+}
+
+/**
+ * @brief Get the hash of the current sequence, also while it is paused
+ *
+ * @return u32_t The hash given to set, or 0 if the sequence has been changed since
+ */
+u32_t SequenceScheduler::getHash() {
+  return hash;
+}
+
+u16_t SequenceScheduler::getAnimationIndex() {
+  return currentAnimation;
+}
+
+/**
+ * @brief Get the number of ticks the current animation has been shown
+ */
+u16_t SequenceScheduler::getTick() {
+  return tick;
+}
+
+/**
+ * @brief Jump to a position in the sequence, e.g. to follow another controller showing the same
+ * sequence. The animator continues from the matching tick of the animation.
+ *
+ * @param animation Index of the animation in the sequence
+ * @param tick Ticks the animation has been shown
+ * @return false if the position is not in the sequence
+ */
+bool SequenceScheduler::seek(u16_t animation, u16_t tick) {
+  if (animations.size() <= animation || animations[animation]->tickDuration < tick) return false;
+
+  Animation* next = animations[animation];
+  if (animation != currentAnimation || this->tick == 0) {
+    animator->setLayers(next->layers);
+    animator->setDirection(next->direction);
+    animator->setBrightness(next->brightness);
+  }
+  animator->setTick(next->firstTick + tick * next->direction);
+
+  currentAnimation = animation;
+  this->tick = tick;
+  return true;
 }
 
 /**
@@ -87,13 +220,34 @@ Sequence* SequenceScheduler::getSequence() {
   return new Sequence({ animations });
 }
 
+/**
+ * @brief Change a parameter of a layer in the current sequence. The layer is changed in place,
+ * so a running animation keeps its tick and is not restarted.
+ *
+ * @param animation Index of the animation in the sequence
+ * @param layer Index of the layer in the animation
+ * @param field The field to change
+ * @param index Element index, only used for colors and sections
+ * @param value The new value of the field
+ * @return true if the layer was patched
+ */
+bool SequenceScheduler::patch(u32_t animation, u32_t layer, protocol_LayerField field, u32_t index, u32_t value) {
+  if (animations.size() <= animation) return false;
+  std::vector<ILayer*>& layers = animations[animation]->layers;
+  if (layers.size() <= layer) return false;
+  if (!LayerRegistry::patch(layers[layer], field, index, value)) return false;
+
+  hash = 0; // The sequence no longer matches its encoding
+  return true;
+}
+
 /**
  * @brief A method to update the LED strip with the current animation
  * If the current step has exceeded its duration, the scheduler will move to the next step.
  * It should be called every 20ms
  */
 void SequenceScheduler::update() {
-  if (animations.size() == 0) return;
+  if (isPaused() || animations.size() == 0) return;
 
   // Exceeded current steps duration => move to next step
   if (animations.size() != 1 && animations[currentAnimation]->tickDuration <= tick) {
@@ -13,15 +13,38 @@ struct Animation {
   Direction direction;
   u8_t brightness;
   u16_t firstTick; // Which tick should the animation start on. Default is 0.
+
+  ~Animation();
+
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr, size_t size);
+};
+
+/**
+ * @brief Sources that can take the animator over from the sequence. Only the current owner hands
+ * the animator back, such that a source that stops does not resume the sequence over another.
+ */
+enum class AnimatorOwner : u8_t {
+  SEQUENCE,     // The scheduler applies the sequence
+  LIVE_CONTROL, // Control frames, see LiveControl
+  PIXEL_STREAM, // Raw pixels, see PixelStream
+  DMX_INPUT,    // The physical DMX input, see ReadDMXProcess
 };
 
 struct Sequence {
   std::vector<Animation*> animations;
+
+  static void destroy(Sequence* sequence);
+
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr, size_t size);
 };
 
 class SequenceScheduler : public Process {
   u16_t currentAnimation = 0;
   u16_t tick = 0;
+  AnimatorOwner owner = AnimatorOwner::SEQUENCE;
+  u32_t hash = 0; // Hash of the encoded sequence, or 0 if it was not set from a message or has changed since
   std::vector<Animation*> animations;
   Animator* animator;
 
@@ -36,9 +59,18 @@ class SequenceScheduler : public Process {
   void add(std::vector<ILayer*> layers, u16_t tickDuration, Direction direction = Direction::FORWARD, u8_t brightness = 255, u16_t firstTick = 0);
   void add(Animation* animation);
   void set(std::vector<Animation*> animations);
-  void set(Sequence* sequence);
+  void set(Sequence* sequence, u32_t hash = 0);
+  u32_t getHash();
+  u16_t getAnimationIndex();
+  u16_t getTick();
+  bool seek(u16_t animation, u16_t tick);
   Sequence * getSequence();
+  bool patch(u32_t animation, u32_t layer, protocol_LayerField field, u32_t index, u32_t value);
   void clear();
+  void pause(AnimatorOwner owner);
+  bool resume(AnimatorOwner owner);
+  bool isPaused();
+  AnimatorOwner getOwner();
 
   String getName() override;
   void update() override;
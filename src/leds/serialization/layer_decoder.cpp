@@ -4,13 +4,14 @@
 #include <pb_decode.h>
 #include <vector>
 #include "layer_decoder.h"
-#include "../layers/masks/masks.h"
-#include "../layers/colors/colors.h"
+#include "../layers/registry.h"
 
 /**
  * This function reads a stream of varint-encoded color values and decodes them into
  * CRGB objects, which are then stored in the provided vector. The decoding process
- * continues until there are no more bytes left in the stream.
+ * continues until there are no more bytes left in the stream. The colors are counted
+ * on a copy of the stream first, such that the vector grows in a single, exactly sized
+ * allocation without a scratch buffer on the stack. A layer has at most LAYER_COLORS_MAX colors.
  *
  * @param stream A pointer to the input stream from which color values are read.
  * @param field A pointer to the field iterator (not used in this function).
@@ -20,14 +21,52 @@
 bool LayerDecoder::decode_colors(pb_istream_t* stream, const pb_field_iter_t* field, void** arg) {
   std::vector<CRGB>* colors = static_cast<std::vector<CRGB>*>(*arg);
 
-  while (stream->bytes_left) {
+  // Messages are decoded from memory, so reading a copy of the stream leaves the stream itself in place
+  pb_istream_t counting = *stream;
+  size_t count = 0;
+  while (counting.bytes_left) {
     uint32_t value;
-    if (!pb_decode_varint32(stream, &value)) {
+    if (colors->size() + count == LAYER_COLORS_MAX || !pb_decode_varint32(&counting, &value)) {
       debug("\033[1;31mFailed to decode colors\033[0m\n", 0);
       return false;
     }
+    count++;
+  }
+
+  colors->reserve(colors->size() + count);
+  while (stream->bytes_left) {
+    uint32_t value;
+    if (!pb_decode_varint32(stream, &value)) return false;
     colors->push_back(CRGB(value));
   }
+  return true;
+}
+
+/**
+ * This function reads a stream of 1-byte palette indexes and appends the colors they refer to
+ * to the colors of the layer. Indexes outside the palette fail the decoding.
+ *
+ * @param stream A pointer to the input stream from which the indexes are read.
+ * @param field A pointer to the field iterator (not used in this function).
+ * @param arg A pointer to a PaletteColors with the colors of the layer and the palette of the sequence.
+ * @return true if all indexes are valid; false otherwise.
+ */
+bool LayerDecoder::decode_color_indexes(pb_istream_t* stream, const pb_field_iter_t* field, void** arg) {
+  PaletteColors* target = static_cast<PaletteColors*>(*arg);
+  if (LAYER_COLORS_MAX < target->colors->size() + stream->bytes_left) {
+    debug("\033[1;31mToo many colors\033[0m\n", 0);
+    return false;
+  }
+  target->colors->reserve(target->colors->size() + stream->bytes_left);
+
+  while (stream->bytes_left) {
+    pb_byte_t index = 0;
+    if (!pb_read(stream, &index, 1) || index >= target->palette->size()) {
+      debug("\033[1;31mFailed to decode color index %d\033[0m\n", index);
+      return false;
+    }
+    target->colors->push_back((*target->palette)[index]);
+  }
 
   return true;
 }
@@ -44,14 +83,13 @@ bool LayerDecoder::decode_colors(pb_istream_t* stream, const pb_field_iter_t* fi
  */
 bool LayerDecoder::decode_bytes(pb_istream_t* stream, const pb_field_iter_t* field, void** arg) {
   std::vector<u8_t>* bytes = static_cast<std::vector<u8_t>*>(*arg);
+  size_t offset = bytes->size();
 
-  while (stream->bytes_left) {
-    u8_t value;
-    if (!pb_read(stream, &value, 1)) {
-      debug("\033[1;31mFailed to decode bytes\033[0m\n", 0);
-      return false;
-    }
-    bytes->push_back(value);
+  // Read the whole field in one go, instead of growing the vector byte by byte
+  bytes->resize(offset + stream->bytes_left);
+  if (!pb_read(stream, bytes->data() + offset, bytes->size() - offset)) {
+    debug("\033[1;31mFailed to decode bytes\033[0m\n", 0);
+    return false;
   }
 
   return true;
@@ -61,25 +99,28 @@ bool LayerDecoder::decode_bytes(pb_istream_t* stream, const pb_field_iter_t* fie
  * This function decodes a stream of varint-encoded layer data into a vector of ILayer objects.
  * The decoding process involves reading the stream, determining the type of layer being decoded,
  * and then decoding the appropriate data fields into the corresponding layer type.
- * Set args to a new std::vector<ILayer*>() to store the decoded layers.
+ * Set args to a LayersDecoding, which points to the vector where the decoded layers will be stored.
  *
  * @param stream A pointer to the input stream from which layer data is read.
  * @param field A pointer to the field iterator (not used in this function).
- * @param arg A pointer to a vector of ILayer pointers where the decoded layers will be stored.
+ * @param arg A pointer to a LayersDecoding with the layers and the palette of the sequence.
  * @return true if the layer is successfully decoded and stored; false if an error occurs during decoding.
  */
 bool LayerDecoder::decode_layer(pb_istream_t* stream, const pb_field_iter_t* field, void** arg) {
-  std::vector<ILayer*>* layers = static_cast<std::vector<ILayer*>*>(*arg);
+  LayersDecoding* decoding = static_cast<LayersDecoding*>(*arg);
+  std::vector<ILayer*>* layers = decoding->layers;
   protocol_Layer incomingLayer = protocol_Layer_init_zero; // Empty layer to store incoming data in.
-  ILayer* layer; // Empty pointer to store layer in.
 
   std::vector<CRGB> colors;
   std::vector<u8_t> bytes;
+  PaletteColors paletteColors = { &colors, decoding->palette };
 
   incomingLayer.sections.funcs.decode = LayerDecoder::decode_bytes;
   incomingLayer.sections.arg = &bytes;
   incomingLayer.colors.funcs.decode = LayerDecoder::decode_colors;
   incomingLayer.colors.arg = &colors;
+  incomingLayer.color_indexes.funcs.decode = LayerDecoder::decode_color_indexes;
+  incomingLayer.color_indexes.arg = &paletteColors;
 
   // Perform the decoding of the incomingLayer
   if (!pb_decode(stream, protocol_Layer_fields, &incomingLayer)) {
@@ -87,57 +128,10 @@ bool LayerDecoder::decode_layer(pb_istream_t* stream, const pb_field_iter_t* fie
     return false;  // Return empty sequence if decoding fails
   }
 
-  // Large switch statement to determine which layer type is being decoded
-  switch (incomingLayer.type) {
-    case protocol_LayerType_FadeColor:
-      layer = new FadeColor(colors, incomingLayer.duration);
-      break;
-    case protocol_LayerType_RainbowColor:
-      layer = new RainbowColor(incomingLayer.duration, incomingLayer.length);
-      break;
-    case protocol_LayerType_SectionsWaveColor:
-      layer = new SectionsWaveColor(colors, incomingLayer.duration);
-      break;
-    case protocol_LayerType_SectionsColor:
-      layer = new SectionsColor(colors, incomingLayer.duration);
-      break;
-    case protocol_LayerType_SingleColor:
-      layer = new SingleColor(CRGB(incomingLayer.color));
-      break;
-    case protocol_LayerType_SwitchColor:
-      layer = new SwitchColor(colors, incomingLayer.duration);
-      break;
-    
-    case protocol_LayerType_BlinkMask:
-      layer = new BlinkMask(bytes, incomingLayer.duration);
-      break;
-    case protocol_LayerType_InvertMask:
-      layer = new InvertMask();
-      break;
-    case protocol_LayerType_PulseSawtoothMask:
-      layer = new PulseSawtoothMask(incomingLayer.gap, incomingLayer.duration);
-      break;
-    case protocol_LayerType_PulseMask:
-      layer = new PulseMask(incomingLayer.gap, incomingLayer.duration);
-      break;
-    case protocol_LayerType_SawtoothMask:
-      layer = new SawtoothMask(incomingLayer.length, incomingLayer.gap, incomingLayer.duration);
-      break;
-    case protocol_LayerType_SectionsWaveMask:
-      layer = new SectionsWaveMask(bytes, incomingLayer.duration);
-      break;
-    case protocol_LayerType_SectionsMask:
-      layer = new SectionsMask(bytes, incomingLayer.duration);
-      break;
-    case protocol_LayerType_StarsMask:
-      layer = new StarsMask(incomingLayer.frequency, incomingLayer.speed, incomingLayer.length);
-      break;
-    case protocol_LayerType_WaveMask:
-      layer = new WaveMask(incomingLayer.length, incomingLayer.gap, incomingLayer.duration);
-      break;
-    default:
-      debug("Missing layer type %d", incomingLayer.type);
-      return false;
+  // Look up the layer type, and create the layer if the parameters are valid
+  ILayer* layer = LayerRegistry::create(incomingLayer, colors, bytes);
+  if (layer == nullptr) {
+    return false;
   }
 
   // Push the decoded layer into the layers vector
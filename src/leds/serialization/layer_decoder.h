@@ -6,12 +6,30 @@
 #include <pb_decode.h>
 #include <vector>
 
+/**
+ * @brief Argument of the layer callback: where the layers are stored, and the palette of their sequence.
+ */
+struct LayersDecoding {
+  std::vector<ILayer*>* layers;
+  const std::vector<CRGB>* palette;
+};
+
+/**
+ * @brief Argument of the color_indexes callback.
+ */
+struct PaletteColors {
+  std::vector<CRGB>* colors;
+  const std::vector<CRGB>* palette;
+};
+
 class LayerDecoder {
   private:
   /**
    * This function reads a stream of varint-encoded color values and decodes them into
    * CRGB objects, which are then stored in the provided vector. The decoding process
-   * continues until there are no more bytes left in the stream.
+   * continues until there are no more bytes left in the stream. The colors are counted
+   * on a copy of the stream first, such that the vector grows in a single, exactly sized
+   * allocation without a scratch buffer on the stack. A layer has at most LAYER_COLORS_MAX colors.
    *
    * @param stream A pointer to the input stream from which color values are read.
    * @param field A pointer to the field iterator (not used in this function).
@@ -20,6 +38,17 @@ class LayerDecoder {
    */
   static bool decode_colors(pb_istream_t* stream, const pb_field_iter_t* field, void** arg);
 
+  /**
+   * This function reads a stream of 1-byte palette indexes and appends the colors they refer to
+   * to the colors of the layer. Indexes outside the palette fail the decoding.
+   *
+   * @param stream A pointer to the input stream from which the indexes are read.
+   * @param field A pointer to the field iterator (not used in this function).
+   * @param arg A pointer to a PaletteColors with the colors of the layer and the palette of the sequence.
+   * @return true if all indexes are valid; false otherwise.
+   */
+  static bool decode_color_indexes(pb_istream_t* stream, const pb_field_iter_t* field, void** arg);
+
   /**
    * This function reads a stream of varint-encoded byte values and decodes them into
    * a vector of bytes. The decoding process continues until there are no more bytes
@@ -37,11 +66,11 @@ class LayerDecoder {
    * This function decodes a stream of varint-encoded layer data into a vector of ILayer objects.
    * The decoding process involves reading the stream, determining the type of layer being decoded,
    * and then decoding the appropriate data fields into the corresponding layer type.
-   * Set args to a new std::vector<ILayer*>() to store the decoded layers.
+   * Set args to a LayersDecoding, which points to the vector where the decoded layers will be stored.
    *
    * @param stream A pointer to the input stream from which layer data is read.
    * @param field A pointer to the field iterator (not used in this function).
-   * @param arg A pointer to a vector of ILayer pointers where the decoded layers will be stored.
+   * @param arg A pointer to a LayersDecoding with the layers and the palette of the sequence.
    * @return true if the layer is successfully decoded and stored; false if an error occurs during decoding.
    */
   static bool decode_layer(pb_istream_t* stream, const pb_field_iter_t* field, void** arg);
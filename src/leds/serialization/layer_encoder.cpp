@@ -1,33 +1,65 @@
 #include "layer_encoder.h"
 #include "../layers/layer.h"
 #include <vector>
-#include "../layers/masks/masks.h"
-#include "../layers/colors/colors.h"
-
-
-u8_t calculate_encoding_size(u32_t value) {
-    u8_t size = 0;
-    do {
-        value >>= 7;
+#include "../layers/registry.h"
+#include "palette.h"
+
+// The encoder never allocates. Submessage sizes are computed arithmetically up front, such that
+// every layer is written once, instead of once per nesting level by pb_encode_submessage.
+
+/**
+ * @brief Number of bytes used to encode a value as a varint
+ */
+size_t LayerEncoder::varint_size(u32_t value) {
+    size_t size = 1;
+    while (value >>= 7) {
         size++;
-    } while (value > 0);
+    }
 
     return size;
 }
 
-bool pb_encode_size(pb_ostream_t *stream, u32_t* values, size_t values_size) {
+/**
+ * @brief Size of the packed colors, excluding tag and length.
+ */
+static size_t packed_colors_size(const std::vector<CRGB> *colors) {
     size_t size = 0;
-
-    for (size_t i = 0; i < values_size; i++)
+    for (const CRGB& color : *colors)
     {
-        size += calculate_encoding_size(values[i]);
+        size += LayerEncoder::varint_size(Palette::toInt(color));
     }
 
-    // Encode the length of the packed data
+    return size;
+}
+
+/**
+ * @brief Size of a length-delimited field with a single byte tag
+ */
+size_t LayerEncoder::delimited_size(size_t size) {
+    return 1 + LayerEncoder::varint_size(size) + size;
+}
+
+/**
+ * @brief Write a submessage whose size is already known, without the sizing pass of pb_encode_submessage.
+ * The tag must already be written.
+ *
+ * @param size The encoded size of the submessage
+ * @return false if encoding fails, or the submessage does not match the size
+ */
+bool LayerEncoder::encode_submessage(pb_ostream_t *stream, const pb_msgdesc_t *fields, const void *src_struct, size_t size) {
     if (!pb_encode_varint(stream, size)) {
         return false;
     }
 
+    size_t start = stream->bytes_written;
+    if (!pb_encode(stream, fields, src_struct)) {
+        return false;
+    }
+
+    if (stream->bytes_written - start != size) {
+        PB_RETURN_ERROR(stream, "submessage size changed");
+    }
+
     return true;
 }
 
@@ -35,32 +67,36 @@ bool LayerEncoder::colors_callback(pb_ostream_t *stream, const pb_field_iter_t *
 {
     if (!*arg) return true; // Nothing to encode
 
-    std::vector<CRGB>* colors = static_cast<std::vector<CRGB>*>(*arg);
-    u32_t* colors_int = new u32_t[colors->size()];
+    const std::vector<CRGB>* colors = static_cast<const std::vector<CRGB>*>(*arg);
 
-    for (int i = 0; i < colors->size(); i++)
-    {
-        CRGB color = colors->at(i);
-        colors_int[i] = color.r << 16 | color.g << 8 | color.b;
+    if (!pb_encode_tag(stream, PB_WT_STRING, field->tag) ||
+        !pb_encode_varint(stream, packed_colors_size(colors))) {
+        return false;
     }
 
-    if (!pb_encode_tag(stream, PB_WT_STRING, field->tag)) {
-        return false;
+    for (const CRGB& color : *colors)
+    {
+        if (!pb_encode_varint(stream, Palette::toInt(color))) return false;
     }
 
-    if (!pb_encode_size(stream, colors_int, colors->size())) {
+    return true;
+}
+
+bool LayerEncoder::color_indexes_callback(pb_ostream_t *stream, const pb_field_iter_t *field, void * const *arg)
+{
+    if (!*arg) return true; // Nothing to encode
+
+    const IndexedColors* indexed = static_cast<const IndexedColors*>(*arg);
+
+    if (!pb_encode_tag(stream, PB_WT_STRING, field->tag) ||
+        !pb_encode_varint(stream, indexed->colors->size())) {
         return false;
     }
-    
 
-    for (size_t i = 0; i < colors->size(); i++)
+    for (const CRGB& color : *indexed->colors)
     {
-
-        if (!pb_encode_varint(stream, colors_int[i]))
-        {
-            printf("Encoding failed\n");
-            return false;
-        }
+        pb_byte_t index = indexed->palette->indexOf(Palette::toInt(color));
+        if (!pb_write(stream, &index, 1)) return false;
     }
 
     return true;
@@ -70,20 +106,88 @@ bool LayerEncoder::sections_callback(pb_ostream_t *stream, const pb_field_iter_t
 {
     if (!*arg) return true; // Nothing to encode
 
-    std::vector<u8_t>* bytes = static_cast<std::vector<u8_t>*>(*arg);
+    const std::vector<u8_t>* bytes = static_cast<const std::vector<u8_t>*>(*arg);
 
     if (!pb_encode_tag(stream, PB_WT_STRING, field->tag) ||
         !pb_encode_varint(stream, bytes->size())) {
         return false;
     }
-    
-    for (u8_t byte : *bytes)
+
+    if (!pb_write(stream, bytes->data(), bytes->size())) return false;
+
+    return true;
+}
+
+/**
+ * @brief Move the colors of a layer to color_indexes, if they are all in the palette
+ *
+ * @param layer The layer, as returned by LayerRegistry::encode
+ * @param indexed Storage for the color_indexes argument, which must outlive the encoding of the layer
+ * @param palette The palette of the sequence, or nullptr
+ */
+void LayerEncoder::index_colors(protocol_Layer *layer, IndexedColors *indexed, const Palette *palette) {
+    const std::vector<CRGB>* colors = static_cast<const std::vector<CRGB>*>(layer->colors.arg);
+    if (colors == nullptr || palette == nullptr || !palette->contains(*colors)) return;
+
+    indexed->colors = colors;
+    indexed->palette = palette;
+    layer->colors.arg = nullptr;
+    layer->color_indexes.arg = indexed;
+}
+
+/**
+ * @brief Encoded size of a layer. The numbers are sized by nanopb, and the colors and sections are counted directly.
+ *
+ * @param layer The layer, as returned by LayerRegistry::encode and index_colors
+ * @param size Set to the encoded size
+ */
+bool LayerEncoder::layer_size(const protocol_Layer *layer, size_t *size) {
+    protocol_Layer numbers = *layer;
+    numbers.colors.funcs.encode = nullptr;
+    numbers.sections.funcs.encode = nullptr;
+    numbers.color_indexes.funcs.encode = nullptr;
+
+    if (!pb_get_encoded_size(size, protocol_Layer_fields, &numbers)) {
+        return false;
+    }
+
+    if (layer->colors.arg) {
+        *size += delimited_size(packed_colors_size(static_cast<const std::vector<CRGB>*>(layer->colors.arg)));
+    }
+
+    if (layer->sections.arg) {
+        *size += delimited_size(static_cast<const std::vector<u8_t>*>(layer->sections.arg)->size());
+    }
+
+    if (layer->color_indexes.arg) {
+        *size += delimited_size(static_cast<const IndexedColors*>(layer->color_indexes.arg)->colors->size());
+    }
+
+    return true;
+}
+
+/**
+ * @brief Encoded size of the layers field of an animation, including tags and lengths.
+ *
+ * @param layers The layers of the animation
+ * @param palette The palette of the sequence, or nullptr
+ * @param size Set to the encoded size
+ */
+bool LayerEncoder::layers_size(const std::vector<ILayer*> *layers, const Palette *palette, size_t *size) {
+    *size = 0;
+
+    for (ILayer* layer : *layers)
     {
-        if (!pb_write(stream, &byte, 1))
-        {
-            printf("Encoding failed\n");
+        protocol_Layer encoded_layer = LayerRegistry::encode(layer);
+        IndexedColors indexed;
+        index_colors(&encoded_layer, &indexed, palette);
+
+        size_t layer_bytes;
+        if (!layer_size(&encoded_layer, &layer_bytes)) {
             return false;
         }
+
+        *size += delimited_size(layer_bytes);
     }
 
     return true;
@@ -91,24 +195,29 @@ bool LayerEncoder::sections_callback(pb_ostream_t *stream, const pb_field_iter_t
 
 bool LayerEncoder::layer_callback(pb_ostream_t *stream, const pb_field_iter_t *field, void * const *arg)
 {
-    std::vector<ILayer*>* layers = static_cast<std::vector<ILayer*>*>(*arg);
+    const LayersEncoding* encoding = static_cast<const LayersEncoding*>(*arg);
 
-    for (ILayer* layer : *layers)
+    for (ILayer* layer : *encoding->layers)
     {
-        protocol_Layer encoded_layer = layer->toEncodable();
+        protocol_Layer encoded_layer = LayerRegistry::encode(layer);
+        IndexedColors indexed;
+        index_colors(&encoded_layer, &indexed, encoding->palette);
+
+        size_t size;
+        if (!layer_size(&encoded_layer, &size)) {
+            return false;
+        }
+
         encoded_layer.colors.funcs.encode = colors_callback;
         encoded_layer.sections.funcs.encode = sections_callback;
+        encoded_layer.color_indexes.funcs.encode = color_indexes_callback;
 
         if (!pb_encode_tag(stream, PB_WT_STRING, field->tag)) {
             return false;
         }
 
-        if (!pb_encode_submessage(stream, protocol_Layer_fields, &encoded_layer))
-        {
-            printf("Encoding failed\n");
-            return false;
-        }
+        if (!encode_submessage(stream, protocol_Layer_fields, &encoded_layer, size)) return false;
     }
 
     return true;
-}
\ No newline at end of file
+}
@@ -2,13 +2,41 @@
 #define ENCODER_H
 
 #include <pb_encode.h>
+#include <vector>
+#include "protocol.pb.h"
+#include "../layers/layer.h"
+
+class Palette;
+
+/**
+ * @brief Argument of the layer callback: the layers of an animation and the palette of their sequence
+ */
+struct LayersEncoding {
+    const std::vector<ILayer*>* layers;
+    const Palette* palette; // nullptr to encode every color directly
+};
+
+/**
+ * @brief Argument of the color_indexes callback
+ */
+struct IndexedColors {
+    const std::vector<CRGB>* colors;
+    const Palette* palette;
+};
 
 class LayerEncoder {
 private:
     static bool colors_callback(pb_ostream_t *stream, const pb_field_iter_t *field, void * const *arg);
+    static bool color_indexes_callback(pb_ostream_t *stream, const pb_field_iter_t *field, void * const *arg);
     static bool sections_callback(pb_ostream_t *stream, const pb_field_iter_t *field, void * const *arg);
+    static void index_colors(protocol_Layer *layer, IndexedColors *indexed, const Palette *palette);
+    static bool layer_size(const protocol_Layer *layer, size_t *size);
 
 public:
+    static size_t varint_size(u32_t value);
+    static size_t delimited_size(size_t size);
+    static bool layers_size(const std::vector<ILayer*> *layers, const Palette *palette, size_t *size);
+    static bool encode_submessage(pb_ostream_t *stream, const pb_msgdesc_t *fields, const void *src_struct, size_t size);
     static bool layer_callback(pb_ostream_t *stream, const pb_field_iter_t *field, void * const *arg);
 };
 
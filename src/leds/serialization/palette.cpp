@@ -0,0 +1,128 @@
+#include "palette.h"
+#include "layer_encoder.h"
+#include "../layers/registry.h"
+
+u32_t Palette::toInt(const CRGB& color) {
+    return (u32_t)color.r << 16 | color.g << 8 | color.b;
+}
+
+/**
+ * @brief Add the colors of a layer, unless they do not all fit in the palette
+ *
+ * @return true if every color is now in the palette
+ */
+bool Palette::add(const std::vector<CRGB>& colors) {
+    u8_t added = 0;
+    for (const CRGB& color : colors)
+    {
+        u32_t value = toInt(color);
+        if (indexOf(value) >= 0) continue;
+
+        if (count == PALETTE_MAX_SIZE) {
+            count -= added; // Roll back, such that the palette only holds colors of indexed layers
+            return false;
+        }
+
+        this->colors[count++] = value;
+        added++;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Bytes saved by indexing the layers, minus the bytes of the palette itself
+ */
+size_t Palette::savings(const std::vector<Animation*>& animations) const {
+    size_t saved = 0;
+    for (Animation* animation : animations)
+    {
+        for (ILayer* layer : animation->layers)
+        {
+            protocol_Layer encoded_layer = LayerRegistry::encode(layer);
+            const std::vector<CRGB>* layer_colors = static_cast<const std::vector<CRGB>*>(encoded_layer.colors.arg);
+            if (layer_colors == nullptr || !contains(*layer_colors)) continue;
+
+            for (const CRGB& color : *layer_colors)
+            {
+                saved += LayerEncoder::varint_size(toInt(color)) - 1;
+            }
+        }
+    }
+
+    size_t palette_bytes = 0;
+    for (u8_t i = 0; i < count; i++)
+    {
+        palette_bytes += LayerEncoder::varint_size(colors[i]);
+    }
+
+    size_t cost = LayerEncoder::delimited_size(palette_bytes);
+    return saved > cost ? saved - cost : 0;
+}
+
+/**
+ * @brief Collect the colors of every layer in the animations. The palette is left empty if
+ * it would not make the encoded sequence smaller, e.g. when no color is used twice.
+ *
+ * @param animations The animations that are about to be encoded
+ */
+void Palette::build(const std::vector<Animation*>& animations) {
+    clear();
+
+    for (Animation* animation : animations)
+    {
+        for (ILayer* layer : animation->layers)
+        {
+            protocol_Layer encoded_layer = LayerRegistry::encode(layer);
+            const std::vector<CRGB>* layer_colors = static_cast<const std::vector<CRGB>*>(encoded_layer.colors.arg);
+            if (layer_colors != nullptr) {
+                add(*layer_colors);
+            }
+        }
+    }
+
+    if (savings(animations) == 0) {
+        clear();
+    }
+}
+
+void Palette::clear() {
+    count = 0;
+}
+
+/**
+ * @brief Find a color in the palette
+ *
+ * @param color The color as 0xRRGGBB
+ * @return int The index of the color, or -1 if it is not in the palette
+ */
+int Palette::indexOf(u32_t color) const {
+    for (u8_t i = 0; i < count; i++)
+    {
+        if (colors[i] == color) return i;
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Whether a layer can be encoded with indexes, i.e. all of its colors are in the palette
+ */
+bool Palette::contains(const std::vector<CRGB>& colors) const {
+    if (count == 0 || colors.empty()) return false;
+
+    for (const CRGB& color : colors)
+    {
+        if (indexOf(toInt(color)) < 0) return false;
+    }
+
+    return true;
+}
+
+size_t Palette::size() const {
+    return count;
+}
+
+u32_t Palette::operator[](size_t index) const {
+    return colors[index];
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FastLED.h>
+#include <vector>
+#include "../sequence_scheduler.h"
+
+// Indexes are encoded as single bytes, but the table is kept small, as it lives on the stack while encoding
+#define PALETTE_MAX_SIZE 64
+
+/**
+ * @brief Colors shared by the layers of a sequence. Most shows reuse a handful of colors across
+ * their animations, so layers refer to the palette with a 1-byte index instead of a 3-4 byte varint.
+ *
+ * A layer is only indexed when all of its colors are in the palette. Layers with colors that did
+ * not fit are encoded with their colors, as before.
+ */
+class Palette {
+    u32_t colors[PALETTE_MAX_SIZE];
+    u8_t count = 0;
+
+    bool add(const std::vector<CRGB>& colors);
+    size_t savings(const std::vector<Animation*>& animations) const;
+
+public:
+    static u32_t toInt(const CRGB& color);
+
+    void build(const std::vector<Animation*>& animations);
+    void clear();
+    int indexOf(u32_t color) const;
+    bool contains(const std::vector<CRGB>& colors) const;
+    size_t size() const;
+    u32_t operator[](size_t index) const;
+};
@@ -6,8 +6,54 @@
 #include <vector>
 #include "debug.h"
 #include "layer_decoder.h"
+#include "../layers/registry.h"
+#include "../../diagnostics/telemetry.h"
 #include "sequence_decoder.h"
 
+/**
+ * @brief Decodes the palette of a sequence into SequenceDecoding::palette.
+ *
+ * The palette must precede the animations in the encoded sequence, such that it is complete
+ * before the layers refer to it. A palette after the first animation fails the decoding.
+ *
+ * @param stream The input stream holding the packed colors.
+ * @param field The field iterator pointing to the current field being decoded.
+ * @param arg A pointer to the argument passed to the callback, which is expected to be a SequenceDecoding.
+ * @return true if the palette is successfully decoded, false otherwise.
+ */
+bool SequenceDecoder::decode_palette(pb_istream_t* stream, const pb_field_iter_t* field, void** arg) {
+  SequenceDecoding* decoding = static_cast<SequenceDecoding*>(*arg);
+
+  if (!decoding->sequence->animations.empty()) {
+    debug("\033[1;31mPalette after the animations\033[0m\n", 0);
+    return false;
+  }
+
+  // Count the colors on a copy of the stream, such that the palette is allocated once
+  pb_istream_t counting = *stream;
+  size_t count = 0;
+  while (counting.bytes_left) {
+    uint32_t value;
+    if (!pb_decode_varint32(&counting, &value)) {
+      debug("\033[1;31mFailed to decode palette\033[0m\n", 0);
+      return false;
+    }
+    count++;
+  }
+
+  size_t capacity = decoding->palette.capacity();
+  decoding->palette.reserve(decoding->palette.size() + count);
+  Telemetry::reallocated(Subsystem::DECODER, capacity * sizeof(CRGB), decoding->palette.capacity() * sizeof(CRGB));
+
+  while (stream->bytes_left) {
+    uint32_t value;
+    if (!pb_decode_varint32(stream, &value)) return false;
+    decoding->palette.push_back(CRGB(value));
+  }
+
+  return true;
+}
+
 /**
  * @brief Decodes an animation from the provided protobuf stream.
  *
@@ -17,18 +63,19 @@
  *
  * @param stream The input stream from which the animation data is read.
  * @param field The field iterator pointing to the current field being decoded.
- * @param arg A pointer to the argument passed to the callback, which is expected to be a Sequence object.
- * @return true if the animation is successfully decoded, false otherwise.
+ * @param arg A pointer to the argument passed to the callback, which is expected to be a SequenceDecoding.
+ * @return true if the animation is successfully decoded, false otherwise, also if its layers
+ * exceed ANIMATION_COST_MAX.
  */
 bool SequenceDecoder::decode_animation(pb_istream_t* stream, const pb_field_iter_t* field, void** arg) {
   _protocol_Animation incomingAnimation = protocol_Animation_init_zero;
   Animation* animation = new Animation();
-  Sequence* sequence = static_cast<Sequence*>(*arg);
-  sequence->animations.push_back(animation);
+  SequenceDecoding* decoding = static_cast<SequenceDecoding*>(*arg);
+  decoding->sequence->animations.push_back(animation); // Owned by the sequence, also if decoding fails below
 
-  std::vector<ILayer*>* layers = new std::vector<ILayer*>();
+  LayersDecoding layers = { &animation->layers, &decoding->palette };
   incomingAnimation.layers.funcs.decode = LayerDecoder::decode_layer;
-  incomingAnimation.layers.arg = &animation->layers;
+  incomingAnimation.layers.arg = &layers;
 
   // Decode the incomingAnimation from the stream
   if (!pb_decode(stream, protocol_Animation_fields, &incomingAnimation)) {
@@ -36,7 +83,13 @@ bool SequenceDecoder::decode_animation(pb_istream_t* stream, const pb_field_iter
     return false;  // Return false if decoding fails
   }
 
-  animation->direction = incomingAnimation.direction == protocol_Direction_FORWARD ? Direction::FORWARD : Direction::BACKWARD;
+  u32_t cost = LayerRegistry::cost(animation->layers);
+  if (ANIMATION_COST_MAX < cost) {
+    debug("\033[1;31mAnimation of cost %d exceeds the frame budget\033[0m\n", (int)cost);
+    return false;
+  }
+
+  animation->direction = enum_value(incomingAnimation.direction) == protocol_Direction_FORWARD ? Direction::FORWARD : Direction::BACKWARD;
   animation->tickDuration = incomingAnimation.duration;
   animation->firstTick = incomingAnimation.first_tick;
   animation->brightness = incomingAnimation.brightness;
@@ -44,6 +97,31 @@ bool SequenceDecoder::decode_animation(pb_istream_t* stream, const pb_field_iter
   return true;  // Return true if decoding is successful
 }
 
+/**
+ * @brief Sets the callbacks of a protocol_Sequence, such that it is decoded into a Sequence.
+ *
+ * @param incoming The protocol_Sequence that is about to be decoded, e.g. a field of a message.
+ * @param decoding Holds the Sequence that will be populated with the decoded data. It must
+ * outlive the decoding, and be finished afterwards.
+ */
+void SequenceDecoder::prepare(protocol_Sequence* incoming, SequenceDecoding* decoding) {
+  incoming->palette.funcs.decode = SequenceDecoder::decode_palette;
+  incoming->palette.arg = decoding;
+  incoming->animations.funcs.decode = SequenceDecoder::decode_animation;
+  incoming->animations.arg = decoding;
+}
+
+/**
+ * @brief Release the palette once the sequence has been decoded. The sequence is not affected.
+ *
+ * @param decoding The state of a decoding that has ended, successfully or not.
+ */
+void SequenceDecoder::finish(SequenceDecoding* decoding) {
+  Telemetry::reallocated(Subsystem::DECODER, decoding->palette.capacity() * sizeof(CRGB), 0);
+  std::vector<CRGB>().swap(decoding->palette);
+  decoding->sequence = nullptr;
+}
+
 /**
  * @brief Decodes a sequence from the provided protobuf stream.
  *
@@ -53,19 +131,20 @@ bool SequenceDecoder::decode_animation(pb_istream_t* stream, const pb_field_iter
  *
  * @param stream The input stream from which the sequence data is read.
  * @param sequence A pointer to the Sequence object that will be populated with the decoded data.
- * @return true if the sequence is successfully decoded, false otherwise.
+ * @return true if the sequence is successfully decoded, false otherwise. The sequence then holds
+ * what was decoded before the error, so release it with Sequence::destroy.
  */
 bool SequenceDecoder::decode(pb_istream_t* stream, Sequence* sequence) {
   protocol_Sequence incomingSequence = protocol_Sequence_init_zero;
+  SequenceDecoding decoding = { sequence, {} };
 
-  incomingSequence.animations.funcs.decode = SequenceDecoder::decode_animation;
-  incomingSequence.animations.arg = sequence;
+  prepare(&incomingSequence, &decoding);
 
+  bool success = pb_decode(stream, protocol_Sequence_fields, &incomingSequence);
+  finish(&decoding);
 
-  if (!pb_decode(stream, protocol_Sequence_fields, &incomingSequence)) {
+  if (!success) {
     debug("\033[1;31mFailed to decode sequence\033[0m\n", 0);
-    return false;  // Return empty sequence if decoding fails
   }
-
-  return true;
+  return success;
 }
\ No newline at end of file
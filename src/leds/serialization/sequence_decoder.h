@@ -1,12 +1,36 @@
 #pragma once
 
 #include "../sequence_scheduler.h"
+#include "protocol.pb.h"
 #include <pb_decode.h>
 #include <vector>
 
+/**
+ * @brief State of the callbacks while a sequence is decoded. The palette is only needed until the
+ * layers have resolved their color indexes, so it is held here rather than by the sequence, and
+ * released by SequenceDecoder::finish.
+ */
+struct SequenceDecoding {
+  Sequence* sequence;
+  std::vector<CRGB> palette;
+};
+
 class SequenceDecoder {
   public:
 
+  /**
+   * @brief Decodes the palette of a sequence into SequenceDecoding::palette.
+   *
+   * The palette must precede the animations in the encoded sequence, such that it is complete
+   * before the layers refer to it. A palette after the first animation fails the decoding.
+   *
+   * @param stream The input stream holding the packed colors.
+   * @param field The field iterator pointing to the current field being decoded.
+   * @param arg A pointer to the argument passed to the callback, which is expected to be a SequenceDecoding.
+   * @return true if the palette is successfully decoded, false otherwise.
+   */
+  static bool decode_palette(pb_istream_t* stream, const pb_field_iter_t* field, void** arg);
+
   /**
  * @brief Decodes an animation from the provided protobuf stream.
  *
@@ -16,11 +40,27 @@ class SequenceDecoder {
  *
  * @param stream The input stream from which the animation data is read.
  * @param field The field iterator pointing to the current field being decoded.
- * @param arg A pointer to the argument passed to the callback, which is expected to be a Sequence object.
+ * @param arg A pointer to the argument passed to the callback, which is expected to be a SequenceDecoding.
  * @return true if the animation is successfully decoded, false otherwise.
  */
   static bool decode_animation(pb_istream_t* stream, const pb_field_iter_t* field, void** arg);
 
+  /**
+   * @brief Sets the callbacks of a protocol_Sequence, such that it is decoded into a Sequence.
+   *
+   * @param incoming The protocol_Sequence that is about to be decoded, e.g. a field of a message.
+   * @param decoding Holds the Sequence that will be populated with the decoded data. It must
+   * outlive the decoding, and be finished afterwards.
+   */
+  static void prepare(protocol_Sequence* incoming, SequenceDecoding* decoding);
+
+  /**
+   * @brief Release the palette once the sequence has been decoded. The sequence is not affected.
+   *
+   * @param decoding The state of a decoding that has ended, successfully or not.
+   */
+  static void finish(SequenceDecoding* decoding);
+
   /**
    * @brief Decodes a sequence from the provided protobuf stream.
    *
@@ -30,7 +70,8 @@ class SequenceDecoder {
    *
    * @param stream The input stream from which the sequence data is read.
    * @param sequence A pointer to the Sequence object that will be populated with the decoded data.
-   * @return true if the sequence is successfully decoded, false otherwise.
+   * @return true if the sequence is successfully decoded, false otherwise. The sequence then holds
+   * what was decoded before the error, so release it with Sequence::destroy.
    */
   static bool decode(pb_istream_t* stream, Sequence* sequence);
 };
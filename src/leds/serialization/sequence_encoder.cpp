@@ -4,13 +4,39 @@
 #include "layer_encoder.h"
 #include "../animator.h"
 
+bool SequenceEncoder::palette_callback(pb_ostream_t *stream, const pb_field_iter_t *field, void * const *arg)
+{
+    const Palette* palette = static_cast<const Palette*>(*arg);
+    if (palette->size() == 0) return true; // Nothing to encode
+
+    size_t size = 0;
+    for (size_t i = 0; i < palette->size(); i++)
+    {
+        size += LayerEncoder::varint_size((*palette)[i]);
+    }
+
+    if (!pb_encode_tag(stream, PB_WT_STRING, field->tag) ||
+        !pb_encode_varint(stream, size)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < palette->size(); i++)
+    {
+        if (!pb_encode_varint(stream, (*palette)[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
 
 bool SequenceEncoder::animations_callback(pb_ostream_t *stream, const pb_field_iter_t *field, void * const *arg)
 {
-    std::vector<Animation*>* animations = static_cast<std::vector<Animation*>*>(*arg);
+    const SequenceEncoding* encoding = static_cast<const SequenceEncoding*>(*arg);
 
-    for (Animation* animation : *animations)
+    for (Animation* animation : encoding->sequence->animations)
     {
+        LayersEncoding layers = { &animation->layers, &encoding->palette };
         protocol_Direction direction = animation->direction == FORWARD ? protocol_Direction_FORWARD : protocol_Direction_BACKWARD;
         protocol_Animation encoded_animation = {
             .direction = direction,
@@ -21,15 +47,25 @@ bool SequenceEncoder::animations_callback(pb_ostream_t *stream, const pb_field_i
                 .funcs = {
                     .encode = LayerEncoder::layer_callback,
                 },
-                .arg = &animation->layers
+                .arg = &layers
             }
         };
 
+        // Size the animation without its layers, and add the layers, which are sized separately
+        size_t size;
+        size_t layers_size;
+        encoded_animation.layers.funcs.encode = nullptr;
+        if (!pb_get_encoded_size(&size, protocol_Animation_fields, &encoded_animation) ||
+            !LayerEncoder::layers_size(&animation->layers, &encoding->palette, &layers_size)) {
+            return false;
+        }
+        encoded_animation.layers.funcs.encode = LayerEncoder::layer_callback;
+
         if (!pb_encode_tag(stream, PB_WT_STRING, field->tag)) {
             return false;
         }
 
-        if (!pb_encode_submessage(stream, protocol_Animation_fields, &encoded_animation))
+        if (!LayerEncoder::encode_submessage(stream, protocol_Animation_fields, &encoded_animation, size + layers_size))
         {
             debug("\033[1;31mFailed to encode animation\033[0m\n", 0);
             return false;
@@ -39,16 +75,38 @@ bool SequenceEncoder::animations_callback(pb_ostream_t *stream, const pb_field_i
     return true;
 }
 
-bool SequenceEncoder::encode(pb_ostream_t *stream, Sequence * sequence)
+/**
+ * @brief Prepare a sequence for encoding, e.g. as a field of a larger message, and build its palette.
+ * The animations are encoded by a callback, so the sequence and the encoding must outlive the encoding.
+ *
+ * @param sequence The sequence to encode
+ * @param encoding Storage for the palette, usually on the stack of the caller
+ */
+protocol_Sequence SequenceEncoder::toEncodable(Sequence * sequence, SequenceEncoding * encoding)
 {
-    protocol_Sequence encoded_sequence = {
+    encoding->sequence = sequence;
+    encoding->palette.build(sequence->animations);
+
+    return protocol_Sequence {
+        .palette = {
+            .funcs = {
+                .encode = SequenceEncoder::palette_callback,
+            },
+            .arg = &encoding->palette
+        },
         .animations = {
             .funcs = {
                 .encode = SequenceEncoder::animations_callback,
             },
-            .arg = &sequence->animations
+            .arg = encoding
         }
     };
+}
+
+bool SequenceEncoder::encode(pb_ostream_t *stream, Sequence * sequence)
+{
+    SequenceEncoding encoding;
+    protocol_Sequence encoded_sequence = toEncodable(sequence, &encoding);
 
     if (!pb_encode(stream, protocol_Sequence_fields, &encoded_sequence))
         {
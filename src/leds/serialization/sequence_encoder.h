@@ -1,9 +1,22 @@
 #include <pb_encode.h>
 #include "../sequence_scheduler.h"
+#include "protocol.pb.h"
+#include "palette.h"
+
+/**
+ * @brief State of the callbacks while a sequence is encoded. It must outlive the encoding.
+ */
+struct SequenceEncoding {
+    Sequence* sequence;
+    Palette palette;
+};
+
 class SequenceEncoder {
 private:
+    static bool palette_callback(pb_ostream_t *stream, const pb_field_iter_t *field, void * const *arg);
     static bool animations_callback(pb_ostream_t *stream, const pb_field_iter_t *field, void * const *arg);
     
 public:
+    static protocol_Sequence toEncodable(Sequence * sequence, SequenceEncoding * encoding);
     static bool encode(pb_ostream_t *stream, Sequence * sequence);
 };
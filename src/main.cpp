@@ -13,168 +13,257 @@
 #include "leds/serialization/sequence_decoder.h"
 #include "leds/serialization/sequence_encoder.h"
 #include "scheduler/scheduler.h"
-/* #include "connectivity/espnow.h" */
+#include "connectivity/espnow.h"
+#include "connectivity/relay.h"
+#include "connectivity/beacon.h"
 #include "leds/generators/generators.h"
 /* #include "dmx/dmx.h" */
 #include "connectivity/serialization/message_decoder.h"
+#include "connectivity/serialization/message_encoder.h"
 #include "state/binary_store.h"
 #include "connectivity/name_generator.h"
+#include "connectivity/serial_reader.h"
+#include "connectivity/bluetooth.h"
+#include "diagnostics/telemetry.h"
+#include "diagnostics/link_monitor.h"
+#include "diagnostics/log.h"
+#include "dmx/live_control.h"
+#include "dmx/dmx_network.h"
+#include "leds/pixel_stream.h"
 
 #define CE_PIN 0
 #define CSN_PIN 10
+#define IRQ_PIN 1 // IRQ of the nRF24L01, active low
+#define RADIO_ADDRESS "SHOW1" // Pipe the controllers listen on
 #define LED_PIN 7
 #define NUM_LEDS 300
 #define BUILTIN_LED 8
 const uint16_t MAX_BUFFER_SIZE = 1028;
+// The part this controller plays in keeping the show on one sequence, see SequenceBeacon. Build the
+// controller the host sends sequences to with -D BEACON_ROLE=BeaconRole::GATEWAY.
+#ifndef BEACON_ROLE
+#define BEACON_ROLE BeaconRole::RECEIVER
+#endif
+// Art-Net and sACN from a lighting desk are received on the network given with -D WIFI_SSID=\"...\"
+// and -D WIFI_PASSWORD=\"...\". The access point must be on the channel ESP-NOW uses.
+#ifndef DMX_NETWORK_UNIVERSE
+#define DMX_NETWORK_UNIVERSE 1
+#endif
+#define WIFI_CONNECT_TIMEOUT 10000 // ms
 CRGB *leds = new CRGB[NUM_LEDS];
-RF24 radio = RF24(CE_PIN, CSN_PIN);
 u8_t frames_per_second = 40;
 
 ProcessScheduler scheduler;
 Animator *animator;
 SequenceScheduler *sequenceScheduler;
 MessageDecoder* messageDecoder;
+Telemetry* telemetry;
+LinkMonitor* linkMonitor;
+LiveControl* liveControl;
+PixelStream* pixelStream;
+BluetoothStream* bluetoothStream;
+ESPNetwork* espNetwork;
+Radio* radio;
+Relay* relay;
+SequenceBeacon* beacon;
 BinaryStore store("config", "program");
 
 /**
- * @brief Reads a data packet from Serial based on a length prefix.
- *
- * The protocol expects a 2-byte uint16_t length, followed by 'length' bytes of data.
- *
- * @param dataBuffer A pointer to the buffer where the received data will be stored.
- * This buffer must be pre-allocated by the caller and be at least
- * MAX_BUFFER_SIZE bytes long.
- * @return The number of bytes successfully read into dataBuffer (excluding the 2-byte length prefix),
- * or a negative error code:
- * - -1: No data available to read (timeout or empty buffer).
- * - -2: Not enough data available for the 2-byte length header within timeout.
- * - -3: Announced data length exceeds MAX_BUFFER_SIZE.
- * - -4: Not enough data available for the full payload within timeout after header.
+ * @brief Play a decoded sequence. The gateway also keeps it as it was encoded, such that it resends
+ * the bytes the hash of its beacons was taken over.
  */
-int16_t readSerialPacket(byte* dataBuffer) {
-    uint16_t expectedLength = 0;
-    size_t bytesRead = 0;
-
-    // Set a timeout for reading. Adjust as needed based on your application's requirements.
-    // This is important to prevent the function from blocking indefinitely.
-    // For example, if you expect data quickly, set a short timeout.
-    // Serial.setTimeout(100); // Example: 100 milliseconds timeout for all read operations in this function
-
-    // --- Read the 2-byte length prefix ---
-    if (Serial.available() < 2) {
-      return 0;
-    }
+void setSequence(Sequence *sequence) {
+  size_t length;
+  const u8_t* encoded = messageDecoder->getSequenceData(&length);
+  if (encoded != nullptr) beacon->keep(encoded, length, messageDecoder->getSequenceHash());
 
-    // Read the two bytes for the length
-    byte lengthBytes[2];
-    bytesRead = Serial.readBytes(lengthBytes, 2);
+  sequenceScheduler->set(sequence, messageDecoder->getSequenceHash());
+}
 
-    if (bytesRead != 2) {
-        return -2;
-    }
+void onReceiveSequence(Sequence *sequence) {
+  setSequence(sequence);
+}
+
+// Broadcasts for other groups are already skipped by the decoder
+void onReceiveBroadcastSequence(Sequence *sequence, std::vector<uint32_t> *group_ids) {
+  setSequence(sequence);
+}
 
-    // Reconstruct uint16_t from bytes (assuming little-endian as is common)
-    // If your sender is big-endian, swap lengthBytes[0] and lengthBytes[1]
-    expectedLength = (uint16_t)lengthBytes[0] | ((uint16_t)lengthBytes[1] << 8);
 
-    printf("to-read: %d\n",expectedLength);
+u8_t buffer[MAX_BUFFER_SIZE];
+u32_t buffer_length;
 
-    // --- Validate expected length ---
-    if (expectedLength > MAX_BUFFER_SIZE) {
+// The packet currently being decoded. Only valid during the decoder callbacks.
+const u8_t* received_packet;
+size_t received_packet_length;
+// Where responses to the packet being decoded are written
+Print* response_output = nullptr;
 
-        // Discard the remaining bytes to clear the buffer for the next packet
-        while (Serial.available() && expectedLength > 0) {
-            Serial.read(); // Read and discard
-            expectedLength--;
-        }
-        return -3; // Length exceeds buffer capacity
-    }
+Settings settings = { 0, 0 };
+
+void onReceiveSaveState(Sequence *sequence, protocol_Settings *newSettings) {
+  store.saveData(received_packet, received_packet_length);
+  settings.group_id = newSettings->group_id;
+  settings.virtual_offset = newSettings->virtual_offset;
+  messageDecoder->setGroup(settings.group_id);
+  setSequence(sequence);
+}
+
+void onRequestState() {
+  if (response_output == nullptr) return;
 
-    // --- Read the actual data payload ---
-    if (expectedLength == 0) {
-        return 0; // No payload to read
+  Sequence* sequence = sequenceScheduler->getSequence();
+  State state = { sequence, &settings };
+  protocol_Diagnostics diagnostics = telemetry->toEncodable();
+  DedupeStats dedupe = messageDecoder->getDedupeStats();
+  diagnostics.dedupe_hits = dedupe.hits;
+  diagnostics.dedupe_misses = dedupe.misses;
+  linkMonitor->toEncodable(&diagnostics);
+
+  MessageEncoder::sendState(response_output, &state, &diagnostics);
+  delete sequence;
+}
+
+void onReceivePatch(protocol_Patch *patch) {
+  if (!sequenceScheduler->patch(patch->animation, patch->layer, patch->field, patch->index, patch->value)) {
+    debug("\033[1;31mRejected patch of layer %d\033[0m\n", patch->layer);
+  }
+}
+
+/**
+ * @brief Handle a packet received on any transport
+ *
+ * @param output Where responses to the packet are written
+ * @param link The transport, which decode errors are counted for
+ */
+void onPacket(const uint8_t* data, size_t length, Print* output, Link link) {
+  // Pixel frames are decoded straight into the LED buffer
+  if (PixelStream::isPixelFrame(data, length)) {
+    if (!pixelStream->apply(data, length)) {
+      debug("\033[1;31mInvalid pixel frame\033[0m\n", 0);
+      linkMonitor->countDecodeError(link);
     }
+    return;
+  }
 
-    // Wait until enough data is available or timeout
-    unsigned long startTime = millis();
-    while (Serial.available() < expectedLength && (millis() - startTime) < 1000) { // Wait up to 100ms for payload
-        delay(1);
+  // Control frames bypass the protobuf decoder
+  if (LiveControl::isControlFrame(data, length)) {
+    if (!liveControl->post(data, length)) {
+      debug("\033[1;31mInvalid control frame\033[0m\n", 0);
+      linkMonitor->countDecodeError(link);
     }
+    return;
+  }
 
-    if (Serial.available() < expectedLength) {
-        // Discard any partial data that might have arrived
-        while (Serial.available()) {
-            Serial.read();
-        }
-        return -4; // Not enough data for payload
+  // Beacons of the gateway, and requests of the receivers for its sequence
+  if (SequenceBeacon::isBeaconFrame(data, length)) {
+    if (!beacon->receive(data, length)) {
+      linkMonitor->countDecodeError(link);
     }
+    return;
+  }
 
-    // Read the actual data into the buffer
-    bytesRead = Serial.readBytes(dataBuffer, expectedLength);
+  received_packet = data;
+  received_packet_length = length;
+  response_output = output;
 
-    if (bytesRead != expectedLength) {
-        return -4;
-    }
+  if (!messageDecoder->decode(data, length)) {
+    linkMonitor->countDecodeError(link);
+  }
+}
 
-    return bytesRead; // Return the number of bytes successfully read
+void onSerialData(const uint8_t* data, size_t length) {
+  onPacket(data, length, &Serial, Link::SERIAL_PORT);
 }
 
-void onReceiveSequence(Sequence *sequence) {
-  sequenceScheduler->set(sequence);
+void onBluetoothData(const uint8_t* data, size_t length) {
+  onPacket(data, length, bluetoothStream, Link::BLUETOOTH);
 }
 
+bool sendRelayFrame(const u8_t* frame, size_t length) {
+  return espNetwork->write(Payload{ (u8_t*)frame, (u32_t)length });
+}
 
-u8_t buffer[1028];
-u32_t buffer_length;
+bool sendBeaconFrame(const u8_t* frame, size_t length) {
+  return relay->originate(frame, length);
+}
 
-void onReceiveSaveState(Sequence *sequence, protocol_Settings *settings) {
-  buffer_length = store.saveData(buffer, buffer_length);
-  sequenceScheduler->set(sequence);
+/**
+ * @brief Resend the sequence of the gateway that receivers requested, as a sequence message around
+ * the encoded sequence as it was received
+ */
+void onSequenceRequested(const u8_t* sequence, size_t length) {
+  static u8_t message[MAX_BUFFER_SIZE + 8];
+  pb_ostream_t stream = pb_ostream_from_buffer(message, sizeof(message));
+  if (!pb_encode_tag(&stream, PB_WT_STRING, protocol_Message_sequence_tag) || !pb_encode_string(&stream, sequence, length) || !relay->originate(message, stream.bytes_written)) {
+    debug("\033[1;31mFailed to resend the sequence\033[0m\n", 0);
+  }
 }
 
-class ReadFromPC : public Process {
-public:
-  ReadFromPC() {
-    // Constructor can be used to initialize anything if needed
-    buffer_length = store.loadData(buffer, sizeof(buffer));
+// Relayed messages are passed on to controllers out of range of the sender. There is no one to
+// respond to over ESP-NOW.
+void onEspNowData(const uint8_t* data, size_t length) {
+  if (!Relay::isRelayFrame(data, length)) {
+    onPacket(data, length, nullptr, Link::ESPNOW);
+    return;
+  }
 
-    // Only if contains program
-    if (5 < buffer_length) {
-      pb_istream_t stream = pb_istream_from_buffer(buffer,buffer_length);
-      messageDecoder->decode(&stream);
-    }
+  const u8_t* message;
+  size_t messageLength;
+  if (relay->receive(data, length, &message, &messageLength)) {
+    onPacket(message, messageLength, nullptr, Link::ESPNOW);
   }
+}
 
-  void update() override {
-      buffer_length = readSerialPacket(buffer);
-      if (buffer_length < 1) {
-        if (buffer_length != 0) printf("length-return: %d\n",buffer_length);
-        return;
-      }
+// Messages from a radio transmitter. The controllers only listen, so there is no one to respond to.
+void onRadioData(const uint8_t* data, size_t length) {
+  onPacket(data, length, nullptr, Link::RADIO);
+}
 
-      pb_istream_t stream = pb_istream_from_buffer(buffer,buffer_length);
-      messageDecoder->decode(&stream);
-    }
+/**
+ * @brief Load the program saved in flash, if any, and decode it.
+ */
+void loadStoredProgram() {
+  buffer_length = store.loadData(buffer, sizeof(buffer));
 
-  String getName() override { return "ReadFromPC"; }
-};
+  // Only if contains program
+  if (5 < buffer_length) {
+    received_packet = buffer;
+    received_packet_length = buffer_length;
+    response_output = nullptr;
+
+    messageDecoder->decode(buffer, buffer_length);
+  }
+}
 
 void setup() {
   // put your setup code here, to run once:
   scheduler = ProcessScheduler();
-  Serial.begin(115200);
+  // Room for a couple of frames, as the serial protocol only drains the buffer every 10ms
+  Serial.setRxBufferSize(MAX_BUFFER_SIZE * 2);
+  Serial.begin(2000000);
+
+  // Log lines are framed, as responses are framed on the same port
+  scheduler.addProcess(new Log(&Serial), 10);
 
   FastLED.addLeds<WS2812B, LED_PIN, RGB>(leds, NUM_LEDS);
 
   animator = new Animator(leds, NUM_LEDS);
   sequenceScheduler = new SequenceScheduler(animator);
-  messageDecoder = new MessageDecoder();
+  messageDecoder = new MessageDecoder(sequenceScheduler);
 
   messageDecoder->setOnSequenceReceived(onReceiveSequence);
+  messageDecoder->setOnBroadcastSequenceReceived(onReceiveBroadcastSequence);
   messageDecoder->setOnSaveStateReceived(onReceiveSaveState);
+  messageDecoder->setOnPatchReceived(onReceivePatch);
+  messageDecoder->setOnRequestState(onRequestState);
+
+  // Created before the stored program is loaded, such that the gateway keeps its sequence
+  beacon = new SequenceBeacon(sequenceScheduler, BEACON_ROLE, sendBeaconFrame);
+  beacon->setOnSequenceRequested(onSequenceRequested);
 
   scheduler.addProcess(animator, 1000 / frames_per_second);
-  // scheduler.addProcess(new ReadDMXProcess(animator), 1000 /
+  // scheduler.addProcess(new ReadDMXProcess(animator, sequenceScheduler), 1000 /
   // frames_per_second); // Update every 25ms
 
   // Set virtual offset for the animator. This is used when multiple LED strips
@@ -190,7 +279,76 @@ void setup() {
     new StarsMask(300, 5, 1),
   }, 10000);
   
-  scheduler.addProcess(new ReadFromPC(), 20);
+  loadStoredProgram();
+
+  // Apply live control frames at the frame rate
+  liveControl = new LiveControl(animator, sequenceScheduler);
+  scheduler.addProcess(liveControl, 1000 / frames_per_second);
+
+  // Raw pixels from a media server, until they time out
+  pixelStream = new PixelStream(animator, sequenceScheduler);
+  scheduler.addProcess(pixelStream, 100);
+
+  SerialProtocol* serialProtocol = new SerialProtocol(&Serial, MAX_BUFFER_SIZE);
+  serialProtocol->onData(onSerialData);
+  // Every 10ms, such that pixel streams at 60 fps are shown one frame per update
+  scheduler.addProcess(serialProtocol, 10);
+
+  // The same packets as on serial, written to the RX characteristic. Responses are notified.
+  BluetoothService* bluetooth = new BluetoothService(MAX_BUFFER_SIZE);
+  bluetoothStream = new BluetoothStream(bluetooth);
+  bluetooth->onData(onBluetoothData);
+  scheduler.addProcess(bluetooth, 10);
+
+  // Messages from other controllers, rebroadcast to those out of range of the sender
+  espNetwork = new ESPNetwork(ConnectivityMode::WRITER); // Adds the broadcast peer, such that the relay can send
+  relay = new Relay(sendRelayFrame, true, ESPNOW_MAX_MESSAGE_SIZE - RELAY_HEADER_SIZE);
+  espNetwork->onData(onEspNowData);
+  scheduler.addProcess(espNetwork, 1);
+  scheduler.addProcess(relay, 1);
+  // Keeps the controllers on the sequence of the gateway, rather than rebroadcasting it
+  scheduler.addProcess(beacon, 10);
+
+  // Messages over the nRF24L01, if one is fitted. The receive task moves packets from the radio to a
+  // ring buffer on its interrupt, and the process reassembles them. The controllers do not send, as
+  // a write blocks the loop for the auto-ack retries when no receiver is in range, so lost
+  // fragments are not requested either.
+  radio = new Radio(RADIO_ADDRESS, RADIO_ADDRESS, MAX_BUFFER_SIZE, false);
+  if (radio->setup(CE_PIN, CSN_PIN, IRQ_PIN)) {
+    radio->onData(onRadioData);
+    scheduler.addProcess(radio, 10);
+  }
+
+#ifdef WIFI_SSID
+  // After ESP-NOW, which puts Wi-Fi in station mode. Setup goes on without DMX if it is not joined.
+  WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+  u32_t connectStartedAt = millis();
+  while (WiFi.status() != WL_CONNECTED && millis() - connectStartedAt < WIFI_CONNECT_TIMEOUT) {
+    delay(100);
+  }
+
+  DMXNetwork* dmxNetwork = new DMXNetwork(liveControl, DMX_NETWORK_UNIVERSE);
+  if (WiFi.status() == WL_CONNECTED && dmxNetwork->begin()) {
+    scheduler.addProcess(dmxNetwork, 1000 / frames_per_second);
+  }
+  else {
+    debug("\033[1;31mNo DMX over Wi-Fi on %s\033[0m\n", WIFI_SSID);
+    delete dmxNetwork;
+  }
+#endif
+
+  // Packet counters of the transports, sampled every second and printed every minute
+  linkMonitor = new LinkMonitor(60);
+  linkMonitor->watch(Link::SERIAL_PORT, serialProtocol);
+  linkMonitor->watch(Link::BLUETOOTH, bluetooth);
+  linkMonitor->watch(Link::ESPNOW, espNetwork);
+  linkMonitor->watch(Link::RADIO, radio);
+  scheduler.addProcess(linkMonitor, 1000);
+
+  // Sample heap and stacks every second, and print a stats line every minute
+  telemetry = new Telemetry(60);
+  Telemetry::watchTask("loop", xTaskGetCurrentTaskHandle());
+  scheduler.addProcess(telemetry, 1000);
 
 /* 
   const uint8_t defaultProgram[] = { 0xAA, 0xBB, 0xCC, 0xDD };
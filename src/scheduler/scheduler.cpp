@@ -28,7 +28,7 @@ void ProcessScheduler::update() {
 
 
     if (processTookTooLong) {
-      printf("\033[1;31m%s took %dms\033[0m\n", process->process->getName().c_str(), diff);
+      log_printf("\033[1;31m%s took %dms\033[0m\n", process->process->getName().c_str(), diff);
     }
   }
 
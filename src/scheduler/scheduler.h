@@ -10,6 +10,8 @@
  */
 class Process {
   public:
+  virtual ~Process() = default;
+
   /**
    * @brief Update the process.
    *
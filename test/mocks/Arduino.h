@@ -0,0 +1,132 @@
+#pragma once
+
+// The parts of the Arduino API that the modules under test use, for host tests in [env:native]
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+#include <type_traits>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+typedef uint8_t u8_t;
+typedef uint16_t u16_t;
+typedef unsigned long u32_t; // uint32_t is unsigned long on the ESP32-C3, though it is wider here
+typedef int8_t s8_t;
+typedef int16_t s16_t;
+typedef int32_t s32_t;
+typedef uint8_t byte;
+
+using std::max;
+using std::min;
+
+#define IRAM_ATTR
+#define PROGMEM
+
+inline unsigned long millis() {
+  return mock::now;
+}
+
+inline unsigned long micros() {
+  return mock::now * 1000;
+}
+
+inline void delay(unsigned long ms) {
+  mock::now += ms;
+}
+
+inline long random(long min, long max) {
+  return max <= min ? min : min + rand() % (max - min);
+}
+
+inline long random(long max) {
+  return random(0, max);
+}
+
+class String {
+  std::string value;
+
+  public:
+  String() {}
+  String(const char* value) : value(value) {}
+  String(const std::string& value) : value(value) {}
+  template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+  String(T number) : value(std::to_string(number)) {}
+
+  const char* c_str() const {
+    return value.c_str();
+  }
+
+  size_t length() const {
+    return value.size();
+  }
+
+  String& operator+=(const String& other) {
+    value += other.value;
+    return *this;
+  }
+
+  friend String operator+(const String& a, const String& b) {
+    return String(a.value + b.value);
+  }
+
+  friend String operator+(const String& a, const char* b) {
+    return String(a.value + b);
+  }
+
+  friend String operator+(const char* a, const String& b) {
+    return String(a + b.value);
+  }
+
+  bool operator==(const String& other) const {
+    return value == other.value;
+  }
+
+  bool operator!=(const String& other) const {
+    return value != other.value;
+  }
+};
+
+class Print {
+  public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t byte) = 0;
+  virtual size_t write(const uint8_t* data, size_t length) {
+    for (size_t i = 0; i < length; i++) write(data[i]);
+    return length;
+  }
+  virtual void flush() {}
+};
+
+class Stream : public Print {
+  public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+
+  virtual size_t readBytes(uint8_t* buffer, size_t length) {
+    size_t count = 0;
+    for (int byte; count < length && (byte = read()) != -1; count++) buffer[count] = byte;
+    return count;
+  }
+};
+
+// The heap figures are set by the tests
+class EspClass {
+  public:
+  uint32_t freeHeap = 0;
+  uint32_t maxAllocHeap = 0;
+  uint32_t minFreeHeap = 0;
+
+  uint32_t getFreeHeap() { return freeHeap; }
+  uint32_t getMaxAllocHeap() { return maxAllocHeap; }
+  uint32_t getMinFreeHeap() { return minFreeHeap; }
+};
+
+inline EspClass ESP;
@@ -0,0 +1,102 @@
+#pragma once
+
+// AsyncUDP over POSIX sockets on the loopback interface. The UDP task is not started: the tests
+// call mock::deliverUdp to pass the packets that arrived to the handlers, in the test thread.
+// Multicast groups are not joined, so only unicast packets, e.g. Art-Net, are received.
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+class AsyncUDPPacket {
+  uint8_t* bytes;
+  size_t size;
+
+  public:
+  AsyncUDPPacket(uint8_t* bytes, size_t size) : bytes(bytes), size(size) {}
+
+  uint8_t* data() {
+    return bytes;
+  }
+
+  size_t length() {
+    return size;
+  }
+};
+
+typedef std::function<void(AsyncUDPPacket& packet)> AuPacketHandlerFunction;
+
+class AsyncUDP;
+
+namespace mock {
+inline std::vector<AsyncUDP*> sockets;
+}
+
+class AsyncUDP {
+  int fd = -1;
+  AuPacketHandlerFunction handler;
+
+  public:
+  AsyncUDP() {
+    mock::sockets.push_back(this);
+  }
+
+  ~AsyncUDP() {
+    close();
+    mock::sockets.erase(std::remove(mock::sockets.begin(), mock::sockets.end(), this), mock::sockets.end());
+  }
+
+  bool listen(uint16_t port) {
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+      close();
+      return false;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    return true;
+  }
+
+  bool listenMulticast(const IPAddress& address, uint16_t port) {
+    return true;
+  }
+
+  void onPacket(AuPacketHandlerFunction callback) {
+    handler = callback;
+  }
+
+  void close() {
+    if (fd != -1) ::close(fd);
+    fd = -1;
+  }
+
+  // Pass every packet that has arrived to the handler
+  void deliver() {
+    uint8_t buffer[1500];
+    ssize_t length;
+    while (fd != -1 && (length = recv(fd, buffer, sizeof(buffer), 0)) >= 0) {
+      AsyncUDPPacket packet(buffer, length);
+      if (handler) handler(packet);
+    }
+  }
+};
+
+namespace mock {
+// Run the UDP task once, for every socket
+inline void deliverUdp() {
+  for (AsyncUDP* socket : sockets) socket->deliver();
+}
+}
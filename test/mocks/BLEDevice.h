@@ -0,0 +1,180 @@
+#pragma once
+
+// The BLE stack without a radio. The tests connect and disconnect a client and write to
+// characteristics through mock::ble, which calls the callbacks in the test thread like the BLE task
+// would. Notifications are kept in the characteristic. Every object created is kept in mock::ble.
+
+#include <Arduino.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+class BLEServer;
+class BLECharacteristic;
+
+class BLEDescriptor {
+  public:
+  virtual ~BLEDescriptor() {}
+};
+
+class BLE2902 : public BLEDescriptor {};
+
+class BLEServerCallbacks {
+  public:
+  virtual ~BLEServerCallbacks() {}
+  virtual void onConnect(BLEServer* server) {}
+  virtual void onDisconnect(BLEServer* server) {}
+};
+
+class BLECharacteristicCallbacks {
+  public:
+  virtual ~BLECharacteristicCallbacks() {}
+  virtual void onWrite(BLECharacteristic* characteristic) {}
+};
+
+class BLECharacteristic {
+  public:
+  static const uint32_t PROPERTY_READ = 1 << 0;
+  static const uint32_t PROPERTY_WRITE = 1 << 1;
+  static const uint32_t PROPERTY_NOTIFY = 1 << 2;
+  static const uint32_t PROPERTY_WRITE_NR = 1 << 5;
+
+  std::string uuid;
+  std::vector<uint8_t> value;
+  std::vector<std::vector<uint8_t>> notifications;
+  BLECharacteristicCallbacks* callbacks = nullptr;
+  std::vector<std::unique_ptr<BLEDescriptor>> descriptors;
+
+  BLECharacteristic(const char* uuid) : uuid(uuid) {}
+
+  void addDescriptor(BLEDescriptor* descriptor) {
+    descriptors.emplace_back(descriptor);
+  }
+
+  void setCallbacks(BLECharacteristicCallbacks* callbacks) {
+    this->callbacks = callbacks;
+  }
+
+  void setValue(uint8_t* data, size_t length) {
+    value.assign(data, data + length);
+  }
+
+  uint8_t* getData() {
+    return value.data();
+  }
+
+  size_t getLength() {
+    return value.size();
+  }
+
+  void notify() {
+    notifications.push_back(value);
+  }
+};
+
+class BLEService {
+  public:
+  std::vector<std::unique_ptr<BLECharacteristic>> characteristics;
+
+  BLECharacteristic* createCharacteristic(const char* uuid, uint32_t properties) {
+    characteristics.emplace_back(new BLECharacteristic(uuid));
+    return characteristics.back().get();
+  }
+
+  void start() {}
+};
+
+class BLEServer {
+  public:
+  std::vector<std::unique_ptr<BLEServerCallbacks>> callbacks;
+  std::vector<std::unique_ptr<BLEService>> services;
+  uint16_t mtu = 23;
+  int advertisingStarts = 0;
+
+  void setCallbacks(BLEServerCallbacks* callbacks) {
+    this->callbacks.emplace_back(callbacks);
+  }
+
+  BLEService* createService(const char* uuid) {
+    services.emplace_back(new BLEService());
+    return services.back().get();
+  }
+
+  void startAdvertising() {
+    advertisingStarts++;
+  }
+
+  uint16_t getConnId() {
+    return 0;
+  }
+
+  uint16_t getPeerMTU(uint16_t connection) {
+    return mtu;
+  }
+};
+
+class BLEAdvertising {
+  public:
+  void addServiceUUID(const char* uuid) {}
+  void setScanResponse(bool enabled) {}
+  void setMinPreferred(uint16_t interval) {}
+};
+
+namespace mock {
+struct BLE {
+  std::vector<std::unique_ptr<BLEServer>> servers;
+  BLEAdvertising advertising;
+
+  BLEServer* server() {
+    return servers.back().get();
+  }
+
+  // The characteristic of the last server created
+  BLECharacteristic* characteristic(const char* uuid) {
+    for (auto& service : server()->services) {
+      for (auto& characteristic : service->characteristics) {
+        if (characteristic->uuid == uuid) return characteristic.get();
+      }
+    }
+    return nullptr;
+  }
+
+  void connect(uint16_t mtu = 247) {
+    server()->mtu = mtu;
+    server()->callbacks.back()->onConnect(server());
+  }
+
+  void disconnect() {
+    server()->mtu = 23;
+    server()->callbacks.back()->onDisconnect(server());
+  }
+
+  // A write of the client, as received by the BLE task
+  void write(const char* uuid, const uint8_t* data, size_t length) {
+    BLECharacteristic* target = characteristic(uuid);
+    target->value.assign(data, data + length);
+    if (target->callbacks != nullptr) target->callbacks->onWrite(target);
+  }
+};
+
+// Never destroyed, like the BLE objects of the firmware
+inline BLE& ble = *new BLE();
+}
+
+class BLEDevice {
+  public:
+  static void init(const char* name) {}
+
+  static BLEServer* createServer() {
+    mock::ble.servers.emplace_back(new BLEServer());
+    return mock::ble.server();
+  }
+
+  static void setMTU(uint16_t mtu) {}
+
+  static BLEAdvertising* getAdvertising() {
+    return &mock::ble.advertising;
+  }
+
+  static void startAdvertising() {}
+};
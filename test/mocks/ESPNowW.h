@@ -0,0 +1,58 @@
+#pragma once
+
+// ESP-NOW without a radio. Packets passed to send_message are kept until the test confirms them
+// with the send callback, or delivers them to the receive callback.
+
+#include <stdint.h>
+#include <deque>
+#include <vector>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_NOW_MAX_DATA_LEN 250
+
+typedef enum {
+  ESP_NOW_SEND_SUCCESS = 0,
+  ESP_NOW_SEND_FAIL,
+} esp_now_send_status_t;
+
+typedef void (*esp_now_recv_cb_t)(const uint8_t* mac, const uint8_t* data, int length);
+typedef void (*esp_now_send_cb_t)(const uint8_t* mac, esp_now_send_status_t status);
+
+class ESPNowClass {
+  public:
+  std::deque<std::vector<uint8_t>> sent; // Packets accepted by send_message, in order
+  esp_err_t sendResult = ESP_OK;         // Returned by send_message, which drops the packet unless ESP_OK
+  esp_now_recv_cb_t receive = nullptr;
+  esp_now_send_cb_t confirm = nullptr;
+
+  esp_err_t init() {
+    return ESP_OK;
+  }
+
+  esp_err_t set_mac(const uint8_t* mac) {
+    return ESP_OK;
+  }
+
+  esp_err_t add_peer(const uint8_t* mac, int channel = 0, int encrypt = 0, int netif = 0) {
+    return ESP_OK;
+  }
+
+  esp_err_t reg_recv_cb(esp_now_recv_cb_t callback) {
+    receive = callback;
+    return ESP_OK;
+  }
+
+  esp_err_t reg_send_cb(esp_now_send_cb_t callback) {
+    confirm = callback;
+    return ESP_OK;
+  }
+
+  esp_err_t send_message(const uint8_t* mac, const uint8_t* data, int length) {
+    if (sendResult == ESP_OK) sent.push_back(std::vector<uint8_t>(data, data + length));
+    return sendResult;
+  }
+};
+
+inline ESPNowClass ESPNow;
@@ -0,0 +1,94 @@
+#pragma once
+
+// The parts of FastLED that the modules under test use, for host tests in [env:native]
+
+#include <stdint.h>
+
+inline uint8_t scale8(uint8_t value, uint8_t scale) {
+  return ((uint16_t)value * (1 + (uint16_t)scale)) >> 8;
+}
+
+struct CHSV {
+  uint8_t h, s, v;
+
+  CHSV(uint8_t h, uint8_t s, uint8_t v) : h(h), s(s), v(v) {}
+};
+
+struct CRGB {
+  union {
+    struct {
+      uint8_t r, g, b;
+    };
+    uint8_t raw[3];
+  };
+
+  enum HTMLColorCode : uint32_t {
+    Aqua = 0x00FFFF,
+    Black = 0x000000,
+    Blue = 0x0000FF,
+    Fuchsia = 0xFF00FF,
+    Green = 0x008000,
+    Lime = 0x00FF00,
+    Red = 0xFF0000,
+    White = 0xFFFFFF,
+    Yellow = 0xFFFF00,
+  };
+
+  CRGB() : r(0), g(0), b(0) {}
+  CRGB(uint8_t r, uint8_t g, uint8_t b) : r(r), g(g), b(b) {}
+  CRGB(uint32_t color) : r(color >> 16), g(color >> 8), b(color) {}
+  CRGB(HTMLColorCode color) : CRGB((uint32_t)color) {}
+
+  // A plain HSV conversion, close enough to hsv2rgb_rainbow for tests
+  CRGB(const CHSV& hsv) {
+    uint8_t region = hsv.h / 43;
+    uint8_t remainder = (hsv.h - region * 43) * 6;
+    uint8_t p = ::scale8(hsv.v, 255 - hsv.s);
+    uint8_t q = ::scale8(hsv.v, 255 - ::scale8(hsv.s, remainder));
+    uint8_t t = ::scale8(hsv.v, 255 - ::scale8(hsv.s, 255 - remainder));
+    switch (region) {
+      case 0: r = hsv.v; g = t; b = p; break;
+      case 1: r = q; g = hsv.v; b = p; break;
+      case 2: r = p; g = hsv.v; b = t; break;
+      case 3: r = p; g = q; b = hsv.v; break;
+      case 4: r = t; g = p; b = hsv.v; break;
+      default: r = hsv.v; g = p; b = q; break;
+    }
+  }
+
+  CRGB& scale8(uint8_t scale) {
+    r = ::scale8(r, scale);
+    g = ::scale8(g, scale);
+    b = ::scale8(b, scale);
+    return *this;
+  }
+
+  bool operator==(const CRGB& other) const {
+    return r == other.r && g == other.g && b == other.b;
+  }
+
+  bool operator!=(const CRGB& other) const {
+    return !(*this == other);
+  }
+
+  friend CRGB operator-(const CRGB& a, const CRGB& b) {
+    return CRGB(a.r > b.r ? a.r - b.r : 0, a.g > b.g ? a.g - b.g : 0, a.b > b.b ? a.b - b.b : 0);
+  }
+};
+
+enum EOrder { RGB, GRB };
+enum ESPIChipsets { WS2812B };
+
+class CFastLED {
+  public:
+  unsigned long shown = 0; // Calls of show, counted for tests
+
+  template <ESPIChipsets CHIPSET, int DATA_PIN, EOrder ORDER>
+  void addLeds(CRGB* leds, int count) {}
+
+  void show(uint8_t brightness = 255) {
+    shown++;
+  }
+};
+
+inline CFastLED FastLED;
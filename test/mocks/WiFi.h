@@ -0,0 +1,23 @@
+#pragma once
+
+// The Wi-Fi setup ESP-NOW and UDP need, which does nothing on the host
+
+#include <stdint.h>
+
+#define WIFI_STA 1
+
+class IPAddress {
+  public:
+  uint8_t octets[4] = {};
+
+  IPAddress() {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : octets{ a, b, c, d } {}
+};
+
+class WiFiClass {
+  public:
+  void mode(int mode) {}
+  void disconnect() {}
+};
+
+inline WiFiClass WiFi;
@@ -0,0 +1,92 @@
+#pragma once
+
+// The UART and GPIO drivers of ESP-IDF, which do nothing on the host. The DMX receive state
+// machine is fed UART events by the tests instead.
+
+#include <stdint.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+
+typedef int uart_port_t;
+typedef int gpio_num_t;
+typedef int esp_err_t;
+
+enum { UART_NUM_0, UART_NUM_1 };
+enum { GPIO_NUM_2 = 2, GPIO_NUM_3 = 3, GPIO_NUM_4 = 4 };
+enum { GPIO_MODE_OUTPUT = 2 };
+enum { UART_DATA_8_BITS = 3 };
+enum { UART_PARITY_DISABLE = 0 };
+enum { UART_STOP_BITS_2 = 3 };
+enum { UART_HW_FLOWCTRL_DISABLE = 0 };
+#define UART_PIN_NO_CHANGE (-1)
+#define UART_SIGNAL_TXD_INV (1 << 3)
+
+typedef struct {
+  int baud_rate;
+  int data_bits;
+  int parity;
+  int stop_bits;
+  int flow_ctrl;
+} uart_config_t;
+
+typedef enum {
+  UART_DATA,
+  UART_BREAK,
+  UART_BUFFER_FULL,
+  UART_FIFO_OVF,
+  UART_FRAME_ERR,
+  UART_PARITY_ERR,
+  UART_DATA_BREAK,
+  UART_PATTERN_DET,
+  UART_EVENT_MAX,
+} uart_event_type_t;
+
+typedef struct {
+  uart_event_type_t type;
+  size_t size;
+  bool timeout_flag;
+} uart_event_t;
+
+inline esp_err_t uart_param_config(uart_port_t port, const uart_config_t* config) {
+  return 0;
+}
+
+inline esp_err_t uart_set_pin(uart_port_t port, int tx, int rx, int rts, int cts) {
+  return 0;
+}
+
+inline esp_err_t uart_driver_install(uart_port_t port, int rxSize, int txSize, int queueSize, QueueHandle_t* queue, int flags) {
+  return 0;
+}
+
+inline int uart_read_bytes(uart_port_t port, void* buffer, uint32_t length, TickType_t wait) {
+  return 0;
+}
+
+inline int uart_write_bytes(uart_port_t port, const char* data, size_t length) {
+  return length;
+}
+
+inline esp_err_t uart_flush_input(uart_port_t port) {
+  return 0;
+}
+
+inline esp_err_t uart_wait_tx_done(uart_port_t port, TickType_t wait) {
+  return 0;
+}
+
+inline esp_err_t uart_set_line_inverse(uart_port_t port, uint32_t mask) {
+  return 0;
+}
+
+inline void gpio_pad_select_gpio(int pin) {}
+
+inline esp_err_t gpio_set_direction(int pin, int mode) {
+  return 0;
+}
+
+inline esp_err_t gpio_set_level(int pin, int level) {
+  return 0;
+}
+
+inline void ets_delay_us(uint32_t us) {}
@@ -0,0 +1,37 @@
+#pragma once
+
+// The parts of FreeRTOS that the modules under test use, for host tests in [env:native].
+// Tests run on a single thread, so tasks are never started.
+
+#include <stdint.h>
+
+typedef void* TaskHandle_t;
+typedef void* QueueHandle_t;
+typedef void* SemaphoreHandle_t;
+typedef uint32_t TickType_t;
+typedef TickType_t portTickType;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY 0xFFFFFFFF
+#define pdMS_TO_TICKS(ms) (ms)
+#define portTICK_PERIOD_MS 1
+
+typedef struct {
+  int unused;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+#define portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL(mux)
+#define portENTER_CRITICAL_ISR(mux)
+#define portEXIT_CRITICAL_ISR(mux)
+#define portYIELD_FROM_ISR(woken)
+
+namespace mock {
+// The time in ms, returned by millis and xTaskGetTickCount, and advanced by the tests
+inline unsigned long now = 0;
+}
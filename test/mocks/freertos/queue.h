@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string.h>
+#include <deque>
+#include <vector>
+#include "FreeRTOS.h"
+
+namespace mock {
+struct Queue {
+  size_t length;
+  size_t itemSize;
+  std::deque<std::vector<uint8_t>> items;
+};
+}
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  return new mock::Queue{ length, itemSize, {} };
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t handle, const void* item, TickType_t wait) {
+  mock::Queue* queue = static_cast<mock::Queue*>(handle);
+  if (queue->items.size() == queue->length) return pdFALSE;
+
+  const uint8_t* bytes = static_cast<const uint8_t*>(item);
+  queue->items.emplace_back(bytes, bytes + queue->itemSize);
+  return pdTRUE;
+}
+
+inline BaseType_t xQueueSendFromISR(QueueHandle_t handle, const void* item, BaseType_t* woken) {
+  return xQueueSend(handle, item, 0);
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t handle, void* item, TickType_t wait) {
+  mock::Queue* queue = static_cast<mock::Queue*>(handle);
+  if (queue->items.empty()) return pdFALSE;
+
+  memcpy(item, queue->items.front().data(), queue->itemSize);
+  queue->items.pop_front();
+  return pdTRUE;
+}
+
+inline BaseType_t xQueueReset(QueueHandle_t handle) {
+  static_cast<mock::Queue*>(handle)->items.clear();
+  return pdPASS;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t handle) {
+  return static_cast<mock::Queue*>(handle)->items.size();
+}
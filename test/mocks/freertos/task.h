@@ -0,0 +1,33 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void*);
+
+// Tasks are never started, the tests call their functions directly
+inline BaseType_t xTaskCreate(TaskFunction_t task, const char* name, uint32_t stack, void* parameters, UBaseType_t priority, TaskHandle_t* handle) {
+  return pdPASS;
+}
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char* name, uint32_t stack, void* parameters, UBaseType_t priority, TaskHandle_t* handle, BaseType_t core) {
+  return pdPASS;
+}
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() {
+  return nullptr;
+}
+
+namespace mock {
+// The stack high-water mark of every task, set by the tests
+inline UBaseType_t stackFree = 0;
+}
+
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+  return mock::stackFree;
+}
+
+inline void vTaskDelay(TickType_t ticks) {}
+
+inline TickType_t xTaskGetTickCount() {
+  return mock::now / portTICK_PERIOD_MS;
+}
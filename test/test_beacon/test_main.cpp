@@ -0,0 +1,252 @@
+#include <unity.h>
+#include <deque>
+#include <vector>
+#include "connectivity/beacon.h"
+#include "connectivity/serialization/message_decoder.h"
+#include "leds/layers/colors/colors.h"
+#include "leds/layers/masks/masks.h"
+#include "leds/serialization/sequence_encoder.h"
+#include "connectivity/serialization/hash.h"
+
+// A gateway and a receiver on a shared medium. Frames and messages each side sends are queued, and
+// the tests deliver them to the other side.
+
+struct Controller {
+  CRGB leds[10];
+  Animator* animator;
+  SequenceScheduler* scheduler;
+  MessageDecoder* decoder;
+  SequenceBeacon* beacon;
+  std::deque<std::vector<u8_t>> sent;
+};
+
+static Controller gateway;
+static Controller receiver;
+static Controller* decoding = nullptr; // The controller whose decoder callback runs
+
+static void onSequence(Sequence* sequence) {
+  size_t length;
+  const u8_t* encoded = decoding->decoder->getSequenceData(&length);
+  if (encoded != nullptr) decoding->beacon->keep(encoded, length, decoding->decoder->getSequenceHash());
+  decoding->scheduler->set(sequence, decoding->decoder->getSequenceHash());
+}
+
+static bool gatewaySend(const u8_t* frame, size_t length) {
+  gateway.sent.push_back(std::vector<u8_t>(frame, frame + length));
+  return true;
+}
+
+static bool receiverSend(const u8_t* frame, size_t length) {
+  receiver.sent.push_back(std::vector<u8_t>(frame, frame + length));
+  return true;
+}
+
+// Wrapped in a sequence message, like main.cpp does
+static void onSequenceRequested(const u8_t* sequence, size_t length) {
+  u8_t message[1024];
+  pb_ostream_t stream = pb_ostream_from_buffer(message, sizeof(message));
+  TEST_ASSERT_TRUE(pb_encode_tag(&stream, PB_WT_STRING, protocol_Message_sequence_tag));
+  TEST_ASSERT_TRUE(pb_encode_string(&stream, sequence, length));
+  gatewaySend(message, stream.bytes_written);
+}
+
+static void create(Controller* controller, BeaconRole role, BeaconSend send) {
+  controller->animator = new Animator(controller->leds, 10);
+  controller->scheduler = new SequenceScheduler(controller->animator);
+  controller->decoder = new MessageDecoder(controller->scheduler);
+  controller->decoder->setOnSequenceReceived(onSequence);
+  controller->beacon = new SequenceBeacon(controller->scheduler, role, send);
+  controller->sent.clear();
+}
+
+static void destroy(Controller* controller) {
+  delete controller->beacon;
+  delete controller->decoder;
+  controller->scheduler->clear();
+  delete controller->scheduler;
+  delete controller->animator;
+}
+
+static void decode(Controller* controller, const std::vector<u8_t>& message) {
+  decoding = controller;
+  TEST_ASSERT_TRUE(controller->decoder->decode(message.data(), message.size()));
+}
+
+// Deliver what one side sent to the other: beacon frames to the beacon, messages to the decoder
+static void deliver(Controller* from, Controller* to) {
+  while (!from->sent.empty()) {
+    std::vector<u8_t> packet = from->sent.front();
+    from->sent.pop_front();
+    if (SequenceBeacon::isBeaconFrame(packet.data(), packet.size())) {
+      TEST_ASSERT_TRUE(to->beacon->receive(packet.data(), packet.size()));
+    }
+    else {
+      decode(to, packet);
+    }
+  }
+}
+
+static void run(u32_t ms) {
+  for (u32_t i = 0; i < ms; i += 10) {
+    delay(10);
+    gateway.beacon->update();
+    receiver.beacon->update();
+    deliver(&gateway, &receiver);
+    deliver(&receiver, &gateway);
+  }
+}
+
+/**
+ * A sequence message as the host may send it: the same sequence as SequenceEncoder encodes, with a
+ * field SequenceEncoder does not write. Encoding the decoded sequence again gives other bytes.
+ */
+static std::vector<u8_t> hostMessage() {
+  Sequence* sequence = new Sequence();
+  sequence->animations.push_back(new Animation{ { new SingleColor(CRGB(12, 34, 56)), new SectionsMask({ 255, 0, 255, 0 }, 20) }, 200, Direction::FORWARD, 200, 0 });
+  u8_t encoded[512];
+  pb_ostream_t stream = pb_ostream_from_buffer(encoded, sizeof(encoded));
+  TEST_ASSERT_TRUE(SequenceEncoder::encode(&stream, sequence));
+  TEST_ASSERT_TRUE(pb_encode_tag(&stream, PB_WT_VARINT, 15));
+  TEST_ASSERT_TRUE(pb_encode_varint(&stream, 1));
+  size_t length = stream.bytes_written;
+  Sequence::destroy(sequence);
+
+  u8_t message[600];
+  stream = pb_ostream_from_buffer(message, sizeof(message));
+  TEST_ASSERT_TRUE(pb_encode_tag(&stream, PB_WT_STRING, protocol_Message_sequence_tag));
+  TEST_ASSERT_TRUE(pb_encode_string(&stream, encoded, length));
+  return std::vector<u8_t>(message, message + stream.bytes_written);
+}
+
+void setUp(void) {
+  mock::now = 1;
+  create(&gateway, BeaconRole::GATEWAY, gatewaySend);
+  create(&receiver, BeaconRole::RECEIVER, receiverSend);
+  gateway.beacon->setOnSequenceRequested(onSequenceRequested);
+}
+
+void tearDown(void) {
+  destroy(&gateway);
+  destroy(&receiver);
+}
+
+void test_receiver_gets_the_hash_of_the_gateway(void) {
+  decode(&gateway, hostMessage());
+  TEST_ASSERT_NOT_EQUAL(0, gateway.scheduler->getHash());
+
+  // Resending the sequence encoded again would never match
+  u8_t encoded[512];
+  Sequence* playing = gateway.scheduler->getSequence();
+  pb_ostream_t stream = pb_ostream_from_buffer(encoded, sizeof(encoded));
+  TEST_ASSERT_TRUE(SequenceEncoder::encode(&stream, playing));
+  TEST_ASSERT_NOT_EQUAL(gateway.scheduler->getHash(), Hash::xxh32(encoded, stream.bytes_written));
+  delete playing;
+
+  run(BEACON_INTERVAL + BEACON_REQUEST_JITTER + BEACON_RESEND_WINDOW + 100);
+  TEST_ASSERT_EQUAL(1, receiver.beacon->getStats().requests);
+  TEST_ASSERT_EQUAL(1, gateway.beacon->getStats().resends);
+  TEST_ASSERT_EQUAL(gateway.scheduler->getHash(), receiver.scheduler->getHash());
+
+  // The beacons after the resend match, so the receiver asks no more
+  run(BEACON_INTERVAL * 5);
+  TEST_ASSERT_EQUAL(1, receiver.beacon->getStats().requests);
+  TEST_ASSERT_EQUAL(1, gateway.beacon->getStats().resends);
+  TEST_ASSERT_EQUAL(1, receiver.beacon->getStats().mismatches);
+}
+
+void test_receiver_keeps_nothing(void) {
+  decode(&receiver, hostMessage());
+  receiver.beacon->setOnSequenceRequested(onSequenceRequested);
+  receiver.beacon->receive(std::vector<u8_t>{ BEACON_FRAME_MAGIC, BEACON_REQUEST, 0, 0, 0, 0, 0, 0, 0, 0 }.data(), BEACON_FRAME_SIZE);
+
+  run(BEACON_RESEND_WINDOW * 2);
+  TEST_ASSERT_EQUAL(0, receiver.beacon->getStats().resends);
+}
+
+// After a patch the sequence has no hash, and the kept sequence is not resent
+void test_kept_sequence_of_another_hash_is_not_resent(void) {
+  decode(&gateway, hostMessage());
+  u32_t hash = gateway.scheduler->getHash();
+  gateway.beacon->keep(std::vector<u8_t>{ 1, 2, 3 }.data(), 3, hash + 1);
+
+  u8_t request[BEACON_FRAME_SIZE] = { BEACON_FRAME_MAGIC, BEACON_REQUEST, (u8_t)hash, (u8_t)(hash >> 8), (u8_t)(hash >> 16), (u8_t)(hash >> 24) };
+  gateway.beacon->receive(request, BEACON_FRAME_SIZE);
+  run(BEACON_RESEND_WINDOW * 2);
+  TEST_ASSERT_EQUAL(0, gateway.beacon->getStats().resends);
+}
+
+// The beacons stop while another source controls the gateway, and carry on once it hands back, such
+// that a receiver that rebooted meanwhile still gets the sequence
+void test_gateway_beacons_again_after_resume(void) {
+  decode(&gateway, hostMessage());
+  u32_t hash = gateway.scheduler->getHash();
+  run(BEACON_INTERVAL + BEACON_REQUEST_JITTER + BEACON_RESEND_WINDOW + 100);
+  TEST_ASSERT_EQUAL(hash, receiver.scheduler->getHash());
+
+  gateway.scheduler->pause(AnimatorOwner::LIVE_CONTROL);
+  destroy(&receiver);
+  create(&receiver, BeaconRole::RECEIVER, receiverSend);
+  u32_t sent = gateway.beacon->getStats().sent;
+  run(BEACON_INTERVAL * 3);
+  TEST_ASSERT_EQUAL(sent, gateway.beacon->getStats().sent);
+  TEST_ASSERT_EQUAL(0, receiver.beacon->getStats().received);
+
+  TEST_ASSERT_TRUE(gateway.scheduler->resume(AnimatorOwner::LIVE_CONTROL));
+  TEST_ASSERT_EQUAL(hash, gateway.scheduler->getHash());
+  run(BEACON_INTERVAL + BEACON_REQUEST_JITTER + BEACON_RESEND_WINDOW + 100);
+  TEST_ASSERT_GREATER_THAN(sent, gateway.beacon->getStats().sent);
+  TEST_ASSERT_EQUAL(1, receiver.beacon->getStats().requests);
+  TEST_ASSERT_EQUAL(hash, receiver.scheduler->getHash());
+}
+
+void test_receiver_follows_the_position_of_the_gateway(void) {
+  decode(&gateway, hostMessage());
+  decode(&receiver, hostMessage());
+  for (int i = 0; i < 50; i++) gateway.scheduler->update();
+  for (int i = 0; i < 10; i++) receiver.scheduler->update();
+
+  run(BEACON_INTERVAL);
+  TEST_ASSERT_EQUAL(1, receiver.beacon->getStats().synced);
+  TEST_ASSERT_EQUAL(0, receiver.beacon->getStats().requests);
+  TEST_ASSERT_EQUAL(gateway.scheduler->getAnimationIndex(), receiver.scheduler->getAnimationIndex());
+  TEST_ASSERT_EQUAL(gateway.scheduler->getTick(), receiver.scheduler->getTick());
+
+  // Within the tolerance the receiver is left alone
+  for (int i = 0; i < BEACON_TICK_TOLERANCE; i++) gateway.scheduler->update();
+  run(BEACON_INTERVAL);
+  TEST_ASSERT_EQUAL(1, receiver.beacon->getStats().synced);
+  TEST_ASSERT_EQUAL(2, receiver.beacon->getStats().received);
+
+  // A paused receiver does not follow
+  for (int i = 0; i < 20; i++) gateway.scheduler->update();
+  receiver.scheduler->pause(AnimatorOwner::PIXEL_STREAM);
+  run(BEACON_INTERVAL);
+  TEST_ASSERT_EQUAL(1, receiver.beacon->getStats().synced);
+  TEST_ASSERT_NOT_EQUAL(gateway.scheduler->getTick(), receiver.scheduler->getTick());
+}
+
+void test_positions_outside_the_sequence_are_not_followed(void) {
+  decode(&receiver, hostMessage());
+  u32_t hash = receiver.scheduler->getHash();
+  TEST_ASSERT_TRUE(receiver.scheduler->seek(0, 200));
+  TEST_ASSERT_FALSE(receiver.scheduler->seek(0, 201));
+  TEST_ASSERT_FALSE(receiver.scheduler->seek(1, 0));
+  TEST_ASSERT_EQUAL(200, receiver.scheduler->getTick());
+
+  u8_t beacon[BEACON_FRAME_SIZE] = { BEACON_FRAME_MAGIC, BEACON_POSITION, (u8_t)hash, (u8_t)(hash >> 8), (u8_t)(hash >> 16), (u8_t)(hash >> 24), 1, 0, 0, 0 };
+  TEST_ASSERT_TRUE(receiver.beacon->receive(beacon, BEACON_FRAME_SIZE));
+  TEST_ASSERT_EQUAL(1, receiver.beacon->getStats().invalid);
+  TEST_ASSERT_EQUAL(0, receiver.beacon->getStats().synced);
+  TEST_ASSERT_EQUAL(0, receiver.scheduler->getAnimationIndex());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_receiver_gets_the_hash_of_the_gateway);
+  RUN_TEST(test_receiver_keeps_nothing);
+  RUN_TEST(test_kept_sequence_of_another_hash_is_not_resent);
+  RUN_TEST(test_gateway_beacons_again_after_resume);
+  RUN_TEST(test_receiver_follows_the_position_of_the_gateway);
+  RUN_TEST(test_positions_outside_the_sequence_are_not_followed);
+  return UNITY_END();
+}
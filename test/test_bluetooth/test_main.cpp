@@ -0,0 +1,212 @@
+#include <unity.h>
+#include <chrono>
+#include <vector>
+#include "connectivity/bluetooth.h"
+#include "connectivity/serial_reader.h"
+
+// Frames written to the RX characteristic of BluetoothService in BLE-sized writes, with the BLE
+// task played by mock::ble and the main loop by update
+
+#define RX_UUID "b2085082-e29b-4d4e-b868-f782458dec9b"
+#define TX_UUID "b2085082-e29b-4d4e-b868-f782458dec9c"
+
+class BufferStream : public Stream {
+  public:
+  std::vector<uint8_t> data;
+  size_t position = 0;
+
+  size_t write(uint8_t byte) override {
+    data.push_back(byte);
+    return 1;
+  }
+
+  int available() override {
+    return data.size() - position;
+  }
+
+  int read() override {
+    return position < data.size() ? data[position++] : -1;
+  }
+};
+
+static BluetoothService* service = nullptr;
+static std::vector<std::vector<uint8_t>> received;
+
+static void onFrame(const uint8_t* data, size_t length) {
+  received.push_back(std::vector<uint8_t>(data, data + length));
+}
+
+static std::vector<uint8_t> payload(size_t length, uint8_t seed = 0) {
+  std::vector<uint8_t> bytes(length);
+  for (size_t i = 0; i < length; i++) {
+    bytes[i] = (i * 7 + seed) % 5 == 0 ? 0 : (uint8_t)(i + seed);
+  }
+  return bytes;
+}
+
+static std::vector<uint8_t> frame(const std::vector<uint8_t>& bytes) {
+  BufferStream output;
+  FrameEncoder::send(&output, bytes.data(), bytes.size());
+  return output.data;
+}
+
+// Write the bytes in writes of at most `size` bytes, like a client with that MTU payload
+static void write(const std::vector<uint8_t>& bytes, size_t size) {
+  for (size_t offset = 0; offset < bytes.size(); offset += size) {
+    mock::ble.write(RX_UUID, bytes.data() + offset, min(size, bytes.size() - offset));
+  }
+}
+
+void setUp(void) {
+  received.clear();
+  service = new BluetoothService(1024);
+  service->onData(onFrame);
+  mock::ble.connect();
+}
+
+void tearDown(void) {
+  delete service;
+}
+
+void test_frame_in_mtu_sized_writes(void) {
+  write(frame(payload(1000)), BLE_CHUNK_SIZE);
+  TEST_ASSERT_TRUE(received.empty()); // Nothing is decoded in the BLE task
+
+  service->update();
+  TEST_ASSERT_EQUAL(1, received.size());
+  TEST_ASSERT_TRUE(received[0] == payload(1000));
+  TEST_ASSERT_EQUAL(1, service->getFrameStats().frames);
+}
+
+void test_frames_across_write_boundaries(void) {
+  std::vector<uint8_t> stream;
+  for (uint8_t i = 0; i < 6; i++) {
+    std::vector<uint8_t> encoded = frame(payload(100 + i * 37, i));
+    stream.insert(stream.end(), encoded.begin(), encoded.end());
+  }
+
+  write(std::vector<uint8_t>(stream.begin(), stream.begin() + 200), 20); // Before the MTU exchange
+  service->update();
+  write(std::vector<uint8_t>(stream.begin() + 200, stream.end()), 512); // Writes spanning several slots
+  service->update();
+
+  TEST_ASSERT_EQUAL(6, received.size());
+  for (uint8_t i = 0; i < 6; i++) {
+    TEST_ASSERT_TRUE(received[i] == payload(100 + i * 37, i));
+  }
+}
+
+/**
+ * A write that does not fit the queue is dropped whole. The frame it belonged to fails, and the
+ * frames around it arrive.
+ */
+void test_dropped_write_loses_only_its_frame(void) {
+  u32_t dropped = service->getStats().dropped;
+  for (uint8_t i = 0; i < 3; i++) {
+    write(frame(payload(1000, i)), BLE_CHUNK_SIZE); // 5 slots each
+  }
+  write(frame(payload(600, 3)), 512); // The first write needs 3 slots, but only 1 is free
+  TEST_ASSERT_EQUAL(dropped + 1, service->getStats().dropped);
+
+  service->update();
+  write(frame(payload(300, 4)), BLE_CHUNK_SIZE);
+  service->update();
+
+  TEST_ASSERT_EQUAL(4, received.size());
+  TEST_ASSERT_TRUE(received[2] == payload(1000, 2));
+  TEST_ASSERT_TRUE(received[3] == payload(300, 4));
+  FrameStats stats = service->getFrameStats();
+  TEST_ASSERT_EQUAL(1, stats.crcErrors + stats.framingErrors);
+  TEST_ASSERT_EQUAL(4, service->getLinkCounters().received);
+}
+
+void test_disconnect_mid_frame_drops_only_that_frame(void) {
+  int advertising = mock::ble.server()->advertisingStarts;
+  std::vector<uint8_t> cut = frame(payload(600, 1));
+  write(std::vector<uint8_t>(cut.begin(), cut.begin() + 300), BLE_CHUNK_SIZE);
+
+  mock::ble.disconnect();
+  service->update();
+  FrameStats stats = service->getFrameStats();
+  TEST_ASSERT_EQUAL(1, stats.crcErrors + stats.framingErrors); // Dropped before the next client writes
+  TEST_ASSERT_EQUAL(advertising + 1, mock::ble.server()->advertisingStarts);
+
+  // A client that does not start with a delimiter is not joined with the cut off frame either
+  std::vector<uint8_t> next = frame(payload(200, 2));
+  mock::ble.connect();
+  write(std::vector<uint8_t>(next.begin() + 1, next.end()), BLE_CHUNK_SIZE);
+  service->update();
+
+  TEST_ASSERT_EQUAL(1, received.size());
+  TEST_ASSERT_TRUE(received[0] == payload(200, 2));
+}
+
+void test_responses_are_notified_in_mtu_chunks(void) {
+  BLECharacteristic* tx = mock::ble.characteristic(TX_UUID);
+  tx->notifications.clear();
+  mock::ble.connect(103);
+
+  BluetoothStream stream(service);
+  FrameEncoder::send(&stream, payload(700).data(), 700);
+  stream.flush();
+
+  FrameDecoder decoder(1024);
+  decoder.onFrame(onFrame);
+  for (const std::vector<uint8_t>& notification : tx->notifications) {
+    TEST_ASSERT_TRUE(notification.size() <= 100);
+    decoder.push(notification.data(), notification.size());
+  }
+  TEST_ASSERT_EQUAL(1, received.size());
+  TEST_ASSERT_TRUE(received[0] == payload(700));
+  TEST_ASSERT_EQUAL(tx->notifications.size(), service->getLinkCounters().sent);
+}
+
+/**
+ * The same stream through the BLE receive path and through SerialProtocol. Reports the main loop
+ * time of each, as BLE adds a copy of each write into the queue.
+ */
+void test_main_loop_cost_against_serial(void) {
+  const size_t frames = 1000;
+  u32_t dropped = service->getStats().dropped;
+  std::vector<uint8_t> stream;
+  for (size_t i = 0; i < frames; i++) {
+    std::vector<uint8_t> encoded = frame(payload(512, i));
+    stream.insert(stream.end(), encoded.begin(), encoded.end());
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t offset = 0; offset < stream.size(); offset += BLE_CHUNK_SIZE * 8) {
+    size_t end = min(offset + BLE_CHUNK_SIZE * 8, stream.size());
+    write(std::vector<uint8_t>(stream.begin() + offset, stream.begin() + end), BLE_CHUNK_SIZE);
+    service->update();
+  }
+  double bluetooth = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  TEST_ASSERT_EQUAL(frames, received.size());
+  TEST_ASSERT_EQUAL(dropped, service->getStats().dropped);
+
+  received.clear();
+  BufferStream serial;
+  serial.data = stream;
+  SerialProtocol protocol(&serial, 1024);
+  protocol.onData(onFrame);
+
+  start = std::chrono::steady_clock::now();
+  while (serial.available() > 0) protocol.update();
+  double wired = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  TEST_ASSERT_EQUAL(frames, received.size());
+
+  char message[100];
+  snprintf(message, sizeof(message), "Main loop: BLE %.1f ms/MB, serial %.1f ms/MB", bluetooth * 1e9 / stream.size(), wired * 1e9 / stream.size());
+  TEST_MESSAGE(message);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_frame_in_mtu_sized_writes);
+  RUN_TEST(test_frames_across_write_boundaries);
+  RUN_TEST(test_dropped_write_loses_only_its_frame);
+  RUN_TEST(test_disconnect_mid_frame_drops_only_that_frame);
+  RUN_TEST(test_responses_are_notified_in_mtu_chunks);
+  RUN_TEST(test_main_loop_cost_against_serial);
+  return UNITY_END();
+}
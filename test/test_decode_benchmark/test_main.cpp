@@ -0,0 +1,179 @@
+#include <unity.h>
+#include <chrono>
+#include <malloc.h>
+#include <new>
+#include <vector>
+#include "connectivity/serialization/message_decoder.h"
+
+// Decoding of a message of MAX_BUFFER_SIZE bytes, the largest main receives. Its colors are
+// varints rather than palette indexes, the most expensive form of a layer.
+
+#define MAX_BUFFER_SIZE 1028 // See main.cpp
+
+// Heap held while counting is enabled, and the most held at once
+static bool counting = false;
+static size_t heldBytes = 0;
+static size_t peakBytes = 0;
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+  void* pointer = malloc(size);
+  if (pointer == nullptr) throw std::bad_alloc();
+  if (counting) {
+    allocations++;
+    heldBytes += malloc_usable_size(pointer);
+    if (peakBytes < heldBytes) peakBytes = heldBytes;
+  }
+  return pointer;
+}
+
+void operator delete(void* pointer) noexcept {
+  if (counting && pointer != nullptr) heldBytes -= malloc_usable_size(pointer);
+  free(pointer);
+}
+
+void operator delete(void* pointer, size_t size) noexcept {
+  operator delete(pointer);
+}
+
+static void varint(std::vector<u8_t>& out, u32_t value) {
+  do {
+    u8_t byte = value & 0x7F;
+    value >>= 7;
+    out.push_back(value ? byte | 0x80 : byte);
+  } while (value);
+}
+
+static void field(std::vector<u8_t>& out, u32_t tag, const std::vector<u8_t>& content) {
+  varint(out, (tag << 3) | PB_WT_STRING);
+  varint(out, content.size());
+  out.insert(out.end(), content.begin(), content.end());
+}
+
+// An animation of a FadeColor with `count` colors of 3-byte varints
+static std::vector<u8_t> animation(u8_t count) {
+  std::vector<u8_t> colors;
+  for (u8_t i = 0; i < count; i++) varint(colors, 0x400000 + i * 0x010203);
+
+  std::vector<u8_t> layer = { (protocol_Layer_type_tag << 3) | PB_WT_VARINT, protocol_LayerType_FadeColor };
+  varint(layer, (protocol_Layer_duration_tag << 3) | PB_WT_VARINT);
+  varint(layer, 1000);
+  field(layer, protocol_Layer_colors_tag, colors);
+
+  std::vector<u8_t> encoded = { (protocol_Animation_duration_tag << 3) | PB_WT_VARINT, 100 };
+  field(encoded, protocol_Animation_layers_tag, layer);
+  return encoded;
+}
+
+// A sequence message of exactly MAX_BUFFER_SIZE bytes, filled with animations
+static std::vector<u8_t> maximalMessage(size_t* animations) {
+  std::vector<u8_t> sequence;
+  *animations = 0;
+  while (true) {
+    std::vector<u8_t> next = sequence;
+    field(next, protocol_Sequence_animations_tag, animation(32));
+    std::vector<u8_t> message;
+    field(message, protocol_Message_sequence_tag, next);
+    if (MAX_BUFFER_SIZE < message.size()) break;
+    sequence = next;
+    (*animations)++;
+  }
+
+  // Fill the rest with one more animation of fewer colors
+  for (u8_t count = 31; 0 < count; count--) {
+    std::vector<u8_t> next = sequence;
+    field(next, protocol_Sequence_animations_tag, animation(count));
+    std::vector<u8_t> message;
+    field(message, protocol_Message_sequence_tag, next);
+    if (message.size() <= MAX_BUFFER_SIZE) {
+      (*animations)++;
+      return message;
+    }
+  }
+
+  std::vector<u8_t> message;
+  field(message, protocol_Message_sequence_tag, sequence);
+  return message;
+}
+
+static Sequence* received = nullptr;
+
+static void onSequence(Sequence* sequence) {
+  received = sequence;
+}
+
+void setUp(void) {
+  received = nullptr;
+}
+
+void tearDown(void) {
+  Sequence::destroy(received);
+}
+
+void test_maximal_message_is_decoded(void) {
+  size_t animations;
+  std::vector<u8_t> message = maximalMessage(&animations);
+  TEST_ASSERT_GREATER_OR_EQUAL(MAX_BUFFER_SIZE - 4, message.size());
+
+  MessageDecoder decoder;
+  decoder.setOnSequenceReceived(onSequence);
+  TEST_ASSERT_TRUE(decoder.decode(message.data(), message.size()));
+  TEST_ASSERT_NOT_NULL(received);
+  TEST_ASSERT_EQUAL(animations, received->animations.size());
+  TEST_ASSERT_EQUAL(1, received->animations[0]->layers.size());
+}
+
+/**
+ * The colors of a layer are allocated once at their exact size, so the heap held while decoding
+ * is the decoded sequence itself. Everything is released once the sequence is destroyed.
+ */
+void test_peak_heap_of_maximal_message(void) {
+  size_t animations;
+  std::vector<u8_t> message = maximalMessage(&animations);
+  MessageDecoder decoder;
+  decoder.setOnSequenceReceived(onSequence);
+
+  heldBytes = peakBytes = allocations = 0;
+  counting = true;
+  TEST_ASSERT_TRUE(decoder.decode(message.data(), message.size()));
+  size_t sequenceBytes = heldBytes;
+  Sequence::destroy(received);
+  received = nullptr;
+  counting = false;
+
+  TEST_ASSERT_EQUAL(0, heldBytes);
+  TEST_ASSERT_EQUAL(sequenceBytes, peakBytes);
+
+  char report[120];
+  snprintf(report, sizeof(report), "%u byte message: %u animations, %u allocations, peak heap %u bytes",
+           (unsigned)message.size(), (unsigned)animations, (unsigned)allocations, (unsigned)peakBytes);
+  TEST_MESSAGE(report);
+}
+
+void test_decode_time_of_maximal_message(void) {
+  size_t animations;
+  std::vector<u8_t> message = maximalMessage(&animations);
+  MessageDecoder decoder;
+  decoder.setOnSequenceReceived(onSequence);
+  const size_t runs = 5000;
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < runs; i++) {
+    decoder.decode(message.data(), message.size());
+    Sequence::destroy(received);
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  received = nullptr;
+
+  char report[80];
+  snprintf(report, sizeof(report), "Decoded in %.1f us, %.0f messages/s", seconds / runs * 1e6, runs / seconds);
+  TEST_MESSAGE(report);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_maximal_message_is_decoded);
+  RUN_TEST(test_peak_heap_of_maximal_message);
+  RUN_TEST(test_decode_time_of_maximal_message);
+  return UNITY_END();
+}
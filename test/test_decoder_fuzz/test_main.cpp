@@ -0,0 +1,267 @@
+#include <unity.h>
+#include <chrono>
+#include <malloc.h>
+#include <new>
+#include <vector>
+#include "diagnostics/telemetry.h"
+#include "connectivity/serialization/message_decoder.h"
+#include "leds/layers/colors/colors.h"
+#include "leds/layers/masks/masks.h"
+#include "leds/serialization/sequence_encoder.h"
+
+// Decodes mutations of valid messages: flipped bits, overwritten, inserted and removed bytes, and
+// truncations. Whatever the decoder makes of them, everything it allocated must be released once
+// the callbacks have destroyed what they were handed. This is checked with the Telemetry counters
+// of the decoder, scheduler and layers, and with the heap as a whole. Patches are applied to a
+// playing sequence, as they would be by main.
+
+#define MUTATIONS 20000
+#define LEDS 10
+
+// Heap held while counting is enabled
+static bool counting = false;
+static size_t heldBytes = 0;
+
+void* operator new(size_t size) {
+  void* pointer = malloc(size);
+  if (pointer == nullptr) throw std::bad_alloc();
+  if (counting) heldBytes += malloc_usable_size(pointer);
+  return pointer;
+}
+
+void operator delete(void* pointer) noexcept {
+  if (counting && pointer != nullptr) heldBytes -= malloc_usable_size(pointer);
+  free(pointer);
+}
+
+void operator delete(void* pointer, size_t size) noexcept {
+  operator delete(pointer);
+}
+
+static void varint(std::vector<u8_t>& out, u32_t value) {
+  do {
+    u8_t byte = value & 0x7F;
+    value >>= 7;
+    out.push_back(value ? byte | 0x80 : byte);
+  } while (value);
+}
+
+static void field(std::vector<u8_t>& out, u32_t tag, const std::vector<u8_t>& content) {
+  varint(out, (tag << 3) | PB_WT_STRING);
+  varint(out, content.size());
+  out.insert(out.end(), content.begin(), content.end());
+}
+
+// A sequence using most layer types, with repeated colors such that it is encoded with a palette
+static Sequence* make_sequence() {
+  std::vector<CRGB> colors = { CRGB(255, 0, 0), CRGB(0, 255, 0), CRGB(0, 0, 255) };
+  Sequence* sequence = new Sequence();
+  sequence->animations.push_back(new Animation{ { new FadeColor(colors, 1200), new WaveMask(10, 2, 100) }, 400, Direction::FORWARD, 255, 0 });
+  sequence->animations.push_back(new Animation{ { new SectionsColor(colors, 40), new SectionsMask({ 1, 2, 3 }, 30) }, 400, Direction::BACKWARD, 128, 5 });
+  sequence->animations.push_back(new Animation{ { new SwitchColor(colors, 30), new StarsMask(100, 10, 5) }, 400, Direction::FORWARD, 255, 0 });
+  sequence->animations.push_back(new Animation{ { new RainbowColor(100, 20), new PulseMask(5, 50) }, 400, Direction::FORWARD, 255, 0 });
+  return sequence;
+}
+
+static std::vector<u8_t> sequence() {
+  Sequence* sequence = make_sequence();
+  u8_t buffer[512];
+  pb_ostream_t stream = pb_ostream_from_buffer(buffer, sizeof(buffer));
+  TEST_ASSERT_TRUE(SequenceEncoder::encode(&stream, sequence));
+  Sequence::destroy(sequence);
+  return std::vector<u8_t>(buffer, buffer + stream.bytes_written);
+}
+
+// One valid message of every type the decoder handles
+static std::vector<std::vector<u8_t>> corpus() {
+  std::vector<std::vector<u8_t>> messages;
+  std::vector<u8_t> encoded = sequence();
+
+  std::vector<u8_t> message;
+  field(message, protocol_Message_sequence_tag, encoded);
+  messages.push_back(message);
+
+  // Broadcasts with packed and unpacked groups, on either side of the sequence
+  std::vector<u8_t> groups;
+  for (u32_t group = 1; group <= 40; group += 3) varint(groups, group);
+  std::vector<u8_t> wrapped;
+  field(wrapped, protocol_BroadcastSequence_target_groups_tag, groups);
+  field(wrapped, protocol_BroadcastSequence_sequence_tag, encoded);
+  message.clear();
+  field(message, protocol_Message_broadcast_sequence_tag, wrapped);
+  messages.push_back(message);
+
+  wrapped.clear();
+  field(wrapped, protocol_BroadcastSequence_sequence_tag, encoded);
+  for (u32_t group = 1; group <= 4; group++) {
+    varint(wrapped, (protocol_BroadcastSequence_target_groups_tag << 3) | PB_WT_VARINT);
+    varint(wrapped, group);
+  }
+  message.clear();
+  field(message, protocol_Message_broadcast_sequence_tag, wrapped);
+  messages.push_back(message);
+
+  std::vector<u8_t> settings = { (protocol_Settings_group_id_tag << 3) | PB_WT_VARINT, 1, (protocol_Settings_virtual_offset_tag << 3) | PB_WT_VARINT, 20 };
+  wrapped.clear();
+  field(wrapped, protocol_State_sequence_tag, encoded);
+  field(wrapped, protocol_State_settings_tag, settings);
+  message.clear();
+  field(message, protocol_Message_save_state_tag, wrapped);
+  messages.push_back(message);
+
+  std::vector<u8_t> patch = {
+    (protocol_Patch_animation_tag << 3) | PB_WT_VARINT, 1,
+    (protocol_Patch_field_tag << 3) | PB_WT_VARINT, protocol_LayerField_DurationField,
+    (protocol_Patch_value_tag << 3) | PB_WT_VARINT, 100,
+  };
+  message.clear();
+  field(message, protocol_Message_patch_tag, patch);
+  messages.push_back(message);
+
+  messages.push_back({ (protocol_Message_request_state_tag << 3) | PB_WT_VARINT, 1 });
+  return messages;
+}
+
+// Deterministic, such that a failure can be reproduced
+static uint32_t state = 0x12345678;
+
+static u32_t next_random(u32_t limit) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state % limit;
+}
+
+static std::vector<u8_t> mutate(std::vector<u8_t> message) {
+  u32_t mutations = 1 + next_random(4);
+  for (u32_t i = 0; i < mutations && !message.empty(); i++) {
+    size_t position = next_random(message.size());
+    switch (next_random(6)) {
+      case 0: message[position] ^= 1 << next_random(8); break;
+      case 1: message[position] = next_random(256); break;
+      case 2: message.insert(message.begin() + position, next_random(256)); break;
+      case 3: message.erase(message.begin() + position); break;
+      case 4: message.resize(position); break;
+      case 5: message[position] = 0xFF; break; // Runaway varints and lengths
+    }
+  }
+  return message;
+}
+
+static void onSequence(Sequence* sequence) {
+  Sequence::destroy(sequence);
+}
+
+static void onBroadcast(Sequence* sequence, std::vector<uint32_t>* groups) {
+  Sequence::destroy(sequence);
+}
+
+static void onSaveState(Sequence* sequence, protocol_Settings* settings) {
+  Sequence::destroy(sequence);
+}
+
+static void onRequestState() {}
+
+static MessageDecoder* decoder = nullptr;
+static CRGB leds[LEDS];
+static Animator* animator = nullptr;
+static SequenceScheduler* scheduler = nullptr;
+
+static void onPatch(protocol_Patch* patch) {
+  scheduler->patch(patch->animation, patch->layer, patch->field, patch->index, patch->value);
+}
+
+void setUp(void) {
+  animator = new Animator(leds, LEDS);
+  scheduler = new SequenceScheduler(animator);
+  scheduler->set(make_sequence()); // The target of the patches
+
+  decoder = new MessageDecoder();
+  decoder->setGroup(1);
+  decoder->setOnSequenceReceived(onSequence);
+  decoder->setOnBroadcastSequenceReceived(onBroadcast);
+  decoder->setOnSaveStateReceived(onSaveState);
+  decoder->setOnRequestState(onRequestState);
+  decoder->setOnPatchReceived(onPatch);
+}
+
+void tearDown(void) {
+  delete decoder;
+  scheduler->clear();
+  delete scheduler;
+  delete animator;
+}
+
+static u32_t liveBytes(Subsystem subsystem) {
+  return Telemetry::getAllocationStats(subsystem).liveBytes;
+}
+
+void test_corpus_is_decoded(void) {
+  for (const std::vector<u8_t>& message : corpus()) {
+    TEST_ASSERT_TRUE(decoder->decode(message.data(), message.size()));
+  }
+}
+
+void test_mutated_messages_release_everything(void) {
+  std::vector<std::vector<u8_t>> messages = corpus();
+  u32_t decoder = liveBytes(Subsystem::DECODER);
+  u32_t scheduler = liveBytes(Subsystem::SCHEDULER);
+  u32_t layers = liveBytes(Subsystem::LAYERS);
+  u32_t failures = 0;
+
+  for (u32_t i = 0; i < MUTATIONS; i++) {
+    std::vector<u8_t> message = mutate(messages[i % messages.size()]);
+
+    heldBytes = 0;
+    counting = true;
+    bool success = ::decoder->decode(message.data(), message.size());
+    counting = false;
+    if (!success) failures++;
+
+    TEST_ASSERT_EQUAL_MESSAGE(0, heldBytes, "Heap held after decoding");
+    TEST_ASSERT_EQUAL(decoder, liveBytes(Subsystem::DECODER));
+    TEST_ASSERT_EQUAL(scheduler, liveBytes(Subsystem::SCHEDULER));
+    TEST_ASSERT_EQUAL(layers, liveBytes(Subsystem::LAYERS));
+  }
+
+  // Both the failure paths and the callbacks were taken
+  TEST_ASSERT_GREATER_THAN(MUTATIONS / 10, failures);
+  TEST_ASSERT_LESS_THAN(MUTATIONS, failures);
+
+  char report[80];
+  snprintf(report, sizeof(report), "%u of %u mutated messages failed to decode", (unsigned)failures, MUTATIONS);
+  TEST_MESSAGE(report);
+}
+
+void test_decode_throughput(void) {
+  std::vector<std::vector<u8_t>> messages = corpus();
+  std::vector<std::vector<u8_t>> mutated;
+  for (u32_t i = 0; i < MUTATIONS; i++) mutated.push_back(mutate(messages[i % messages.size()]));
+  const size_t runs = 20000;
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < runs; i++) {
+    const std::vector<u8_t>& message = messages[i % messages.size()];
+    decoder->decode(message.data(), message.size());
+  }
+  double valid = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < runs; i++) {
+    const std::vector<u8_t>& message = mutated[i % mutated.size()];
+    decoder->decode(message.data(), message.size());
+  }
+  double invalid = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  char report[100];
+  snprintf(report, sizeof(report), "Valid: %.0f messages/s, mutated: %.0f messages/s", runs / valid, runs / invalid);
+  TEST_MESSAGE(report);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_corpus_is_decoded);
+  RUN_TEST(test_mutated_messages_release_everything);
+  RUN_TEST(test_decode_throughput);
+  return UNITY_END();
+}
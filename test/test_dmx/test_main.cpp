@@ -0,0 +1,407 @@
+#include <unity.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "dmx/dmx.h"
+#include "leds/layers/colors/colors.h"
+
+// UART event streams, as the DMX receive task gets them from the driver, fed to the receive state
+// machine with errors injected. Each frame starts with a break, and its bytes arrive in chunks of
+// the UART receive threshold.
+
+#define CHUNK 120
+#define RACE_FRAMES 400000
+
+struct Event {
+  uart_event_type_t type;
+  std::vector<u8_t> data;
+};
+
+struct DMXTest {
+  static void reset() {
+    DMX::dmx_state = DMX_IDLE;
+    DMX::current_rx_addr = 0;
+    memset(DMX::dmx_frames, 0, sizeof(DMX::dmx_frames));
+    DMX::dmx_frame_count = 0;
+    DMX::dmx_frame_length = 0;
+    DMX::dmx_pending_length = 0;
+    DMX::dmx_pending_frames = 0;
+    DMX::dmx_agreement = 1;
+    memset(DMX::dmx_candidate_frames, 0, sizeof(DMX::dmx_candidate_frames));
+    DMX::dmx_stats = {};
+  }
+
+  static void play(const std::vector<Event>& events) {
+    for (const Event& event : events) {
+      DMX::receive_event(event.type, event.data.data(), event.data.size());
+    }
+  }
+};
+
+// The start code and `count` channels, channel i set to i + seed
+static std::vector<u8_t> frame(size_t count, u8_t seed = 0) {
+  std::vector<u8_t> bytes(count + 1, 0);
+  for (size_t i = 1; i <= count; i++) bytes[i] = i + seed;
+  return bytes;
+}
+
+// The events of a frame: its break, and its bytes in chunks
+static void record(std::vector<Event>& events, const std::vector<u8_t>& bytes) {
+  events.push_back({ UART_BREAK, {} });
+  for (size_t offset = 0; offset < bytes.size(); offset += CHUNK) {
+    size_t end = min(offset + CHUNK, bytes.size());
+    events.push_back({ UART_DATA, std::vector<u8_t>(bytes.begin() + offset, bytes.begin() + end) });
+  }
+}
+
+// The break after the last frame, which ends it
+static void recordBreak(std::vector<Event>& events) {
+  events.push_back({ UART_BREAK, {} });
+}
+
+static u8_t channel(uint16_t number) {
+  u8_t value;
+  DMX::ReadAll(&value, number, 1);
+  return value;
+}
+
+void setUp(void) {
+  DMXTest::reset();
+}
+
+void tearDown(void) {}
+
+void test_frame_is_published_once_its_length_repeats(void) {
+  std::vector<Event> events;
+  record(events, frame(24));
+  record(events, frame(24));
+  recordBreak(events);
+  DMXTest::play(events);
+
+  TEST_ASSERT_EQUAL(1, DMX::FrameCount());
+  TEST_ASSERT_EQUAL(1, DMX::GetStats().lengthMismatches);
+  u8_t channels[24];
+  DMX::ReadAll(channels, 1, 24);
+  for (u8_t i = 0; i < 24; i++) TEST_ASSERT_EQUAL(i + 1, channels[i]);
+}
+
+void test_full_frame_is_published_without_waiting_for_break(void) {
+  std::vector<Event> events;
+  record(events, frame(512, 1));
+  record(events, frame(512, 2));
+  DMXTest::play(events);
+
+  TEST_ASSERT_EQUAL(1, DMX::FrameCount());
+  TEST_ASSERT_EQUAL(3, channel(1));
+  TEST_ASSERT_EQUAL((u8_t)(512 + 2), channel(512));
+}
+
+void test_errors_drop_only_their_frame(void) {
+  const uart_event_type_t errors[] = { UART_FRAME_ERR, UART_PARITY_ERR, UART_FIFO_OVF, UART_BUFFER_FULL };
+  std::vector<Event> events;
+  record(events, frame(200, 0));
+  record(events, frame(200, 0));
+  for (u8_t i = 0; i < 4; i++) {
+    // The error arrives after the first chunk, the rest of the frame is flushed by the driver
+    events.push_back({ UART_BREAK, {} });
+    events.push_back({ UART_DATA, std::vector<u8_t>(CHUNK, 0xEE) });
+    events.back().data[0] = 0;
+    events.push_back({ errors[i], {} });
+  }
+  record(events, frame(200, 5));
+  recordBreak(events);
+  DMXTest::play(events);
+
+  DMXStats stats = DMX::GetStats();
+  TEST_ASSERT_EQUAL(1, stats.framingErrors);
+  TEST_ASSERT_EQUAL(1, stats.parityErrors);
+  TEST_ASSERT_EQUAL(2, stats.overflows);
+  TEST_ASSERT_EQUAL(4, stats.dropped);
+  TEST_ASSERT_EQUAL(2, DMX::FrameCount());
+  TEST_ASSERT_EQUAL(6, channel(1));
+  TEST_ASSERT_EQUAL(205, channel(200));
+}
+
+// The break is a byte without stop bit, which the driver may also report as a framing error
+void test_framing_error_of_break_is_ignored(void) {
+  std::vector<Event> events;
+  for (u8_t i = 0; i < 2; i++) {
+    events.push_back({ UART_BREAK, {} });
+    events.push_back({ UART_FRAME_ERR, {} });
+    events.push_back({ UART_DATA, frame(16) });
+  }
+  recordBreak(events);
+  DMXTest::play(events);
+
+  TEST_ASSERT_EQUAL(0, DMX::GetStats().framingErrors);
+  TEST_ASSERT_EQUAL(1, DMX::FrameCount());
+}
+
+void test_alternate_start_codes_are_ignored(void) {
+  std::vector<Event> events;
+  record(events, frame(16));
+  record(events, frame(16));
+  std::vector<u8_t> rdm = frame(16, 9);
+  rdm[0] = 0xCC;
+  record(events, rdm);
+  recordBreak(events);
+  DMXTest::play(events);
+
+  TEST_ASSERT_EQUAL(1, DMX::GetStats().alternateStartCodes);
+  TEST_ASSERT_EQUAL(1, DMX::FrameCount());
+  TEST_ASSERT_EQUAL(1, channel(1));
+}
+
+/**
+ * Noise that looks like a break cuts a frame short. The short frame is dropped, but a sender that
+ * really sends fewer channels is followed after DMX_LENGTH_FRAMES frames.
+ */
+void test_frame_cut_short_is_dropped(void) {
+  std::vector<Event> events;
+  record(events, frame(100, 0));
+  record(events, frame(100, 0));
+  std::vector<u8_t> cut = frame(100, 1);
+  cut.resize(41);
+  record(events, cut);
+  record(events, frame(100, 2));
+  recordBreak(events);
+  DMXTest::play(events);
+
+  TEST_ASSERT_EQUAL(2, DMX::FrameCount());
+  TEST_ASSERT_EQUAL(2, DMX::GetStats().lengthMismatches);
+  TEST_ASSERT_EQUAL(3, channel(1));
+
+  events.clear();
+  record(events, frame(40, 3));
+  record(events, frame(40, 3));
+  recordBreak(events);
+  DMXTest::play(events);
+  TEST_ASSERT_EQUAL(3, DMX::FrameCount());
+  TEST_ASSERT_EQUAL(4, channel(1));
+  TEST_ASSERT_EQUAL(102, channel(100)); // Channels after a short frame keep their values
+}
+
+void test_frames_without_channels_are_dropped(void) {
+  std::vector<Event> events;
+  for (u8_t i = 0; i < 3; i++) {
+    events.push_back({ UART_BREAK, {} });
+    events.push_back({ UART_DATA, { 0 } });
+  }
+  recordBreak(events);
+  DMXTest::play(events);
+
+  TEST_ASSERT_EQUAL(3, DMX::GetStats().shortFrames);
+  TEST_ASSERT_EQUAL(0, DMX::FrameCount());
+}
+
+void test_changes_are_held_until_frames_agree(void) {
+  std::vector<Event> events;
+  record(events, frame(16));
+  record(events, frame(16));
+  recordBreak(events);
+  DMXTest::play(events);
+
+  DMX::SetAgreement(3);
+  events.clear();
+  std::vector<u8_t> glitch = frame(16);
+  glitch[5] = 0xFF;
+  record(events, glitch);
+  record(events, frame(16));
+
+  std::vector<u8_t> changed = frame(16);
+  changed[5] = 0x80;
+  for (u8_t i = 0; i < 3; i++) record(events, changed);
+  recordBreak(events);
+
+  DMXTest::play(events);
+  TEST_ASSERT_EQUAL(6, DMX::FrameCount());
+  TEST_ASSERT_EQUAL(0x80, channel(5));
+  TEST_ASSERT_EQUAL(3, DMX::GetStats().unconfirmed); // The glitch, and the first 2 frames of the change
+}
+
+/**
+ * Frames that pass the receive checks may still describe masks that cannot be rendered, e.g.
+ * sections without a section. They are not applied, and the LEDs keep rendering.
+ */
+void test_invalid_masks_are_not_applied(void) {
+  CRGB leds[20];
+  Animator animator(leds, 20);
+  SequenceScheduler sequenceScheduler(&animator);
+  ReadDMXProcess process(&animator, &sequenceScheduler);
+  memset(prevChannels, 0, sizeof(prevChannels));
+
+  std::vector<u8_t> channels(16, 0);
+  channels[1] = 255; // Dimmer
+  channels[2] = 200; // Red
+  channels[8] = 4;   // SectionsMask
+  channels[9] = 1;   // of a single section, which is lit
+  channels[10] = 10;
+  std::vector<Event> events;
+  record(events, channels);
+  record(events, channels);
+  recordBreak(events);
+  DMXTest::play(events);
+  process.update();
+  animator.update();
+  TEST_ASSERT_EQUAL(200, leds[0].r);
+
+  channels[4] = 100; // Blue
+  channels[9] = 0;   // Sections without a section
+  events.clear();
+  record(events, channels);
+  recordBreak(events);
+  DMXTest::play(events);
+  process.update();
+  animator.update();
+  TEST_ASSERT_EQUAL(200, leds[0].r);
+  TEST_ASSERT_EQUAL(100, leds[0].b);
+
+  channels[9] = 2; // Two sections, the first one lit
+  events.clear();
+  record(events, channels);
+  recordBreak(events);
+  DMXTest::play(events);
+  process.update();
+  animator.update();
+  TEST_ASSERT_EQUAL(200, leds[0].r);
+  TEST_ASSERT_EQUAL(0, leds[19].r);
+}
+
+// A frame of two zones, the first one red and the second one blue
+static void playZones(bool first = false) {
+  std::vector<u8_t> channels(1 + 2 * DMX_ZONE_CHANNELS, 0);
+  channels[1] = 255; // Dimmer
+  channels[2] = 255;
+  channels[1 + DMX_ZONE_CHANNELS] = 255;
+  channels[4 + DMX_ZONE_CHANNELS] = 255;
+  std::vector<Event> events;
+  if (first) record(events, channels); // Published once its length repeats
+  record(events, channels);
+  recordBreak(events);
+  DMXTest::play(events);
+}
+
+/**
+ * The zones take the animator over from the sequence on every frame after it had it back, and
+ * leave live control alone until it hands the animator back.
+ */
+void test_zones_take_animator_over_from_sequence(void) {
+  CRGB leds[20];
+  Animator animator(leds, 20);
+  SequenceScheduler sequenceScheduler(&animator);
+  // Kept, like the process of the firmware, which never frees its zones
+  static ReadDMXProcess* process = new ReadDMXProcess(&animator, &sequenceScheduler, 2);
+  sequenceScheduler.add({ new SingleColor(CRGB(1, 2, 3)) }, 1000);
+  sequenceScheduler.update();
+
+  playZones(true);
+  process->update();
+  sequenceScheduler.update();
+  animator.update();
+  TEST_ASSERT_EQUAL(AnimatorOwner::DMX_INPUT, sequenceScheduler.getOwner());
+  TEST_ASSERT_TRUE(leds[0] == CRGB(255, 0, 0));
+  TEST_ASSERT_TRUE(leds[19] == CRGB(0, 0, 255));
+
+  // Live control takes over after the DMX input timed out, and keeps the animator
+  delay(DMX_INPUT_TIMEOUT);
+  process->update();
+  TEST_ASSERT_EQUAL(AnimatorOwner::SEQUENCE, sequenceScheduler.getOwner());
+  sequenceScheduler.update();
+  sequenceScheduler.pause(AnimatorOwner::LIVE_CONTROL);
+  playZones();
+  process->update();
+  animator.update();
+  TEST_ASSERT_EQUAL(AnimatorOwner::LIVE_CONTROL, sequenceScheduler.getOwner());
+  TEST_ASSERT_TRUE(leds[0] == CRGB(1, 2, 3));
+
+  // The sequence moves on once live control hands the animator back, and the next frame takes it over again
+  sequenceScheduler.resume(AnimatorOwner::LIVE_CONTROL);
+  sequenceScheduler.update();
+  playZones();
+  process->update();
+  sequenceScheduler.update();
+  animator.update();
+  TEST_ASSERT_EQUAL(AnimatorOwner::DMX_INPUT, sequenceScheduler.getOwner());
+  TEST_ASSERT_TRUE(leds[0] == CRGB(255, 0, 0));
+
+  // Frames keep the animator, and the sequence resumes once they stop
+  delay(DMX_INPUT_TIMEOUT - 1);
+  playZones();
+  process->update();
+  delay(DMX_INPUT_TIMEOUT - 1);
+  process->update();
+  TEST_ASSERT_EQUAL(AnimatorOwner::DMX_INPUT, sequenceScheduler.getOwner());
+  delay(1);
+  process->update();
+  sequenceScheduler.update();
+  animator.update();
+  TEST_ASSERT_EQUAL(AnimatorOwner::SEQUENCE, sequenceScheduler.getOwner());
+  TEST_ASSERT_TRUE(leds[0] == CRGB(1, 2, 3));
+  sequenceScheduler.clear();
+}
+
+/**
+ * The receive task and a reader such as ReadDMXProcess on two threads. The channels of each frame
+ * follow from its first channel, so a snapshot of two frames shows up as channels that do not. The
+ * frame being received may be written while the reader copies it, as the reader notices the frame
+ * was published meanwhile and copies again. ThreadSanitizer reports these discarded copies as races.
+ * Even on a single CPU, a reader without the retry is caught within RACE_FRAMES.
+ */
+void test_snapshots_hold_a_single_frame(void) {
+  // Recorded up front, such that the writer thread only runs the receive state machine
+  std::vector<std::vector<Event>> frames(256);
+  for (int seed = 0; seed < 256; seed++) record(frames[seed], frame(512, seed));
+
+  std::atomic<bool> done{ false };
+  std::thread writer([&]() {
+    for (u32_t i = 0; i < RACE_FRAMES; i++) DMXTest::play(frames[i % frames.size()]);
+    done = true;
+  });
+
+  u32_t snapshots = 0;
+  u32_t torn = 0;
+  u32_t backwards = 0;
+  uint32_t previous = 0;
+  u8_t channels[512];
+  while (!done) {
+    uint32_t count = DMX::ReadAll(channels, 1, sizeof(channels));
+    if (count < previous) backwards++;
+    previous = count;
+    if (count == 0) continue; // Nothing published yet
+
+    snapshots++;
+    u8_t seed = channels[0] - 1;
+    for (int i = 1; i < 512; i++) {
+      if (channels[i] != (u8_t)(i + 1 + seed)) {
+        torn++;
+        break;
+      }
+    }
+  }
+  writer.join();
+
+  TEST_ASSERT_EQUAL(0, torn);
+  TEST_ASSERT_EQUAL(0, backwards);
+  TEST_ASSERT_GREATER_THAN(0, snapshots);
+  TEST_ASSERT_EQUAL(RACE_FRAMES - 1, DMX::FrameCount()); // The first frame waits for its length to repeat
+
+  char report[80];
+  snprintf(report, sizeof(report), "%u snapshots of %u frames", (unsigned)snapshots, RACE_FRAMES - 1);
+  TEST_MESSAGE(report);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_frame_is_published_once_its_length_repeats);
+  RUN_TEST(test_full_frame_is_published_without_waiting_for_break);
+  RUN_TEST(test_errors_drop_only_their_frame);
+  RUN_TEST(test_framing_error_of_break_is_ignored);
+  RUN_TEST(test_alternate_start_codes_are_ignored);
+  RUN_TEST(test_frame_cut_short_is_dropped);
+  RUN_TEST(test_frames_without_channels_are_dropped);
+  RUN_TEST(test_changes_are_held_until_frames_agree);
+  RUN_TEST(test_invalid_masks_are_not_applied);
+  RUN_TEST(test_zones_take_animator_over_from_sequence);
+  RUN_TEST(test_snapshots_hold_a_single_frame);
+  return UNITY_END();
+}
@@ -0,0 +1,240 @@
+#include <unity.h>
+#include <algorithm>
+#include <vector>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "dmx/dmx_network.h"
+#include "leds/layers/colors/colors.h"
+
+// Art-Net packets are sent from a local UDP socket to the port DMXNetwork listens on. The UDP task
+// is run by mock::deliverUdp, and the main loop by update.
+
+#define LEDS 200 // The second universe is only partly on the strip
+
+static CRGB leds[LEDS];
+static Animator* animator = nullptr;
+static SequenceScheduler* sequenceScheduler = nullptr;
+static PixelStream* pixelStream = nullptr;
+static DMXNetwork* network = nullptr;
+static int sender = -1;
+
+static std::vector<u8_t> artnet(u16_t universe, u8_t sequence, const std::vector<u8_t>& channels) {
+  std::vector<u8_t> packet = { 'A', 'r', 't', '-', 'N', 'e', 't', 0, 0x00, 0x50, 0, 14, sequence, 0 };
+  packet.push_back(universe & 0xFF);
+  packet.push_back(universe >> 8);
+  packet.push_back(channels.size() >> 8);
+  packet.push_back(channels.size() & 0xFF);
+  packet.insert(packet.end(), channels.begin(), channels.end());
+  return packet;
+}
+
+static std::vector<u8_t> e131(u16_t universe, u8_t sequence, const std::vector<u8_t>& channels) {
+  std::vector<u8_t> packet(126, 0);
+  const u8_t id[] = { 'A', 'S', 'C', '-', 'E', '1', '.', '1', '7' };
+  packet[1] = 0x10;
+  memcpy(packet.data() + 4, id, sizeof(id));
+  packet[21] = 0x04;
+  packet[43] = 0x02;
+  packet[111] = sequence;
+  packet[113] = universe >> 8;
+  packet[114] = universe & 0xFF;
+  packet[117] = 0x02;
+  packet[118] = 0xA1;
+  packet[123] = (channels.size() + 1) >> 8;
+  packet[124] = (channels.size() + 1) & 0xFF;
+  packet.insert(packet.end(), channels.begin(), channels.end());
+  return packet;
+}
+
+// A universe of DMX_UNIVERSE_PIXELS pixels of one colour
+static std::vector<u8_t> universeOf(CRGB color) {
+  std::vector<u8_t> channels;
+  for (size_t i = 0; i < DMX_UNIVERSE_PIXELS; i++) {
+    channels.insert(channels.end(), { color.r, color.g, color.b });
+  }
+  return channels;
+}
+
+static void send(const std::vector<u8_t>& packet) {
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(ARTNET_PORT);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  TEST_ASSERT_EQUAL(packet.size(), sendto(sender, packet.data(), packet.size(), 0, (sockaddr*)&address, sizeof(address)));
+}
+
+// Send a universe, and run the UDP task once it has arrived
+static void sendUniverse(u16_t universe, u8_t sequence, CRGB color) {
+  send(artnet(universe, sequence, universeOf(color)));
+  usleep(1000);
+  mock::deliverUdp();
+}
+
+static void assertRange(size_t first, size_t count, CRGB color) {
+  for (size_t i = first; i < first + count; i++) {
+    TEST_ASSERT_TRUE(leds[i] == color);
+  }
+}
+
+void setUp(void) {
+  mock::now = 0;
+  std::fill(leds, leds + LEDS, CRGB::Black);
+  animator = new Animator(leds, LEDS);
+  sequenceScheduler = new SequenceScheduler(animator);
+  pixelStream = new PixelStream(animator, sequenceScheduler);
+  network = new DMXNetwork(pixelStream, animator, 1, 2);
+  TEST_ASSERT_TRUE(network->begin());
+  sender = socket(AF_INET, SOCK_DGRAM, 0);
+}
+
+void tearDown(void) {
+  close(sender);
+  delete network;
+  delete pixelStream;
+  sequenceScheduler->clear();
+  delete sequenceScheduler;
+  delete animator;
+}
+
+void test_frame_is_written_to_leds_by_update(void) {
+  unsigned long shown = FastLED.shown;
+  sendUniverse(1, 1, CRGB(255, 0, 0));
+  sendUniverse(2, 1, CRGB(0, 255, 0));
+
+  // The UDP task never writes the LEDs
+  assertRange(0, LEDS, CRGB(0, 0, 0));
+  TEST_ASSERT_EQUAL(shown, FastLED.shown);
+
+  network->update();
+  assertRange(0, DMX_UNIVERSE_PIXELS, CRGB(255, 0, 0));
+  assertRange(DMX_UNIVERSE_PIXELS, LEDS - DMX_UNIVERSE_PIXELS, CRGB(0, 255, 0));
+  TEST_ASSERT_EQUAL(shown + 1, FastLED.shown);
+  TEST_ASSERT_EQUAL(1, network->getStats().frames);
+  TEST_ASSERT_EQUAL(2, network->getStats().packets);
+  TEST_ASSERT_TRUE(animator->isStreaming());
+}
+
+void test_next_frame_does_not_overwrite_complete_frame(void) {
+  sendUniverse(1, 1, CRGB(255, 0, 0));
+  sendUniverse(2, 1, CRGB(255, 0, 0));
+  sendUniverse(1, 2, CRGB(0, 0, 255));
+
+  network->update();
+  assertRange(0, LEDS, CRGB(255, 0, 0));
+
+  sendUniverse(2, 2, CRGB(0, 0, 255));
+  network->update();
+  assertRange(0, LEDS, CRGB(0, 0, 255));
+  TEST_ASSERT_EQUAL(2, network->getStats().frames);
+}
+
+void test_frame_not_shown_in_time_is_skipped(void) {
+  sendUniverse(1, 1, CRGB(255, 0, 0));
+  sendUniverse(2, 1, CRGB(255, 0, 0));
+  sendUniverse(1, 2, CRGB(0, 0, 255));
+  sendUniverse(2, 2, CRGB(0, 0, 255));
+
+  network->update();
+  assertRange(0, LEDS, CRGB(0, 0, 255));
+  TEST_ASSERT_EQUAL(1, network->getStats().frames);
+  TEST_ASSERT_EQUAL(1, network->getStats().skipped);
+}
+
+void test_incomplete_frame_is_shown_after_wait(void) {
+  sendUniverse(1, 1, CRGB(255, 0, 0));
+
+  network->update();
+  assertRange(0, LEDS, CRGB(0, 0, 0));
+
+  delay(DMX_PIXEL_FRAME_WAIT);
+  network->update();
+  assertRange(0, DMX_UNIVERSE_PIXELS, CRGB(255, 0, 0));
+  assertRange(DMX_UNIVERSE_PIXELS, LEDS - DMX_UNIVERSE_PIXELS, CRGB(0, 0, 0));
+}
+
+// A universe that arrives again starts the next frame, so the frame before it is complete
+void test_repeated_universe_completes_frame(void) {
+  sendUniverse(1, 1, CRGB(255, 0, 0));
+  sendUniverse(1, 2, CRGB(0, 0, 255));
+
+  network->update();
+  assertRange(0, DMX_UNIVERSE_PIXELS, CRGB(255, 0, 0));
+
+  delay(DMX_PIXEL_FRAME_WAIT);
+  network->update();
+  assertRange(0, DMX_UNIVERSE_PIXELS, CRGB(0, 0, 255));
+}
+
+void test_layers_are_not_rendered_over_frame(void) {
+  sequenceScheduler->add({ new SingleColor(CRGB(1, 2, 3)) }, 1000);
+  sequenceScheduler->update();
+  animator->update();
+  TEST_ASSERT_TRUE(leds[0] == CRGB(1, 2, 3));
+
+  sendUniverse(1, 1, CRGB(255, 0, 0));
+  sendUniverse(2, 1, CRGB(255, 0, 0));
+  network->update();
+  sequenceScheduler->update();
+  animator->update();
+  assertRange(0, LEDS, CRGB(255, 0, 0));
+}
+
+void test_packets_for_other_universes_are_filtered(void) {
+  sendUniverse(3, 1, CRGB(255, 0, 0));
+  send({ 'n', 'o', 't', ' ', 'd', 'm', 'x' });
+  usleep(1000);
+  mock::deliverUdp();
+
+  delay(DMX_PIXEL_FRAME_WAIT);
+  network->update();
+  assertRange(0, LEDS, CRGB(0, 0, 0));
+  TEST_ASSERT_EQUAL(1, network->getStats().filtered);
+  TEST_ASSERT_EQUAL(1, network->getStats().invalid);
+}
+
+void test_late_packets_are_dropped(void) {
+  sendUniverse(1, 10, CRGB(255, 0, 0));
+  sendUniverse(1, 9, CRGB(0, 0, 255));
+
+  TEST_ASSERT_EQUAL(1, network->getStats().outOfOrder);
+  delay(DMX_PIXEL_FRAME_WAIT);
+  network->update();
+  assertRange(0, DMX_UNIVERSE_PIXELS, CRGB(255, 0, 0));
+}
+
+// Multicast is not received on the host, so the sACN packets are passed in as the UDP task would
+void test_sacn_frame_is_shown(void) {
+  std::vector<u8_t> first = e131(1, 1, universeOf(CRGB(0, 255, 0)));
+  std::vector<u8_t> second = e131(2, 1, universeOf(CRGB(0, 255, 0)));
+  network->receive(first.data(), first.size(), true);
+  network->receive(second.data(), second.size(), true);
+
+  network->update();
+  assertRange(0, LEDS, CRGB(0, 255, 0));
+}
+
+void test_truncated_packets_are_invalid(void) {
+  std::vector<u8_t> packet = artnet(1, 1, universeOf(CRGB(255, 0, 0)));
+  network->receive(packet.data(), packet.size() - 1, false);
+  packet = e131(1, 1, universeOf(CRGB(255, 0, 0)));
+  network->receive(packet.data(), packet.size() - 1, true);
+
+  TEST_ASSERT_EQUAL(2, network->getStats().invalid);
+  TEST_ASSERT_EQUAL(0, network->getStats().packets);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_frame_is_written_to_leds_by_update);
+  RUN_TEST(test_next_frame_does_not_overwrite_complete_frame);
+  RUN_TEST(test_frame_not_shown_in_time_is_skipped);
+  RUN_TEST(test_incomplete_frame_is_shown_after_wait);
+  RUN_TEST(test_repeated_universe_completes_frame);
+  RUN_TEST(test_layers_are_not_rendered_over_frame);
+  RUN_TEST(test_packets_for_other_universes_are_filtered);
+  RUN_TEST(test_late_packets_are_dropped);
+  RUN_TEST(test_sacn_frame_is_shown);
+  RUN_TEST(test_truncated_packets_are_invalid);
+  return UNITY_END();
+}
@@ -0,0 +1,159 @@
+#include <unity.h>
+#include <vector>
+#include "connectivity/espnow.h"
+
+// Loopback of ESPNetwork through the ESP-NOW mock: sent packets are delivered back to the same
+// network, and the tests decide when and how the send callbacks arrive
+
+static ESPNetwork* network = nullptr;
+static std::vector<std::vector<uint8_t>> received;
+static const uint8_t peer[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+static void onData(const uint8_t* data, size_t length) {
+  received.push_back(std::vector<uint8_t>(data, data + length));
+}
+
+static std::vector<uint8_t> message(size_t length, uint8_t seed = 0) {
+  std::vector<uint8_t> bytes(length);
+  for (size_t i = 0; i < length; i++) bytes[i] = (uint8_t)(i * 13 + seed);
+  return bytes;
+}
+
+static bool write(std::vector<uint8_t>& bytes) {
+  return network->write(Payload{ bytes.data(), (u32_t)bytes.size() });
+}
+
+// The send callback of the oldest packet ESP-NOW holds, which is delivered if it was sent
+static void confirm(esp_now_send_status_t status) {
+  std::vector<uint8_t> packet = ESPNow.sent.front();
+  ESPNow.sent.pop_front();
+  if (status == ESP_NOW_SEND_SUCCESS) ESPNow.receive(peer, packet.data(), packet.size());
+  ESPNow.confirm(peer, status);
+}
+
+void setUp(void) {
+  mock::now = 0;
+  ESPNow.sent.clear();
+  ESPNow.sendResult = ESP_OK;
+  received.clear();
+  network = new ESPNetwork(ConnectivityMode::WRITER);
+  network->onData(onData);
+}
+
+void tearDown(void) {
+  delete network;
+}
+
+void test_loopback_of_fragmented_messages(void) {
+  std::vector<uint8_t> first = message(ESPNOW_MAX_MESSAGE_SIZE, 1);
+  std::vector<uint8_t> second = message(40, 2);
+  TEST_ASSERT_TRUE(write(first));
+  TEST_ASSERT_TRUE(write(second));
+
+  for (int i = 0; i < 100 && !ESPNow.sent.empty(); i++) {
+    confirm(ESP_NOW_SEND_SUCCESS);
+    network->update();
+  }
+
+  TEST_ASSERT_EQUAL(2, received.size());
+  TEST_ASSERT_TRUE(received[0] == first);
+  TEST_ASSERT_TRUE(received[1] == second);
+  TEST_ASSERT_EQUAL(0, network->getStats().retries);
+}
+
+void test_failed_packet_is_sent_again(void) {
+  std::vector<uint8_t> bytes = message(100);
+  write(bytes);
+
+  confirm(ESP_NOW_SEND_FAIL);
+  network->update();
+  TEST_ASSERT_EQUAL(1, ESPNow.sent.size());
+
+  confirm(ESP_NOW_SEND_SUCCESS);
+  network->update();
+  TEST_ASSERT_EQUAL(1, received.size());
+  TEST_ASSERT_EQUAL(1, network->getStats().retries);
+  TEST_ASSERT_EQUAL(1, network->getStats().packetsSent);
+}
+
+void test_packet_is_given_up_after_retries(void) {
+  std::vector<uint8_t> bytes = message(100);
+  write(bytes);
+
+  for (int i = 0; i <= ESPNOW_SEND_RETRIES; i++) {
+    confirm(ESP_NOW_SEND_FAIL);
+    network->update();
+  }
+
+  TEST_ASSERT_TRUE(ESPNow.sent.empty());
+  TEST_ASSERT_EQUAL(ESPNOW_SEND_RETRIES, network->getStats().retries);
+  TEST_ASSERT_EQUAL(1, network->getStats().sendFailures);
+}
+
+/**
+ * The callback of an attempt that timed out arrives after the packet was sent again. It must not
+ * complete the new attempt, which then fails and is retried.
+ */
+void test_late_callback_of_timed_out_attempt_is_ignored(void) {
+  std::vector<uint8_t> bytes = message(100);
+  write(bytes);
+
+  delay(ESPNOW_SEND_TIMEOUT);
+  network->update();
+  TEST_ASSERT_EQUAL(1, network->getStats().timeouts);
+  TEST_ASSERT_EQUAL(2, ESPNow.sent.size());
+
+  confirm(ESP_NOW_SEND_SUCCESS); // Of the first attempt
+  network->update();
+  TEST_ASSERT_EQUAL(0, network->getStats().packetsSent);
+  TEST_ASSERT_EQUAL(1, ESPNow.sent.size());
+
+  confirm(ESP_NOW_SEND_FAIL); // Of the second attempt
+  network->update();
+  TEST_ASSERT_EQUAL(0, network->getStats().packetsSent);
+  TEST_ASSERT_EQUAL(2, network->getStats().retries);
+  TEST_ASSERT_EQUAL(1, ESPNow.sent.size());
+
+  confirm(ESP_NOW_SEND_SUCCESS);
+  network->update();
+  TEST_ASSERT_EQUAL(1, network->getStats().packetsSent);
+  TEST_ASSERT_EQUAL(0, network->getStats().sendFailures);
+  TEST_ASSERT_EQUAL(1, received.size()); // Delivered twice, but the reassembler drops the duplicate
+}
+
+void test_rejected_send_is_tried_again(void) {
+  std::vector<uint8_t> bytes = message(100);
+  ESPNow.sendResult = ESP_FAIL;
+  write(bytes);
+  TEST_ASSERT_TRUE(ESPNow.sent.empty());
+
+  ESPNow.sendResult = ESP_OK;
+  network->update();
+  TEST_ASSERT_EQUAL(1, ESPNow.sent.size());
+
+  confirm(ESP_NOW_SEND_SUCCESS); // Numbered as the first callback, as the rejected send has none
+  network->update();
+  TEST_ASSERT_EQUAL(1, network->getStats().packetsSent);
+  TEST_ASSERT_EQUAL(1, received.size());
+}
+
+void test_full_queue_rejects_messages(void) {
+  std::vector<uint8_t> bytes = message(ESPNOW_MAX_MESSAGE_SIZE);
+  for (int i = 0; i <= ESPNOW_SEND_QUEUE; i++) {
+    TEST_ASSERT_TRUE(write(bytes)); // The first message is taken from the queue right away
+  }
+
+  TEST_ASSERT_FALSE(write(bytes));
+  TEST_ASSERT_EQUAL(1, network->getStats().queueFull);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_loopback_of_fragmented_messages);
+  RUN_TEST(test_failed_packet_is_sent_again);
+  RUN_TEST(test_packet_is_given_up_after_retries);
+  RUN_TEST(test_late_callback_of_timed_out_attempt_is_ignored);
+  RUN_TEST(test_rejected_send_is_tried_again);
+  RUN_TEST(test_full_queue_rejects_messages);
+  return UNITY_END();
+}
@@ -0,0 +1,379 @@
+#include <unity.h>
+#include <vector>
+#include "connectivity/fragmentation.h"
+
+// Fragmentation over the packets of an nRF24L01, and a lossy link between a sender and a
+// reassembler that drops packets in both directions
+
+#define MTU 32
+#define FRAGMENT_SIZE (MTU - FRAGMENT_HEADER_SIZE)
+#define MAX_MESSAGE_SIZE 1024
+
+static FragmentSender* sender = nullptr;
+static FragmentReassembler* reassembler = nullptr;
+static std::vector<std::vector<u8_t>> received;
+
+static std::vector<u8_t> message(size_t length, u8_t seed = 0) {
+  std::vector<u8_t> bytes(length);
+  for (size_t i = 0; i < length; i++) bytes[i] = (u8_t)(i * 13 + seed);
+  return bytes;
+}
+
+static std::vector<std::vector<u8_t>> fragments() {
+  std::vector<std::vector<u8_t>> packets;
+  u8_t packet[MTU];
+  size_t length;
+  while ((length = sender->next(packet)) != 0) packets.push_back(std::vector<u8_t>(packet, packet + length));
+  return packets;
+}
+
+static bool push(const std::vector<u8_t>& packet) {
+  const u8_t* data;
+  size_t length;
+  if (!reassembler->push(packet.data(), packet.size(), &data, &length)) return false;
+  received.push_back(std::vector<u8_t>(data, data + length));
+  return true;
+}
+
+void setUp(void) {
+  mock::now = 1;
+  received.clear();
+  sender = new FragmentSender(MTU, MAX_MESSAGE_SIZE);
+  reassembler = new FragmentReassembler(MTU, MAX_MESSAGE_SIZE);
+}
+
+void tearDown(void) {
+  delete sender;
+  delete reassembler;
+}
+
+void test_header_round_trip(void) {
+  u8_t packet[FRAGMENT_HEADER_SIZE];
+  FragmentHeader written = { FRAGMENT_DATA, 0xBEEF, 3, 7 };
+  written.write(packet);
+
+  FragmentHeader header;
+  TEST_ASSERT_TRUE(FragmentHeader::read(packet, sizeof(packet), &header));
+  TEST_ASSERT_EQUAL_HEX8(FRAGMENT_DATA, header.type);
+  TEST_ASSERT_EQUAL_HEX16(0xBEEF, header.messageId);
+  TEST_ASSERT_EQUAL(3, header.index);
+  TEST_ASSERT_EQUAL(7, header.count);
+
+  TEST_ASSERT_FALSE(FragmentHeader::read(packet, FRAGMENT_HEADER_SIZE - 1, &header));
+  packet[3] = 7; // Index past the count
+  TEST_ASSERT_FALSE(FragmentHeader::read(packet, sizeof(packet), &header));
+  packet[0] = 0x42;
+  TEST_ASSERT_FALSE(FragmentHeader::read(packet, sizeof(packet), &header));
+}
+
+void test_messages_are_split_and_reassembled_in_any_order(void) {
+  std::vector<u8_t> bytes = message(200);
+  TEST_ASSERT_TRUE(sender->begin(bytes.data(), bytes.size()));
+  std::vector<std::vector<u8_t>> packets = fragments();
+  TEST_ASSERT_EQUAL((200 + FRAGMENT_SIZE - 1) / FRAGMENT_SIZE, packets.size());
+  for (size_t i = 0; i + 1 < packets.size(); i++) TEST_ASSERT_EQUAL(MTU, packets[i].size());
+
+  for (size_t i = packets.size(); 0 < i; i--) push(packets[i - 1]);
+  TEST_ASSERT_EQUAL(1, received.size());
+  TEST_ASSERT_TRUE(received[0] == bytes);
+
+  // Single fragments are delivered as they are
+  std::vector<u8_t> small = message(FRAGMENT_SIZE, 1);
+  TEST_ASSERT_TRUE(sender->begin(small.data(), small.size()));
+  packets = fragments();
+  TEST_ASSERT_EQUAL(1, packets.size());
+  TEST_ASSERT_TRUE(push(packets[0]));
+  TEST_ASSERT_TRUE(received[1] == small);
+}
+
+void test_invalid_messages_are_rejected(void) {
+  std::vector<u8_t> bytes = message(MAX_MESSAGE_SIZE + 1);
+  TEST_ASSERT_FALSE(sender->begin(bytes.data(), 0));
+  TEST_ASSERT_FALSE(sender->begin(bytes.data(), bytes.size()));
+  TEST_ASSERT_EQUAL(MAX_MESSAGE_SIZE, sender->maxMessageSize());
+
+  // A short fragment that is not the last
+  TEST_ASSERT_TRUE(sender->begin(bytes.data(), 100));
+  std::vector<u8_t> packet = fragments()[0];
+  packet.pop_back();
+  TEST_ASSERT_FALSE(push(packet));
+  TEST_ASSERT_EQUAL(1, reassembler->getStats().invalid);
+}
+
+void test_duplicates_are_dropped(void) {
+  std::vector<u8_t> bytes = message(100);
+  sender->begin(bytes.data(), bytes.size());
+  std::vector<std::vector<u8_t>> packets = fragments();
+
+  push(packets[0]);
+  push(packets[0]);
+  TEST_ASSERT_EQUAL(1, reassembler->getStats().duplicates);
+  for (size_t i = 1; i < packets.size(); i++) push(packets[i]);
+  TEST_ASSERT_EQUAL(1, received.size());
+
+  // Late retransmits of a completed message are not delivered again
+  for (const std::vector<u8_t>& packet : packets) TEST_ASSERT_FALSE(push(packet));
+  TEST_ASSERT_EQUAL(1, received.size());
+  TEST_ASSERT_EQUAL(1 + packets.size(), reassembler->getStats().duplicates);
+}
+
+void test_recent_ids_are_bounded(void) {
+  std::vector<u8_t> bytes = message(10);
+  sender->begin(bytes.data(), bytes.size());
+  std::vector<u8_t> first = fragments()[0];
+  TEST_ASSERT_TRUE(push(first));
+  TEST_ASSERT_FALSE(push(first));
+
+  // The id of the first message is forgotten once REASSEMBLY_RECENT others completed
+  for (int i = 0; i < REASSEMBLY_RECENT; i++) {
+    sender->begin(bytes.data(), bytes.size());
+    TEST_ASSERT_TRUE(push(fragments()[0]));
+  }
+  TEST_ASSERT_TRUE(push(first));
+}
+
+void test_nack_requests_missing_fragments(void) {
+  std::vector<u8_t> bytes = message(200);
+  sender->begin(bytes.data(), bytes.size());
+  std::vector<std::vector<u8_t>> packets = fragments();
+  for (size_t i = 0; i < packets.size(); i++) {
+    if (i != 1 && i != 5) push(packets[i]);
+  }
+
+  // Only once the message stalled
+  u8_t nack[MTU];
+  delay(NACK_DELAY - 1);
+  TEST_ASSERT_EQUAL(0, reassembler->nextNack(nack));
+  delay(1);
+  size_t length = reassembler->nextNack(nack);
+  TEST_ASSERT_EQUAL(FRAGMENT_HEADER_SIZE + 1, length);
+  TEST_ASSERT_EQUAL_HEX8(FRAGMENT_NACK, nack[0]);
+  TEST_ASSERT_EQUAL_HEX8((1 << 1) | (1 << 5), nack[FRAGMENT_HEADER_SIZE]);
+  TEST_ASSERT_EQUAL(0, reassembler->nextNack(nack));
+
+  // Exactly the missing fragments are sent again
+  TEST_ASSERT_TRUE(sender->onNack(nack, length));
+  std::vector<std::vector<u8_t>> retransmits = fragments();
+  TEST_ASSERT_EQUAL(2, retransmits.size());
+  TEST_ASSERT_TRUE(retransmits[0] == packets[1]);
+  TEST_ASSERT_TRUE(retransmits[1] == packets[5]);
+  TEST_ASSERT_EQUAL(2, sender->getStats().retransmits);
+
+  for (const std::vector<u8_t>& packet : retransmits) push(packet);
+  TEST_ASSERT_EQUAL(1, received.size());
+  TEST_ASSERT_TRUE(received[0] == bytes);
+}
+
+void test_nacks_are_limited_and_matched_to_the_message(void) {
+  std::vector<u8_t> bytes = message(100);
+  sender->begin(bytes.data(), bytes.size());
+  push(fragments()[0]);
+
+  u8_t nack[MTU];
+  size_t length = 0;
+  for (int i = 0; i < NACK_MAX; i++) {
+    delay(NACK_DELAY);
+    length = reassembler->nextNack(nack);
+    TEST_ASSERT_NOT_EQUAL(0, length);
+  }
+  delay(NACK_DELAY);
+  TEST_ASSERT_EQUAL(0, reassembler->nextNack(nack));
+  TEST_ASSERT_EQUAL(NACK_MAX, reassembler->getStats().nacksSent);
+
+  // A NACK of the previous message is ignored once the next one started
+  sender->begin(bytes.data(), bytes.size());
+  fragments();
+  TEST_ASSERT_FALSE(sender->onNack(nack, length));
+  TEST_ASSERT_EQUAL(0, sender->getStats().nacksReceived);
+
+  // NACKs are only sent if enabled
+  FragmentReassembler silent(MTU, MAX_MESSAGE_SIZE, false);
+  const u8_t* data;
+  size_t messageLength;
+  sender->begin(bytes.data(), bytes.size());
+  std::vector<u8_t> packet = fragments()[0];
+  silent.push(packet.data(), packet.size(), &data, &messageLength);
+  delay(NACK_DELAY);
+  TEST_ASSERT_EQUAL(0, silent.nextNack(nack));
+}
+
+void test_stalled_messages_time_out(void) {
+  std::vector<u8_t> bytes = message(100);
+  sender->begin(bytes.data(), bytes.size());
+  std::vector<std::vector<u8_t>> packets = fragments();
+  push(packets[0]);
+
+  delay(REASSEMBLY_TIMEOUT - 1);
+  reassembler->expire();
+  TEST_ASSERT_EQUAL(0, reassembler->getStats().timeouts);
+  delay(1);
+  reassembler->expire();
+  TEST_ASSERT_EQUAL(1, reassembler->getStats().timeouts);
+
+  // The remaining fragments start over, and do not complete the message
+  for (size_t i = 1; i < packets.size(); i++) push(packets[i]);
+  TEST_ASSERT_EQUAL(0, received.size());
+  push(packets[0]);
+  TEST_ASSERT_EQUAL(1, received.size());
+}
+
+void test_least_recently_updated_message_is_evicted(void) {
+  std::vector<u8_t> bytes = message(100);
+  std::vector<std::vector<std::vector<u8_t>>> messages;
+  for (int i = 0; i <= REASSEMBLY_SLOTS; i++) {
+    sender->begin(bytes.data(), bytes.size());
+    messages.push_back(fragments());
+  }
+
+  // Fill the slots, then update the first message such that the second is the oldest
+  for (int i = 0; i < REASSEMBLY_SLOTS; i++) {
+    push(messages[i][0]);
+    delay(1);
+  }
+  push(messages[0][1]);
+  delay(1);
+
+  push(messages[REASSEMBLY_SLOTS][0]);
+  TEST_ASSERT_EQUAL(1, reassembler->getStats().evictions);
+
+  // The first message survived, the second starts over
+  for (size_t i = 2; i < messages[0].size(); i++) push(messages[0][i]);
+  TEST_ASSERT_EQUAL(1, received.size());
+  for (size_t i = 1; i < messages[1].size(); i++) push(messages[1][i]);
+  TEST_ASSERT_EQUAL(1, received.size());
+}
+
+/**
+ * Lossy link: every packet, fragments as well as NACKs, is lost independently. A packet takes
+ * 0.5 ms, and the sender waits 5 ms between messages. It moves on once the message is delivered
+ * or the receiver stopped asking for fragments.
+ */
+struct LinkResult {
+  u32_t delivered;
+  u32_t packets;   // Packets sent, including retransmits and NACKs
+  u32_t fragments; // Fragments of the messages, without retransmits
+  u32_t micros;    // Duration of the simulation
+};
+
+static uint32_t randomState = 0x2545F491;
+
+static bool lost(double loss) {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState < loss * UINT32_MAX;
+}
+
+static LinkResult simulate(size_t size, double loss, bool nack, u32_t messages) {
+  FragmentSender linkSender(MTU, MAX_MESSAGE_SIZE);
+  FragmentReassembler linkReassembler(MTU, MAX_MESSAGE_SIZE, nack);
+  LinkResult result = {};
+  u32_t micros = 0;
+  auto advance = [&](u32_t us) {
+    micros += us;
+    mock::now = 1 + micros / 1000;
+  };
+
+  for (u32_t m = 0; m < messages; m++) {
+    std::vector<u8_t> bytes = message(size, m);
+    linkSender.begin(bytes.data(), bytes.size());
+    result.fragments += (size + FRAGMENT_SIZE - 1) / FRAGMENT_SIZE;
+    bool delivered = false;
+
+    while (true) {
+      u8_t packet[MTU];
+      size_t length;
+      while ((length = linkSender.next(packet)) != 0) {
+        advance(500);
+        result.packets++;
+        if (lost(loss)) continue;
+
+        const u8_t* data;
+        size_t dataLength;
+        if (linkReassembler.push(packet, length, &data, &dataLength)) {
+          TEST_ASSERT_EQUAL(size, dataLength);
+          TEST_ASSERT_EQUAL_MEMORY(bytes.data(), data, size);
+          delivered = true;
+        }
+      }
+      if (delivered || !nack) break;
+
+      // Wait for the receiver to ask for the missing fragments
+      size_t nackLength = 0;
+      for (u32_t waited = 0; nackLength == 0 && waited <= NACK_DELAY; waited++) {
+        advance(1000);
+        nackLength = linkReassembler.nextNack(packet);
+      }
+      if (nackLength == 0) break; // Gave up, or nothing of the message arrived
+
+      advance(500);
+      result.packets++;
+      if (!lost(loss)) linkSender.onNack(packet, nackLength);
+    }
+
+    if (delivered) result.delivered++;
+    advance(5000);
+    linkReassembler.expire();
+  }
+
+  result.micros = micros;
+  return result;
+}
+
+static void report(const char* name, size_t size, double loss, const LinkResult& result, u32_t messages) {
+  char line[120];
+  snprintf(line, sizeof(line), "%s %4u B, %2.0f%% loss: %5.1f%% delivered, %.2f packets per fragment, goodput %.1f kB/s",
+           name, (unsigned)size, loss * 100, 100.0 * result.delivered / messages, (double)result.packets / result.fragments,
+           result.delivered * size / (result.micros / 1e6) / 1000);
+  TEST_MESSAGE(line);
+}
+
+void test_lossless_link_delivers_everything(void) {
+  const u32_t messages = 200;
+  for (size_t size : { 200, 600, MAX_MESSAGE_SIZE }) {
+    LinkResult result = simulate(size, 0, true, messages);
+    TEST_ASSERT_EQUAL(messages, result.delivered);
+    TEST_ASSERT_EQUAL(result.fragments, result.packets);
+    report("NACK", size, 0, result, messages);
+  }
+}
+
+void test_nacks_recover_lost_fragments(void) {
+  const u32_t messages = 2000;
+  const double losses[] = { 0.01, 0.05, 0.10, 0.20 };
+  const double minimum[] = { 0.99, 0.99, 0.97, 0.85 }; // Delivered with NACKs, for 200 B messages
+
+  for (size_t i = 0; i < sizeof(losses) / sizeof(losses[0]); i++) {
+    LinkResult without = simulate(200, losses[i], false, messages);
+    LinkResult with = simulate(200, losses[i], true, messages);
+    report("Plain", 200, losses[i], without, messages);
+    report("NACK ", 200, losses[i], with, messages);
+
+    TEST_ASSERT_GREATER_OR_EQUAL(minimum[i] * messages, with.delivered);
+    TEST_ASSERT_GREATER_THAN(without.delivered, with.delivered);
+  }
+
+  // Larger messages lose a fragment more often, NACKs keep most of them
+  LinkResult without = simulate(600, 0.10, false, messages);
+  LinkResult with = simulate(600, 0.10, true, messages);
+  report("Plain", 600, 0.10, without, messages);
+  report("NACK ", 600, 0.10, with, messages);
+  TEST_ASSERT_LESS_THAN(0.2 * messages, without.delivered);
+  TEST_ASSERT_GREATER_OR_EQUAL(0.95 * messages, with.delivered);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_header_round_trip);
+  RUN_TEST(test_messages_are_split_and_reassembled_in_any_order);
+  RUN_TEST(test_invalid_messages_are_rejected);
+  RUN_TEST(test_duplicates_are_dropped);
+  RUN_TEST(test_recent_ids_are_bounded);
+  RUN_TEST(test_nack_requests_missing_fragments);
+  RUN_TEST(test_nacks_are_limited_and_matched_to_the_message);
+  RUN_TEST(test_stalled_messages_time_out);
+  RUN_TEST(test_least_recently_updated_message_is_evicted);
+  RUN_TEST(test_lossless_link_delivers_everything);
+  RUN_TEST(test_nacks_recover_lost_fragments);
+  return UNITY_END();
+}
@@ -0,0 +1,215 @@
+#include <unity.h>
+#include <chrono>
+#include <vector>
+#include "connectivity/framing.h"
+
+// Loopback of FrameEncoder into FrameDecoder, with corruption injected between them
+
+class BufferPrint : public Print {
+  public:
+  std::vector<uint8_t> data;
+
+  size_t write(uint8_t byte) override {
+    data.push_back(byte);
+    return 1;
+  }
+};
+
+static std::vector<std::vector<uint8_t>> received;
+
+static void onFrame(const uint8_t* data, size_t length) {
+  received.push_back(std::vector<uint8_t>(data, data + length));
+}
+
+static std::vector<uint8_t> payload(size_t length, uint8_t seed = 0) {
+  std::vector<uint8_t> bytes(length);
+  for (size_t i = 0; i < length; i++) {
+    bytes[i] = (i * 7 + seed) % 5 == 0 ? 0 : (uint8_t)(i + seed); // Plenty of zeros to stuff
+  }
+  return bytes;
+}
+
+static std::vector<uint8_t> frame(const std::vector<uint8_t>& bytes) {
+  BufferPrint output;
+  FrameEncoder::send(&output, bytes.data(), bytes.size());
+  return output.data;
+}
+
+static void append(std::vector<uint8_t>& stream, const std::vector<uint8_t>& bytes) {
+  stream.insert(stream.end(), bytes.begin(), bytes.end());
+}
+
+void setUp(void) {
+  received.clear();
+}
+
+void tearDown(void) {}
+
+void test_frame_is_enclosed_in_delimiters(void) {
+  std::vector<uint8_t> encoded = frame(payload(300));
+
+  TEST_ASSERT_EQUAL_UINT8(FRAME_DELIMITER, encoded.front());
+  TEST_ASSERT_EQUAL_UINT8(FRAME_DELIMITER, encoded.back());
+  for (size_t i = 1; i + 1 < encoded.size(); i++) {
+    TEST_ASSERT_TRUE(encoded[i] != FRAME_DELIMITER);
+  }
+}
+
+void test_loopback_across_block_boundaries(void) {
+  const size_t lengths[] = { 1, 2, 250, 253, 254, 255, 256, 508, 509, 1000 };
+  FrameDecoder decoder(1024);
+  decoder.onFrame(onFrame);
+
+  for (size_t length : lengths) {
+    std::vector<uint8_t> encoded = frame(payload(length, length));
+    decoder.push(encoded.data(), encoded.size());
+  }
+
+  TEST_ASSERT_EQUAL(sizeof(lengths) / sizeof(lengths[0]), received.size());
+  for (size_t i = 0; i < received.size(); i++) {
+    TEST_ASSERT_TRUE(received[i] == payload(lengths[i], lengths[i]));
+  }
+}
+
+void test_loopback_in_single_bytes(void) {
+  std::vector<uint8_t> stream;
+  append(stream, frame(payload(100, 1)));
+  append(stream, frame(payload(600, 2)));
+
+  FrameDecoder decoder(1024);
+  decoder.onFrame(onFrame);
+  for (uint8_t byte : stream) decoder.push(&byte, 1);
+
+  TEST_ASSERT_EQUAL(2, received.size());
+  TEST_ASSERT_TRUE(received[1] == payload(600, 2));
+}
+
+void test_text_before_frame_is_dropped(void) {
+  // E.g. a boot message, written to the port before the log process frames the logs
+  const char* text = "ESP-ROM:esp32c3-api1-20210207\nmode:DIO\n";
+  std::vector<uint8_t> stream(text, text + strlen(text));
+  append(stream, frame(payload(64)));
+
+  FrameDecoder decoder(1024);
+  decoder.onFrame(onFrame);
+  decoder.push(stream.data(), stream.size());
+
+  TEST_ASSERT_EQUAL(1, received.size());
+  TEST_ASSERT_TRUE(received[0] == payload(64));
+  FrameStats stats = decoder.getStats();
+  TEST_ASSERT_EQUAL(1, stats.frames);
+  TEST_ASSERT_EQUAL(1, stats.crcErrors + stats.framingErrors);
+}
+
+void test_flipped_bit_fails_crc_and_next_frame_survives(void) {
+  std::vector<uint8_t> corrupt = frame(payload(200, 3));
+  corrupt[100] ^= 0x10;
+  if (corrupt[100] == FRAME_DELIMITER) corrupt[100] = 0x01;
+
+  std::vector<uint8_t> stream = corrupt;
+  append(stream, frame(payload(200, 4)));
+
+  FrameDecoder decoder(1024);
+  decoder.onFrame(onFrame);
+  decoder.push(stream.data(), stream.size());
+
+  TEST_ASSERT_EQUAL(1, received.size());
+  TEST_ASSERT_TRUE(received[0] == payload(200, 4));
+  TEST_ASSERT_EQUAL(1, decoder.getStats().crcErrors + decoder.getStats().framingErrors);
+}
+
+void test_dropped_byte_resynchronises_on_next_delimiter(void) {
+  std::vector<uint8_t> broken = frame(payload(300, 5));
+  broken.erase(broken.begin() + 150);
+
+  std::vector<uint8_t> stream = broken;
+  append(stream, frame(payload(10, 6)));
+
+  FrameDecoder decoder(1024);
+  decoder.onFrame(onFrame);
+  decoder.push(stream.data(), stream.size());
+
+  TEST_ASSERT_EQUAL(1, received.size());
+  TEST_ASSERT_TRUE(received[0] == payload(10, 6));
+}
+
+void test_oversized_frame_is_dropped(void) {
+  std::vector<uint8_t> stream = frame(payload(200));
+  append(stream, frame(payload(50)));
+
+  FrameDecoder decoder(100);
+  decoder.onFrame(onFrame);
+  decoder.push(stream.data(), stream.size());
+
+  TEST_ASSERT_EQUAL(1, received.size());
+  TEST_ASSERT_EQUAL(1, decoder.getStats().overflows);
+}
+
+void test_aborted_frame_is_dropped(void) {
+  BufferPrint output;
+  FrameEncoder encoder(&output);
+  std::vector<uint8_t> partial = payload(80);
+  encoder.write(partial.data(), partial.size());
+  encoder.abort();
+  append(output.data, frame(payload(20)));
+
+  FrameDecoder decoder(1024);
+  decoder.onFrame(onFrame);
+  decoder.push(output.data.data(), output.data.size());
+
+  TEST_ASSERT_EQUAL(1, received.size());
+  TEST_ASSERT_TRUE(received[0] == payload(20));
+}
+
+/**
+ * Corrupt one byte in every tenth frame of a long stream. Every other frame must arrive, and no
+ * corrupt frame may be delivered. Also reports the loopback throughput, which must stay well above
+ * the 250 kB/s of 2 Mbaud.
+ */
+void test_loopback_throughput_with_corruption(void) {
+  const size_t frames = 2000;
+  std::vector<uint8_t> stream;
+  for (size_t i = 0; i < frames; i++) {
+    std::vector<uint8_t> encoded = frame(payload(512, i));
+    if (i % 10 == 0) {
+      size_t at = 1 + (i * 31) % (encoded.size() - 2);
+      encoded[at] = encoded[at] == 0x55 ? 0xAA : 0x55;
+    }
+    append(stream, encoded);
+  }
+
+  FrameDecoder decoder(1024);
+  decoder.onFrame(onFrame);
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < stream.size(); i += 64) {
+    decoder.push(stream.data() + i, min((size_t)64, stream.size() - i));
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  FrameStats stats = decoder.getStats();
+  TEST_ASSERT_EQUAL(frames - frames / 10, stats.frames);
+  TEST_ASSERT_EQUAL(frames / 10, stats.crcErrors + stats.framingErrors);
+  for (size_t i = 0; i < received.size(); i++) {
+    size_t sent = i + i / 9 + 1; // The index of the i-th frame that was not corrupted
+    TEST_ASSERT_TRUE(received[i] == payload(512, sent));
+  }
+
+  char message[80];
+  snprintf(message, sizeof(message), "Decoded %.1f MB/s", stream.size() / seconds / 1e6);
+  TEST_MESSAGE(message);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_frame_is_enclosed_in_delimiters);
+  RUN_TEST(test_loopback_across_block_boundaries);
+  RUN_TEST(test_loopback_in_single_bytes);
+  RUN_TEST(test_text_before_frame_is_dropped);
+  RUN_TEST(test_flipped_bit_fails_crc_and_next_frame_survives);
+  RUN_TEST(test_dropped_byte_resynchronises_on_next_delimiter);
+  RUN_TEST(test_oversized_frame_is_dropped);
+  RUN_TEST(test_aborted_frame_is_dropped);
+  RUN_TEST(test_loopback_throughput_with_corruption);
+  return UNITY_END();
+}
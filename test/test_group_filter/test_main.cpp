@@ -0,0 +1,183 @@
+#include <unity.h>
+#include <vector>
+#include "diagnostics/telemetry.h"
+#include "connectivity/serialization/message_decoder.h"
+#include "leds/layers/colors/colors.h"
+#include "leds/serialization/sequence_encoder.h"
+
+// The group filter of broadcasts, which skips broadcasts for other groups before anything of the
+// sequence is decoded. Target groups may be packed or not, and come before or after the sequence.
+
+#define GROUP 300 // Two bytes as a varint
+
+static MessageDecoder* decoder = nullptr;
+static std::vector<std::vector<uint32_t>> broadcasts;
+
+enum class Groups { PACKED, UNPACKED };
+
+static void varint(std::vector<u8_t>& out, u32_t value) {
+  do {
+    u8_t byte = value & 0x7F;
+    value >>= 7;
+    out.push_back(value ? byte | 0x80 : byte);
+  } while (value);
+}
+
+static void field(std::vector<u8_t>& out, u32_t tag, const std::vector<u8_t>& content) {
+  varint(out, (tag << 3) | PB_WT_STRING);
+  varint(out, content.size());
+  out.insert(out.end(), content.begin(), content.end());
+}
+
+static std::vector<u8_t> sequence() {
+  Sequence* sequence = new Sequence();
+  sequence->animations.push_back(new Animation{ { new SingleColor(CRGB::Red) }, 1000, Direction::FORWARD, 255, 0 });
+  u8_t buffer[64];
+  pb_ostream_t stream = pb_ostream_from_buffer(buffer, sizeof(buffer));
+  TEST_ASSERT_TRUE(SequenceEncoder::encode(&stream, sequence));
+  Sequence::destroy(sequence);
+  return std::vector<u8_t>(buffer, buffer + stream.bytes_written);
+}
+
+static void groups(std::vector<u8_t>& out, const std::vector<u32_t>& ids, Groups encoding) {
+  if (ids.empty()) return;
+  if (encoding == Groups::PACKED) {
+    std::vector<u8_t> packed;
+    for (u32_t id : ids) varint(packed, id);
+    field(out, protocol_BroadcastSequence_target_groups_tag, packed);
+    return;
+  }
+  for (u32_t id : ids) {
+    varint(out, (protocol_BroadcastSequence_target_groups_tag << 3) | PB_WT_VARINT);
+    varint(out, id);
+  }
+}
+
+static std::vector<u8_t> broadcast(const std::vector<u32_t>& ids, Groups encoding, bool groupsFirst) {
+  std::vector<u8_t> wrapped;
+  if (groupsFirst) groups(wrapped, ids, encoding);
+  field(wrapped, protocol_BroadcastSequence_sequence_tag, sequence());
+  if (!groupsFirst) groups(wrapped, ids, encoding);
+
+  std::vector<u8_t> message;
+  field(message, protocol_Message_broadcast_sequence_tag, wrapped);
+  return message;
+}
+
+static bool decode(const std::vector<u8_t>& message) {
+  return decoder->decode(message.data(), message.size());
+}
+
+static void onBroadcast(Sequence* sequence, std::vector<uint32_t>* groupIds) {
+  broadcasts.push_back(*groupIds);
+  Sequence::destroy(sequence);
+}
+
+static void onSequence(Sequence* sequence) {
+  Sequence::destroy(sequence);
+}
+
+void setUp(void) {
+  broadcasts.clear();
+  decoder = new MessageDecoder();
+  decoder->setGroup(GROUP);
+  decoder->setOnBroadcastSequenceReceived(onBroadcast);
+  decoder->setOnSequenceReceived(onSequence);
+}
+
+void tearDown(void) {
+  delete decoder;
+}
+
+void test_broadcast_for_every_group_is_accepted(void) {
+  TEST_ASSERT_TRUE(decode(broadcast({}, Groups::PACKED, true)));
+  TEST_ASSERT_EQUAL(1, broadcasts.size());
+  TEST_ASSERT_EQUAL(0, broadcasts[0].size());
+  TEST_ASSERT_EQUAL(1, decoder->getGroupFilterStats().accepted);
+}
+
+void test_groups_in_every_encoding_and_position(void) {
+  for (Groups encoding : { Groups::PACKED, Groups::UNPACKED }) {
+    for (bool groupsFirst : { true, false }) {
+      broadcasts.clear();
+      GroupFilterStats before = decoder->getGroupFilterStats();
+
+      TEST_ASSERT_TRUE(decode(broadcast({ 1, GROUP, 70000 }, encoding, groupsFirst)));
+      TEST_ASSERT_TRUE(decode(broadcast({ 1, GROUP + 1, 70000 }, encoding, groupsFirst)));
+
+      GroupFilterStats after = decoder->getGroupFilterStats();
+      TEST_ASSERT_EQUAL(before.accepted + 1, after.accepted);
+      TEST_ASSERT_EQUAL(before.rejected + 1, after.rejected);
+
+      // The groups are decoded in full for the callback
+      TEST_ASSERT_EQUAL(1, broadcasts.size());
+      TEST_ASSERT_TRUE(broadcasts[0] == std::vector<uint32_t>({ 1, GROUP, 70000 }));
+    }
+  }
+}
+
+void test_groups_split_over_fields(void) {
+  // Packed and unpacked groups on either side of the sequence, the own group in the last field
+  std::vector<u8_t> wrapped;
+  groups(wrapped, { 1, 2 }, Groups::PACKED);
+  groups(wrapped, { 3 }, Groups::UNPACKED);
+  field(wrapped, protocol_BroadcastSequence_sequence_tag, sequence());
+  groups(wrapped, { 4, GROUP }, Groups::PACKED);
+  std::vector<u8_t> message;
+  field(message, protocol_Message_broadcast_sequence_tag, wrapped);
+
+  TEST_ASSERT_TRUE(decode(message));
+  TEST_ASSERT_EQUAL(1, broadcasts.size());
+  TEST_ASSERT_TRUE(broadcasts[0] == std::vector<uint32_t>({ 1, 2, 3, 4, GROUP }));
+
+  decoder->setGroup(5);
+  TEST_ASSERT_TRUE(decode(message));
+  TEST_ASSERT_EQUAL(1, broadcasts.size());
+  TEST_ASSERT_EQUAL(1, decoder->getGroupFilterStats().rejected);
+}
+
+void test_rejected_broadcast_is_not_decoded(void) {
+  std::vector<u8_t> message = broadcast({ 1, 2, 3 }, Groups::UNPACKED, false);
+  AllocationStats decoderBefore = Telemetry::getAllocationStats(Subsystem::DECODER);
+  AllocationStats schedulerBefore = Telemetry::getAllocationStats(Subsystem::SCHEDULER);
+  AllocationStats layersBefore = Telemetry::getAllocationStats(Subsystem::LAYERS);
+
+  TEST_ASSERT_TRUE(decode(message));
+
+  TEST_ASSERT_EQUAL(decoderBefore.allocations, Telemetry::getAllocationStats(Subsystem::DECODER).allocations);
+  TEST_ASSERT_EQUAL(schedulerBefore.allocations, Telemetry::getAllocationStats(Subsystem::SCHEDULER).allocations);
+  TEST_ASSERT_EQUAL(layersBefore.allocations, Telemetry::getAllocationStats(Subsystem::LAYERS).allocations);
+  TEST_ASSERT_EQUAL(0, decoder->getDedupeStats().misses);
+}
+
+void test_other_messages_are_not_filtered(void) {
+  std::vector<u8_t> message;
+  field(message, protocol_Message_sequence_tag, sequence());
+  TEST_ASSERT_TRUE(decode(message));
+
+  GroupFilterStats stats = decoder->getGroupFilterStats();
+  TEST_ASSERT_EQUAL(0, stats.accepted);
+  TEST_ASSERT_EQUAL(0, stats.rejected);
+}
+
+void test_malformed_groups_are_left_to_the_decoder(void) {
+  // The packed groups claim more bytes than the broadcast holds
+  std::vector<u8_t> wrapped = { (protocol_BroadcastSequence_target_groups_tag << 3) | PB_WT_STRING, 10, 1 };
+  std::vector<u8_t> message;
+  field(message, protocol_Message_broadcast_sequence_tag, wrapped);
+
+  TEST_ASSERT_FALSE(decode(message));
+  TEST_ASSERT_EQUAL(0, broadcasts.size());
+  TEST_ASSERT_EQUAL(0, decoder->getGroupFilterStats().rejected);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_broadcast_for_every_group_is_accepted);
+  RUN_TEST(test_groups_in_every_encoding_and_position);
+  RUN_TEST(test_groups_split_over_fields);
+  RUN_TEST(test_rejected_broadcast_is_not_decoded);
+  RUN_TEST(test_other_messages_are_not_filtered);
+  RUN_TEST(test_malformed_groups_are_left_to_the_decoder);
+  return UNITY_END();
+}
@@ -0,0 +1,189 @@
+#include <unity.h>
+#include <string.h>
+#include <vector>
+#include "connectivity/serialization/hash.h"
+#include "connectivity/serialization/message_decoder.h"
+#include "leds/layers/colors/colors.h"
+#include "leds/serialization/sequence_encoder.h"
+
+#define LEDS 10
+#define PRIME32_1 0x9E3779B1U
+
+static CRGB leds[LEDS];
+static Animator* animator = nullptr;
+static SequenceScheduler* scheduler = nullptr;
+static MessageDecoder* decoder = nullptr;
+static u32_t sequencesReceived;
+static u32_t statesReceived;
+
+static void varint(std::vector<u8_t>& out, u32_t value) {
+  do {
+    u8_t byte = value & 0x7F;
+    value >>= 7;
+    out.push_back(value ? byte | 0x80 : byte);
+  } while (value);
+}
+
+static void field(std::vector<u8_t>& out, u32_t tag, const std::vector<u8_t>& content) {
+  varint(out, (tag << 3) | PB_WT_STRING);
+  varint(out, content.size());
+  out.insert(out.end(), content.begin(), content.end());
+}
+
+// A message of the given type, of a sequence with a single color
+static std::vector<u8_t> message(u32_t tag, CRGB color) {
+  Sequence* sequence = new Sequence();
+  sequence->animations.push_back(new Animation{ { new SingleColor(color) }, 1000, Direction::FORWARD, 255, 0 });
+  u8_t buffer[64];
+  pb_ostream_t stream = pb_ostream_from_buffer(buffer, sizeof(buffer));
+  TEST_ASSERT_TRUE(SequenceEncoder::encode(&stream, sequence));
+  Sequence::destroy(sequence);
+  std::vector<u8_t> encoded(buffer, buffer + stream.bytes_written);
+
+  std::vector<u8_t> message;
+  if (tag == protocol_Message_sequence_tag) {
+    field(message, tag, encoded);
+  }
+  else {
+    std::vector<u8_t> wrapped;
+    field(wrapped, protocol_State_sequence_tag, encoded);
+    field(message, tag, wrapped);
+  }
+  return message;
+}
+
+static bool decode(const std::vector<u8_t>& bytes) {
+  return decoder->decode(bytes.data(), bytes.size());
+}
+
+static void onSequence(Sequence* sequence) {
+  sequencesReceived++;
+  scheduler->set(sequence, decoder->getSequenceHash());
+}
+
+static void onSaveState(Sequence* sequence, protocol_Settings* settings) {
+  statesReceived++;
+  scheduler->set(sequence, decoder->getSequenceHash());
+}
+
+void setUp(void) {
+  mock::now = 0;
+  sequencesReceived = 0;
+  statesReceived = 0;
+  animator = new Animator(leds, LEDS);
+  scheduler = new SequenceScheduler(animator);
+  decoder = new MessageDecoder(scheduler);
+  decoder->setOnSequenceReceived(onSequence);
+  decoder->setOnSaveStateReceived(onSaveState);
+}
+
+void tearDown(void) {
+  delete decoder;
+  scheduler->clear();
+  delete scheduler;
+  delete animator;
+}
+
+static u32_t hash(const char* text, u32_t seed = 0) {
+  return Hash::xxh32((const uint8_t*) text, strlen(text), seed);
+}
+
+void test_xxh32_reference_vectors(void) {
+  // Reference values of the xxHash library
+  TEST_ASSERT_EQUAL_HEX32(0x02CC5D05, hash(""));
+  TEST_ASSERT_EQUAL_HEX32(0x36B78AE7, hash("", PRIME32_1));
+  TEST_ASSERT_EQUAL_HEX32(0x550D7456, hash("a"));
+  TEST_ASSERT_EQUAL_HEX32(0x32D153FF, hash("abc"));
+  TEST_ASSERT_EQUAL_HEX32(0xE2293B2F, hash("Nobody inspects the spammish repetition"));
+
+  // Exactly one round, and several rounds with a tail of words and bytes
+  u8_t bytes[101];
+  for (size_t i = 0; i < sizeof(bytes); i++) bytes[i] = i;
+  TEST_ASSERT_EQUAL_HEX32(0xB72837F4, Hash::xxh32(bytes, 16));
+  TEST_ASSERT_EQUAL_HEX32(0x1A20E95B, Hash::xxh32(bytes, sizeof(bytes)));
+  TEST_ASSERT_EQUAL_HEX32(0x37B352EE, Hash::xxh32(bytes, sizeof(bytes), PRIME32_1));
+}
+
+void test_xxh32_reads_unaligned_data(void) {
+  u8_t bytes[102];
+  for (size_t i = 0; i < sizeof(bytes) - 1; i++) bytes[i + 1] = i;
+  TEST_ASSERT_EQUAL_HEX32(0x1A20E95B, Hash::xxh32(bytes + 1, sizeof(bytes) - 1));
+}
+
+void test_same_sequence_is_skipped(void) {
+  std::vector<u8_t> red = message(protocol_Message_sequence_tag, CRGB::Red);
+  TEST_ASSERT_TRUE(decode(red));
+  TEST_ASSERT_EQUAL(1, sequencesReceived);
+  TEST_ASSERT_NOT_EQUAL(0, scheduler->getHash());
+  TEST_ASSERT_EQUAL(0, decoder->getDedupeStats().hits);
+  TEST_ASSERT_EQUAL(1, decoder->getDedupeStats().misses);
+
+  // The hash is taken over the encoded sequence
+  std::vector<u8_t> encoded(red.begin() + 2, red.end());
+  TEST_ASSERT_EQUAL_HEX32(Hash::xxh32(encoded.data(), encoded.size()), scheduler->getHash());
+
+  TEST_ASSERT_TRUE(decode(red));
+  TEST_ASSERT_EQUAL(1, sequencesReceived);
+  TEST_ASSERT_EQUAL(1, decoder->getDedupeStats().hits);
+  TEST_ASSERT_EQUAL(1, decoder->getDedupeStats().misses);
+}
+
+void test_other_sequence_is_decoded(void) {
+  TEST_ASSERT_TRUE(decode(message(protocol_Message_sequence_tag, CRGB::Red)));
+  u32_t red = scheduler->getHash();
+  TEST_ASSERT_TRUE(decode(message(protocol_Message_sequence_tag, CRGB::Blue)));
+  TEST_ASSERT_EQUAL(2, sequencesReceived);
+  TEST_ASSERT_NOT_EQUAL(red, scheduler->getHash());
+  TEST_ASSERT_EQUAL(0, decoder->getDedupeStats().hits);
+  TEST_ASSERT_EQUAL(2, decoder->getDedupeStats().misses);
+
+  // A patched sequence no longer matches its encoding
+  TEST_ASSERT_TRUE(scheduler->patch(0, 0, protocol_LayerField_ColorField, 0, 0xFF0000));
+  TEST_ASSERT_TRUE(decode(message(protocol_Message_sequence_tag, CRGB::Blue)));
+  TEST_ASSERT_EQUAL(3, sequencesReceived);
+}
+
+void test_saved_state_is_always_decoded(void) {
+  std::vector<u8_t> state = message(protocol_Message_save_state_tag, CRGB::Red);
+  TEST_ASSERT_TRUE(decode(state));
+  TEST_ASSERT_TRUE(decode(state));
+  TEST_ASSERT_EQUAL(2, statesReceived);
+  TEST_ASSERT_EQUAL(0, decoder->getDedupeStats().hits);
+
+  // The state sets the hash of the sequence, like a sequence message
+  TEST_ASSERT_TRUE(decode(message(protocol_Message_sequence_tag, CRGB::Red)));
+  TEST_ASSERT_EQUAL(0, sequencesReceived);
+  TEST_ASSERT_EQUAL(1, decoder->getDedupeStats().hits);
+}
+
+// Receiving the sequence while another source controls the animator hands the animator back to it
+void test_paused_sequence_is_decoded(void) {
+  std::vector<u8_t> red = message(protocol_Message_sequence_tag, CRGB::Red);
+  TEST_ASSERT_TRUE(decode(red));
+  u32_t hash = scheduler->getHash();
+
+  scheduler->pause(AnimatorOwner::PIXEL_STREAM);
+  TEST_ASSERT_EQUAL(hash, scheduler->getHash());
+  TEST_ASSERT_TRUE(decode(red));
+  TEST_ASSERT_EQUAL(2, sequencesReceived);
+  TEST_ASSERT_FALSE(scheduler->isPaused());
+  TEST_ASSERT_EQUAL(0, decoder->getDedupeStats().hits);
+
+  // Once resumed, the sequence is recognised again
+  scheduler->pause(AnimatorOwner::PIXEL_STREAM);
+  TEST_ASSERT_TRUE(scheduler->resume(AnimatorOwner::PIXEL_STREAM));
+  TEST_ASSERT_TRUE(decode(red));
+  TEST_ASSERT_EQUAL(2, sequencesReceived);
+  TEST_ASSERT_EQUAL(1, decoder->getDedupeStats().hits);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_xxh32_reference_vectors);
+  RUN_TEST(test_xxh32_reads_unaligned_data);
+  RUN_TEST(test_same_sequence_is_skipped);
+  RUN_TEST(test_other_sequence_is_decoded);
+  RUN_TEST(test_saved_state_is_always_decoded);
+  RUN_TEST(test_paused_sequence_is_decoded);
+  return UNITY_END();
+}
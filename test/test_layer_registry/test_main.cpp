@@ -0,0 +1,192 @@
+#include <unity.h>
+#include <vector>
+#include "leds/layers/registry.h"
+#include "leds/layers/colors/colors.h"
+#include "leds/layers/masks/masks.h"
+#include "leds/sequence_scheduler.h"
+
+#define LEDS 10
+
+static CRGB leds[LEDS];
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static protocol_Layer layer_of(protocol_LayerType type) {
+  protocol_Layer layer = protocol_Layer_init_zero;
+  layer.type = type;
+  return layer;
+}
+
+// The colors of a layer, as they are encoded
+static const std::vector<CRGB>& colors_of(ILayer* layer) {
+  return *static_cast<const std::vector<CRGB>*>(LayerRegistry::encode(layer).colors.arg);
+}
+
+void test_find_every_type(void) {
+  for (int type = protocol_LayerType_SingleColor; type <= protocol_LayerType_SwitchColor; type++) {
+    const LayerDefinition* definition = LayerRegistry::find((protocol_LayerType) type);
+    TEST_ASSERT_NOT_NULL(definition);
+    TEST_ASSERT_EQUAL(type, definition->type);
+  }
+  for (int type = LAYER_MASK_OFFSET; type <= _protocol_LayerType_MAX; type++) {
+    const LayerDefinition* definition = LayerRegistry::find((protocol_LayerType) type);
+    TEST_ASSERT_NOT_NULL(definition);
+    TEST_ASSERT_EQUAL(type, definition->type);
+  }
+  TEST_ASSERT_NULL(LayerRegistry::find((protocol_LayerType) (LAYER_COLOR_COUNT)));
+  TEST_ASSERT_NULL(LayerRegistry::find((protocol_LayerType) (_protocol_LayerType_MAX + 1)));
+}
+
+void test_validate_required_and_ranges(void) {
+  const LayerDefinition* wave = LayerRegistry::find(protocol_LayerType_WaveMask);
+  protocol_Layer layer = layer_of(protocol_LayerType_WaveMask);
+  layer.duration = 100;
+  layer.length = 10;
+  TEST_ASSERT_TRUE(LayerRegistry::validate(wave, layer, 0, 0));
+
+  // The gap is optional, the length is not
+  layer.length = 0;
+  TEST_ASSERT_FALSE(LayerRegistry::validate(wave, layer, 0, 0));
+  layer.length = UINT16_MAX + 1;
+  TEST_ASSERT_FALSE(LayerRegistry::validate(wave, layer, 0, 0));
+  layer.length = UINT16_MAX;
+  TEST_ASSERT_TRUE(LayerRegistry::validate(wave, layer, 0, 0));
+
+  // Fields outside of the schema are ignored
+  layer.speed = UINT32_MAX;
+  TEST_ASSERT_TRUE(LayerRegistry::validate(wave, layer, 0, 0));
+
+  // Narrow fields are stored in a byte
+  const LayerDefinition* stars = LayerRegistry::find(protocol_LayerType_StarsMask);
+  layer = layer_of(protocol_LayerType_StarsMask);
+  layer.speed = UINT8_MAX;
+  TEST_ASSERT_TRUE(LayerRegistry::validate(stars, layer, 0, 0));
+  layer.speed = UINT8_MAX + 1;
+  TEST_ASSERT_FALSE(LayerRegistry::validate(stars, layer, 0, 0));
+
+  // Colors are 24 bits
+  const LayerDefinition* single = LayerRegistry::find(protocol_LayerType_SingleColor);
+  layer = layer_of(protocol_LayerType_SingleColor);
+  layer.color = 0xFFFFFF;
+  TEST_ASSERT_TRUE(LayerRegistry::validate(single, layer, 0, 0));
+  layer.color = 0x1000000;
+  TEST_ASSERT_FALSE(LayerRegistry::validate(single, layer, 0, 0));
+}
+
+void test_validate_elements(void) {
+  const LayerDefinition* fade = LayerRegistry::find(protocol_LayerType_FadeColor);
+  protocol_Layer layer = layer_of(protocol_LayerType_FadeColor);
+  layer.duration = 3;
+  TEST_ASSERT_FALSE(LayerRegistry::validate(fade, layer, 0, 0));
+  TEST_ASSERT_TRUE(LayerRegistry::validate(fade, layer, 3, 0));
+
+  // Every color needs a tick of the duration
+  TEST_ASSERT_FALSE(LayerRegistry::validate(fade, layer, 4, 0));
+
+  // Sections do not count for a color layer
+  TEST_ASSERT_FALSE(LayerRegistry::validate(fade, layer, 0, 1));
+}
+
+void test_patch_assigns_valid_values(void) {
+  WaveMask wave(10, 0, 100);
+  TEST_ASSERT_TRUE(LayerRegistry::patch(&wave, protocol_LayerField_LengthField, 0, 20));
+  TEST_ASSERT_TRUE(LayerRegistry::patch(&wave, protocol_LayerField_GapField, 0, 0));
+  TEST_ASSERT_TRUE(LayerRegistry::patch(&wave, protocol_LayerField_DurationField, 0, UINT16_MAX));
+
+  protocol_Layer encoded = LayerRegistry::encode(&wave);
+  TEST_ASSERT_EQUAL(20, encoded.length);
+  TEST_ASSERT_EQUAL(0, encoded.gap);
+  TEST_ASSERT_EQUAL(UINT16_MAX, encoded.duration);
+}
+
+void test_patch_rejects_values_outside_schema(void) {
+  WaveMask wave(10, 0, 100);
+  TEST_ASSERT_FALSE(LayerRegistry::patch(&wave, protocol_LayerField_LengthField, 0, 0));
+  TEST_ASSERT_FALSE(LayerRegistry::patch(&wave, protocol_LayerField_DurationField, 0, UINT16_MAX + 1));
+  TEST_ASSERT_FALSE(LayerRegistry::patch(&wave, protocol_LayerField_SpeedField, 0, 1));
+  TEST_ASSERT_FALSE(LayerRegistry::patch(&wave, protocol_LayerField_ColorsField, 0, 1));
+  TEST_ASSERT_FALSE(LayerRegistry::patch(&wave, (protocol_LayerField) (_protocol_LayerField_MAX + 1), 0, 1));
+
+  StarsMask stars(100, 10, 5);
+  TEST_ASSERT_FALSE(LayerRegistry::patch(&stars, protocol_LayerField_SpeedField, 0, UINT8_MAX + 1));
+  TEST_ASSERT_TRUE(LayerRegistry::patch(&stars, protocol_LayerField_SpeedField, 0, UINT8_MAX));
+
+  SingleColor single(CRGB::Black);
+  TEST_ASSERT_FALSE(LayerRegistry::patch(&single, protocol_LayerField_ColorField, 0, 0x1000000));
+  TEST_ASSERT_TRUE(LayerRegistry::patch(&single, protocol_LayerField_ColorField, 0, 0xFFFFFF));
+  TEST_ASSERT_EQUAL(0xFFFFFF, LayerRegistry::encode(&single).color);
+
+  // Nothing was assigned by the rejected patches
+  protocol_Layer encoded = LayerRegistry::encode(&wave);
+  TEST_ASSERT_EQUAL(10, encoded.length);
+  TEST_ASSERT_EQUAL(100, encoded.duration);
+}
+
+void test_patch_elements(void) {
+  FadeColor fade({ CRGB::Red, CRGB::Green }, 3);
+
+  // Replace and append, but no gaps
+  TEST_ASSERT_TRUE(LayerRegistry::patch(&fade, protocol_LayerField_ColorsField, 0, 0x0000FF));
+  TEST_ASSERT_TRUE(LayerRegistry::patch(&fade, protocol_LayerField_ColorsField, 2, 0xFFFFFF));
+  TEST_ASSERT_FALSE(LayerRegistry::patch(&fade, protocol_LayerField_ColorsField, 4, 0xFFFFFF));
+  TEST_ASSERT_FALSE(LayerRegistry::patch(&fade, protocol_LayerField_ColorsField, 0, 0x1000000));
+  TEST_ASSERT_EQUAL(3, colors_of(&fade).size());
+  TEST_ASSERT_TRUE(colors_of(&fade)[0] == CRGB(0x0000FF));
+  TEST_ASSERT_TRUE(colors_of(&fade)[2] == CRGB(0xFFFFFF));
+
+  // A fourth color needs a fourth tick
+  TEST_ASSERT_FALSE(LayerRegistry::patch(&fade, protocol_LayerField_ColorsField, 3, 0));
+  TEST_ASSERT_FALSE(LayerRegistry::patch(&fade, protocol_LayerField_DurationField, 0, 2));
+  TEST_ASSERT_TRUE(LayerRegistry::patch(&fade, protocol_LayerField_DurationField, 0, 4));
+  TEST_ASSERT_TRUE(LayerRegistry::patch(&fade, protocol_LayerField_ColorsField, 3, 0));
+  TEST_ASSERT_EQUAL(4, colors_of(&fade).size());
+
+  SectionsMask sections({ 1 }, 10);
+  TEST_ASSERT_FALSE(LayerRegistry::patch(&sections, protocol_LayerField_SectionsField, 0, UINT8_MAX + 1));
+  TEST_ASSERT_TRUE(LayerRegistry::patch(&sections, protocol_LayerField_SectionsField, 1, UINT8_MAX));
+  TEST_ASSERT_EQUAL(2, sections.sections.size());
+  TEST_ASSERT_EQUAL(UINT8_MAX, sections.sections[1]);
+}
+
+void test_patch_colors_up_to_limit(void) {
+  FadeColor fade({}, UINT16_MAX);
+  for (u32_t i = 0; i < LAYER_COLORS_MAX; i++) {
+    TEST_ASSERT_TRUE(LayerRegistry::patch(&fade, protocol_LayerField_ColorsField, i, i));
+  }
+  TEST_ASSERT_FALSE(LayerRegistry::patch(&fade, protocol_LayerField_ColorsField, LAYER_COLORS_MAX, 0));
+  TEST_ASSERT_EQUAL(LAYER_COLORS_MAX, colors_of(&fade).size());
+}
+
+void test_scheduler_patch(void) {
+  Animator animator(leds, LEDS);
+  SequenceScheduler scheduler(&animator);
+  scheduler.add({ new SingleColor(CRGB::Red), new WaveMask(10, 0, 100) }, 1000);
+
+  TEST_ASSERT_TRUE(scheduler.patch(0, 1, protocol_LayerField_LengthField, 0, 5));
+  TEST_ASSERT_FALSE(scheduler.patch(0, 1, protocol_LayerField_LengthField, 0, 0));
+  TEST_ASSERT_FALSE(scheduler.patch(0, 0, protocol_LayerField_DurationField, 0, 5));
+  TEST_ASSERT_FALSE(scheduler.patch(0, 2, protocol_LayerField_LengthField, 0, 5));
+  TEST_ASSERT_FALSE(scheduler.patch(1, 0, protocol_LayerField_ColorField, 0, 0));
+
+  // The sequence shares its animations with the scheduler
+  Sequence* sequence = scheduler.getSequence();
+  TEST_ASSERT_EQUAL(5, LayerRegistry::encode(sequence->animations[0]->layers[1]).length);
+  delete sequence;
+
+  scheduler.clear();
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_find_every_type);
+  RUN_TEST(test_validate_required_and_ranges);
+  RUN_TEST(test_validate_elements);
+  RUN_TEST(test_patch_assigns_valid_values);
+  RUN_TEST(test_patch_rejects_values_outside_schema);
+  RUN_TEST(test_patch_elements);
+  RUN_TEST(test_patch_colors_up_to_limit);
+  RUN_TEST(test_scheduler_patch);
+  return UNITY_END();
+}
@@ -0,0 +1,137 @@
+#include <unity.h>
+#include "diagnostics/link_monitor.h"
+
+// The moving averages per minute of the link counters, sampled every second like main does
+
+#define SAMPLE_INTERVAL 1000
+
+class FakeLink : public LinkSource {
+  public:
+  LinkCounters counters = {};
+
+  LinkCounters getLinkCounters() override {
+    return counters;
+  }
+};
+
+static LinkMonitor* monitor = nullptr;
+static FakeLink* radio = nullptr;
+
+// Receive `packets` over the interval, then sample
+static void receive(u32_t packets, u32_t interval = SAMPLE_INTERVAL) {
+  radio->counters.received += packets;
+  delay(interval);
+  monitor->sample();
+}
+
+void setUp(void) {
+  mock::now = 0;
+  monitor = new LinkMonitor(0);
+  radio = new FakeLink();
+}
+
+void tearDown(void) {
+  delete monitor;
+  delete radio;
+}
+
+void test_counts_before_watching_are_not_averaged(void) {
+  radio->counters.received = 5000;
+  radio->counters.sent = 300;
+  monitor->watch(Link::RADIO, radio);
+
+  receive(0);
+  TEST_ASSERT_EQUAL(0, monitor->getPerMinute(Link::RADIO).received);
+  TEST_ASSERT_EQUAL(0, monitor->getPerMinute(Link::RADIO).sent);
+  TEST_ASSERT_EQUAL(5000, monitor->getCounters(Link::RADIO).received);
+}
+
+void test_average_follows_a_steady_rate(void) {
+  monitor->watch(Link::RADIO, radio);
+
+  // 10 packets a second is 600 a minute. The latest sample weighs LINK_AVERAGE_WEIGHT.
+  receive(10);
+  TEST_ASSERT_EQUAL(60, monitor->getPerMinute(Link::RADIO).received);
+  for (int i = 1; i < 10; i++) receive(10);
+  TEST_ASSERT_EQUAL(391, monitor->getPerMinute(Link::RADIO).received); // 600 * (1 - 0.9^10)
+
+  for (int i = 0; i < 90; i++) receive(10);
+  TEST_ASSERT_EQUAL(600, monitor->getPerMinute(Link::RADIO).received);
+
+  // And decays once the link goes quiet
+  for (int i = 0; i < 10; i++) receive(0);
+  TEST_ASSERT_EQUAL(209, monitor->getPerMinute(Link::RADIO).received); // 600 * 0.9^10
+}
+
+void test_rate_is_taken_over_the_time_since_the_last_sample(void) {
+  monitor->watch(Link::RADIO, radio);
+  for (int i = 0; i < 100; i++) receive(10);
+  TEST_ASSERT_EQUAL(600, monitor->getPerMinute(Link::RADIO).received);
+
+  // A late update, with twice the packets, is the same rate
+  receive(20, SAMPLE_INTERVAL * 2);
+  receive(5, SAMPLE_INTERVAL / 2);
+  TEST_ASSERT_EQUAL(600, monitor->getPerMinute(Link::RADIO).received);
+
+  // No time has passed, so there is no rate to take
+  radio->counters.received += 100;
+  monitor->sample();
+  TEST_ASSERT_EQUAL(600, monitor->getPerMinute(Link::RADIO).received);
+}
+
+void test_links_are_averaged_separately(void) {
+  FakeLink espnow;
+  monitor->watch(Link::RADIO, radio);
+  monitor->watch(Link::ESPNOW, &espnow);
+
+  for (int i = 0; i < 100; i++) {
+    espnow.counters.sent += 2;
+    espnow.counters.retransmits += 1;
+    receive(10);
+  }
+
+  LinkCounters radioRates = monitor->getPerMinute(Link::RADIO);
+  LinkCounters espnowRates = monitor->getPerMinute(Link::ESPNOW);
+  TEST_ASSERT_EQUAL(600, radioRates.received);
+  TEST_ASSERT_EQUAL(0, radioRates.sent);
+  TEST_ASSERT_EQUAL(0, espnowRates.received);
+  TEST_ASSERT_EQUAL(120, espnowRates.sent);
+  TEST_ASSERT_EQUAL(60, espnowRates.retransmits);
+}
+
+void test_decode_errors_are_counted_per_link(void) {
+  monitor->watch(Link::RADIO, radio);
+  for (int i = 0; i < 100; i++) {
+    monitor->countDecodeError(Link::RADIO);
+    monitor->countDecodeError(Link::SERIAL_PORT); // Not watched
+    receive(0);
+  }
+
+  TEST_ASSERT_EQUAL(100, monitor->getCounters(Link::RADIO).decodeErrors);
+  TEST_ASSERT_EQUAL(60, monitor->getPerMinute(Link::RADIO).decodeErrors);
+  TEST_ASSERT_EQUAL(100, monitor->getCounters(Link::SERIAL_PORT).decodeErrors);
+  TEST_ASSERT_EQUAL(0, monitor->getCounters(Link::SERIAL_PORT).received);
+}
+
+void test_only_watched_links_are_encoded(void) {
+  monitor->watch(Link::ESPNOW, radio);
+  for (int i = 0; i < 100; i++) receive(10);
+
+  protocol_Diagnostics diagnostics = protocol_Diagnostics_init_zero;
+  monitor->toEncodable(&diagnostics);
+  TEST_ASSERT_EQUAL(1, diagnostics.links_count);
+  TEST_ASSERT_EQUAL(protocol_Link_ESPNowLink, diagnostics.links[0].link);
+  TEST_ASSERT_EQUAL(1000, diagnostics.links[0].total.received);
+  TEST_ASSERT_EQUAL(600, diagnostics.links[0].per_minute.received);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_counts_before_watching_are_not_averaged);
+  RUN_TEST(test_average_follows_a_steady_rate);
+  RUN_TEST(test_rate_is_taken_over_the_time_since_the_last_sample);
+  RUN_TEST(test_links_are_averaged_separately);
+  RUN_TEST(test_decode_errors_are_counted_per_link);
+  RUN_TEST(test_only_watched_links_are_encoded);
+  return UNITY_END();
+}
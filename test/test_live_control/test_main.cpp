@@ -0,0 +1,137 @@
+#include <unity.h>
+#include <vector>
+#include "dmx/live_control.h"
+#include "leds/layers/colors/colors.h"
+
+#define LEDS 20
+
+static CRGB leds[LEDS];
+static Animator* animator = nullptr;
+static SequenceScheduler* sequenceScheduler = nullptr;
+static LiveControl* liveControl = nullptr;
+
+// A control frame of a single colour at full brightness, without masks
+static std::vector<u8_t> frame(u8_t red, u8_t green, u8_t blue) {
+  std::vector<u8_t> bytes(CONTROL_FRAME_SIZE, 0);
+  bytes[0] = CONTROL_FRAME_MAGIC;
+  bytes[1] = 255; // Dimmer
+  bytes[2] = red;
+  bytes[3] = green;
+  bytes[4] = blue;
+  return bytes;
+}
+
+static bool post(const std::vector<u8_t>& bytes) {
+  return liveControl->post(bytes.data(), bytes.size());
+}
+
+// Run the processes in the order of the main loop
+static void loop() {
+  liveControl->update();
+  sequenceScheduler->update();
+  animator->update();
+}
+
+void setUp(void) {
+  mock::now = 0;
+  std::fill(leds, leds + LEDS, CRGB::Black);
+  animator = new Animator(leds, LEDS);
+  sequenceScheduler = new SequenceScheduler(animator);
+  liveControl = new LiveControl(animator, sequenceScheduler);
+  sequenceScheduler->add({ new SingleColor(CRGB(1, 2, 3)) }, 1000);
+  loop();
+}
+
+void tearDown(void) {
+  delete liveControl;
+  sequenceScheduler->clear();
+  delete sequenceScheduler;
+  delete animator;
+}
+
+void test_control_frames_are_recognised_by_magic(void) {
+  std::vector<u8_t> bytes = frame(255, 0, 0);
+  TEST_ASSERT_TRUE(LiveControl::isControlFrame(bytes.data(), bytes.size()));
+  TEST_ASSERT_FALSE(LiveControl::isControlFrame(bytes.data(), 0));
+
+  bytes[0] = 0x0A; // Field 1 of a Message
+  TEST_ASSERT_FALSE(LiveControl::isControlFrame(bytes.data(), bytes.size()));
+}
+
+void test_invalid_frames_are_rejected(void) {
+  std::vector<u8_t> bytes = frame(255, 0, 0);
+  TEST_ASSERT_FALSE(liveControl->post(bytes.data(), bytes.size() - 1));
+
+  bytes.push_back(0);
+  TEST_ASSERT_FALSE(post(bytes));
+
+  bytes = frame(255, 0, 0);
+  bytes[0] = 0x0A;
+  TEST_ASSERT_FALSE(post(bytes));
+
+  bytes = frame(255, 0, 0);
+  bytes[12] = 4; // SectionsMask as the second mask, without sections
+  TEST_ASSERT_FALSE(post(bytes));
+
+  loop();
+  TEST_ASSERT_EQUAL(AnimatorOwner::SEQUENCE, sequenceScheduler->getOwner());
+  TEST_ASSERT_TRUE(leds[0] == CRGB(1, 2, 3));
+}
+
+void test_frame_takes_animator_over_from_sequence(void) {
+  TEST_ASSERT_TRUE(post(frame(255, 0, 0)));
+  TEST_ASSERT_TRUE(leds[0] == CRGB(1, 2, 3)); // Applied on the next update only
+
+  loop();
+  TEST_ASSERT_EQUAL(AnimatorOwner::LIVE_CONTROL, sequenceScheduler->getOwner());
+  TEST_ASSERT_TRUE(leds[0] == CRGB(255, 0, 0));
+  TEST_ASSERT_TRUE(leds[LEDS - 1] == CRGB(255, 0, 0));
+}
+
+void test_latest_pending_frame_is_applied(void) {
+  post(frame(255, 0, 0));
+  post(frame(0, 0, 255));
+  loop();
+  TEST_ASSERT_TRUE(leds[0] == CRGB(0, 0, 255));
+}
+
+void test_frame_ends_pixel_stream(void) {
+  sequenceScheduler->pause(AnimatorOwner::PIXEL_STREAM);
+  animator->setStreaming(true);
+
+  post(frame(0, 255, 0));
+  loop();
+  TEST_ASSERT_EQUAL(AnimatorOwner::LIVE_CONTROL, sequenceScheduler->getOwner());
+  TEST_ASSERT_FALSE(animator->isStreaming());
+  TEST_ASSERT_TRUE(leds[0] == CRGB(0, 255, 0));
+}
+
+void test_sequence_resumes_after_timeout(void) {
+  post(frame(255, 0, 0));
+  loop();
+
+  // Every frame restarts the timeout
+  delay(LIVE_CONTROL_TIMEOUT - 1);
+  post(frame(255, 0, 0));
+  loop();
+  delay(LIVE_CONTROL_TIMEOUT - 1);
+  loop();
+  TEST_ASSERT_EQUAL(AnimatorOwner::LIVE_CONTROL, sequenceScheduler->getOwner());
+  TEST_ASSERT_TRUE(leds[0] == CRGB(255, 0, 0));
+
+  delay(1);
+  loop();
+  TEST_ASSERT_EQUAL(AnimatorOwner::SEQUENCE, sequenceScheduler->getOwner());
+  TEST_ASSERT_TRUE(leds[0] == CRGB(1, 2, 3));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_control_frames_are_recognised_by_magic);
+  RUN_TEST(test_invalid_frames_are_rejected);
+  RUN_TEST(test_frame_takes_animator_over_from_sequence);
+  RUN_TEST(test_latest_pending_frame_is_applied);
+  RUN_TEST(test_frame_ends_pixel_stream);
+  RUN_TEST(test_sequence_resumes_after_timeout);
+  return UNITY_END();
+}
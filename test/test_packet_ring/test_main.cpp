@@ -0,0 +1,152 @@
+#include <unity.h>
+#include <string.h>
+#include <thread>
+#include "connectivity/packet_ring.h"
+
+// The ring between the receive task of the radio and the main loop. The threaded test is meant to
+// be run under ThreadSanitizer as well, e.g. with -fsanitize=thread in the build flags.
+
+#define SLOTS 4
+#define SIZE 32
+#define PACKETS 100000
+
+typedef PacketRing<SLOTS, SIZE> Ring;
+
+static Ring* ring = nullptr;
+
+static bool produce(u8_t value, u8_t length) {
+  u8_t* slot = ring->claim();
+  if (slot == nullptr) {
+    ring->drop();
+    return false;
+  }
+  memset(slot, value, length);
+  ring->commit(length);
+  return true;
+}
+
+void setUp(void) {
+  ring = new Ring();
+}
+
+void tearDown(void) {
+  delete ring;
+}
+
+void test_packets_are_read_in_order(void) {
+  u8_t length;
+  TEST_ASSERT_NULL(ring->peek(&length));
+
+  TEST_ASSERT_TRUE(produce(1, 10));
+  TEST_ASSERT_TRUE(produce(2, SIZE));
+  TEST_ASSERT_EQUAL(2, ring->size());
+
+  const u8_t* packet = ring->peek(&length);
+  TEST_ASSERT_NOT_NULL(packet);
+  TEST_ASSERT_EQUAL(10, length);
+  TEST_ASSERT_EQUAL(1, packet[9]);
+
+  // Peeking does not remove the packet
+  TEST_ASSERT_EQUAL_PTR(packet, ring->peek(&length));
+  ring->pop();
+
+  packet = ring->peek(&length);
+  TEST_ASSERT_EQUAL(SIZE, length);
+  TEST_ASSERT_EQUAL(2, packet[SIZE - 1]);
+  ring->pop();
+  TEST_ASSERT_NULL(ring->peek(&length));
+  TEST_ASSERT_EQUAL(0, ring->size());
+}
+
+void test_full_ring_drops_new_packets(void) {
+  for (int i = 0; i < SLOTS; i++) TEST_ASSERT_TRUE(produce(i, 1));
+  TEST_ASSERT_FALSE(produce(0xFF, 1));
+  TEST_ASSERT_EQUAL(SLOTS, ring->size());
+  TEST_ASSERT_EQUAL(1, ring->getDrops());
+
+  // The packets that were not read yet are kept
+  u8_t length;
+  TEST_ASSERT_EQUAL(0, ring->peek(&length)[0]);
+  ring->pop();
+  TEST_ASSERT_TRUE(produce(SLOTS, 1));
+  for (int i = 1; i <= SLOTS; i++) {
+    TEST_ASSERT_EQUAL(i, ring->peek(&length)[0]);
+    ring->pop();
+  }
+}
+
+void test_slots_are_reused_around_the_ring(void) {
+  u8_t length;
+  for (int i = 0; i < SLOTS * 10; i++) {
+    TEST_ASSERT_TRUE(produce(i, 1 + i % SIZE));
+    const u8_t* packet = ring->peek(&length);
+    TEST_ASSERT_EQUAL(1 + i % SIZE, length);
+    TEST_ASSERT_EQUAL((u8_t)i, packet[length - 1]);
+    ring->pop();
+  }
+  TEST_ASSERT_EQUAL(0, ring->getDrops());
+}
+
+// A packet of the producer thread: its sequence number, then its low byte repeated
+static bool produce_numbered(uint32_t number) {
+  u8_t* slot = ring->claim();
+  if (slot == nullptr) return false;
+  u8_t length = sizeof(number) + number % (SIZE - sizeof(number) + 1);
+  memcpy(slot, &number, sizeof(number));
+  memset(slot + sizeof(number), (u8_t)number, length - sizeof(number));
+  ring->commit(length);
+  return true;
+}
+
+/**
+ * A producer and a consumer thread, like the receive task and the main loop. A packet read while
+ * it is written, or a slot reused before it is popped, shows up as a packet of mixed bytes or a
+ * number out of order. The producer waits while the ring is full, such that every packet is handed
+ * over and the threads keep taking turns.
+ */
+void test_single_producer_single_consumer(void) {
+  std::thread producer([]() {
+    for (uint32_t i = 0; i < PACKETS; i++) {
+      while (!produce_numbered(i)) std::this_thread::yield();
+    }
+  });
+
+  u32_t received = 0;
+  u32_t corrupt = 0;
+  u32_t outOfOrder = 0;
+  int64_t previous = -1;
+  while (received < PACKETS) {
+    u8_t length;
+    const u8_t* packet = ring->peek(&length);
+    if (packet == nullptr) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    uint32_t number;
+    memcpy(&number, packet, sizeof(number));
+    if (length != sizeof(number) + number % (SIZE - sizeof(number) + 1)) corrupt++;
+    for (u8_t i = sizeof(number); i < length; i++) {
+      if (packet[i] != (u8_t)number) corrupt++;
+    }
+    if (number != previous + 1) outOfOrder++;
+    previous = number;
+    received++;
+    ring->pop();
+  }
+  producer.join();
+
+  TEST_ASSERT_EQUAL(0, corrupt);
+  TEST_ASSERT_EQUAL(0, outOfOrder);
+  TEST_ASSERT_EQUAL(0, ring->size());
+  TEST_ASSERT_EQUAL(0, ring->getDrops());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_packets_are_read_in_order);
+  RUN_TEST(test_full_ring_drops_new_packets);
+  RUN_TEST(test_slots_are_reused_around_the_ring);
+  RUN_TEST(test_single_producer_single_consumer);
+  return UNITY_END();
+}
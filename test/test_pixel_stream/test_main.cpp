@@ -0,0 +1,326 @@
+#include <unity.h>
+#include <algorithm>
+#include <vector>
+#include "connectivity/serial_reader.h"
+#include "leds/pixel_stream.h"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+#define LEDS 30
+
+static CRGB leds[LEDS];
+static Animator* animator = nullptr;
+static SequenceScheduler* sequenceScheduler = nullptr;
+static PixelStream* pixelStream = nullptr;
+
+static std::vector<u8_t> frame(PixelEncoding encoding, u16_t offset, const std::vector<u8_t>& pixels, u8_t flags = PIXEL_FRAME_SHOW) {
+  std::vector<u8_t> bytes = { PIXEL_FRAME_MAGIC, encoding, (u8_t)offset, (u8_t)(offset >> 8), flags };
+  bytes.insert(bytes.end(), pixels.begin(), pixels.end());
+  return bytes;
+}
+
+static bool apply(const std::vector<u8_t>& bytes) {
+  return pixelStream->apply(bytes.data(), bytes.size());
+}
+
+// Pixels that are not black, such that untouched pixels stand out
+static std::vector<u8_t> rgb(size_t count, u8_t seed = 1) {
+  std::vector<u8_t> bytes;
+  for (size_t i = 0; i < count * 3; i++) bytes.push_back((u8_t)(i + seed) | 0x01);
+  return bytes;
+}
+
+static void assertPixels(const std::vector<u8_t>& expected, size_t first) {
+  TEST_ASSERT_EQUAL_MEMORY(expected.data(), (const u8_t*)(leds + first), expected.size());
+}
+
+static void assertUntouched() {
+  for (size_t i = 0; i < LEDS; i++) {
+    TEST_ASSERT_TRUE(leds[i] == CRGB(0, 0, 0));
+  }
+  TEST_ASSERT_FALSE(animator->isStreaming());
+  TEST_ASSERT_EQUAL(1, pixelStream->getStats().invalid);
+}
+
+void setUp(void) {
+  mock::now = 0;
+  std::fill(leds, leds + LEDS, CRGB::Black);
+  animator = new Animator(leds, LEDS);
+  sequenceScheduler = new SequenceScheduler(animator);
+  pixelStream = new PixelStream(animator, sequenceScheduler);
+}
+
+void tearDown(void) {
+  delete pixelStream;
+  delete sequenceScheduler;
+  delete animator;
+}
+
+void test_raw_frame_is_written_at_offset(void) {
+  std::vector<u8_t> pixels = rgb(10);
+  unsigned long shown = FastLED.shown;
+
+  TEST_ASSERT_TRUE(apply(frame(PIXEL_RAW, 20, pixels)));
+  assertPixels(pixels, 20);
+  TEST_ASSERT_TRUE(leds[19] == CRGB(0, 0, 0));
+  TEST_ASSERT_TRUE(animator->isStreaming());
+  TEST_ASSERT_EQUAL(AnimatorOwner::PIXEL_STREAM, sequenceScheduler->getOwner());
+  TEST_ASSERT_EQUAL(shown + 1, FastLED.shown);
+}
+
+void test_raw_frame_without_show_flag_is_not_shown(void) {
+  unsigned long shown = FastLED.shown;
+
+  TEST_ASSERT_TRUE(apply(frame(PIXEL_RAW, 0, rgb(LEDS), 0)));
+  TEST_ASSERT_EQUAL(shown, FastLED.shown);
+  TEST_ASSERT_EQUAL(0, pixelStream->getStats().shown);
+}
+
+void test_truncated_raw_frame_is_dropped(void) {
+  std::vector<u8_t> pixels = rgb(5);
+  pixels.pop_back();
+
+  TEST_ASSERT_FALSE(apply(frame(PIXEL_RAW, 0, pixels)));
+  assertUntouched();
+}
+
+void test_oversized_raw_frame_is_dropped(void) {
+  TEST_ASSERT_FALSE(apply(frame(PIXEL_RAW, 1, rgb(LEDS))));
+  assertUntouched();
+}
+
+void test_offset_beyond_strip_is_dropped(void) {
+  TEST_ASSERT_FALSE(apply(frame(PIXEL_RAW, LEDS + 1, {})));
+  assertUntouched();
+}
+
+void test_truncated_header_is_dropped(void) {
+  std::vector<u8_t> bytes = { PIXEL_FRAME_MAGIC, PIXEL_RAW, 0, 0 };
+
+  TEST_ASSERT_FALSE(apply(bytes));
+  assertUntouched();
+}
+
+void test_unknown_encoding_is_dropped(void) {
+  TEST_ASSERT_FALSE(apply(frame((PixelEncoding)7, 0, rgb(1))));
+  assertUntouched();
+}
+
+void test_rle_frame_fills_runs(void) {
+  TEST_ASSERT_TRUE(apply(frame(PIXEL_RLE, 2, { 3, 10, 20, 30, 1, 40, 50, 60 })));
+
+  TEST_ASSERT_TRUE(leds[1] == CRGB(0, 0, 0));
+  for (size_t i = 2; i < 5; i++) TEST_ASSERT_TRUE(leds[i] == CRGB(10, 20, 30));
+  TEST_ASSERT_TRUE(leds[5] == CRGB(40, 50, 60));
+  TEST_ASSERT_TRUE(leds[6] == CRGB(0, 0, 0));
+}
+
+void test_rle_runs_may_fill_the_strip(void) {
+  TEST_ASSERT_TRUE(apply(frame(PIXEL_RLE, 0, { 20, 1, 1, 1, 10, 2, 2, 2 })));
+  TEST_ASSERT_TRUE(leds[LEDS - 1] == CRGB(2, 2, 2));
+}
+
+void test_truncated_rle_frame_is_dropped(void) {
+  TEST_ASSERT_FALSE(apply(frame(PIXEL_RLE, 0, { 3, 10, 20, 30, 1, 40, 50 })));
+  assertUntouched();
+}
+
+void test_empty_rle_run_is_dropped(void) {
+  TEST_ASSERT_FALSE(apply(frame(PIXEL_RLE, 0, { 3, 10, 20, 30, 0, 40, 50, 60 })));
+  assertUntouched();
+}
+
+// The first run fits, the second does not. Neither may be written.
+void test_oversized_rle_frame_is_dropped(void) {
+  TEST_ASSERT_FALSE(apply(frame(PIXEL_RLE, 10, { 10, 10, 20, 30, 11, 40, 50, 60 })));
+  assertUntouched();
+}
+
+void test_delta_frame_keeps_skipped_pixels(void) {
+  std::vector<u8_t> first = rgb(LEDS, 1);
+  TEST_ASSERT_TRUE(apply(frame(PIXEL_RAW, 0, first)));
+
+  std::vector<u8_t> changes = { 2, 1, 7, 8, 9, 3, 2, 4, 5, 6, 1, 2, 3 };
+  TEST_ASSERT_TRUE(apply(frame(PIXEL_DELTA, 0, changes)));
+
+  std::vector<u8_t> expected = first;
+  const u8_t changed[][4] = { { 2, 7, 8, 9 }, { 6, 4, 5, 6 }, { 7, 1, 2, 3 } };
+  for (const u8_t* pixel : changed) memcpy(expected.data() + pixel[0] * 3, pixel + 1, 3);
+  assertPixels(expected, 0);
+}
+
+void test_delta_frame_may_only_skip(void) {
+  TEST_ASSERT_TRUE(apply(frame(PIXEL_DELTA, 0, { LEDS, 0 })));
+  TEST_ASSERT_TRUE(animator->isStreaming());
+}
+
+void test_truncated_delta_header_is_dropped(void) {
+  TEST_ASSERT_FALSE(apply(frame(PIXEL_DELTA, 0, { 0, 1, 7, 8, 9, 2 })));
+  assertUntouched();
+}
+
+void test_truncated_delta_pixels_are_dropped(void) {
+  TEST_ASSERT_FALSE(apply(frame(PIXEL_DELTA, 0, { 0, 1, 7, 8, 9, 0, 2, 1, 2, 3, 4 })));
+  assertUntouched();
+}
+
+// The first chunk fits, the second skips past the strip. Neither may be written.
+void test_oversized_delta_frame_is_dropped(void) {
+  TEST_ASSERT_FALSE(apply(frame(PIXEL_DELTA, 0, { 0, 1, 7, 8, 9, LEDS, 1, 1, 2, 3 })));
+  assertUntouched();
+}
+
+void test_stream_times_out_and_resumes_sequence(void) {
+  TEST_ASSERT_TRUE(apply(frame(PIXEL_RAW, 0, rgb(1))));
+
+  delay(PIXEL_STREAM_TIMEOUT);
+  pixelStream->update();
+
+  TEST_ASSERT_FALSE(animator->isStreaming());
+  TEST_ASSERT_EQUAL(AnimatorOwner::SEQUENCE, sequenceScheduler->getOwner());
+  TEST_ASSERT_EQUAL(1, pixelStream->getStats().timeouts);
+}
+
+#ifndef _WIN32
+
+/**
+ * @brief The master side of a pseudo-terminal, read like the serial port of the controller
+ */
+class PtyStream : public Stream {
+  int fd;
+
+  public:
+  PtyStream(int fd) : fd(fd) {}
+
+  int available() override {
+    int count = 0;
+    return ioctl(fd, FIONREAD, &count) == 0 ? count : 0;
+  }
+
+  int read() override {
+    u8_t byte;
+    return ::read(fd, &byte, 1) == 1 ? byte : -1;
+  }
+
+  size_t write(uint8_t byte) override {
+    return ::write(fd, &byte, 1) == 1 ? 1 : 0;
+  }
+};
+
+/**
+ * @brief Writes to the terminal side of a pseudo-terminal, like a media server writing to the port
+ */
+class PtyPrint : public Print {
+  int fd;
+
+  public:
+  PtyPrint(int fd) : fd(fd) {}
+
+  size_t write(uint8_t byte) override {
+    return ::write(fd, &byte, 1) == 1 ? 1 : 0;
+  }
+
+  size_t write(const uint8_t* data, size_t length) override {
+    return ::write(fd, data, length);
+  }
+};
+
+class BufferPrint : public Print {
+  public:
+  std::vector<uint8_t> data;
+
+  size_t write(uint8_t byte) override {
+    data.push_back(byte);
+    return 1;
+  }
+};
+
+static void onSerialData(const uint8_t* data, size_t length) {
+  if (PixelStream::isPixelFrame(data, length)) pixelStream->apply(data, length);
+}
+
+// Wait for the bytes written to the terminal to reach the master, then read them like the main loop
+static void readAll(SerialProtocol& protocol, PtyStream& stream, size_t expected) {
+  for (int i = 0; i < 100 && (size_t)stream.available() < expected; i++) usleep(1000);
+  protocol.update();
+}
+
+/**
+ * Frames written to a pseudo-terminal, as a media server would write them to the USB serial port,
+ * are read by the serial protocol and shown. A corrupt frame between them is dropped.
+ */
+void test_frames_over_pseudo_terminal(void) {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  TEST_ASSERT_TRUE(0 <= master);
+  TEST_ASSERT_EQUAL(0, grantpt(master));
+  TEST_ASSERT_EQUAL(0, unlockpt(master));
+  int terminal = open(ptsname(master), O_RDWR | O_NOCTTY);
+  TEST_ASSERT_TRUE(0 <= terminal);
+
+  // Binary frames must pass the line discipline unchanged
+  termios settings;
+  tcgetattr(terminal, &settings);
+  cfmakeraw(&settings);
+  tcsetattr(terminal, TCSANOW, &settings);
+
+  PtyStream stream(master);
+  PtyPrint port(terminal);
+  SerialProtocol protocol(&stream, 1024);
+  protocol.onData(onSerialData);
+  unsigned long shown = FastLED.shown;
+
+  std::vector<u8_t> raw = frame(PIXEL_RAW, 0, rgb(LEDS));
+  std::vector<u8_t> corrupt = frame(PIXEL_RLE, 0, { LEDS, 1, 1, 1 });
+  std::vector<u8_t> rle = frame(PIXEL_RLE, 0, { 10, 9, 9, 9 });
+  FrameEncoder::send(&port, raw.data(), raw.size());
+  readAll(protocol, stream, raw.size());
+
+  BufferPrint encoded;
+  FrameEncoder::send(&encoded, corrupt.data(), corrupt.size());
+  encoded.data[encoded.data.size() / 2] ^= 0x40;
+  port.write(encoded.data.data(), encoded.data.size());
+  FrameEncoder::send(&port, rle.data(), rle.size());
+  readAll(protocol, stream, encoded.data.size() + rle.size());
+
+  close(terminal);
+  close(master);
+
+  TEST_ASSERT_EQUAL(2, protocol.getStats().frames);
+  TEST_ASSERT_EQUAL(1, protocol.getStats().crcErrors + protocol.getStats().framingErrors);
+  TEST_ASSERT_EQUAL(shown + 2, FastLED.shown);
+  for (size_t i = 0; i < 10; i++) TEST_ASSERT_TRUE(leds[i] == CRGB(9, 9, 9));
+  assertPixels(std::vector<u8_t>(raw.begin() + PIXEL_FRAME_HEADER_SIZE + 30, raw.end()), 10);
+}
+
+#endif
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_raw_frame_is_written_at_offset);
+  RUN_TEST(test_raw_frame_without_show_flag_is_not_shown);
+  RUN_TEST(test_truncated_raw_frame_is_dropped);
+  RUN_TEST(test_oversized_raw_frame_is_dropped);
+  RUN_TEST(test_offset_beyond_strip_is_dropped);
+  RUN_TEST(test_truncated_header_is_dropped);
+  RUN_TEST(test_unknown_encoding_is_dropped);
+  RUN_TEST(test_rle_frame_fills_runs);
+  RUN_TEST(test_rle_runs_may_fill_the_strip);
+  RUN_TEST(test_truncated_rle_frame_is_dropped);
+  RUN_TEST(test_empty_rle_run_is_dropped);
+  RUN_TEST(test_oversized_rle_frame_is_dropped);
+  RUN_TEST(test_delta_frame_keeps_skipped_pixels);
+  RUN_TEST(test_delta_frame_may_only_skip);
+  RUN_TEST(test_truncated_delta_header_is_dropped);
+  RUN_TEST(test_truncated_delta_pixels_are_dropped);
+  RUN_TEST(test_oversized_delta_frame_is_dropped);
+  RUN_TEST(test_stream_times_out_and_resumes_sequence);
+#ifndef _WIN32
+  RUN_TEST(test_frames_over_pseudo_terminal);
+#endif
+  return UNITY_END();
+}
@@ -0,0 +1,361 @@
+#include <unity.h>
+#include <algorithm>
+#include <deque>
+#include <math.h>
+#include <vector>
+#include "connectivity/relay.h"
+
+// Discrete-event simulation of controllers flooding messages through Relay, in steps of 1 ms.
+// Radios are half duplex and sense the carrier before sending, but a receiver that hears two
+// frames at once, e.g. from hidden terminals, gets neither.
+
+#define NODES 50
+#define AREA 400             // m, side of the square the controllers are placed in
+#define RANGE 110            // m
+#define AIRTIME 3            // ms per frame
+#define MESSAGE_SIZE 294     // Frames of 300 bytes with the relay header
+#define MESSAGES 50          // Messages per topology
+#define MESSAGE_INTERVAL 500 // ms between messages of the origin
+#define TOPOLOGIES 5
+#define NAIVE 0              // Strategy of flooding without backoff and suppression
+#define NAIVE_JITTER 2       // ms of random contention before a naive rebroadcast, as the MAC would add
+
+struct Transmission {
+  int node;
+  u32_t start;
+  std::vector<u8_t> frame;
+};
+
+/**
+ * @brief Rebroadcasts every new message as soon as the channel is free, after a short jitter. The
+ * baseline the relay is compared with.
+ */
+class NaiveFlood {
+  std::vector<u32_t> seen;
+  std::deque<std::vector<u8_t>> queue;
+  u32_t dueAt = 0;
+
+  public:
+  RelaySend send;
+
+  bool receive(const u8_t* frame, size_t length) {
+    u32_t messageId;
+    memcpy(&messageId, frame + 2, 4);
+    if (std::find(seen.begin(), seen.end(), messageId) != seen.end()) return false;
+
+    seen.push_back(messageId);
+    if (0 < frame[1]) {
+      queue.push_back(std::vector<u8_t>(frame, frame + length));
+      queue.back()[1]--;
+      dueAt = millis() + 1 + random(NAIVE_JITTER + 1);
+    }
+    return true;
+  }
+
+  void originate(const u8_t* frame, size_t length) {
+    u32_t messageId;
+    memcpy(&messageId, frame + 2, 4);
+    seen.push_back(messageId);
+    queue.push_back(std::vector<u8_t>(frame, frame + length));
+  }
+
+  void update() {
+    if (queue.empty() || millis() < dueAt) return;
+    if (send(queue.front().data(), queue.front().size())) queue.pop_front();
+  }
+};
+
+struct Result {
+  u32_t expected;
+  u32_t delivered;
+  u32_t transmissions;
+  std::vector<u32_t> latencies;
+
+  float delivery() {
+    return 100.0f * delivered / expected;
+  }
+
+  u32_t latencyP95() {
+    if (latencies.empty()) return 0;
+    std::sort(latencies.begin(), latencies.end());
+    return latencies[latencies.size() * 95 / 100];
+  }
+};
+
+class Simulation {
+  std::vector<float> x, y;
+  std::vector<std::vector<int>> neighbours;
+  std::vector<Transmission> air; // Frames on the air, or ended within the last AIRTIME
+  std::vector<Relay*> relays;
+  std::vector<NaiveFlood> naive;
+  std::vector<std::vector<bool>> delivered;
+  u32_t originatedAt[MESSAGES];
+  int strategy;
+
+  bool inRange(int a, int b) {
+    return hypotf(x[a] - x[b], y[a] - y[b]) <= RANGE;
+  }
+
+  bool overlaps(const Transmission& a, const Transmission& b) {
+    return a.start < b.start + AIRTIME && b.start < a.start + AIRTIME;
+  }
+
+  /**
+   * @brief Every controller must be reachable from the origin within the hops of a message
+   */
+  bool reachable() {
+    std::vector<int> hops(NODES, -1);
+    std::deque<int> next = { 0 };
+    hops[0] = 0;
+    while (!next.empty()) {
+      int node = next.front();
+      next.pop_front();
+      for (int neighbour : neighbours[node]) {
+        if (hops[neighbour] != -1) continue;
+        hops[neighbour] = hops[node] + 1;
+        next.push_back(neighbour);
+      }
+    }
+    return std::all_of(hops.begin(), hops.end(), [](int h) { return h != -1 && h <= RELAY_MAX_HOPS + 1; });
+  }
+
+  /**
+   * @brief Pass a frame that ended now to every neighbour that heard it without a collision
+   */
+  void deliver(const Transmission& transmission) {
+    for (int receiver : neighbours[transmission.node]) {
+      bool collided = false;
+      for (const Transmission& other : air) {
+        if (&other == &transmission || !overlaps(transmission, other)) continue;
+        if (other.node == receiver || inRange(other.node, receiver)) collided = true;
+      }
+      if (!collided) receive(receiver, transmission.frame);
+    }
+  }
+
+  void receive(int node, const std::vector<u8_t>& frame) {
+    current = node;
+    const u8_t* message = frame.data() + RELAY_HEADER_SIZE;
+    size_t messageLength;
+    bool isNew = strategy == NAIVE
+      ? naive[node].receive(frame.data(), frame.size())
+      : relays[node]->receive(frame.data(), frame.size(), &message, &messageLength);
+    if (!isNew) return;
+
+    u16_t index = message[0] | message[1] << 8;
+    if (delivered[node][index]) return;
+    delivered[node][index] = true;
+    result.delivered++;
+    result.latencies.push_back(millis() - originatedAt[index]);
+  }
+
+  void originate(u16_t index) {
+    u8_t message[MESSAGE_SIZE] = { (u8_t)index, (u8_t)(index >> 8) };
+    current = 0;
+    originatedAt[index] = millis();
+
+    if (strategy != NAIVE) {
+      // Sent right away if the channel is free, which it always is at this interval
+      relays[0]->originate(message, sizeof(message));
+      return;
+    }
+    u8_t frame[MESSAGE_SIZE + RELAY_HEADER_SIZE] = { RELAY_FRAME_MAGIC, RELAY_MAX_HOPS };
+    u32_t messageId = (u32_t)random(0x10000) << 16 | (u32_t)random(0x10000);
+    memcpy(frame + 2, &messageId, 4);
+    memcpy(frame + RELAY_HEADER_SIZE, message, sizeof(message));
+    naive[0].originate(frame, sizeof(frame));
+  }
+
+  public:
+  static Simulation* instance; // The send callback of the relay takes no argument
+  static int current;          // The controller whose relay is running
+  Result result = {};
+
+  /**
+   * @brief Place the controllers of a topology, with the origin in the middle
+   *
+   * @param seed Seed of the topology, and of the backoffs
+   * @param strategy NAIVE, or the suppression count of the relays
+   */
+  Simulation(unsigned seed, int strategy) {
+    srand(seed);
+    this->strategy = strategy;
+    instance = this;
+
+    do {
+      x.assign(1, AREA / 2.0f);
+      y.assign(1, AREA / 2.0f);
+      for (int i = 1; i < NODES; i++) {
+        x.push_back(rand() % AREA);
+        y.push_back(rand() % AREA);
+      }
+      neighbours.assign(NODES, {});
+      for (int a = 0; a < NODES; a++) {
+        for (int b = 0; b < NODES; b++) {
+          if (a != b && inRange(a, b)) neighbours[a].push_back(b);
+        }
+      }
+    } while (!reachable());
+
+    for (int i = 0; i < NODES; i++) {
+      relays.push_back(strategy == NAIVE ? nullptr : new Relay(Simulation::send, true, 1024, strategy));
+      naive.push_back(NaiveFlood());
+      naive.back().send = Simulation::send;
+    }
+    delivered.assign(NODES, std::vector<bool>(MESSAGES, false));
+    result.expected = (NODES - 1) * MESSAGES;
+  }
+
+  ~Simulation() {
+    for (Relay* relay : relays) delete relay;
+  }
+
+  /**
+   * @brief Start sending a frame, unless the controller or a neighbour is already sending
+   */
+  static bool send(const u8_t* frame, size_t length) {
+    u32_t now = millis();
+    for (const Transmission& other : instance->air) {
+      if (now < other.start || other.start + AIRTIME <= now) continue;
+      if (other.node == current) return false; // Half duplex
+      // Frames that started in this step are not sensed yet, so neighbours may start together
+      if (other.start < now && instance->inRange(other.node, current)) return false;
+    }
+
+    instance->air.push_back(Transmission{ current, now, std::vector<u8_t>(frame, frame + length) });
+    instance->result.transmissions++;
+    return true;
+  }
+
+  Result run() {
+    mock::now = 1;
+    u32_t end = MESSAGES * MESSAGE_INTERVAL;
+    for (; mock::now < end; mock::now++) {
+      // Receiving never sends, so air does not change while frames are delivered
+      for (const Transmission& transmission : air) {
+        if (transmission.start + AIRTIME == mock::now) deliver(transmission);
+      }
+      air.erase(std::remove_if(air.begin(), air.end(), [](const Transmission& t) { return t.start + 2 * AIRTIME <= mock::now; }), air.end());
+
+      if (mock::now % MESSAGE_INTERVAL == 1) originate(mock::now / MESSAGE_INTERVAL);
+
+      for (current = 0; current < NODES; current++) {
+        if (strategy == NAIVE) naive[current].update();
+        else relays[current]->update();
+      }
+    }
+    return result;
+  }
+};
+
+Simulation* Simulation::instance = nullptr;
+int Simulation::current = 0;
+
+// Totals over every topology, by strategy
+static Result simulate(int strategy) {
+  Result total = {};
+  for (unsigned seed = 1; seed <= TOPOLOGIES; seed++) {
+    Simulation simulation(seed, strategy);
+    Result result = simulation.run();
+    total.expected += result.expected;
+    total.delivered += result.delivered;
+    total.transmissions += result.transmissions;
+    total.latencies.insert(total.latencies.end(), result.latencies.begin(), result.latencies.end());
+  }
+  return total;
+}
+
+static void report(const char* name, Result& result) {
+  char message[160];
+  u32_t messages = TOPOLOGIES * MESSAGES;
+  snprintf(message, sizeof(message), "%s: %.1f%% delivered, p95 latency %lu ms, %.1f transmissions (%.0f ms airtime) per message",
+    name, result.delivery(), (unsigned long)result.latencyP95(), (float)result.transmissions / messages, (float)result.transmissions * AIRTIME / messages);
+  TEST_MESSAGE(message);
+}
+
+void setUp(void) {
+  mock::now = 0;
+}
+
+void tearDown(void) {}
+
+/**
+ * A message reaches controllers RELAY_MAX_HOPS + 1 hops away, but no further
+ */
+void test_hops_bound_the_flood(void) {
+  std::vector<Relay*> line;
+  static std::vector<std::vector<u8_t>> sent;
+  for (int i = 0; i < RELAY_MAX_HOPS + 3; i++) {
+    line.push_back(new Relay([](const u8_t* frame, size_t length) {
+      sent.push_back(std::vector<u8_t>(frame, frame + length));
+      return true;
+    }));
+  }
+
+  const u8_t message[] = { 1, 2, 3 };
+  std::vector<int> reached = { 0 };
+  line[0]->originate(message, sizeof(message));
+  for (size_t node = 1; node < line.size() && !sent.empty(); node++) {
+    std::vector<u8_t> frame = sent.back();
+    sent.clear();
+
+    const u8_t* received;
+    size_t length;
+    if (!line[node]->receive(frame.data(), frame.size(), &received, &length)) break;
+    TEST_ASSERT_EQUAL(sizeof(message), length);
+    reached.push_back(node);
+
+    delay(RELAY_BACKOFF_MAX);
+    line[node]->update();
+  }
+
+  TEST_ASSERT_EQUAL(RELAY_MAX_HOPS + 2, reached.size());
+  for (Relay* relay : line) delete relay;
+}
+
+void test_duplicate_is_not_delivered_again(void) {
+  static std::vector<u8_t> sent;
+  Relay origin([](const u8_t* frame, size_t length) {
+    sent.assign(frame, frame + length);
+    return true;
+  });
+  Relay relay([](const u8_t* frame, size_t length) { return true; });
+
+  const u8_t message[] = { 1, 2, 3 };
+  origin.originate(message, sizeof(message));
+
+  const u8_t* received;
+  size_t length;
+  TEST_ASSERT_TRUE(relay.receive(sent.data(), sent.size(), &received, &length));
+  TEST_ASSERT_FALSE(relay.receive(sent.data(), sent.size(), &received, &length));
+  TEST_ASSERT_EQUAL(1, relay.getStats().duplicates);
+}
+
+/**
+ * Compare suppression counts with naive flooding. RELAY_SUPPRESS_COUNT must deliver nearly every
+ * message, with less airtime than naive flooding. A lower count saves more airtime, but misses
+ * controllers on sparse topologies.
+ */
+void test_simulated_flooding(void) {
+  Result naive = simulate(NAIVE);
+  report("Naive flooding", naive);
+
+  for (int count = 2; count <= 4; count++) {
+    Result relay = simulate(count);
+    char name[32];
+    snprintf(name, sizeof(name), "Relay, suppression after %d", count);
+    report(name, relay);
+
+    if (count != RELAY_SUPPRESS_COUNT) continue;
+    TEST_ASSERT_TRUE(97.0f <= relay.delivery());
+    TEST_ASSERT_TRUE(relay.transmissions < naive.transmissions);
+  }
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_hops_bound_the_flood);
+  RUN_TEST(test_duplicate_is_not_delivered_again);
+  RUN_TEST(test_simulated_flooding);
+  return UNITY_END();
+}
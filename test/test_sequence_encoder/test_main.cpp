@@ -0,0 +1,141 @@
+#include <unity.h>
+#include <chrono>
+#include <new>
+#include <vector>
+#include "leds/layers/colors/colors.h"
+#include "leds/layers/masks/masks.h"
+#include "leds/serialization/sequence_decoder.h"
+#include "leds/serialization/sequence_encoder.h"
+
+// Heap allocations made while counting is enabled
+static bool counting = false;
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+  if (counting) allocations++;
+  void* pointer = malloc(size);
+  if (pointer == nullptr) throw std::bad_alloc();
+  return pointer;
+}
+
+void operator delete(void* pointer) noexcept {
+  free(pointer);
+}
+
+void operator delete(void* pointer, size_t size) noexcept {
+  free(pointer);
+}
+
+static Sequence* sequence = nullptr;
+
+static Sequence* createSequence() {
+  Sequence* created = new Sequence();
+  std::vector<CRGB> colors = { CRGB(255, 0, 0), CRGB(0, 255, 0), CRGB(0, 0, 255), CRGB(255, 255, 0) };
+  created->animations.push_back(new Animation{ { new FadeColor(colors, 1200), new StarsMask(300, 5, 1) }, 400, Direction::FORWARD, 255, 0 });
+  created->animations.push_back(new Animation{ { new SectionsColor(colors, 40), new WaveMask(60, 20, 100) }, 800, Direction::BACKWARD, 128, 10 });
+  created->animations.push_back(new Animation{ { new SingleColor(CRGB(12, 34, 56)), new SectionsMask({ 255, 0, 255, 0 }, 20) }, 200, Direction::FORWARD, 200, 0 });
+  return created;
+}
+
+static size_t encode(Sequence* encoded, uint8_t* buffer, size_t size) {
+  pb_ostream_t stream = pb_ostream_from_buffer(buffer, size);
+  if (!SequenceEncoder::encode(&stream, encoded)) return 0;
+  return stream.bytes_written;
+}
+
+void setUp(void) {
+  sequence = createSequence();
+  counting = false;
+  allocations = 0;
+}
+
+void tearDown(void) {
+  Sequence::destroy(sequence);
+}
+
+void test_encoding_allocates_nothing(void) {
+  uint8_t buffer[1024];
+
+  counting = true;
+  size_t length = encode(sequence, buffer, sizeof(buffer));
+  counting = false;
+
+  TEST_ASSERT_GREATER_THAN(0, length);
+  TEST_ASSERT_EQUAL(0, allocations);
+}
+
+void test_sizing_matches_encoding(void) {
+  uint8_t buffer[1024];
+  pb_ostream_t sizing = PB_OSTREAM_SIZING;
+
+  TEST_ASSERT_TRUE(SequenceEncoder::encode(&sizing, sequence));
+  TEST_ASSERT_EQUAL(sizing.bytes_written, encode(sequence, buffer, sizeof(buffer)));
+}
+
+void test_decoded_sequence_encodes_identically(void) {
+  uint8_t buffer[1024];
+  size_t length = encode(sequence, buffer, sizeof(buffer));
+
+  Sequence* decoded = new Sequence();
+  pb_istream_t stream = pb_istream_from_buffer(buffer, length);
+  TEST_ASSERT_TRUE(SequenceDecoder::decode(&stream, decoded));
+  TEST_ASSERT_EQUAL(3, decoded->animations.size());
+
+  uint8_t reencoded[1024];
+  TEST_ASSERT_EQUAL(length, encode(decoded, reencoded, sizeof(reencoded)));
+  TEST_ASSERT_EQUAL_MEMORY(buffer, reencoded, length);
+  Sequence::destroy(decoded);
+}
+
+void test_palette_after_animations_is_rejected(void) {
+  uint8_t buffer[1024];
+  size_t length = encode(sequence, buffer, sizeof(buffer));
+  TEST_ASSERT_EQUAL_UINT8((1 << 3) | PB_WT_STRING, buffer[0]); // The packed palette comes first
+
+  // Move the palette behind the animations, as a different encoder could have written it
+  pb_istream_t field = pb_istream_from_buffer(buffer + 1, length - 1);
+  uint32_t paletteLength;
+  TEST_ASSERT_TRUE(pb_decode_varint32(&field, &paletteLength));
+  size_t paletteEnd = length - field.bytes_left + paletteLength;
+  std::vector<uint8_t> reordered(buffer + paletteEnd, buffer + length);
+  reordered.insert(reordered.end(), buffer, buffer + paletteEnd);
+
+  Sequence* decoded = new Sequence();
+  pb_istream_t stream = pb_istream_from_buffer(reordered.data(), reordered.size());
+  TEST_ASSERT_FALSE(SequenceDecoder::decode(&stream, decoded));
+  Sequence::destroy(decoded);
+}
+
+void test_encoding_into_a_short_buffer_fails(void) {
+  uint8_t buffer[1024];
+  size_t length = encode(sequence, buffer, sizeof(buffer));
+
+  TEST_ASSERT_EQUAL(0, encode(sequence, buffer, length - 1));
+}
+
+void test_encode_throughput(void) {
+  uint8_t buffer[1024];
+  const size_t runs = 20000;
+  size_t bytes = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < runs; i++) {
+    bytes += encode(sequence, buffer, sizeof(buffer));
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  char message[80];
+  snprintf(message, sizeof(message), "Encoded %.0f sequences/s, %.1f MB/s", runs / seconds, bytes / seconds / 1e6);
+  TEST_MESSAGE(message);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_encoding_allocates_nothing);
+  RUN_TEST(test_sizing_matches_encoding);
+  RUN_TEST(test_decoded_sequence_encodes_identically);
+  RUN_TEST(test_palette_after_animations_is_rejected);
+  RUN_TEST(test_encoding_into_a_short_buffer_fails);
+  RUN_TEST(test_encode_throughput);
+  return UNITY_END();
+}
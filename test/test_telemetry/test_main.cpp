@@ -0,0 +1,176 @@
+#include <unity.h>
+#include <vector>
+#include "diagnostics/telemetry.h"
+#include "connectivity/serialization/message_decoder.h"
+#include "leds/layers/colors/colors.h"
+#include "leds/layers/masks/masks.h"
+#include "leds/serialization/sequence_encoder.h"
+
+// The allocation counters are static and count since the start of the test run, so the tests
+// compare them before and after
+
+static void varint(std::vector<u8_t>& out, u32_t value) {
+  do {
+    u8_t byte = value & 0x7F;
+    value >>= 7;
+    out.push_back(value ? byte | 0x80 : byte);
+  } while (value);
+}
+
+static void field(std::vector<u8_t>& out, u32_t tag, const std::vector<u8_t>& content) {
+  varint(out, (tag << 3) | PB_WT_STRING);
+  varint(out, content.size());
+  out.insert(out.end(), content.begin(), content.end());
+}
+
+// A broadcast for groups 1 to `groups`, of a sequence whose colors are encoded in a palette. The
+// groups precede the sequence, and an invalid layer at its end fails the decoding if requested.
+static std::vector<u8_t> broadcast(u32_t groups, bool invalid = false) {
+  Sequence* sequence = new Sequence();
+  std::vector<CRGB> colors = { CRGB(255, 0, 0), CRGB(0, 255, 0), CRGB(0, 0, 255) };
+  sequence->animations.push_back(new Animation{ { new FadeColor(colors, 1200) }, 400, Direction::FORWARD, 255, 0 });
+  sequence->animations.push_back(new Animation{ { new SectionsColor(colors, 40) }, 400, Direction::FORWARD, 255, 0 });
+  u8_t buffer[256];
+  pb_ostream_t stream = pb_ostream_from_buffer(buffer, sizeof(buffer));
+  TEST_ASSERT_TRUE(SequenceEncoder::encode(&stream, sequence));
+  Sequence::destroy(sequence);
+  std::vector<u8_t> encoded(buffer, buffer + stream.bytes_written);
+  TEST_ASSERT_EQUAL_UINT8((protocol_Sequence_palette_tag << 3) | PB_WT_STRING, encoded[0]);
+  if (invalid) {
+    std::vector<u8_t> layer = { (protocol_Layer_type_tag << 3) | PB_WT_VARINT, protocol_LayerType_FadeColor }; // Without colors
+    std::vector<u8_t> animation;
+    field(animation, protocol_Animation_layers_tag, layer);
+    field(encoded, protocol_Sequence_animations_tag, animation);
+  }
+
+  std::vector<u8_t> targetGroups;
+  for (u32_t group = 1; group <= groups; group++) varint(targetGroups, group);
+  std::vector<u8_t> wrapped;
+  field(wrapped, protocol_BroadcastSequence_target_groups_tag, targetGroups);
+  field(wrapped, protocol_BroadcastSequence_sequence_tag, encoded);
+  std::vector<u8_t> message;
+  field(message, protocol_Message_broadcast_sequence_tag, wrapped);
+  return message;
+}
+
+static AllocationStats decoderDuringCallback;
+static size_t groupsDuringCallback;
+
+static void onBroadcast(Sequence* sequence, std::vector<uint32_t>* groups) {
+  decoderDuringCallback = Telemetry::getAllocationStats(Subsystem::DECODER);
+  groupsDuringCallback = groups->size();
+  Sequence::destroy(sequence);
+}
+
+void setUp(void) {
+  mock::now = 0;
+}
+
+void tearDown(void) {}
+
+void test_counters_track_live_and_peak_bytes(void) {
+  AllocationStats before = Telemetry::getAllocationStats(Subsystem::RADIO);
+  Telemetry::allocated(Subsystem::RADIO, 100);
+  Telemetry::allocated(Subsystem::RADIO, 50);
+  Telemetry::released(Subsystem::RADIO, 100);
+  AllocationStats after = Telemetry::getAllocationStats(Subsystem::RADIO);
+
+  TEST_ASSERT_EQUAL(before.allocations + 2, after.allocations);
+  TEST_ASSERT_EQUAL(before.frees + 1, after.frees);
+  TEST_ASSERT_EQUAL(before.liveBytes + 50, after.liveBytes);
+  TEST_ASSERT_GREATER_OR_EQUAL(before.liveBytes + 150, after.peakBytes);
+  Telemetry::released(Subsystem::RADIO, 50);
+}
+
+void test_reallocation_releases_previous_buffer(void) {
+  AllocationStats before = Telemetry::getAllocationStats(Subsystem::RADIO);
+  Telemetry::reallocated(Subsystem::RADIO, 0, 64);
+  Telemetry::reallocated(Subsystem::RADIO, 64, 64);
+  Telemetry::reallocated(Subsystem::RADIO, 64, 128);
+  AllocationStats grown = Telemetry::getAllocationStats(Subsystem::RADIO);
+  TEST_ASSERT_EQUAL(before.allocations + 2, grown.allocations);
+  TEST_ASSERT_EQUAL(before.frees + 1, grown.frees);
+  TEST_ASSERT_EQUAL(before.liveBytes + 128, grown.liveBytes);
+
+  Telemetry::reallocated(Subsystem::RADIO, 128, 0);
+  TEST_ASSERT_EQUAL(before.liveBytes, Telemetry::getAllocationStats(Subsystem::RADIO).liveBytes);
+}
+
+/**
+ * The palette and the target groups are decoder scratch. They are held during the callback, and
+ * released once the message is decoded.
+ */
+void test_decoder_scratch_is_attributed_and_released(void) {
+  std::vector<u8_t> message = broadcast(3);
+  MessageDecoder decoder;
+  decoder.setOnBroadcastSequenceReceived(onBroadcast);
+  decoder.setGroup(2);
+
+  AllocationStats before = Telemetry::getAllocationStats(Subsystem::DECODER);
+  TEST_ASSERT_TRUE(decoder.decode(message.data(), message.size()));
+  AllocationStats after = Telemetry::getAllocationStats(Subsystem::DECODER);
+
+  TEST_ASSERT_EQUAL(3, groupsDuringCallback);
+  TEST_ASSERT_EQUAL(before.liveBytes + 3 * sizeof(uint32_t), decoderDuringCallback.liveBytes);
+  TEST_ASSERT_EQUAL(before.allocations + 2, after.allocations); // The palette and the groups
+  TEST_ASSERT_EQUAL(before.frees + 2, after.frees);
+  TEST_ASSERT_EQUAL(before.liveBytes, after.liveBytes);
+}
+
+void test_failed_decoding_releases_scratch(void) {
+  std::vector<u8_t> message = broadcast(3, true);
+  MessageDecoder decoder;
+  decoder.setOnBroadcastSequenceReceived(onBroadcast);
+  decoder.setGroup(2);
+
+  AllocationStats before = Telemetry::getAllocationStats(Subsystem::DECODER);
+  TEST_ASSERT_FALSE(decoder.decode(message.data(), message.size()));
+  AllocationStats after = Telemetry::getAllocationStats(Subsystem::DECODER);
+  TEST_ASSERT_EQUAL(before.allocations + 2, after.allocations);
+  TEST_ASSERT_EQUAL(before.frees + 2, after.frees);
+  TEST_ASSERT_EQUAL(before.liveBytes, after.liveBytes);
+}
+
+void test_encodable_holds_sample_and_counters(void) {
+  ESP.freeHeap = 200000;
+  ESP.maxAllocHeap = 110000;
+  ESP.minFreeHeap = 190000;
+  mock::stackFree = 5212;
+  mock::now = 61000;
+  int task;
+  Telemetry::watchTask("loop", &task);
+  Telemetry telemetry(0);
+  Telemetry::allocated(Subsystem::LAYERS, 40);
+
+  protocol_Diagnostics diagnostics = telemetry.toEncodable();
+  TEST_ASSERT_EQUAL(61000, diagnostics.uptime);
+  TEST_ASSERT_EQUAL(200000, diagnostics.free_heap);
+  TEST_ASSERT_EQUAL(110000, diagnostics.largest_free_block);
+  TEST_ASSERT_EQUAL(190000, diagnostics.min_free_heap);
+  TEST_ASSERT_EQUAL(1, diagnostics.stacks_count);
+  TEST_ASSERT_EQUAL_STRING("loop", diagnostics.stacks[0].name);
+  TEST_ASSERT_EQUAL(5212, diagnostics.stacks[0].free);
+
+  TEST_ASSERT_EQUAL((size_t)Subsystem::COUNT, diagnostics.allocations_count);
+  for (size_t i = 0; i < (size_t)Subsystem::COUNT; i++) {
+    AllocationStats stats = Telemetry::getAllocationStats((Subsystem)i);
+    TEST_ASSERT_EQUAL(i, diagnostics.allocations[i].subsystem);
+    TEST_ASSERT_EQUAL(stats.allocations, diagnostics.allocations[i].allocations);
+    TEST_ASSERT_EQUAL(stats.frees, diagnostics.allocations[i].frees);
+    TEST_ASSERT_EQUAL(stats.liveBytes, diagnostics.allocations[i].live_bytes);
+    TEST_ASSERT_EQUAL(stats.peakBytes, diagnostics.allocations[i].peak_bytes);
+  }
+  TEST_ASSERT_EQUAL(protocol_Subsystem_Decoder, diagnostics.allocations[(size_t)Subsystem::DECODER].subsystem);
+  TEST_ASSERT_EQUAL(protocol_Subsystem_Radio, diagnostics.allocations[(size_t)Subsystem::RADIO].subsystem);
+  Telemetry::released(Subsystem::LAYERS, 40);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_counters_track_live_and_peak_bytes);
+  RUN_TEST(test_reallocation_releases_previous_buffer);
+  RUN_TEST(test_decoder_scratch_is_attributed_and_released);
+  RUN_TEST(test_failed_decoding_releases_scratch);
+  RUN_TEST(test_encodable_holds_sample_and_counters);
+  return UNITY_END();
+}
@@ -0,0 +1,175 @@
+/**
+ * Serial framing shared with the controller firmware (src/connectivity/framing.h)
+ * Frame on the wire: 0x00 + COBS(payload + CRC-32 little-endian) + 0x00
+ */
+
+export const FRAME_DELIMITER = 0x00
+export const FRAME_CRC_SIZE = 4
+/** First byte of a log frame from the controller (src/diagnostics/log.h), followed by the text */
+export const LOG_FRAME_MAGIC = 0xef
+
+const CRC32_TABLE = (() => {
+  const table = new Uint32Array(256)
+  for (let i = 0; i < 256; i++) {
+    let crc = i
+    for (let bit = 0; bit < 8; bit++) {
+      crc = crc & 1 ? (crc >>> 1) ^ 0xedb88320 : crc >>> 1
+    }
+    table[i] = crc >>> 0
+  }
+  return table
+})()
+
+/**
+ * Calculate the CRC-32 (IEEE 802.3, as used by zlib) of the data
+ * @param data Bytes to checksum
+ * @returns CRC as unsigned 32-bit number
+ */
+export function crc32(data: Uint8Array): number {
+  let crc = 0xffffffff
+  for (const byte of data) {
+    crc = CRC32_TABLE[(crc ^ byte) & 0xff]! ^ (crc >>> 8)
+  }
+  return (crc ^ 0xffffffff) >>> 0
+}
+
+/**
+ * Build a frame from a payload: append the CRC, COBS encode and enclose in delimiters
+ * @param payload Bytes to frame, e.g. a serialized protocol.Message
+ * @returns The bytes to write to the serial port
+ */
+export function encodeFrame(payload: Uint8Array): Uint8Array {
+  const crc = crc32(payload)
+  const data = new Uint8Array(payload.length + 4)
+  data.set(payload)
+  data.set([crc & 0xff, (crc >>> 8) & 0xff, (crc >>> 16) & 0xff, (crc >>> 24) & 0xff], payload.length)
+
+  const output = new Uint8Array(data.length + Math.floor(data.length / 254) + 3)
+  output[0] = FRAME_DELIMITER
+  let codeIndex = 1
+  let outputIndex = 2
+  let code = 1
+
+  for (const byte of data) {
+    if (byte !== 0) {
+      output[outputIndex++] = byte
+      code++
+    }
+
+    if (byte === 0 || code === 0xff) {
+      output[codeIndex] = code
+      code = 1
+      codeIndex = outputIndex++
+    }
+  }
+
+  output[codeIndex] = code
+  output[outputIndex++] = FRAME_DELIMITER
+  return output.slice(0, outputIndex)
+}
+
+/**
+ * COBS decode a frame, excluding its delimiters
+ * @param data The encoded bytes
+ * @returns The decoded bytes, or null if the data is not valid COBS
+ */
+export function cobsDecode(data: Uint8Array): Uint8Array | null {
+  const output = new Uint8Array(data.length)
+  let readIndex = 0
+  let writeIndex = 0
+
+  while (readIndex < data.length) {
+    const code = data[readIndex++]!
+    if (code === 0 || readIndex + code - 1 > data.length) return null
+
+    for (let i = 1; i < code; i++) {
+      output[writeIndex++] = data[readIndex++]!
+    }
+
+    // A zero is implied after every block, except after full blocks and the last block
+    if (code !== 0xff && readIndex < data.length) {
+      output[writeIndex++] = 0
+    }
+  }
+
+  return output.slice(0, writeIndex)
+}
+
+export interface FrameStats {
+  frames: number
+  crcErrors: number
+  framingErrors: number
+  overflows: number
+}
+
+/**
+ * Reassembles frames from bytes read in arbitrary chunks, like FrameDecoder in the firmware.
+ * Bytes outside frames, and frames that fail COBS or the CRC, are dropped up to the next delimiter.
+ */
+export class FrameDecoder {
+  private buffer: Uint8Array
+  private length = 0
+  private discarding = false
+  readonly stats: FrameStats = { frames: 0, crcErrors: 0, framingErrors: 0, overflows: 0 }
+
+  /**
+   * @param onFrame Called with the payload of every valid frame
+   * @param maxPayloadSize The largest payload that can be received, excluding the CRC
+   */
+  constructor(
+    private onFrame: (payload: Uint8Array) => void,
+    maxPayloadSize = 4096,
+  ) {
+    const size = maxPayloadSize + FRAME_CRC_SIZE
+    this.buffer = new Uint8Array(size + Math.floor(size / 254) + 1)
+  }
+
+  /**
+   * Feed received bytes. Complete frames are delivered as soon as their delimiter is seen.
+   * @param data The received bytes
+   */
+  push(data: Uint8Array) {
+    for (const byte of data) {
+      if (byte === FRAME_DELIMITER) {
+        this.completeFrame()
+        continue
+      }
+
+      if (this.discarding) continue
+
+      if (this.length === this.buffer.length) {
+        this.stats.overflows++
+        this.discarding = true
+        continue
+      }
+
+      this.buffer[this.length++] = byte
+    }
+  }
+
+  private completeFrame() {
+    const frame = this.buffer.subarray(0, this.length)
+    const discarded = this.discarding
+    this.length = 0
+    this.discarding = false
+
+    if (discarded || frame.length === 0) return
+
+    const decoded = cobsDecode(frame)
+    if (decoded === null || decoded.length <= FRAME_CRC_SIZE) {
+      this.stats.framingErrors++
+      return
+    }
+
+    const payload = decoded.subarray(0, decoded.length - FRAME_CRC_SIZE)
+    const trailer = decoded.subarray(payload.length)
+    const expected = (trailer[0]! | (trailer[1]! << 8) | (trailer[2]! << 16) | (trailer[3]! << 24)) >>> 0
+    if (crc32(payload) !== expected) {
+      this.stats.crcErrors++
+      return
+    }
+
+    this.stats.frames++
+    this.onFrame(payload)
+  }
+}
@@ -21,12 +21,36 @@ export namespace protocol {
         SectionsWaveMask = 55,
         SectionsMask = 56,
         StarsMask = 57,
-        WaveMask = 58
+        WaveMask = 58,
+        SectionsRandomMask = 59
+    }
+    export enum LayerField {
+        NoField = 0,
+        DurationField = 2,
+        LengthField = 3,
+        ColorField = 4,
+        GapField = 5,
+        FrequencyField = 6,
+        SpeedField = 7,
+        ColorsField = 8,
+        SectionsField = 9
     }
     export enum Direction {
         FORWARD = 0,
         BACKWARD = 1
     }
+    export enum Subsystem {
+        Decoder = 0,
+        Scheduler = 1,
+        Layers = 2,
+        Radio = 3
+    }
+    export enum Link {
+        RadioLink = 0,
+        ESPNowLink = 1,
+        BluetoothLink = 2,
+        SerialLink = 3
+    }
     export class Layer extends pb_1.Message {
         #one_of_decls: number[][] = [];
         constructor(data?: any[] | {
@@ -39,6 +63,7 @@ export namespace protocol {
             speed?: number;
             colors?: number[];
             sections?: Uint8Array;
+            color_indexes?: Uint8Array;
         }) {
             super();
             pb_1.Message.initialize(this, Array.isArray(data) ? data : [], 0, -1, [8], this.#one_of_decls);
@@ -70,6 +95,9 @@ export namespace protocol {
                 if ("sections" in data && data.sections != undefined) {
                     this.sections = data.sections;
                 }
+                if ("color_indexes" in data && data.color_indexes != undefined) {
+                    this.color_indexes = data.color_indexes;
+                }
             }
         }
         get type() {
@@ -126,6 +154,12 @@ export namespace protocol {
         set sections(value: Uint8Array) {
             pb_1.Message.setField(this, 9, value);
         }
+        get color_indexes() {
+            return pb_1.Message.getFieldWithDefault(this, 10, new Uint8Array(0)) as Uint8Array;
+        }
+        set color_indexes(value: Uint8Array) {
+            pb_1.Message.setField(this, 10, value);
+        }
         static fromObject(data: {
             type?: LayerType;
             duration?: number;
@@ -136,6 +170,7 @@ export namespace protocol {
             speed?: number;
             colors?: number[];
             sections?: Uint8Array;
+            color_indexes?: Uint8Array;
         }): Layer {
             const message = new Layer({});
             if (data.type != null) {
@@ -165,6 +200,9 @@ export namespace protocol {
             if (data.sections != null) {
                 message.sections = data.sections;
             }
+            if (data.color_indexes != null) {
+                message.color_indexes = data.color_indexes;
+            }
             return message;
         }
         toObject() {
@@ -178,6 +216,7 @@ export namespace protocol {
                 speed?: number;
                 colors?: number[];
                 sections?: Uint8Array;
+                color_indexes?: Uint8Array;
             } = {};
             if (this.type != null) {
                 data.type = this.type;
@@ -206,6 +245,9 @@ export namespace protocol {
             if (this.sections != null) {
                 data.sections = this.sections;
             }
+            if (this.color_indexes != null) {
+                data.color_indexes = this.color_indexes;
+            }
             return data;
         }
         serialize(): Uint8Array;
@@ -230,6 +272,8 @@ export namespace protocol {
                 writer.writePackedUint32(8, this.colors);
             if (this.sections.length)
                 writer.writeBytes(9, this.sections);
+            if (this.color_indexes.length)
+                writer.writeBytes(10, this.color_indexes);
             if (!w)
                 return writer.getResultBuffer();
         }
@@ -266,6 +310,9 @@ export namespace protocol {
                     case 9:
                         message.sections = reader.readBytes();
                         break;
+                    case 10:
+                        message.color_indexes = reader.readBytes();
+                        break;
                     default: reader.skipField();
                 }
             }
@@ -440,16 +487,26 @@ export namespace protocol {
     export class Sequence extends pb_1.Message {
         #one_of_decls: number[][] = [];
         constructor(data?: any[] | {
+            palette?: number[];
             animations?: Animation[];
         }) {
             super();
-            pb_1.Message.initialize(this, Array.isArray(data) ? data : [], 0, -1, [2], this.#one_of_decls);
+            pb_1.Message.initialize(this, Array.isArray(data) ? data : [], 0, -1, [1, 2], this.#one_of_decls);
             if (!Array.isArray(data) && typeof data == "object") {
+                if ("palette" in data && data.palette != undefined) {
+                    this.palette = data.palette;
+                }
                 if ("animations" in data && data.animations != undefined) {
                     this.animations = data.animations;
                 }
             }
         }
+        get palette() {
+            return pb_1.Message.getFieldWithDefault(this, 1, []) as number[];
+        }
+        set palette(value: number[]) {
+            pb_1.Message.setField(this, 1, value);
+        }
         get animations() {
             return pb_1.Message.getRepeatedWrapperField(this, Animation, 2) as Animation[];
         }
@@ -457,9 +514,13 @@ export namespace protocol {
             pb_1.Message.setRepeatedWrapperField(this, 2, value);
         }
         static fromObject(data: {
+            palette?: number[];
             animations?: ReturnType<typeof Animation.prototype.toObject>[];
         }): Sequence {
             const message = new Sequence({});
+            if (data.palette != null) {
+                message.palette = data.palette;
+            }
             if (data.animations != null) {
                 message.animations = data.animations.map(item => Animation.fromObject(item));
             }
@@ -467,8 +528,12 @@ export namespace protocol {
         }
         toObject() {
             const data: {
+                palette?: number[];
                 animations?: ReturnType<typeof Animation.prototype.toObject>[];
             } = {};
+            if (this.palette != null) {
+                data.palette = this.palette;
+            }
             if (this.animations != null) {
                 data.animations = this.animations.map((item: Animation) => item.toObject());
             }
@@ -478,6 +543,8 @@ export namespace protocol {
         serialize(w: pb_1.BinaryWriter): void;
         serialize(w?: pb_1.BinaryWriter): Uint8Array | void {
             const writer = w || new pb_1.BinaryWriter();
+            if (this.palette.length)
+                writer.writePackedUint32(1, this.palette);
             if (this.animations.length)
                 writer.writeRepeatedMessage(2, this.animations, (item: Animation) => item.serialize(writer));
             if (!w)
@@ -489,6 +556,9 @@ export namespace protocol {
                 if (reader.isEndGroup())
                     break;
                 switch (reader.getFieldNumber()) {
+                    case 1:
+                        message.palette = reader.readPackedUint32();
+                        break;
                     case 2:
                         reader.readMessage(message.animations, () => pb_1.Message.addToRepeatedWrapperField(message, 2, Animation.deserialize(reader), Animation));
                         break;
@@ -687,64 +757,112 @@ export namespace protocol {
             return BroadcastSequence.deserialize(bytes);
         }
     }
-    export class State extends pb_1.Message {
+    export class SubsystemAllocations extends pb_1.Message {
         #one_of_decls: number[][] = [];
         constructor(data?: any[] | {
-            sequence?: Sequence;
-            settings?: Settings;
+            subsystem?: Subsystem;
+            allocations?: number;
+            frees?: number;
+            live_bytes?: number;
+            peak_bytes?: number;
         }) {
             super();
             pb_1.Message.initialize(this, Array.isArray(data) ? data : [], 0, -1, [], this.#one_of_decls);
             if (!Array.isArray(data) && typeof data == "object") {
-                if ("sequence" in data && data.sequence != undefined) {
-                    this.sequence = data.sequence;
+                if ("subsystem" in data && data.subsystem != undefined) {
+                    this.subsystem = data.subsystem;
                 }
-                if ("settings" in data && data.settings != undefined) {
-                    this.settings = data.settings;
+                if ("allocations" in data && data.allocations != undefined) {
+                    this.allocations = data.allocations;
+                }
+                if ("frees" in data && data.frees != undefined) {
+                    this.frees = data.frees;
+                }
+                if ("live_bytes" in data && data.live_bytes != undefined) {
+                    this.live_bytes = data.live_bytes;
+                }
+                if ("peak_bytes" in data && data.peak_bytes != undefined) {
+                    this.peak_bytes = data.peak_bytes;
                 }
             }
         }
-        get sequence() {
-            return pb_1.Message.getWrapperField(this, Sequence, 1) as Sequence;
+        get subsystem() {
+            return pb_1.Message.getFieldWithDefault(this, 1, Subsystem.Decoder) as Subsystem;
         }
-        set sequence(value: Sequence) {
-            pb_1.Message.setWrapperField(this, 1, value);
+        set subsystem(value: Subsystem) {
+            pb_1.Message.setField(this, 1, value);
         }
-        get has_sequence() {
-            return pb_1.Message.getField(this, 1) != null;
+        get allocations() {
+            return pb_1.Message.getFieldWithDefault(this, 2, 0) as number;
         }
-        get settings() {
-            return pb_1.Message.getWrapperField(this, Settings, 2) as Settings;
+        set allocations(value: number) {
+            pb_1.Message.setField(this, 2, value);
         }
-        set settings(value: Settings) {
-            pb_1.Message.setWrapperField(this, 2, value);
+        get frees() {
+            return pb_1.Message.getFieldWithDefault(this, 3, 0) as number;
         }
-        get has_settings() {
-            return pb_1.Message.getField(this, 2) != null;
+        set frees(value: number) {
+            pb_1.Message.setField(this, 3, value);
+        }
+        get live_bytes() {
+            return pb_1.Message.getFieldWithDefault(this, 4, 0) as number;
+        }
+        set live_bytes(value: number) {
+            pb_1.Message.setField(this, 4, value);
+        }
+        get peak_bytes() {
+            return pb_1.Message.getFieldWithDefault(this, 5, 0) as number;
+        }
+        set peak_bytes(value: number) {
+            pb_1.Message.setField(this, 5, value);
         }
         static fromObject(data: {
-            sequence?: ReturnType<typeof Sequence.prototype.toObject>;
-            settings?: ReturnType<typeof Settings.prototype.toObject>;
-        }): State {
-            const message = new State({});
-            if (data.sequence != null) {
-                message.sequence = Sequence.fromObject(data.sequence);
+            subsystem?: Subsystem;
+            allocations?: number;
+            frees?: number;
+            live_bytes?: number;
+            peak_bytes?: number;
+        }): SubsystemAllocations {
+            const message = new SubsystemAllocations({});
+            if (data.subsystem != null) {
+                message.subsystem = data.subsystem;
             }
-            if (data.settings != null) {
-                message.settings = Settings.fromObject(data.settings);
+            if (data.allocations != null) {
+                message.allocations = data.allocations;
+            }
+            if (data.frees != null) {
+                message.frees = data.frees;
+            }
+            if (data.live_bytes != null) {
+                message.live_bytes = data.live_bytes;
+            }
+            if (data.peak_bytes != null) {
+                message.peak_bytes = data.peak_bytes;
             }
             return message;
         }
         toObject() {
             const data: {
-                sequence?: ReturnType<typeof Sequence.prototype.toObject>;
-                settings?: ReturnType<typeof Settings.prototype.toObject>;
+                subsystem?: Subsystem;
+                allocations?: number;
+                frees?: number;
+                live_bytes?: number;
+                peak_bytes?: number;
             } = {};
-            if (this.sequence != null) {
-                data.sequence = this.sequence.toObject();
+            if (this.subsystem != null) {
+                data.subsystem = this.subsystem;
             }
-            if (this.settings != null) {
-                data.settings = this.settings.toObject();
+            if (this.allocations != null) {
+                data.allocations = this.allocations;
+            }
+            if (this.frees != null) {
+                data.frees = this.frees;
+            }
+            if (this.live_bytes != null) {
+                data.live_bytes = this.live_bytes;
+            }
+            if (this.peak_bytes != null) {
+                data.peak_bytes = this.peak_bytes;
             }
             return data;
         }
@@ -752,24 +870,39 @@ export namespace protocol {
         serialize(w: pb_1.BinaryWriter): void;
         serialize(w?: pb_1.BinaryWriter): Uint8Array | void {
             const writer = w || new pb_1.BinaryWriter();
-            if (this.has_sequence)
-                writer.writeMessage(1, this.sequence, () => this.sequence.serialize(writer));
-            if (this.has_settings)
-                writer.writeMessage(2, this.settings, () => this.settings.serialize(writer));
+            if (this.subsystem != Subsystem.Decoder)
+                writer.writeEnum(1, this.subsystem);
+            if (this.allocations != 0)
+                writer.writeUint32(2, this.allocations);
+            if (this.frees != 0)
+                writer.writeUint32(3, this.frees);
+            if (this.live_bytes != 0)
+                writer.writeUint32(4, this.live_bytes);
+            if (this.peak_bytes != 0)
+                writer.writeUint32(5, this.peak_bytes);
             if (!w)
                 return writer.getResultBuffer();
         }
-        static deserialize(bytes: Uint8Array | pb_1.BinaryReader): State {
-            const reader = bytes instanceof pb_1.BinaryReader ? bytes : new pb_1.BinaryReader(bytes), message = new State();
+        static deserialize(bytes: Uint8Array | pb_1.BinaryReader): SubsystemAllocations {
+            const reader = bytes instanceof pb_1.BinaryReader ? bytes : new pb_1.BinaryReader(bytes), message = new SubsystemAllocations();
             while (reader.nextField()) {
                 if (reader.isEndGroup())
                     break;
                 switch (reader.getFieldNumber()) {
                     case 1:
-                        reader.readMessage(message.sequence, () => message.sequence = Sequence.deserialize(reader));
+                        message.subsystem = reader.readEnum();
                         break;
                     case 2:
-                        reader.readMessage(message.settings, () => message.settings = Settings.deserialize(reader));
+                        message.allocations = reader.readUint32();
+                        break;
+                    case 3:
+                        message.frees = reader.readUint32();
+                        break;
+                    case 4:
+                        message.live_bytes = reader.readUint32();
+                        break;
+                    case 5:
+                        message.peak_bytes = reader.readUint32();
                         break;
                     default: reader.skipField();
                 }
@@ -779,168 +912,62 @@ export namespace protocol {
         serializeBinary(): Uint8Array {
             return this.serialize();
         }
-        static deserializeBinary(bytes: Uint8Array): State {
-            return State.deserialize(bytes);
+        static deserializeBinary(bytes: Uint8Array): SubsystemAllocations {
+            return SubsystemAllocations.deserialize(bytes);
         }
     }
-    export class Message extends pb_1.Message {
-        #one_of_decls: number[][] = [[1, 2, 3, 4, 5]];
-        constructor(data?: any[] | ({} & (({
-            sequence?: Sequence;
-            broadcast_sequence?: never;
-            save_state?: never;
-            request_state?: never;
-            response_state?: never;
-        } | {
-            sequence?: never;
-            broadcast_sequence?: BroadcastSequence;
-            save_state?: never;
-            request_state?: never;
-            response_state?: never;
-        } | {
-            sequence?: never;
-            broadcast_sequence?: never;
-            save_state?: State;
-            request_state?: never;
-            response_state?: never;
-        } | {
-            sequence?: never;
-            broadcast_sequence?: never;
-            save_state?: never;
-            request_state?: boolean;
-            response_state?: never;
-        } | {
-            sequence?: never;
-            broadcast_sequence?: never;
-            save_state?: never;
-            request_state?: never;
-            response_state?: State;
-        })))) {
+    export class TaskStack extends pb_1.Message {
+        #one_of_decls: number[][] = [];
+        constructor(data?: any[] | {
+            name?: string;
+            free?: number;
+        }) {
             super();
             pb_1.Message.initialize(this, Array.isArray(data) ? data : [], 0, -1, [], this.#one_of_decls);
             if (!Array.isArray(data) && typeof data == "object") {
-                if ("sequence" in data && data.sequence != undefined) {
-                    this.sequence = data.sequence;
-                }
-                if ("broadcast_sequence" in data && data.broadcast_sequence != undefined) {
-                    this.broadcast_sequence = data.broadcast_sequence;
-                }
-                if ("save_state" in data && data.save_state != undefined) {
-                    this.save_state = data.save_state;
+                if ("name" in data && data.name != undefined) {
+                    this.name = data.name;
                 }
-                if ("request_state" in data && data.request_state != undefined) {
-                    this.request_state = data.request_state;
-                }
-                if ("response_state" in data && data.response_state != undefined) {
-                    this.response_state = data.response_state;
+                if ("free" in data && data.free != undefined) {
+                    this.free = data.free;
                 }
             }
         }
-        get sequence() {
-            return pb_1.Message.getWrapperField(this, Sequence, 1) as Sequence;
-        }
-        set sequence(value: Sequence) {
-            pb_1.Message.setOneofWrapperField(this, 1, this.#one_of_decls[0], value);
-        }
-        get has_sequence() {
-            return pb_1.Message.getField(this, 1) != null;
-        }
-        get broadcast_sequence() {
-            return pb_1.Message.getWrapperField(this, BroadcastSequence, 2) as BroadcastSequence;
-        }
-        set broadcast_sequence(value: BroadcastSequence) {
-            pb_1.Message.setOneofWrapperField(this, 2, this.#one_of_decls[0], value);
-        }
-        get has_broadcast_sequence() {
-            return pb_1.Message.getField(this, 2) != null;
-        }
-        get save_state() {
-            return pb_1.Message.getWrapperField(this, State, 3) as State;
-        }
-        set save_state(value: State) {
-            pb_1.Message.setOneofWrapperField(this, 3, this.#one_of_decls[0], value);
-        }
-        get has_save_state() {
-            return pb_1.Message.getField(this, 3) != null;
-        }
-        get request_state() {
-            return pb_1.Message.getFieldWithDefault(this, 4, false) as boolean;
-        }
-        set request_state(value: boolean) {
-            pb_1.Message.setOneofField(this, 4, this.#one_of_decls[0], value);
-        }
-        get has_request_state() {
-            return pb_1.Message.getField(this, 4) != null;
-        }
-        get response_state() {
-            return pb_1.Message.getWrapperField(this, State, 5) as State;
+        get name() {
+            return pb_1.Message.getFieldWithDefault(this, 1, "") as string;
         }
-        set response_state(value: State) {
-            pb_1.Message.setOneofWrapperField(this, 5, this.#one_of_decls[0], value);
+        set name(value: string) {
+            pb_1.Message.setField(this, 1, value);
         }
-        get has_response_state() {
-            return pb_1.Message.getField(this, 5) != null;
+        get free() {
+            return pb_1.Message.getFieldWithDefault(this, 2, 0) as number;
         }
-        get payload() {
-            const cases: {
-                [index: number]: "none" | "sequence" | "broadcast_sequence" | "save_state" | "request_state" | "response_state";
-            } = {
-                0: "none",
-                1: "sequence",
-                2: "broadcast_sequence",
-                3: "save_state",
-                4: "request_state",
-                5: "response_state"
-            };
-            return cases[pb_1.Message.computeOneofCase(this, [1, 2, 3, 4, 5])];
+        set free(value: number) {
+            pb_1.Message.setField(this, 2, value);
         }
         static fromObject(data: {
-            sequence?: ReturnType<typeof Sequence.prototype.toObject>;
-            broadcast_sequence?: ReturnType<typeof BroadcastSequence.prototype.toObject>;
-            save_state?: ReturnType<typeof State.prototype.toObject>;
-            request_state?: boolean;
-            response_state?: ReturnType<typeof State.prototype.toObject>;
-        }): Message {
-            const message = new Message({});
-            if (data.sequence != null) {
-                message.sequence = Sequence.fromObject(data.sequence);
-            }
-            if (data.broadcast_sequence != null) {
-                message.broadcast_sequence = BroadcastSequence.fromObject(data.broadcast_sequence);
-            }
-            if (data.save_state != null) {
-                message.save_state = State.fromObject(data.save_state);
-            }
-            if (data.request_state != null) {
-                message.request_state = data.request_state;
+            name?: string;
+            free?: number;
+        }): TaskStack {
+            const message = new TaskStack({});
+            if (data.name != null) {
+                message.name = data.name;
             }
-            if (data.response_state != null) {
-                message.response_state = State.fromObject(data.response_state);
+            if (data.free != null) {
+                message.free = data.free;
             }
             return message;
         }
         toObject() {
             const data: {
-                sequence?: ReturnType<typeof Sequence.prototype.toObject>;
-                broadcast_sequence?: ReturnType<typeof BroadcastSequence.prototype.toObject>;
-                save_state?: ReturnType<typeof State.prototype.toObject>;
-                request_state?: boolean;
-                response_state?: ReturnType<typeof State.prototype.toObject>;
+                name?: string;
+                free?: number;
             } = {};
-            if (this.sequence != null) {
-                data.sequence = this.sequence.toObject();
-            }
-            if (this.broadcast_sequence != null) {
-                data.broadcast_sequence = this.broadcast_sequence.toObject();
-            }
-            if (this.save_state != null) {
-                data.save_state = this.save_state.toObject();
+            if (this.name != null) {
+                data.name = this.name;
             }
-            if (this.request_state != null) {
-                data.request_state = this.request_state;
-            }
-            if (this.response_state != null) {
-                data.response_state = this.response_state.toObject();
+            if (this.free != null) {
+                data.free = this.free;
             }
             return data;
         }
@@ -948,39 +975,1129 @@ export namespace protocol {
         serialize(w: pb_1.BinaryWriter): void;
         serialize(w?: pb_1.BinaryWriter): Uint8Array | void {
             const writer = w || new pb_1.BinaryWriter();
-            if (this.has_sequence)
-                writer.writeMessage(1, this.sequence, () => this.sequence.serialize(writer));
-            if (this.has_broadcast_sequence)
-                writer.writeMessage(2, this.broadcast_sequence, () => this.broadcast_sequence.serialize(writer));
-            if (this.has_save_state)
-                writer.writeMessage(3, this.save_state, () => this.save_state.serialize(writer));
-            if (this.has_request_state)
-                writer.writeBool(4, this.request_state);
-            if (this.has_response_state)
-                writer.writeMessage(5, this.response_state, () => this.response_state.serialize(writer));
+            if (this.name.length)
+                writer.writeString(1, this.name);
+            if (this.free != 0)
+                writer.writeUint32(2, this.free);
             if (!w)
                 return writer.getResultBuffer();
         }
-        static deserialize(bytes: Uint8Array | pb_1.BinaryReader): Message {
-            const reader = bytes instanceof pb_1.BinaryReader ? bytes : new pb_1.BinaryReader(bytes), message = new Message();
+        static deserialize(bytes: Uint8Array | pb_1.BinaryReader): TaskStack {
+            const reader = bytes instanceof pb_1.BinaryReader ? bytes : new pb_1.BinaryReader(bytes), message = new TaskStack();
             while (reader.nextField()) {
                 if (reader.isEndGroup())
                     break;
                 switch (reader.getFieldNumber()) {
                     case 1:
-                        reader.readMessage(message.sequence, () => message.sequence = Sequence.deserialize(reader));
+                        message.name = reader.readString();
                         break;
                     case 2:
-                        reader.readMessage(message.broadcast_sequence, () => message.broadcast_sequence = BroadcastSequence.deserialize(reader));
-                        break;
-                    case 3:
-                        reader.readMessage(message.save_state, () => message.save_state = State.deserialize(reader));
-                        break;
-                    case 4:
-                        message.request_state = reader.readBool();
+                        message.free = reader.readUint32();
                         break;
-                    case 5:
-                        reader.readMessage(message.response_state, () => message.response_state = State.deserialize(reader));
+                    default: reader.skipField();
+                }
+            }
+            return message;
+        }
+        serializeBinary(): Uint8Array {
+            return this.serialize();
+        }
+        static deserializeBinary(bytes: Uint8Array): TaskStack {
+            return TaskStack.deserialize(bytes);
+        }
+    }
+    export class LinkCounters extends pb_1.Message {
+        #one_of_decls: number[][] = [];
+        constructor(data?: any[] | {
+            sent?: number;
+            received?: number;
+            retransmits?: number;
+            lost?: number;
+            reassembly_timeouts?: number;
+            crc_errors?: number;
+            decode_errors?: number;
+        }) {
+            super();
+            pb_1.Message.initialize(this, Array.isArray(data) ? data : [], 0, -1, [], this.#one_of_decls);
+            if (!Array.isArray(data) && typeof data == "object") {
+                if ("sent" in data && data.sent != undefined) {
+                    this.sent = data.sent;
+                }
+                if ("received" in data && data.received != undefined) {
+                    this.received = data.received;
+                }
+                if ("retransmits" in data && data.retransmits != undefined) {
+                    this.retransmits = data.retransmits;
+                }
+                if ("lost" in data && data.lost != undefined) {
+                    this.lost = data.lost;
+                }
+                if ("reassembly_timeouts" in data && data.reassembly_timeouts != undefined) {
+                    this.reassembly_timeouts = data.reassembly_timeouts;
+                }
+                if ("crc_errors" in data && data.crc_errors != undefined) {
+                    this.crc_errors = data.crc_errors;
+                }
+                if ("decode_errors" in data && data.decode_errors != undefined) {
+                    this.decode_errors = data.decode_errors;
+                }
+            }
+        }
+        get sent() {
+            return pb_1.Message.getFieldWithDefault(this, 1, 0) as number;
+        }
+        set sent(value: number) {
+            pb_1.Message.setField(this, 1, value);
+        }
+        get received() {
+            return pb_1.Message.getFieldWithDefault(this, 2, 0) as number;
+        }
+        set received(value: number) {
+            pb_1.Message.setField(this, 2, value);
+        }
+        get retransmits() {
+            return pb_1.Message.getFieldWithDefault(this, 3, 0) as number;
+        }
+        set retransmits(value: number) {
+            pb_1.Message.setField(this, 3, value);
+        }
+        get lost() {
+            return pb_1.Message.getFieldWithDefault(this, 4, 0) as number;
+        }
+        set lost(value: number) {
+            pb_1.Message.setField(this, 4, value);
+        }
+        get reassembly_timeouts() {
+            return pb_1.Message.getFieldWithDefault(this, 5, 0) as number;
+        }
+        set reassembly_timeouts(value: number) {
+            pb_1.Message.setField(this, 5, value);
+        }
+        get crc_errors() {
+            return pb_1.Message.getFieldWithDefault(this, 6, 0) as number;
+        }
+        set crc_errors(value: number) {
+            pb_1.Message.setField(this, 6, value);
+        }
+        get decode_errors() {
+            return pb_1.Message.getFieldWithDefault(this, 7, 0) as number;
+        }
+        set decode_errors(value: number) {
+            pb_1.Message.setField(this, 7, value);
+        }
+        static fromObject(data: {
+            sent?: number;
+            received?: number;
+            retransmits?: number;
+            lost?: number;
+            reassembly_timeouts?: number;
+            crc_errors?: number;
+            decode_errors?: number;
+        }): LinkCounters {
+            const message = new LinkCounters({});
+            if (data.sent != null) {
+                message.sent = data.sent;
+            }
+            if (data.received != null) {
+                message.received = data.received;
+            }
+            if (data.retransmits != null) {
+                message.retransmits = data.retransmits;
+            }
+            if (data.lost != null) {
+                message.lost = data.lost;
+            }
+            if (data.reassembly_timeouts != null) {
+                message.reassembly_timeouts = data.reassembly_timeouts;
+            }
+            if (data.crc_errors != null) {
+                message.crc_errors = data.crc_errors;
+            }
+            if (data.decode_errors != null) {
+                message.decode_errors = data.decode_errors;
+            }
+            return message;
+        }
+        toObject() {
+            const data: {
+                sent?: number;
+                received?: number;
+                retransmits?: number;
+                lost?: number;
+                reassembly_timeouts?: number;
+                crc_errors?: number;
+                decode_errors?: number;
+            } = {};
+            if (this.sent != null) {
+                data.sent = this.sent;
+            }
+            if (this.received != null) {
+                data.received = this.received;
+            }
+            if (this.retransmits != null) {
+                data.retransmits = this.retransmits;
+            }
+            if (this.lost != null) {
+                data.lost = this.lost;
+            }
+            if (this.reassembly_timeouts != null) {
+                data.reassembly_timeouts = this.reassembly_timeouts;
+            }
+            if (this.crc_errors != null) {
+                data.crc_errors = this.crc_errors;
+            }
+            if (this.decode_errors != null) {
+                data.decode_errors = this.decode_errors;
+            }
+            return data;
+        }
+        serialize(): Uint8Array;
+        serialize(w: pb_1.BinaryWriter): void;
+        serialize(w?: pb_1.BinaryWriter): Uint8Array | void {
+            const writer = w || new pb_1.BinaryWriter();
+            if (this.sent != 0)
+                writer.writeUint32(1, this.sent);
+            if (this.received != 0)
+                writer.writeUint32(2, this.received);
+            if (this.retransmits != 0)
+                writer.writeUint32(3, this.retransmits);
+            if (this.lost != 0)
+                writer.writeUint32(4, this.lost);
+            if (this.reassembly_timeouts != 0)
+                writer.writeUint32(5, this.reassembly_timeouts);
+            if (this.crc_errors != 0)
+                writer.writeUint32(6, this.crc_errors);
+            if (this.decode_errors != 0)
+                writer.writeUint32(7, this.decode_errors);
+            if (!w)
+                return writer.getResultBuffer();
+        }
+        static deserialize(bytes: Uint8Array | pb_1.BinaryReader): LinkCounters {
+            const reader = bytes instanceof pb_1.BinaryReader ? bytes : new pb_1.BinaryReader(bytes), message = new LinkCounters();
+            while (reader.nextField()) {
+                if (reader.isEndGroup())
+                    break;
+                switch (reader.getFieldNumber()) {
+                    case 1:
+                        message.sent = reader.readUint32();
+                        break;
+                    case 2:
+                        message.received = reader.readUint32();
+                        break;
+                    case 3:
+                        message.retransmits = reader.readUint32();
+                        break;
+                    case 4:
+                        message.lost = reader.readUint32();
+                        break;
+                    case 5:
+                        message.reassembly_timeouts = reader.readUint32();
+                        break;
+                    case 6:
+                        message.crc_errors = reader.readUint32();
+                        break;
+                    case 7:
+                        message.decode_errors = reader.readUint32();
+                        break;
+                    default: reader.skipField();
+                }
+            }
+            return message;
+        }
+        serializeBinary(): Uint8Array {
+            return this.serialize();
+        }
+        static deserializeBinary(bytes: Uint8Array): LinkCounters {
+            return LinkCounters.deserialize(bytes);
+        }
+    }
+    export class LinkStats extends pb_1.Message {
+        #one_of_decls: number[][] = [];
+        constructor(data?: any[] | {
+            link?: Link;
+            total?: LinkCounters;
+            per_minute?: LinkCounters;
+        }) {
+            super();
+            pb_1.Message.initialize(this, Array.isArray(data) ? data : [], 0, -1, [], this.#one_of_decls);
+            if (!Array.isArray(data) && typeof data == "object") {
+                if ("link" in data && data.link != undefined) {
+                    this.link = data.link;
+                }
+                if ("total" in data && data.total != undefined) {
+                    this.total = data.total;
+                }
+                if ("per_minute" in data && data.per_minute != undefined) {
+                    this.per_minute = data.per_minute;
+                }
+            }
+        }
+        get link() {
+            return pb_1.Message.getFieldWithDefault(this, 1, Link.RadioLink) as Link;
+        }
+        set link(value: Link) {
+            pb_1.Message.setField(this, 1, value);
+        }
+        get total() {
+            return pb_1.Message.getWrapperField(this, LinkCounters, 2) as LinkCounters;
+        }
+        set total(value: LinkCounters) {
+            pb_1.Message.setWrapperField(this, 2, value);
+        }
+        get has_total() {
+            return pb_1.Message.getField(this, 2) != null;
+        }
+        get per_minute() {
+            return pb_1.Message.getWrapperField(this, LinkCounters, 3) as LinkCounters;
+        }
+        set per_minute(value: LinkCounters) {
+            pb_1.Message.setWrapperField(this, 3, value);
+        }
+        get has_per_minute() {
+            return pb_1.Message.getField(this, 3) != null;
+        }
+        static fromObject(data: {
+            link?: Link;
+            total?: ReturnType<typeof LinkCounters.prototype.toObject>;
+            per_minute?: ReturnType<typeof LinkCounters.prototype.toObject>;
+        }): LinkStats {
+            const message = new LinkStats({});
+            if (data.link != null) {
+                message.link = data.link;
+            }
+            if (data.total != null) {
+                message.total = LinkCounters.fromObject(data.total);
+            }
+            if (data.per_minute != null) {
+                message.per_minute = LinkCounters.fromObject(data.per_minute);
+            }
+            return message;
+        }
+        toObject() {
+            const data: {
+                link?: Link;
+                total?: ReturnType<typeof LinkCounters.prototype.toObject>;
+                per_minute?: ReturnType<typeof LinkCounters.prototype.toObject>;
+            } = {};
+            if (this.link != null) {
+                data.link = this.link;
+            }
+            if (this.total != null) {
+                data.total = this.total.toObject();
+            }
+            if (this.per_minute != null) {
+                data.per_minute = this.per_minute.toObject();
+            }
+            return data;
+        }
+        serialize(): Uint8Array;
+        serialize(w: pb_1.BinaryWriter): void;
+        serialize(w?: pb_1.BinaryWriter): Uint8Array | void {
+            const writer = w || new pb_1.BinaryWriter();
+            if (this.link != Link.RadioLink)
+                writer.writeEnum(1, this.link);
+            if (this.has_total)
+                writer.writeMessage(2, this.total, () => this.total.serialize(writer));
+            if (this.has_per_minute)
+                writer.writeMessage(3, this.per_minute, () => this.per_minute.serialize(writer));
+            if (!w)
+                return writer.getResultBuffer();
+        }
+        static deserialize(bytes: Uint8Array | pb_1.BinaryReader): LinkStats {
+            const reader = bytes instanceof pb_1.BinaryReader ? bytes : new pb_1.BinaryReader(bytes), message = new LinkStats();
+            while (reader.nextField()) {
+                if (reader.isEndGroup())
+                    break;
+                switch (reader.getFieldNumber()) {
+                    case 1:
+                        message.link = reader.readEnum();
+                        break;
+                    case 2:
+                        reader.readMessage(message.total, () => message.total = LinkCounters.deserialize(reader));
+                        break;
+                    case 3:
+                        reader.readMessage(message.per_minute, () => message.per_minute = LinkCounters.deserialize(reader));
+                        break;
+                    default: reader.skipField();
+                }
+            }
+            return message;
+        }
+        serializeBinary(): Uint8Array {
+            return this.serialize();
+        }
+        static deserializeBinary(bytes: Uint8Array): LinkStats {
+            return LinkStats.deserialize(bytes);
+        }
+    }
+    export class Diagnostics extends pb_1.Message {
+        #one_of_decls: number[][] = [];
+        constructor(data?: any[] | {
+            uptime?: number;
+            free_heap?: number;
+            largest_free_block?: number;
+            min_free_heap?: number;
+            stacks?: TaskStack[];
+            allocations?: SubsystemAllocations[];
+            dedupe_hits?: number;
+            dedupe_misses?: number;
+            links?: LinkStats[];
+        }) {
+            super();
+            pb_1.Message.initialize(this, Array.isArray(data) ? data : [], 0, -1, [5, 6, 9], this.#one_of_decls);
+            if (!Array.isArray(data) && typeof data == "object") {
+                if ("uptime" in data && data.uptime != undefined) {
+                    this.uptime = data.uptime;
+                }
+                if ("free_heap" in data && data.free_heap != undefined) {
+                    this.free_heap = data.free_heap;
+                }
+                if ("largest_free_block" in data && data.largest_free_block != undefined) {
+                    this.largest_free_block = data.largest_free_block;
+                }
+                if ("min_free_heap" in data && data.min_free_heap != undefined) {
+                    this.min_free_heap = data.min_free_heap;
+                }
+                if ("stacks" in data && data.stacks != undefined) {
+                    this.stacks = data.stacks;
+                }
+                if ("allocations" in data && data.allocations != undefined) {
+                    this.allocations = data.allocations;
+                }
+                if ("dedupe_hits" in data && data.dedupe_hits != undefined) {
+                    this.dedupe_hits = data.dedupe_hits;
+                }
+                if ("dedupe_misses" in data && data.dedupe_misses != undefined) {
+                    this.dedupe_misses = data.dedupe_misses;
+                }
+                if ("links" in data && data.links != undefined) {
+                    this.links = data.links;
+                }
+            }
+        }
+        get uptime() {
+            return pb_1.Message.getFieldWithDefault(this, 1, 0) as number;
+        }
+        set uptime(value: number) {
+            pb_1.Message.setField(this, 1, value);
+        }
+        get free_heap() {
+            return pb_1.Message.getFieldWithDefault(this, 2, 0) as number;
+        }
+        set free_heap(value: number) {
+            pb_1.Message.setField(this, 2, value);
+        }
+        get largest_free_block() {
+            return pb_1.Message.getFieldWithDefault(this, 3, 0) as number;
+        }
+        set largest_free_block(value: number) {
+            pb_1.Message.setField(this, 3, value);
+        }
+        get min_free_heap() {
+            return pb_1.Message.getFieldWithDefault(this, 4, 0) as number;
+        }
+        set min_free_heap(value: number) {
+            pb_1.Message.setField(this, 4, value);
+        }
+        get stacks() {
+            return pb_1.Message.getRepeatedWrapperField(this, TaskStack, 5) as TaskStack[];
+        }
+        set stacks(value: TaskStack[]) {
+            pb_1.Message.setRepeatedWrapperField(this, 5, value);
+        }
+        get allocations() {
+            return pb_1.Message.getRepeatedWrapperField(this, SubsystemAllocations, 6) as SubsystemAllocations[];
+        }
+        set allocations(value: SubsystemAllocations[]) {
+            pb_1.Message.setRepeatedWrapperField(this, 6, value);
+        }
+        get dedupe_hits() {
+            return pb_1.Message.getFieldWithDefault(this, 7, 0) as number;
+        }
+        set dedupe_hits(value: number) {
+            pb_1.Message.setField(this, 7, value);
+        }
+        get dedupe_misses() {
+            return pb_1.Message.getFieldWithDefault(this, 8, 0) as number;
+        }
+        set dedupe_misses(value: number) {
+            pb_1.Message.setField(this, 8, value);
+        }
+        get links() {
+            return pb_1.Message.getRepeatedWrapperField(this, LinkStats, 9) as LinkStats[];
+        }
+        set links(value: LinkStats[]) {
+            pb_1.Message.setRepeatedWrapperField(this, 9, value);
+        }
+        static fromObject(data: {
+            uptime?: number;
+            free_heap?: number;
+            largest_free_block?: number;
+            min_free_heap?: number;
+            stacks?: ReturnType<typeof TaskStack.prototype.toObject>[];
+            allocations?: ReturnType<typeof SubsystemAllocations.prototype.toObject>[];
+            dedupe_hits?: number;
+            dedupe_misses?: number;
+            links?: ReturnType<typeof LinkStats.prototype.toObject>[];
+        }): Diagnostics {
+            const message = new Diagnostics({});
+            if (data.uptime != null) {
+                message.uptime = data.uptime;
+            }
+            if (data.free_heap != null) {
+                message.free_heap = data.free_heap;
+            }
+            if (data.largest_free_block != null) {
+                message.largest_free_block = data.largest_free_block;
+            }
+            if (data.min_free_heap != null) {
+                message.min_free_heap = data.min_free_heap;
+            }
+            if (data.stacks != null) {
+                message.stacks = data.stacks.map(item => TaskStack.fromObject(item));
+            }
+            if (data.allocations != null) {
+                message.allocations = data.allocations.map(item => SubsystemAllocations.fromObject(item));
+            }
+            if (data.dedupe_hits != null) {
+                message.dedupe_hits = data.dedupe_hits;
+            }
+            if (data.dedupe_misses != null) {
+                message.dedupe_misses = data.dedupe_misses;
+            }
+            if (data.links != null) {
+                message.links = data.links.map(item => LinkStats.fromObject(item));
+            }
+            return message;
+        }
+        toObject() {
+            const data: {
+                uptime?: number;
+                free_heap?: number;
+                largest_free_block?: number;
+                min_free_heap?: number;
+                stacks?: ReturnType<typeof TaskStack.prototype.toObject>[];
+                allocations?: ReturnType<typeof SubsystemAllocations.prototype.toObject>[];
+                dedupe_hits?: number;
+                dedupe_misses?: number;
+                links?: ReturnType<typeof LinkStats.prototype.toObject>[];
+            } = {};
+            if (this.uptime != null) {
+                data.uptime = this.uptime;
+            }
+            if (this.free_heap != null) {
+                data.free_heap = this.free_heap;
+            }
+            if (this.largest_free_block != null) {
+                data.largest_free_block = this.largest_free_block;
+            }
+            if (this.min_free_heap != null) {
+                data.min_free_heap = this.min_free_heap;
+            }
+            if (this.stacks != null) {
+                data.stacks = this.stacks.map((item: TaskStack) => item.toObject());
+            }
+            if (this.allocations != null) {
+                data.allocations = this.allocations.map((item: SubsystemAllocations) => item.toObject());
+            }
+            if (this.dedupe_hits != null) {
+                data.dedupe_hits = this.dedupe_hits;
+            }
+            if (this.dedupe_misses != null) {
+                data.dedupe_misses = this.dedupe_misses;
+            }
+            if (this.links != null) {
+                data.links = this.links.map((item: LinkStats) => item.toObject());
+            }
+            return data;
+        }
+        serialize(): Uint8Array;
+        serialize(w: pb_1.BinaryWriter): void;
+        serialize(w?: pb_1.BinaryWriter): Uint8Array | void {
+            const writer = w || new pb_1.BinaryWriter();
+            if (this.uptime != 0)
+                writer.writeUint32(1, this.uptime);
+            if (this.free_heap != 0)
+                writer.writeUint32(2, this.free_heap);
+            if (this.largest_free_block != 0)
+                writer.writeUint32(3, this.largest_free_block);
+            if (this.min_free_heap != 0)
+                writer.writeUint32(4, this.min_free_heap);
+            if (this.stacks.length)
+                writer.writeRepeatedMessage(5, this.stacks, (item: TaskStack) => item.serialize(writer));
+            if (this.allocations.length)
+                writer.writeRepeatedMessage(6, this.allocations, (item: SubsystemAllocations) => item.serialize(writer));
+            if (this.dedupe_hits != 0)
+                writer.writeUint32(7, this.dedupe_hits);
+            if (this.dedupe_misses != 0)
+                writer.writeUint32(8, this.dedupe_misses);
+            if (this.links.length)
+                writer.writeRepeatedMessage(9, this.links, (item: LinkStats) => item.serialize(writer));
+            if (!w)
+                return writer.getResultBuffer();
+        }
+        static deserialize(bytes: Uint8Array | pb_1.BinaryReader): Diagnostics {
+            const reader = bytes instanceof pb_1.BinaryReader ? bytes : new pb_1.BinaryReader(bytes), message = new Diagnostics();
+            while (reader.nextField()) {
+                if (reader.isEndGroup())
+                    break;
+                switch (reader.getFieldNumber()) {
+                    case 1:
+                        message.uptime = reader.readUint32();
+                        break;
+                    case 2:
+                        message.free_heap = reader.readUint32();
+                        break;
+                    case 3:
+                        message.largest_free_block = reader.readUint32();
+                        break;
+                    case 4:
+                        message.min_free_heap = reader.readUint32();
+                        break;
+                    case 5:
+                        reader.readMessage(message.stacks, () => pb_1.Message.addToRepeatedWrapperField(message, 5, TaskStack.deserialize(reader), TaskStack));
+                        break;
+                    case 6:
+                        reader.readMessage(message.allocations, () => pb_1.Message.addToRepeatedWrapperField(message, 6, SubsystemAllocations.deserialize(reader), SubsystemAllocations));
+                        break;
+                    case 7:
+                        message.dedupe_hits = reader.readUint32();
+                        break;
+                    case 8:
+                        message.dedupe_misses = reader.readUint32();
+                        break;
+                    case 9:
+                        reader.readMessage(message.links, () => pb_1.Message.addToRepeatedWrapperField(message, 9, LinkStats.deserialize(reader), LinkStats));
+                        break;
+                    default: reader.skipField();
+                }
+            }
+            return message;
+        }
+        serializeBinary(): Uint8Array {
+            return this.serialize();
+        }
+        static deserializeBinary(bytes: Uint8Array): Diagnostics {
+            return Diagnostics.deserialize(bytes);
+        }
+    }
+    export class State extends pb_1.Message {
+        #one_of_decls: number[][] = [];
+        constructor(data?: any[] | {
+            sequence?: Sequence;
+            settings?: Settings;
+            diagnostics?: Diagnostics;
+        }) {
+            super();
+            pb_1.Message.initialize(this, Array.isArray(data) ? data : [], 0, -1, [], this.#one_of_decls);
+            if (!Array.isArray(data) && typeof data == "object") {
+                if ("sequence" in data && data.sequence != undefined) {
+                    this.sequence = data.sequence;
+                }
+                if ("settings" in data && data.settings != undefined) {
+                    this.settings = data.settings;
+                }
+                if ("diagnostics" in data && data.diagnostics != undefined) {
+                    this.diagnostics = data.diagnostics;
+                }
+            }
+        }
+        get sequence() {
+            return pb_1.Message.getWrapperField(this, Sequence, 1) as Sequence;
+        }
+        set sequence(value: Sequence) {
+            pb_1.Message.setWrapperField(this, 1, value);
+        }
+        get has_sequence() {
+            return pb_1.Message.getField(this, 1) != null;
+        }
+        get settings() {
+            return pb_1.Message.getWrapperField(this, Settings, 2) as Settings;
+        }
+        set settings(value: Settings) {
+            pb_1.Message.setWrapperField(this, 2, value);
+        }
+        get has_settings() {
+            return pb_1.Message.getField(this, 2) != null;
+        }
+        get diagnostics() {
+            return pb_1.Message.getWrapperField(this, Diagnostics, 3) as Diagnostics;
+        }
+        set diagnostics(value: Diagnostics) {
+            pb_1.Message.setWrapperField(this, 3, value);
+        }
+        get has_diagnostics() {
+            return pb_1.Message.getField(this, 3) != null;
+        }
+        static fromObject(data: {
+            sequence?: ReturnType<typeof Sequence.prototype.toObject>;
+            settings?: ReturnType<typeof Settings.prototype.toObject>;
+            diagnostics?: ReturnType<typeof Diagnostics.prototype.toObject>;
+        }): State {
+            const message = new State({});
+            if (data.sequence != null) {
+                message.sequence = Sequence.fromObject(data.sequence);
+            }
+            if (data.settings != null) {
+                message.settings = Settings.fromObject(data.settings);
+            }
+            if (data.diagnostics != null) {
+                message.diagnostics = Diagnostics.fromObject(data.diagnostics);
+            }
+            return message;
+        }
+        toObject() {
+            const data: {
+                sequence?: ReturnType<typeof Sequence.prototype.toObject>;
+                settings?: ReturnType<typeof Settings.prototype.toObject>;
+                diagnostics?: ReturnType<typeof Diagnostics.prototype.toObject>;
+            } = {};
+            if (this.sequence != null) {
+                data.sequence = this.sequence.toObject();
+            }
+            if (this.settings != null) {
+                data.settings = this.settings.toObject();
+            }
+            if (this.diagnostics != null) {
+                data.diagnostics = this.diagnostics.toObject();
+            }
+            return data;
+        }
+        serialize(): Uint8Array;
+        serialize(w: pb_1.BinaryWriter): void;
+        serialize(w?: pb_1.BinaryWriter): Uint8Array | void {
+            const writer = w || new pb_1.BinaryWriter();
+            if (this.has_sequence)
+                writer.writeMessage(1, this.sequence, () => this.sequence.serialize(writer));
+            if (this.has_settings)
+                writer.writeMessage(2, this.settings, () => this.settings.serialize(writer));
+            if (this.has_diagnostics)
+                writer.writeMessage(3, this.diagnostics, () => this.diagnostics.serialize(writer));
+            if (!w)
+                return writer.getResultBuffer();
+        }
+        static deserialize(bytes: Uint8Array | pb_1.BinaryReader): State {
+            const reader = bytes instanceof pb_1.BinaryReader ? bytes : new pb_1.BinaryReader(bytes), message = new State();
+            while (reader.nextField()) {
+                if (reader.isEndGroup())
+                    break;
+                switch (reader.getFieldNumber()) {
+                    case 1:
+                        reader.readMessage(message.sequence, () => message.sequence = Sequence.deserialize(reader));
+                        break;
+                    case 2:
+                        reader.readMessage(message.settings, () => message.settings = Settings.deserialize(reader));
+                        break;
+                    case 3:
+                        reader.readMessage(message.diagnostics, () => message.diagnostics = Diagnostics.deserialize(reader));
+                        break;
+                    default: reader.skipField();
+                }
+            }
+            return message;
+        }
+        serializeBinary(): Uint8Array {
+            return this.serialize();
+        }
+        static deserializeBinary(bytes: Uint8Array): State {
+            return State.deserialize(bytes);
+        }
+    }
+    export class Patch extends pb_1.Message {
+        #one_of_decls: number[][] = [];
+        constructor(data?: any[] | {
+            animation?: number;
+            layer?: number;
+            field?: LayerField;
+            value?: number;
+            index?: number;
+        }) {
+            super();
+            pb_1.Message.initialize(this, Array.isArray(data) ? data : [], 0, -1, [], this.#one_of_decls);
+            if (!Array.isArray(data) && typeof data == "object") {
+                if ("animation" in data && data.animation != undefined) {
+                    this.animation = data.animation;
+                }
+                if ("layer" in data && data.layer != undefined) {
+                    this.layer = data.layer;
+                }
+                if ("field" in data && data.field != undefined) {
+                    this.field = data.field;
+                }
+                if ("value" in data && data.value != undefined) {
+                    this.value = data.value;
+                }
+                if ("index" in data && data.index != undefined) {
+                    this.index = data.index;
+                }
+            }
+        }
+        get animation() {
+            return pb_1.Message.getFieldWithDefault(this, 1, 0) as number;
+        }
+        set animation(value: number) {
+            pb_1.Message.setField(this, 1, value);
+        }
+        get layer() {
+            return pb_1.Message.getFieldWithDefault(this, 2, 0) as number;
+        }
+        set layer(value: number) {
+            pb_1.Message.setField(this, 2, value);
+        }
+        get field() {
+            return pb_1.Message.getFieldWithDefault(this, 3, LayerField.NoField) as LayerField;
+        }
+        set field(value: LayerField) {
+            pb_1.Message.setField(this, 3, value);
+        }
+        get value() {
+            return pb_1.Message.getFieldWithDefault(this, 4, 0) as number;
+        }
+        set value(value: number) {
+            pb_1.Message.setField(this, 4, value);
+        }
+        get index() {
+            return pb_1.Message.getFieldWithDefault(this, 5, 0) as number;
+        }
+        set index(value: number) {
+            pb_1.Message.setField(this, 5, value);
+        }
+        static fromObject(data: {
+            animation?: number;
+            layer?: number;
+            field?: LayerField;
+            value?: number;
+            index?: number;
+        }): Patch {
+            const message = new Patch({});
+            if (data.animation != null) {
+                message.animation = data.animation;
+            }
+            if (data.layer != null) {
+                message.layer = data.layer;
+            }
+            if (data.field != null) {
+                message.field = data.field;
+            }
+            if (data.value != null) {
+                message.value = data.value;
+            }
+            if (data.index != null) {
+                message.index = data.index;
+            }
+            return message;
+        }
+        toObject() {
+            const data: {
+                animation?: number;
+                layer?: number;
+                field?: LayerField;
+                value?: number;
+                index?: number;
+            } = {};
+            if (this.animation != null) {
+                data.animation = this.animation;
+            }
+            if (this.layer != null) {
+                data.layer = this.layer;
+            }
+            if (this.field != null) {
+                data.field = this.field;
+            }
+            if (this.value != null) {
+                data.value = this.value;
+            }
+            if (this.index != null) {
+                data.index = this.index;
+            }
+            return data;
+        }
+        serialize(): Uint8Array;
+        serialize(w: pb_1.BinaryWriter): void;
+        serialize(w?: pb_1.BinaryWriter): Uint8Array | void {
+            const writer = w || new pb_1.BinaryWriter();
+            if (this.animation != 0)
+                writer.writeUint32(1, this.animation);
+            if (this.layer != 0)
+                writer.writeUint32(2, this.layer);
+            if (this.field != LayerField.NoField)
+                writer.writeEnum(3, this.field);
+            if (this.value != 0)
+                writer.writeUint32(4, this.value);
+            if (this.index != 0)
+                writer.writeUint32(5, this.index);
+            if (!w)
+                return writer.getResultBuffer();
+        }
+        static deserialize(bytes: Uint8Array | pb_1.BinaryReader): Patch {
+            const reader = bytes instanceof pb_1.BinaryReader ? bytes : new pb_1.BinaryReader(bytes), message = new Patch();
+            while (reader.nextField()) {
+                if (reader.isEndGroup())
+                    break;
+                switch (reader.getFieldNumber()) {
+                    case 1:
+                        message.animation = reader.readUint32();
+                        break;
+                    case 2:
+                        message.layer = reader.readUint32();
+                        break;
+                    case 3:
+                        message.field = reader.readEnum();
+                        break;
+                    case 4:
+                        message.value = reader.readUint32();
+                        break;
+                    case 5:
+                        message.index = reader.readUint32();
+                        break;
+                    default: reader.skipField();
+                }
+            }
+            return message;
+        }
+        serializeBinary(): Uint8Array {
+            return this.serialize();
+        }
+        static deserializeBinary(bytes: Uint8Array): Patch {
+            return Patch.deserialize(bytes);
+        }
+    }
+    export class Message extends pb_1.Message {
+        #one_of_decls: number[][] = [[1, 2, 3, 4, 5, 6]];
+        constructor(data?: any[] | ({} & (({
+            sequence?: Sequence;
+            broadcast_sequence?: never;
+            save_state?: never;
+            request_state?: never;
+            response_state?: never;
+            patch?: never;
+        } | {
+            sequence?: never;
+            broadcast_sequence?: BroadcastSequence;
+            save_state?: never;
+            request_state?: never;
+            response_state?: never;
+            patch?: never;
+        } | {
+            sequence?: never;
+            broadcast_sequence?: never;
+            save_state?: State;
+            request_state?: never;
+            response_state?: never;
+            patch?: never;
+        } | {
+            sequence?: never;
+            broadcast_sequence?: never;
+            save_state?: never;
+            request_state?: boolean;
+            response_state?: never;
+            patch?: never;
+        } | {
+            sequence?: never;
+            broadcast_sequence?: never;
+            save_state?: never;
+            request_state?: never;
+            response_state?: State;
+            patch?: never;
+        } | {
+            sequence?: never;
+            broadcast_sequence?: never;
+            save_state?: never;
+            request_state?: never;
+            response_state?: never;
+            patch?: Patch;
+        })))) {
+            super();
+            pb_1.Message.initialize(this, Array.isArray(data) ? data : [], 0, -1, [], this.#one_of_decls);
+            if (!Array.isArray(data) && typeof data == "object") {
+                if ("sequence" in data && data.sequence != undefined) {
+                    this.sequence = data.sequence;
+                }
+                if ("broadcast_sequence" in data && data.broadcast_sequence != undefined) {
+                    this.broadcast_sequence = data.broadcast_sequence;
+                }
+                if ("save_state" in data && data.save_state != undefined) {
+                    this.save_state = data.save_state;
+                }
+                if ("request_state" in data && data.request_state != undefined) {
+                    this.request_state = data.request_state;
+                }
+                if ("response_state" in data && data.response_state != undefined) {
+                    this.response_state = data.response_state;
+                }
+                if ("patch" in data && data.patch != undefined) {
+                    this.patch = data.patch;
+                }
+            }
+        }
+        get sequence() {
+            return pb_1.Message.getWrapperField(this, Sequence, 1) as Sequence;
+        }
+        set sequence(value: Sequence) {
+            pb_1.Message.setOneofWrapperField(this, 1, this.#one_of_decls[0], value);
+        }
+        get has_sequence() {
+            return pb_1.Message.getField(this, 1) != null;
+        }
+        get broadcast_sequence() {
+            return pb_1.Message.getWrapperField(this, BroadcastSequence, 2) as BroadcastSequence;
+        }
+        set broadcast_sequence(value: BroadcastSequence) {
+            pb_1.Message.setOneofWrapperField(this, 2, this.#one_of_decls[0], value);
+        }
+        get has_broadcast_sequence() {
+            return pb_1.Message.getField(this, 2) != null;
+        }
+        get save_state() {
+            return pb_1.Message.getWrapperField(this, State, 3) as State;
+        }
+        set save_state(value: State) {
+            pb_1.Message.setOneofWrapperField(this, 3, this.#one_of_decls[0], value);
+        }
+        get has_save_state() {
+            return pb_1.Message.getField(this, 3) != null;
+        }
+        get request_state() {
+            return pb_1.Message.getFieldWithDefault(this, 4, false) as boolean;
+        }
+        set request_state(value: boolean) {
+            pb_1.Message.setOneofField(this, 4, this.#one_of_decls[0], value);
+        }
+        get has_request_state() {
+            return pb_1.Message.getField(this, 4) != null;
+        }
+        get response_state() {
+            return pb_1.Message.getWrapperField(this, State, 5) as State;
+        }
+        set response_state(value: State) {
+            pb_1.Message.setOneofWrapperField(this, 5, this.#one_of_decls[0], value);
+        }
+        get has_response_state() {
+            return pb_1.Message.getField(this, 5) != null;
+        }
+        get patch() {
+            return pb_1.Message.getWrapperField(this, Patch, 6) as Patch;
+        }
+        set patch(value: Patch) {
+            pb_1.Message.setOneofWrapperField(this, 6, this.#one_of_decls[0], value);
+        }
+        get has_patch() {
+            return pb_1.Message.getField(this, 6) != null;
+        }
+        get payload() {
+            const cases: {
+                [index: number]: "none" | "sequence" | "broadcast_sequence" | "save_state" | "request_state" | "response_state" | "patch";
+            } = {
+                0: "none",
+                1: "sequence",
+                2: "broadcast_sequence",
+                3: "save_state",
+                4: "request_state",
+                5: "response_state",
+                6: "patch"
+            };
+            return cases[pb_1.Message.computeOneofCase(this, [1, 2, 3, 4, 5, 6])];
+        }
+        static fromObject(data: {
+            sequence?: ReturnType<typeof Sequence.prototype.toObject>;
+            broadcast_sequence?: ReturnType<typeof BroadcastSequence.prototype.toObject>;
+            save_state?: ReturnType<typeof State.prototype.toObject>;
+            request_state?: boolean;
+            response_state?: ReturnType<typeof State.prototype.toObject>;
+            patch?: ReturnType<typeof Patch.prototype.toObject>;
+        }): Message {
+            const message = new Message({});
+            if (data.sequence != null) {
+                message.sequence = Sequence.fromObject(data.sequence);
+            }
+            if (data.broadcast_sequence != null) {
+                message.broadcast_sequence = BroadcastSequence.fromObject(data.broadcast_sequence);
+            }
+            if (data.save_state != null) {
+                message.save_state = State.fromObject(data.save_state);
+            }
+            if (data.request_state != null) {
+                message.request_state = data.request_state;
+            }
+            if (data.response_state != null) {
+                message.response_state = State.fromObject(data.response_state);
+            }
+            if (data.patch != null) {
+                message.patch = Patch.fromObject(data.patch);
+            }
+            return message;
+        }
+        toObject() {
+            const data: {
+                sequence?: ReturnType<typeof Sequence.prototype.toObject>;
+                broadcast_sequence?: ReturnType<typeof BroadcastSequence.prototype.toObject>;
+                save_state?: ReturnType<typeof State.prototype.toObject>;
+                request_state?: boolean;
+                response_state?: ReturnType<typeof State.prototype.toObject>;
+                patch?: ReturnType<typeof Patch.prototype.toObject>;
+            } = {};
+            if (this.sequence != null) {
+                data.sequence = this.sequence.toObject();
+            }
+            if (this.broadcast_sequence != null) {
+                data.broadcast_sequence = this.broadcast_sequence.toObject();
+            }
+            if (this.save_state != null) {
+                data.save_state = this.save_state.toObject();
+            }
+            if (this.request_state != null) {
+                data.request_state = this.request_state;
+            }
+            if (this.response_state != null) {
+                data.response_state = this.response_state.toObject();
+            }
+            if (this.patch != null) {
+                data.patch = this.patch.toObject();
+            }
+            return data;
+        }
+        serialize(): Uint8Array;
+        serialize(w: pb_1.BinaryWriter): void;
+        serialize(w?: pb_1.BinaryWriter): Uint8Array | void {
+            const writer = w || new pb_1.BinaryWriter();
+            if (this.has_sequence)
+                writer.writeMessage(1, this.sequence, () => this.sequence.serialize(writer));
+            if (this.has_broadcast_sequence)
+                writer.writeMessage(2, this.broadcast_sequence, () => this.broadcast_sequence.serialize(writer));
+            if (this.has_save_state)
+                writer.writeMessage(3, this.save_state, () => this.save_state.serialize(writer));
+            if (this.has_request_state)
+                writer.writeBool(4, this.request_state);
+            if (this.has_response_state)
+                writer.writeMessage(5, this.response_state, () => this.response_state.serialize(writer));
+            if (this.has_patch)
+                writer.writeMessage(6, this.patch, () => this.patch.serialize(writer));
+            if (!w)
+                return writer.getResultBuffer();
+        }
+        static deserialize(bytes: Uint8Array | pb_1.BinaryReader): Message {
+            const reader = bytes instanceof pb_1.BinaryReader ? bytes : new pb_1.BinaryReader(bytes), message = new Message();
+            while (reader.nextField()) {
+                if (reader.isEndGroup())
+                    break;
+                switch (reader.getFieldNumber()) {
+                    case 1:
+                        reader.readMessage(message.sequence, () => message.sequence = Sequence.deserialize(reader));
+                        break;
+                    case 2:
+                        reader.readMessage(message.broadcast_sequence, () => message.broadcast_sequence = BroadcastSequence.deserialize(reader));
+                        break;
+                    case 3:
+                        reader.readMessage(message.save_state, () => message.save_state = State.deserialize(reader));
+                        break;
+                    case 4:
+                        message.request_state = reader.readBool();
+                        break;
+                    case 5:
+                        reader.readMessage(message.response_state, () => message.response_state = State.deserialize(reader));
+                        break;
+                    case 6:
+                        reader.readMessage(message.patch, () => message.patch = Patch.deserialize(reader));
                         break;
                     default: reader.skipField();
                 }
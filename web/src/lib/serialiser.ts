@@ -41,11 +41,45 @@ export function convertUIModulesToProtocol(uiModules: Module[]): protocol.Sequen
     });
   });
 
+  const palette = applyPalette(animations.flatMap(animation => animation.layers));
+
   return new protocol.Sequence({
+    palette,
     animations
   })
 }
 
+// Must match PALETTE_MAX_SIZE in the firmware
+const PALETTE_MAX_SIZE = 64;
+
+// Move the colors of layers into a palette shared by the sequence, such that layers refer to
+// repeated colors with a 1-byte index. Returns an empty palette when no color is reused.
+function applyPalette(layers: protocol.Layer[]): number[] {
+  const palette: number[] = [];
+  const indexed: protocol.Layer[] = [];
+  let references = 0;
+
+  for (const layer of layers) {
+    if (!layer.colors.length) continue;
+
+    const added = layer.colors.filter((color, i) => !palette.includes(color) && layer.colors.indexOf(color) === i);
+    if (palette.length + added.length > PALETTE_MAX_SIZE) continue;
+
+    palette.push(...added);
+    indexed.push(layer);
+    references += layer.colors.length;
+  }
+
+  if (references <= palette.length) return [];
+
+  for (const layer of indexed) {
+    layer.color_indexes = new Uint8Array(layer.colors.map(color => palette.indexOf(color)));
+    layer.colors = [];
+  }
+
+  return palette;
+}
+
 
 
 const colorTypeToLayerType: Record<string, number> = {
@@ -1,14 +1,15 @@
 import { debounce } from 'lodash';
 import { defineStore } from 'pinia';
+import { encodeFrame, FrameDecoder, LOG_FRAME_MAGIC } from '@/lib/framing';
 
 
 interface SerialState {
   port: SerialPort | null;
-  reader: ReadableStreamDefaultReader<string> | null;
+  reader: ReadableStreamDefaultReader<Uint8Array> | null;
   writer: WritableStreamDefaultWriter<string> | null;
-  decoder: TextDecoderStream | null;
-  encoder: TextEncoderStream | null;
-  receivedData: string;
+  decoder: FrameDecoder | null;
+  receivedData: string; // Log lines of the controller
+  receivedFrame: Uint8Array | null; // Payload of the last response, a serialized protocol.Message
   isConnected: boolean;
   error: string | null;
 }
@@ -21,6 +22,7 @@ interface SerialActions {
   disconnectSerial(): Promise<void>;
 }
 
+const MAX_LOG_LENGTH = 10000; // Characters of log lines kept
 
 // Add the generic type to defineStore for type safety
 export const useSerialStore = defineStore<'serial', SerialState, {}, SerialActions>('serial', {
@@ -29,8 +31,8 @@ export const useSerialStore = defineStore<'serial', SerialState, {}, SerialActio
     reader: null,
     writer: null,
     decoder: null,
-    encoder: null,
     receivedData: '',
+    receivedFrame: null,
     isConnected: false,
     error: null,
   }),
@@ -43,26 +45,29 @@ export const useSerialStore = defineStore<'serial', SerialState, {}, SerialActio
 
         // Open the port with the specified baud rate
         await this.port.open({
-          baudRate: 115200,
+          baudRate: 2000000,
           dataBits: 8,
           stopBits: 1,
           parity: 'none',
           flowControl: 'none'
         });
-        console.log('Serial port opened at 115200 baud.');
-
-        // Set up encoding/decoding streams for reading only
-        this.decoder = new TextDecoderStream();
-
-        // Pipe readable stream through decoder for text data
-        this.port.readable.pipeTo(this.decoder.writable);
-
-        this.reader = this.decoder.readable.getReader();
-
+        console.log('Serial port opened at 2000000 baud.');
+
+        // Everything the controller writes is framed: log lines as well as responses
+        const textDecoder = new TextDecoder();
+        this.decoder = new FrameDecoder((payload) => {
+          if (payload[0] === LOG_FRAME_MAGIC) {
+            this.receivedData = (this.receivedData + textDecoder.decode(payload.subarray(1))).slice(-MAX_LOG_LENGTH);
+          } else {
+            this.receivedFrame = payload;
+          }
+        });
 
+        this.reader = this.port.readable.getReader();
 
         this.isConnected = true;
         this.receivedData = ''; // Clear previous data on new connection
+        this.receivedFrame = null;
 
         // Start reading from the port
         this.readSerial();
@@ -86,8 +91,8 @@ export const useSerialStore = defineStore<'serial', SerialState, {}, SerialActio
             console.log('Reader closed.');
             break;
           }
-          // Append received data to the state
-          this.receivedData = value;
+          // Bytes arrive in arbitrary chunks, frames are delivered once complete
+          this.decoder?.push(value);
         } catch (error) {
           console.error('Error reading from serial port:', error);
           this.error = 'Error reading from serial port.';
@@ -111,14 +116,11 @@ export const useSerialStore = defineStore<'serial', SerialState, {}, SerialActio
       }
 
       try {
-        const prependedData = new Uint8Array(data.length + 2);
-        prependedData[0] = data.length % 256;
-        prependedData[1] = 0;
-        prependedData.set(data, 2);
+        const frame = encodeFrame(data);
 
-        console.log("BEFORE WRITE", prependedData);
+        console.log("BEFORE WRITE", frame);
         const writer = this.port.writable.getWriter();
-        await writer.write(prependedData);
+        await writer.write(frame);
         writer.releaseLock();
 
       } catch (error) {